@@ -0,0 +1,210 @@
+#include "asset_pack.h"
+
+#include "hash.h"
+#include "lz4.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct AssetPack {
+    const uint8_t* data;
+    uint64_t size;
+    const AssetPackHeader* header;
+    const AssetPackRecord* records;
+    const char* names;
+
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+    std::atomic<uint64_t> views;
+    std::atomic<uint64_t> reads;
+    std::atomic<uint64_t> read_bytes;
+    std::atomic<uint64_t> read_ns;
+};
+
+static bool map_file(AssetPack* pack, const char* path)
+{
+#if defined(_WIN32)
+    pack->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (pack->file == INVALID_HANDLE_VALUE) { return false; }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(pack->file, &size) || size.QuadPart == 0) { return false; }
+    pack->mapping = CreateFileMappingA(pack->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!pack->mapping) { return false; }
+    pack->data = (const uint8_t*)MapViewOfFile(pack->mapping, FILE_MAP_READ, 0, 0, 0);
+    pack->size = (uint64_t)size.QuadPart;
+    return pack->data != NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) { return false; }
+    pack->data = (const uint8_t*)data;
+    pack->size = (uint64_t)info.st_size;
+    return true;
+#endif
+}
+
+static void unmap_file(AssetPack* pack)
+{
+#if defined(_WIN32)
+    if (pack->data) { UnmapViewOfFile(pack->data); }
+    if (pack->mapping) { CloseHandle(pack->mapping); }
+    if (pack->file != INVALID_HANDLE_VALUE) { CloseHandle(pack->file); }
+#else
+    if (pack->data) { munmap((void*)pack->data, (size_t)pack->size); }
+#endif
+}
+
+// Everything the lookups and reads rely on, so a truncated or foreign file is rejected up front.
+static bool validate(AssetPack* pack)
+{
+    if (pack->size < sizeof(AssetPackHeader)) { return false; }
+    const AssetPackHeader* header = (const AssetPackHeader*)pack->data;
+    if (header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION) { return false; }
+    if (header->file_size != pack->size) { return false; }
+
+    uint64_t directory_end = sizeof(AssetPackHeader) + (uint64_t)header->entry_count * sizeof(AssetPackRecord);
+    if (directory_end + header->names_size > pack->size) { return false; }
+    pack->header  = header;
+    pack->records = (const AssetPackRecord*)(pack->data + sizeof(AssetPackHeader));
+    pack->names   = (const char*)(pack->data + directory_end);
+    if (header->names_size && pack->names[header->names_size - 1] != '\0') { return false; }
+
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const AssetPackRecord* record = &pack->records[i];
+        if (record->offset > pack->size || record->stored_size > pack->size - record->offset) { return false; }
+        if (record->name >= header->names_size) { return false; }
+        if (record->compression > ASSET_COMPRESSION_LZ4) { return false; }
+        if (record->compression == ASSET_COMPRESSION_NONE && record->stored_size != record->size) { return false; }
+        if (i > 0 && record->key < pack->records[i - 1].key) { return false; }
+    }
+    return true;
+}
+
+static bool same_path(const char* a, const char* b)
+{
+    for (; *a && *b; a++, b++) {
+        char ca = *a == '\\' ? '/' : *a;
+        char cb = *b == '\\' ? '/' : *b;
+        if (ca != cb) { return false; }
+    }
+    return *a == *b;
+}
+
+AssetPack* asset_pack_open(const char* path)
+{
+    AssetPack* pack = new AssetPack();
+    pack->data      = NULL;
+    pack->size      = 0;
+#if defined(_WIN32)
+    pack->file    = INVALID_HANDLE_VALUE;
+    pack->mapping = NULL;
+#endif
+    if (!map_file(pack, path) || !validate(pack)) {
+        asset_pack_close(pack);
+        return NULL;
+    }
+    return pack;
+}
+
+void asset_pack_close(AssetPack* pack)
+{
+    if (!pack) { return; }
+    unmap_file(pack);
+    delete pack;
+}
+
+uint32_t asset_pack_count(const AssetPack* pack) { return pack->header->entry_count; }
+
+uint32_t asset_pack_find(const AssetPack* pack, const char* path)
+{
+    uint64_t key = hash_path(path);
+
+    uint32_t first = 0;
+    uint32_t count = pack->header->entry_count;
+    while (count > 0) {
+        uint32_t half = count / 2;
+        if (pack->records[first + half].key < key) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+
+    // Names that collide sit next to each other.
+    for (uint32_t i = first; i < pack->header->entry_count && pack->records[i].key == key; i++) {
+        if (same_path(pack->names + pack->records[i].name, path)) { return i; }
+    }
+    return ASSET_PACK_NOT_FOUND;
+}
+
+AssetPackEntry asset_pack_entry(const AssetPack* pack, uint32_t index)
+{
+    const AssetPackRecord* record = &pack->records[index];
+    AssetPackEntry entry;
+    entry.name        = pack->names + record->name;
+    entry.size        = record->size;
+    entry.stored_size = record->stored_size;
+    entry.compression = (AssetCompression)record->compression;
+    return entry;
+}
+
+const void* asset_pack_view(AssetPack* pack, uint32_t index)
+{
+    const AssetPackRecord* record = &pack->records[index];
+    if (record->compression != ASSET_COMPRESSION_NONE) { return NULL; }
+    pack->views.fetch_add(1, std::memory_order_relaxed);
+    return pack->data + record->offset;
+}
+
+bool asset_pack_read(AssetPack* pack, uint32_t index, void* destination, uint64_t size)
+{
+    const AssetPackRecord* record = &pack->records[index];
+    if (size != record->size) { return false; }
+
+    auto start          = std::chrono::steady_clock::now();
+    const uint8_t* data = pack->data + record->offset;
+    bool ok             = true;
+    if (record->compression == ASSET_COMPRESSION_LZ4) {
+        ok = lz4_decompress(data, (size_t)record->stored_size, destination, (size_t)size);
+    } else {
+        memcpy(destination, data, (size_t)size);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    pack->reads.fetch_add(1, std::memory_order_relaxed);
+    pack->read_bytes.fetch_add(ok ? size : 0, std::memory_order_relaxed);
+    pack->read_ns.fetch_add((uint64_t)elapsed.count(), std::memory_order_relaxed);
+    return ok;
+}
+
+AssetPackStats asset_pack_stats(const AssetPack* pack)
+{
+    AssetPackStats stats;
+    stats.entries      = pack->header->entry_count;
+    stats.mapped_bytes = pack->size;
+    stats.views        = pack->views.load(std::memory_order_relaxed);
+    stats.reads        = pack->reads.load(std::memory_order_relaxed);
+    stats.read_bytes   = pack->read_bytes.load(std::memory_order_relaxed);
+    stats.read_ns      = pack->read_ns.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A read only archive of assets, memory mapped in one go so that loading an asset is a lookup and a copy rather than
+// an open, a read and a close per file, and so that assets are found wherever the pack is rather than relative to the
+// working directory.
+//
+// The layout, all little endian:
+//     AssetPackHeader
+//     AssetPackRecord[entry_count]   sorted by key
+//     names                          NUL terminated, names_size bytes
+//     entry data                     each entry starts on an ASSET_PACK_ALIGNMENT boundary
+// Keys are hash_path() of the entry's name, its path relative to the packed root with forward slashes. Entries are
+// stored either raw, and can then be used straight from the mapping, or LZ4 compressed.
+#define ASSET_PACK_MAGIC 0x504c4757u // "WGLP"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 4096
+
+#define ASSET_PACK_NOT_FOUND UINT32_MAX
+
+typedef enum AssetCompression {
+    ASSET_COMPRESSION_NONE,
+    ASSET_COMPRESSION_LZ4,
+} AssetCompression;
+
+typedef struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t names_size;
+    uint64_t file_size;
+} AssetPackHeader;
+
+typedef struct AssetPackRecord {
+    uint64_t key;
+    uint64_t offset;
+    uint64_t stored_size;
+    uint64_t size;        // once decompressed
+    uint32_t compression; // AssetCompression
+    uint32_t name;        // offset into the names
+} AssetPackRecord;
+
+typedef struct AssetPack AssetPack;
+
+typedef struct AssetPackEntry {
+    const char* name;
+    uint64_t size;
+    uint64_t stored_size;
+    AssetCompression compression;
+} AssetPackEntry;
+
+typedef struct AssetPackStats {
+    uint32_t entries;
+    uint64_t mapped_bytes;
+    uint64_t views;      // zero copy lookups
+    uint64_t reads;      // copies and decompressions into caller buffers
+    uint64_t read_bytes; // written to caller buffers
+    uint64_t read_ns;    // spent in asset_pack_read()
+} AssetPackStats;
+
+// Maps the pack and checks its directory. Returns NULL if the file is missing or is not a valid pack.
+AssetPack* asset_pack_open(const char* path);
+void asset_pack_close(AssetPack* pack);
+
+uint32_t asset_pack_count(const AssetPack* pack);
+
+// Index of the entry with this name, or ASSET_PACK_NOT_FOUND. Either slash works as a separator.
+uint32_t asset_pack_find(const AssetPack* pack, const char* path);
+
+AssetPackEntry asset_pack_entry(const AssetPack* pack, uint32_t index);
+
+// The entry's bytes inside the mapping, valid until the pack is closed, or NULL if it is compressed.
+const void* asset_pack_view(AssetPack* pack, uint32_t index);
+
+// Copies or decompresses the entry into `destination`, which must be exactly the entry's size. Safe to call from
+// several threads at once.
+bool asset_pack_read(AssetPack* pack, uint32_t index, void* destination, uint64_t size);
+
+AssetPackStats asset_pack_stats(const AssetPack* pack);
+
+#ifdef __cplusplus
+}
+#endif
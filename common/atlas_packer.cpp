@@ -0,0 +1,274 @@
+#include "atlas_packer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#define ATLAS_DEFAULT_PAGE_SIZE 2048u
+
+typedef struct PackRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} PackRect;
+
+typedef struct AtlasPage {
+    std::vector<PackRect> free_rects;
+    uint64_t used_area;
+} AtlasPage;
+
+struct AtlasPacker {
+    AtlasPackerDesc desc;
+    std::vector<AtlasPage> pages;
+    uint32_t rects;
+
+    // Scratch for place(), kept to avoid reallocating on every insert.
+    std::vector<PackRect> split;
+};
+
+typedef struct Placement {
+    uint32_t page;
+    PackRect rect; // including padding
+    bool rotated;
+    int32_t short_side;
+    int32_t long_side;
+} Placement;
+
+static bool contains(const PackRect& outer, const PackRect& inner)
+{
+    return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width
+        && inner.y + inner.height <= outer.y + outer.height;
+}
+
+static bool intersects(const PackRect& a, const PackRect& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// Best short side fit: the free rect that leaves the least over on its tighter side, ties broken on the other side.
+static void score_page(const AtlasPage& page, uint32_t page_index, uint32_t width, uint32_t height, bool rotated,
+    Placement* best)
+{
+    for (const PackRect& free : page.free_rects) {
+        if (free.width < width || free.height < height) { continue; }
+
+        int32_t leftover_x = (int32_t)(free.width - width);
+        int32_t leftover_y = (int32_t)(free.height - height);
+        int32_t short_side = std::min(leftover_x, leftover_y);
+        int32_t long_side  = std::max(leftover_x, leftover_y);
+        if (short_side < best->short_side || (short_side == best->short_side && long_side < best->long_side)) {
+            best->page       = page_index;
+            best->rect       = { free.x, free.y, width, height };
+            best->rotated    = rotated;
+            best->short_side = short_side;
+            best->long_side  = long_side;
+        }
+    }
+}
+
+static void place(AtlasPacker* packer, AtlasPage* page, const PackRect& used)
+{
+    // Split every free rect the new one overlaps into the (up to four) maximal rects around it.
+    std::vector<PackRect>& split = packer->split;
+    split.clear();
+    for (size_t i = 0; i < page->free_rects.size();) {
+        PackRect free = page->free_rects[i];
+        if (!intersects(free, used)) {
+            i++;
+            continue;
+        }
+
+        if (used.x > free.x) { split.push_back({ free.x, free.y, used.x - free.x, free.height }); }
+        if (used.x + used.width < free.x + free.width) {
+            uint32_t right = used.x + used.width;
+            split.push_back({ right, free.y, free.x + free.width - right, free.height });
+        }
+        if (used.y > free.y) { split.push_back({ free.x, free.y, free.width, used.y - free.y }); }
+        if (used.y + used.height < free.y + free.height) {
+            uint32_t bottom = used.y + used.height;
+            split.push_back({ free.x, bottom, free.width, free.y + free.height - bottom });
+        }
+
+        page->free_rects[i] = page->free_rects.back();
+        page->free_rects.pop_back();
+    }
+
+    // Only the new rects can be redundant with anything, so there is no need to compare every pair.
+    for (size_t i = 0; i < split.size();) {
+        bool redundant = false;
+        for (size_t j = 0; j < split.size() && !redundant; j++) {
+            // Of two identical rects keep the later one.
+            redundant = j != i && contains(split[j], split[i]) && (j > i || !contains(split[i], split[j]));
+        }
+        for (size_t j = 0; j < page->free_rects.size() && !redundant; j++) {
+            redundant = contains(page->free_rects[j], split[i]);
+        }
+        if (redundant) {
+            split[i] = split.back();
+            split.pop_back();
+        } else {
+            i++;
+        }
+    }
+    for (size_t i = 0; i < page->free_rects.size();) {
+        bool redundant = false;
+        for (size_t j = 0; j < split.size() && !redundant; j++) {
+            redundant = contains(split[j], page->free_rects[i]);
+        }
+        if (redundant) {
+            page->free_rects[i] = page->free_rects.back();
+            page->free_rects.pop_back();
+        } else {
+            i++;
+        }
+    }
+    page->free_rects.insert(page->free_rects.end(), split.begin(), split.end());
+}
+
+static void open_page(AtlasPacker* packer)
+{
+    AtlasPage page;
+    page.free_rects.push_back({ 0, 0, packer->desc.page_width, packer->desc.page_height });
+    page.used_area = 0;
+    packer->pages.push_back(page);
+}
+
+AtlasPacker* atlas_packer_create(const AtlasPackerDesc* desc)
+{
+    AtlasPacker* packer = new AtlasPacker();
+    packer->desc        = *desc;
+    packer->rects       = 0;
+    if (!packer->desc.page_width) { packer->desc.page_width = ATLAS_DEFAULT_PAGE_SIZE; }
+    if (!packer->desc.page_height) { packer->desc.page_height = ATLAS_DEFAULT_PAGE_SIZE; }
+    return packer;
+}
+
+void atlas_packer_destroy(AtlasPacker* packer) { delete packer; }
+
+bool atlas_packer_insert(AtlasPacker* packer, uint32_t width, uint32_t height, AtlasRect* rect)
+{
+    memset(rect, 0, sizeof(*rect));
+
+    uint32_t padding       = packer->desc.padding;
+    uint32_t padded_width  = width + 2 * padding;
+    uint32_t padded_height = height + 2 * padding;
+    bool rotate            = packer->desc.allow_rotation && width != height;
+
+    bool fits         = padded_width <= packer->desc.page_width && padded_height <= packer->desc.page_height;
+    bool fits_rotated = rotate && padded_height <= packer->desc.page_width && padded_width <= packer->desc.page_height;
+    if (!width || !height || (!fits && !fits_rotated)) { return false; }
+
+    Placement best  = {};
+    best.short_side = INT_MAX;
+    best.long_side  = INT_MAX;
+    for (uint32_t i = 0; i < (uint32_t)packer->pages.size(); i++) {
+        score_page(packer->pages[i], i, padded_width, padded_height, false, &best);
+        if (rotate) { score_page(packer->pages[i], i, padded_height, padded_width, true, &best); }
+    }
+    if (best.short_side == INT_MAX) {
+        open_page(packer);
+        uint32_t page = (uint32_t)packer->pages.size() - 1;
+        score_page(packer->pages[page], page, padded_width, padded_height, false, &best);
+        if (rotate) { score_page(packer->pages[page], page, padded_height, padded_width, true, &best); }
+    }
+
+    AtlasPage* page = &packer->pages[best.page];
+    place(packer, page, best.rect);
+    page->used_area += (uint64_t)width * height;
+    packer->rects++;
+
+    rect->page    = best.page;
+    rect->x       = best.rect.x + padding;
+    rect->y       = best.rect.y + padding;
+    rect->width   = best.rect.width - 2 * padding;
+    rect->height  = best.rect.height - 2 * padding;
+    rect->rotated = best.rotated;
+    return true;
+}
+
+uint32_t atlas_packer_pack(AtlasPacker* packer, const AtlasSize* sizes, uint32_t count, AtlasRect* rects)
+{
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [sizes](uint32_t a, uint32_t b) {
+        uint32_t long_a = std::max(sizes[a].width, sizes[a].height);
+        uint32_t long_b = std::max(sizes[b].width, sizes[b].height);
+        if (long_a != long_b) { return long_a > long_b; }
+        return (uint64_t)sizes[a].width * sizes[a].height > (uint64_t)sizes[b].width * sizes[b].height;
+    });
+
+    uint32_t placed = 0;
+    for (uint32_t i : order) {
+        if (atlas_packer_insert(packer, sizes[i].width, sizes[i].height, &rects[i])) { placed++; }
+    }
+    return placed;
+}
+
+AtlasPackerStats atlas_packer_stats(const AtlasPacker* packer)
+{
+    AtlasPackerStats stats = {};
+    uint64_t page_area     = (uint64_t)packer->desc.page_width * packer->desc.page_height;
+    stats.pages            = (uint32_t)packer->pages.size();
+    stats.rects            = packer->rects;
+    stats.total_area       = page_area * stats.pages;
+    for (const AtlasPage& page : packer->pages) {
+        stats.used_area += page.used_area;
+    }
+    if (stats.pages) {
+        stats.efficiency           = (float)((double)stats.used_area / (double)stats.total_area);
+        stats.last_page_efficiency = (float)((double)packer->pages.back().used_area / (double)page_area);
+    }
+    return stats;
+}
+
+void atlas_blit(uint8_t* page, uint32_t page_width, uint32_t page_height, uint32_t channels, const AtlasRect* rect,
+    uint32_t padding, const uint8_t* pixels)
+{
+    // Source dimensions, before any rotation.
+    uint32_t source_width = rect->rotated ? rect->height : rect->width;
+
+    for (uint32_t y = 0; y < rect->height; y++) {
+        uint8_t* row = page + ((size_t)(rect->y + y) * page_width + rect->x) * channels;
+        if (!rect->rotated) {
+            memcpy(row, pixels + (size_t)y * source_width * channels, (size_t)rect->width * channels);
+            continue;
+        }
+        // Rotated clockwise: page column x comes from source row (width - 1 - x), page row y from source column y.
+        for (uint32_t x = 0; x < rect->width; x++) {
+            const uint8_t* texel = pixels + ((size_t)(rect->width - 1 - x) * source_width + y) * channels;
+            memcpy(row + (size_t)x * channels, texel, channels);
+        }
+    }
+
+    if (!padding) { return; }
+
+    // Extrude: every padding texel takes the value of the nearest edge texel.
+    int64_t left   = std::max<int64_t>(0, (int64_t)rect->x - padding);
+    int64_t top    = std::max<int64_t>(0, (int64_t)rect->y - padding);
+    int64_t right  = std::min<int64_t>(page_width, (int64_t)rect->x + rect->width + padding);
+    int64_t bottom = std::min<int64_t>(page_height, (int64_t)rect->y + rect->height + padding);
+    for (int64_t y = top; y < bottom; y++) {
+        int64_t source_y = std::min<int64_t>(std::max<int64_t>(y, rect->y), rect->y + rect->height - 1);
+        for (int64_t x = left; x < right; x++) {
+            bool inside = y == source_y && x >= rect->x && x < rect->x + rect->width;
+            if (inside) {
+                x = rect->x + rect->width - 1;
+                continue;
+            }
+            int64_t source_x = std::min<int64_t>(std::max<int64_t>(x, rect->x), rect->x + rect->width - 1);
+            const uint8_t* edge = page + ((size_t)source_y * page_width + source_x) * channels;
+            memcpy(page + ((size_t)y * page_width + x) * channels, edge, channels);
+        }
+    }
+}
+
+void atlas_rect_uv(const AtlasRect* rect, uint32_t page_width, uint32_t page_height, float uv[4])
+{
+    uv[0] = (float)rect->x / (float)page_width;
+    uv[1] = (float)rect->y / (float)page_height;
+    uv[2] = (float)(rect->x + rect->width) / (float)page_width;
+    uv[3] = (float)(rect->y + rect->height) / (float)page_height;
+}
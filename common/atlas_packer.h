@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Packs many small images into a few large pages so they can be drawn from one texture, using MaxRects with the best
+// short side fit heuristic. Works both offline, packing a whole set of images at once (sorted largest first, which
+// packs tighter), and at runtime, adding images one at a time as they turn up. A new page is opened whenever an image
+// does not fit in any of the existing ones.
+//
+// Every image is surrounded by `padding` texels that atlas_blit() fills by extruding its edges, so bilinear filtering
+// and the coarser mips sample the image's own border instead of its neighbours. Each mip halves the padding; 2^n
+// texels of padding keep the first n mips clean.
+typedef struct AtlasPacker AtlasPacker;
+
+typedef struct AtlasPackerDesc {
+    uint32_t page_width;  // 0 = 2048
+    uint32_t page_height; // 0 = 2048
+    uint32_t padding;     // texels around every image
+    bool allow_rotation;  // images may be stored rotated 90 degrees clockwise if they fit better
+} AtlasPackerDesc;
+
+// Where an image ended up. x, y, width and height cover the image itself, without padding, as stored in the page, so
+// a rotated image has its width and height swapped.
+typedef struct AtlasRect {
+    uint32_t page;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    bool rotated;
+} AtlasRect;
+
+typedef struct AtlasSize {
+    uint32_t width;
+    uint32_t height;
+} AtlasSize;
+
+typedef struct AtlasPackerStats {
+    uint32_t pages;
+    uint32_t rects;
+    uint64_t used_area;  // texels covered by images, padding not included
+    uint64_t total_area; // texels in all pages
+    float efficiency;    // used_area / total_area
+    float last_page_efficiency;
+} AtlasPackerStats;
+
+// What the offline packer writes out for each image: the page it is on and its rect in UV space, v going down.
+typedef struct AtlasEntry {
+    const char* name;
+    uint32_t page;
+    float u0, v0, u1, v1;
+    bool rotated;
+} AtlasEntry;
+
+AtlasPacker* atlas_packer_create(const AtlasPackerDesc* desc);
+void atlas_packer_destroy(AtlasPacker* packer);
+
+// Places one image. Returns false if it cannot fit even in an empty page.
+bool atlas_packer_insert(AtlasPacker* packer, uint32_t width, uint32_t height, AtlasRect* rect);
+
+// Places a batch of images, largest first. rects[i] is filled for sizes[i]; returns how many could be placed, images
+// that do not fit an empty page get a zero sized rect.
+uint32_t atlas_packer_pack(AtlasPacker* packer, const AtlasSize* sizes, uint32_t count, AtlasRect* rects);
+
+AtlasPackerStats atlas_packer_stats(const AtlasPacker* packer);
+
+// Copies an image into its place in a page, rotating it if needed, and extrudes its edges into the padding around
+// it. Both images are tightly packed with `channels` bytes per texel.
+void atlas_blit(uint8_t* page, uint32_t page_width, uint32_t page_height, uint32_t channels, const AtlasRect* rect,
+    uint32_t padding, const uint8_t* pixels);
+
+void atlas_rect_uv(const AtlasRect* rect, uint32_t page_width, uint32_t page_height, float uv[4]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define DRS_DEFAULT_TARGET_MS 16.6f
+#define DRS_DEFAULT_MIN_SCALE 0.5f
+#define DRS_DEFAULT_MAX_SCALE 1.0f
+#define DRS_DEFAULT_STEP 0.05f
+#define DRS_DEFAULT_HEADROOM 0.85f
+#define DRS_DEFAULT_SETTLE_FRAMES 30u
+
+// Spikes are picked up quickly, improvements slowly.
+#define DRS_RISE_WEIGHT 0.5f
+#define DRS_FALL_WEIGHT 0.1f
+
+void surface_size_init(SurfaceSize* surface, int32_t width, int32_t height)
+{
+    surface->width          = width;
+    surface->height         = height;
+    surface->pending_width  = width;
+    surface->pending_height = height;
+    surface->pending        = false;
+}
+
+void surface_size_request(SurfaceSize* surface, int32_t width, int32_t height)
+{
+    surface->pending_width  = width;
+    surface->pending_height = height;
+    surface->pending        = true;
+}
+
+bool surface_size_apply(SurfaceSize* surface)
+{
+    if (!surface->pending) { return false; }
+    surface->pending = false;
+
+    if (surface->pending_width == surface->width && surface->pending_height == surface->height) { return false; }
+    surface->width  = surface->pending_width;
+    surface->height = surface->pending_height;
+    return true;
+}
+
+static float snap_down(const DynamicResolution* drs, float scale)
+{
+    // The epsilon stops 0.6 / 0.05 = 11.9999 from snapping to 0.55.
+    float step    = drs->desc.scale_step;
+    float snapped = std::floor(scale / step + 1e-3f) * step;
+    return std::min(std::max(snapped, drs->desc.min_scale), drs->desc.max_scale);
+}
+
+static void set_scale(DynamicResolution* drs, float scale)
+{
+    // Assume the new frame costs what the last ones did per pixel, otherwise the history of the old scale would keep
+    // pushing the controller the same way for several frames.
+    float ratio              = scale / drs->scale;
+    drs->smoothed_ms         = drs->smoothed_ms * ratio * ratio;
+    drs->scale               = scale;
+    drs->frames_since_change = 0;
+    drs->changes++;
+}
+
+void dynamic_resolution_init(DynamicResolution* drs, const DynamicResolutionDesc* desc)
+{
+    drs->desc = *desc;
+    if (drs->desc.target_frame_ms <= 0.0f) { drs->desc.target_frame_ms = DRS_DEFAULT_TARGET_MS; }
+    if (drs->desc.min_scale <= 0.0f) { drs->desc.min_scale = DRS_DEFAULT_MIN_SCALE; }
+    if (drs->desc.max_scale <= 0.0f) { drs->desc.max_scale = DRS_DEFAULT_MAX_SCALE; }
+    if (drs->desc.scale_step <= 0.0f) { drs->desc.scale_step = DRS_DEFAULT_STEP; }
+    if (drs->desc.headroom <= 0.0f) { drs->desc.headroom = DRS_DEFAULT_HEADROOM; }
+    if (!drs->desc.settle_frames) { drs->desc.settle_frames = DRS_DEFAULT_SETTLE_FRAMES; }
+    drs->desc.min_scale = std::min(drs->desc.min_scale, drs->desc.max_scale);
+
+    drs->scale               = drs->desc.max_scale;
+    drs->smoothed_ms         = 0.0f;
+    drs->frames_since_change = 0;
+    drs->changes             = 0;
+}
+
+bool dynamic_resolution_update(DynamicResolution* drs, float frame_ms)
+{
+    if (drs->smoothed_ms <= 0.0f) {
+        drs->smoothed_ms = frame_ms;
+    } else {
+        float weight = frame_ms > drs->smoothed_ms ? DRS_RISE_WEIGHT : DRS_FALL_WEIGHT;
+        drs->smoothed_ms += (frame_ms - drs->smoothed_ms) * weight;
+    }
+    drs->frames_since_change++;
+
+    float target = drs->desc.target_frame_ms;
+    if (drs->smoothed_ms > target) {
+        float scale = snap_down(drs, drs->scale * std::sqrt(target / drs->smoothed_ms));
+        if (scale < drs->scale) {
+            set_scale(drs, scale);
+            return true;
+        }
+        return false;
+    }
+
+    if (drs->smoothed_ms < target * drs->desc.headroom && drs->frames_since_change >= drs->desc.settle_frames) {
+        float scale = snap_down(drs, drs->scale + drs->desc.scale_step);
+        float ratio = scale / drs->scale;
+        if (scale > drs->scale && drs->smoothed_ms * ratio * ratio <= target) {
+            set_scale(drs, scale);
+            return true;
+        }
+    }
+    return false;
+}
+
+void dynamic_resolution_scaled_size(
+    const DynamicResolution* drs, int32_t width, int32_t height, int32_t* scaled_width, int32_t* scaled_height)
+{
+    *scaled_width  = std::max(1, (int32_t)std::lround(width * drs->scale));
+    *scaled_height = std::max(1, (int32_t)std::lround(height * drs->scale));
+}
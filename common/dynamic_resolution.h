@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Window size changes arrive as a burst of messages while the user drags a border. Record every one of them and apply
+// the latest once at the start of a frame, so render targets are reallocated at most once per frame.
+typedef struct SurfaceSize {
+    int32_t width; // size in use this frame
+    int32_t height;
+    int32_t pending_width;
+    int32_t pending_height;
+    bool pending;
+} SurfaceSize;
+
+void surface_size_init(SurfaceSize* surface, int32_t width, int32_t height);
+void surface_size_request(SurfaceSize* surface, int32_t width, int32_t height);
+
+// Returns true when the size in use changed. A minimised window reports 0x0; callers skip drawing until it is restored.
+bool surface_size_apply(SurfaceSize* surface);
+
+// Picks the fraction of the output resolution to render the scene at so that frame time stays under a target. GPU
+// cost roughly follows pixel count, so a frame that is 1.2x over budget drops the scale by sqrt(1.2) at once.
+// Raising the scale again is done one step at a time, only after settle_frames frames comfortably under the target
+// (below target_frame_ms * headroom), which keeps the scale from oscillating around the budget.
+//
+// Feed it GPU frame time rather than wall clock time, which is pinned to the refresh rate by vsync. Plain data and
+// no GL, so the controller can be driven with synthetic frame time traces.
+typedef struct DynamicResolutionDesc {
+    float target_frame_ms;  // 0 = 16.6ms
+    float min_scale;        // 0 = 0.5
+    float max_scale;        // 0 = 1.0
+    float scale_step;       // 0 = 0.05, the scale is always a multiple of this
+    float headroom;         // 0 = 0.85
+    uint32_t settle_frames; // 0 = 30
+} DynamicResolutionDesc;
+
+typedef struct DynamicResolution {
+    DynamicResolutionDesc desc;
+    float scale;
+    float smoothed_ms;
+    uint32_t frames_since_change;
+    uint32_t changes;
+} DynamicResolution;
+
+void dynamic_resolution_init(DynamicResolution* drs, const DynamicResolutionDesc* desc);
+
+// Records the time the last frame took. Returns true if the scale changed.
+bool dynamic_resolution_update(DynamicResolution* drs, float frame_ms);
+
+// The size to render the scene at for an output of width x height, never smaller than 1x1.
+void dynamic_resolution_scaled_size(
+    const DynamicResolution* drs, int32_t width, int32_t height, int32_t* scaled_width, int32_t* scaled_height);
+
+#ifdef __cplusplus
+}
+#endif
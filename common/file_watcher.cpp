@@ -0,0 +1,366 @@
+#include "file_watcher.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <CoreServices/CoreServices.h>
+#include <dispatch/dispatch.h>
+#include <limits.h>
+#include <stdlib.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+typedef struct WatchedDirectory {
+    std::string path;
+    HANDLE handle;
+    OVERLAPPED overlapped;
+    DWORD buffer[4096];
+} WatchedDirectory;
+#elif defined(__APPLE__)
+typedef struct WatchedDirectory {
+    std::string path;
+    std::string real_path;
+} WatchedDirectory;
+#endif
+
+struct FileWatcher {
+    uint32_t debounce_ms;
+
+    // Paths seen since they were last reported, with the time of their latest event. Guarded by `mutex` since FSEvents
+    // calls back on its own queue.
+    std::mutex mutex;
+    std::unordered_map<std::string, uint64_t> pending;
+    std::vector<std::string> settled;
+    std::vector<std::string> lost;
+
+#if defined(_WIN32)
+    std::vector<WatchedDirectory*> directories;
+#elif defined(__APPLE__)
+    std::vector<WatchedDirectory> directories;
+    FSEventStreamRef stream;
+    dispatch_queue_t queue;
+#elif defined(__linux__)
+    int fd;
+    std::unordered_map<int, std::string> directories;
+#endif
+};
+
+static std::string join_path(const std::string& directory, const std::string& name)
+{
+    if (directory.empty() || directory.back() == '/' || directory.back() == '\\') { return directory + name; }
+    return directory + "/" + name;
+}
+
+uint64_t file_watcher_now_ms(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void file_watcher_notify(FileWatcher* watcher, const char* path, uint64_t now_ms)
+{
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    watcher->pending[path] = now_ms;
+}
+
+static void lose_directory(FileWatcher* watcher, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    watcher->lost.push_back(path);
+}
+
+#if defined(_WIN32)
+
+static bool issue_read(WatchedDirectory* directory)
+{
+    ResetEvent(directory->overlapped.hEvent);
+    return ReadDirectoryChangesW(directory->handle, directory->buffer, sizeof(directory->buffer), FALSE,
+               FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE, NULL,
+               &directory->overlapped, NULL)
+        != 0;
+}
+
+static void close_directory(WatchedDirectory* directory)
+{
+    CancelIo(directory->handle);
+    CloseHandle(directory->overlapped.hEvent);
+    CloseHandle(directory->handle);
+    delete directory;
+}
+
+static bool backend_init(FileWatcher* watcher) { return true; }
+
+static void backend_shutdown(FileWatcher* watcher)
+{
+    for (WatchedDirectory* directory : watcher->directories) {
+        close_directory(directory);
+    }
+}
+
+static bool backend_add_directory(FileWatcher* watcher, const char* path)
+{
+    WatchedDirectory* directory = new WatchedDirectory();
+    directory->path             = path;
+    directory->handle           = CreateFileA(path, FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (directory->handle == INVALID_HANDLE_VALUE) {
+        delete directory;
+        return false;
+    }
+
+    directory->overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!issue_read(directory)) {
+        CloseHandle(directory->overlapped.hEvent);
+        CloseHandle(directory->handle);
+        delete directory;
+        return false;
+    }
+
+    watcher->directories.push_back(directory);
+    return true;
+}
+
+static void backend_drain(FileWatcher* watcher, uint64_t now_ms)
+{
+    for (size_t i = 0; i < watcher->directories.size();) {
+        WatchedDirectory* directory = watcher->directories[i];
+        DWORD bytes                 = 0;
+        bool armed                  = true;
+        if (!GetOverlappedResult(directory->handle, &directory->overlapped, &bytes, FALSE)) {
+            DWORD error = GetLastError();
+            if (error == ERROR_IO_INCOMPLETE) {
+                i++;
+                continue;
+            }
+            // An overflow ends the read like a change does, and another is issued below. Anything else means the
+            // directory was deleted or became unreadable, and its handle will not report changes again.
+            armed = error == ERROR_NOTIFY_ENUM_DIR;
+            bytes = 0;
+        }
+
+        // Zero bytes means the buffer overflowed and the individual changes were lost.
+        uint8_t* cursor = (uint8_t*)directory->buffer;
+        while (bytes > 0) {
+            FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*)cursor;
+            if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED
+                || info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                char name[MAX_PATH];
+                int length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR),
+                    name, sizeof(name) - 1, NULL, NULL);
+                name[length] = '\0';
+                file_watcher_notify(watcher, join_path(directory->path, name).c_str(), now_ms);
+            }
+            if (info->NextEntryOffset == 0) { break; }
+            cursor += info->NextEntryOffset;
+        }
+
+        if (armed && issue_read(directory)) {
+            i++;
+        } else {
+            lose_directory(watcher, directory->path);
+            close_directory(directory);
+            watcher->directories.erase(watcher->directories.begin() + i);
+        }
+    }
+}
+
+#elif defined(__APPLE__)
+
+static void fsevents_callback(ConstFSEventStreamRef stream, void* info, size_t count, void* paths,
+    const FSEventStreamEventFlags flags[], const FSEventStreamEventId ids[])
+{
+    FileWatcher* watcher = (FileWatcher*)info;
+    char** event_paths   = (char**)paths;
+    uint64_t now_ms      = file_watcher_now_ms();
+
+    const FSEventStreamEventFlags interesting = kFSEventStreamEventFlagItemModified
+        | kFSEventStreamEventFlagItemCreated | kFSEventStreamEventFlagItemRenamed;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!(flags[i] & kFSEventStreamEventFlagItemIsFile) || !(flags[i] & interesting)) { continue; }
+
+        // FSEvents is recursive and reports resolved absolute paths; map direct children back to the watched name.
+        std::string path = event_paths[i];
+        size_t slash     = path.find_last_of('/');
+        if (slash == std::string::npos) { continue; }
+        std::string parent = path.substr(0, slash);
+
+        for (const WatchedDirectory& directory : watcher->directories) {
+            if (directory.real_path == parent) {
+                file_watcher_notify(watcher, join_path(directory.path, path.substr(slash + 1)).c_str(), now_ms);
+            }
+        }
+    }
+}
+
+static void stop_stream(FileWatcher* watcher)
+{
+    if (!watcher->stream) { return; }
+    FSEventStreamStop(watcher->stream);
+    FSEventStreamInvalidate(watcher->stream);
+    FSEventStreamRelease(watcher->stream);
+    watcher->stream = NULL;
+}
+
+static bool backend_init(FileWatcher* watcher)
+{
+    watcher->queue = dispatch_queue_create("file_watcher", DISPATCH_QUEUE_SERIAL);
+    return watcher->queue != NULL;
+}
+
+static void backend_shutdown(FileWatcher* watcher)
+{
+    stop_stream(watcher);
+    dispatch_release(watcher->queue);
+}
+
+static bool backend_add_directory(FileWatcher* watcher, const char* path)
+{
+    char real_path[PATH_MAX];
+    if (!realpath(path, real_path)) { return false; }
+
+    // The callback reads the directory list on the stream's queue, so stop the stream before changing it.
+    stop_stream(watcher);
+    watcher->directories.push_back({ path, real_path });
+
+    CFMutableArrayRef paths = CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+    for (const WatchedDirectory& directory : watcher->directories) {
+        CFStringRef string = CFStringCreateWithCString(NULL, directory.real_path.c_str(), kCFStringEncodingUTF8);
+        CFArrayAppendValue(paths, string);
+        CFRelease(string);
+    }
+
+    FSEventStreamContext context = { 0, watcher, NULL, NULL, NULL };
+    watcher->stream = FSEventStreamCreate(NULL, fsevents_callback, &context, paths, kFSEventStreamEventIdSinceNow, 0.05,
+        kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer);
+    CFRelease(paths);
+    if (!watcher->stream) { return false; }
+
+    FSEventStreamSetDispatchQueue(watcher->stream, watcher->queue);
+    return FSEventStreamStart(watcher->stream);
+}
+
+static void backend_drain(FileWatcher* watcher, uint64_t now_ms) { }
+
+#elif defined(__linux__)
+
+static bool backend_init(FileWatcher* watcher)
+{
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return watcher->fd >= 0;
+}
+
+static void backend_shutdown(FileWatcher* watcher) { close(watcher->fd); }
+
+static bool backend_add_directory(FileWatcher* watcher, const char* path)
+{
+    int wd = inotify_add_watch(watcher->fd, path, IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) { return false; }
+    watcher->directories[wd] = path;
+    return true;
+}
+
+static void backend_drain(FileWatcher* watcher, uint64_t now_ms)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t bytes = read(watcher->fd, buffer, sizeof(buffer));
+        if (bytes <= 0) { return; }
+
+        for (char* cursor = buffer; cursor < buffer + bytes;) {
+            struct inotify_event* event = (struct inotify_event*)cursor;
+            cursor += sizeof(struct inotify_event) + event->len;
+
+            auto directory = watcher->directories.find(event->wd);
+            if (directory == watcher->directories.end()) { continue; }
+            // The kernel removed the watch, because the directory was deleted or its file system unmounted.
+            if (event->mask & IN_IGNORED) {
+                lose_directory(watcher, directory->second);
+                watcher->directories.erase(directory);
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) { continue; }
+            file_watcher_notify(watcher, join_path(directory->second, event->name).c_str(), now_ms);
+        }
+    }
+}
+
+#else
+
+static bool backend_init(FileWatcher* watcher) { return true; }
+static void backend_shutdown(FileWatcher* watcher) { }
+static bool backend_add_directory(FileWatcher* watcher, const char* path) { return false; }
+static void backend_drain(FileWatcher* watcher, uint64_t now_ms) { }
+
+#endif
+
+FileWatcher* file_watcher_create(uint32_t debounce_ms)
+{
+    FileWatcher* watcher = new FileWatcher();
+    watcher->debounce_ms = debounce_ms;
+    if (!backend_init(watcher)) {
+        delete watcher;
+        return NULL;
+    }
+    return watcher;
+}
+
+void file_watcher_destroy(FileWatcher* watcher)
+{
+    if (!watcher) { return; }
+    backend_shutdown(watcher);
+    delete watcher;
+}
+
+bool file_watcher_add_directory(FileWatcher* watcher, const char* directory)
+{
+    return backend_add_directory(watcher, directory);
+}
+
+uint32_t file_watcher_poll(FileWatcher* watcher, uint64_t now_ms, FileChangedFunc on_changed, void* user)
+{
+    backend_drain(watcher, now_ms);
+
+    // Collect under the lock, report outside it so callbacks can add directories or notify.
+    watcher->settled.clear();
+    {
+        std::lock_guard<std::mutex> lock(watcher->mutex);
+        for (auto it = watcher->pending.begin(); it != watcher->pending.end();) {
+            if (now_ms >= it->second + watcher->debounce_ms) {
+                watcher->settled.push_back(it->first);
+                it = watcher->pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const std::string& path : watcher->settled) {
+        on_changed(path.c_str(), user);
+    }
+    return (uint32_t)watcher->settled.size();
+}
+
+uint32_t file_watcher_poll_lost(FileWatcher* watcher, FileChangedFunc on_lost, void* user)
+{
+    std::vector<std::string> lost;
+    {
+        std::lock_guard<std::mutex> lock(watcher->mutex);
+        lost.swap(watcher->lost);
+    }
+    for (const std::string& path : lost) {
+        on_lost(path.c_str(), user);
+    }
+    return (uint32_t)lost.size();
+}
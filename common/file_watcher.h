@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reports files that changed in a set of watched directories. Backed by inotify on Linux, ReadDirectoryChangesW on
+// Windows and FSEvents on macOS. Directories are watched non-recursively; add every directory you care about.
+//
+// Editors tend to save in several steps (truncate, write, rename), so a file is only reported once it has been quiet
+// for debounce_ms. Each changed file is reported once per poll, as the watched directory joined with the file name.
+typedef struct FileWatcher FileWatcher;
+
+typedef void (*FileChangedFunc)(const char* path, void* user);
+
+FileWatcher* file_watcher_create(uint32_t debounce_ms);
+void file_watcher_destroy(FileWatcher* watcher);
+
+bool file_watcher_add_directory(FileWatcher* watcher, const char* directory);
+
+// Records a change as if the OS had reported it. Used by the backends, and handy for driving the watcher by hand.
+void file_watcher_notify(FileWatcher* watcher, const char* path, uint64_t now_ms);
+
+// Drains the OS notifications and calls on_changed for every file that has settled. Returns how many were reported.
+uint32_t file_watcher_poll(FileWatcher* watcher, uint64_t now_ms, FileChangedFunc on_changed, void* user);
+
+// Calls on_lost for every directory the watcher has stopped watching since the last call, because it was deleted or
+// the OS stopped reporting changes in it. Add it again to pick up changes once it is back. Picked up by
+// file_watcher_poll(), so call this after it. Returns how many were reported.
+uint32_t file_watcher_poll_lost(FileWatcher* watcher, FileChangedFunc on_lost, void* user);
+
+uint64_t file_watcher_now_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,748 @@
+#include "gl_capture.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#define DECLARE_ENTRY_POINT(type, name) type name;
+
+typedef struct GlEntryPoints {
+    GL_CAPTURE_ENTRY_POINTS(DECLARE_ENTRY_POINT)
+} GlEntryPoints;
+
+static GlTraceWriter* gl_capture;
+static GlCaptureDispatch capture_dispatch;
+static GlEntryPoints driver_gl; // NULL for the entry points that were not hooked
+static GLint capture_unpack_alignment = 4;
+
+// The samples have at most one buffer mapped at a time.
+static struct {
+    GLenum target;
+    GLintptr offset;
+    GLsizeiptr length;
+    void* pointer;
+} capture_mapping;
+
+// GLint and GLsizei arguments are recorded as their 32 bits, so -1 costs five bytes rather than ten.
+#define CAPTURE(call, ...)                                                                                             \
+    do {                                                                                                               \
+        const uint64_t capture_args[] = { __VA_ARGS__ };                                                               \
+        gl_trace_call(gl_capture, call, capture_args, sizeof(capture_args) / sizeof(uint64_t), NULL, 0);               \
+    } while (0)
+#define CAPTURE_PAYLOAD(call, payload, size, ...)                                                                      \
+    do {                                                                                                               \
+        const uint64_t capture_args[] = { __VA_ARGS__ };                                                               \
+        gl_trace_call(gl_capture, call, capture_args, sizeof(capture_args) / sizeof(uint64_t), payload, size);         \
+    } while (0)
+
+// Bytes glTexImage2D and glTexSubImage2D read from `pixels`, for the unpacked formats the samples upload. Used by the
+// replay too, to check the payloads it is about to hand back to the driver.
+static uint64_t image_upload_size(GLenum format, GLenum type, GLsizei width, GLsizei height, GLint unpack_alignment)
+{
+    if (width <= 0 || height <= 0) { return 0; }
+    uint32_t components = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB || format == GL_BGR ? 3 : 4;
+    uint32_t size       = type == GL_FLOAT ? 4 : type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT ? 2 : 1;
+    uint64_t row        = (uint64_t)width * components * size;
+    uint64_t alignment  = unpack_alignment > 0 ? (uint64_t)unpack_alignment : 4;
+    uint64_t stride     = (row + alignment - 1) / alignment * alignment;
+    return stride * (uint64_t)(height - 1) + row;
+}
+
+static void APIENTRY capture_glAttachShader(GLuint program, GLuint shader)
+{
+    CAPTURE(GL_TRACE_ATTACH_SHADER, program, shader);
+    driver_gl.glAttachShader(program, shader);
+}
+
+static void APIENTRY capture_glBeginQuery(GLenum target, GLuint id)
+{
+    CAPTURE(GL_TRACE_BEGIN_QUERY, target, id);
+    driver_gl.glBeginQuery(target, id);
+}
+
+static void APIENTRY capture_glBindBuffer(GLenum target, GLuint buffer)
+{
+    CAPTURE(GL_TRACE_BIND_BUFFER, target, buffer);
+    driver_gl.glBindBuffer(target, buffer);
+}
+
+static void APIENTRY capture_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    CAPTURE(GL_TRACE_BIND_FRAMEBUFFER, target, framebuffer);
+    driver_gl.glBindFramebuffer(target, framebuffer);
+}
+
+static void APIENTRY capture_glBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+    CAPTURE(GL_TRACE_BIND_RENDERBUFFER, target, renderbuffer);
+    driver_gl.glBindRenderbuffer(target, renderbuffer);
+}
+
+static void APIENTRY capture_glBindTexture(GLenum target, GLuint texture)
+{
+    CAPTURE(GL_TRACE_BIND_TEXTURE, target, texture);
+    driver_gl.glBindTexture(target, texture);
+}
+
+static void APIENTRY capture_glBindVertexArray(GLuint array)
+{
+    CAPTURE(GL_TRACE_BIND_VERTEX_ARRAY, array);
+    driver_gl.glBindVertexArray(array);
+}
+
+static void APIENTRY capture_glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    CAPTURE(GL_TRACE_BLEND_FUNC, sfactor, dfactor);
+    driver_gl.glBlendFunc(sfactor, dfactor);
+}
+
+static void APIENTRY capture_glBlitFramebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1, GLint dst_x0,
+    GLint dst_y0, GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum filter)
+{
+    CAPTURE(GL_TRACE_BLIT_FRAMEBUFFER, (uint32_t)src_x0, (uint32_t)src_y0, (uint32_t)src_x1, (uint32_t)src_y1,
+        (uint32_t)dst_x0, (uint32_t)dst_y0, (uint32_t)dst_x1, (uint32_t)dst_y1, mask, filter);
+    driver_gl.glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+}
+
+static void APIENTRY capture_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_BUFFER_DATA, data, (uint64_t)size, target, (uint64_t)size, usage);
+    driver_gl.glBufferData(target, size, data, usage);
+}
+
+static void APIENTRY capture_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_BUFFER_SUB_DATA, data, (uint64_t)size, target, (uint64_t)offset, (uint64_t)size);
+    driver_gl.glBufferSubData(target, offset, size, data);
+}
+
+static GLenum APIENTRY capture_glCheckFramebufferStatus(GLenum target)
+{
+    GLenum status = driver_gl.glCheckFramebufferStatus(target);
+    CAPTURE(GL_TRACE_CHECK_FRAMEBUFFER_STATUS, target, status);
+    return status;
+}
+
+static void APIENTRY capture_glClear(GLbitfield mask)
+{
+    CAPTURE(GL_TRACE_CLEAR, mask);
+    driver_gl.glClear(mask);
+}
+
+static void APIENTRY capture_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    CAPTURE(GL_TRACE_CLEAR_COLOR, gl_trace_float(red), gl_trace_float(green), gl_trace_float(blue),
+        gl_trace_float(alpha));
+    driver_gl.glClearColor(red, green, blue, alpha);
+}
+
+static void APIENTRY capture_glCompileShader(GLuint shader)
+{
+    CAPTURE(GL_TRACE_COMPILE_SHADER, shader);
+    driver_gl.glCompileShader(shader);
+}
+
+static GLuint APIENTRY capture_glCreateProgram(void)
+{
+    GLuint program = driver_gl.glCreateProgram();
+    CAPTURE(GL_TRACE_CREATE_PROGRAM, program);
+    return program;
+}
+
+static GLuint APIENTRY capture_glCreateShader(GLenum type)
+{
+    GLuint shader = driver_gl.glCreateShader(type);
+    CAPTURE(GL_TRACE_CREATE_SHADER, type, shader);
+    return shader;
+}
+
+static void APIENTRY capture_glDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_DELETE_BUFFERS, buffers, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+    driver_gl.glDeleteBuffers(n, buffers);
+}
+
+static void APIENTRY capture_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_DELETE_FRAMEBUFFERS, framebuffers, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+    driver_gl.glDeleteFramebuffers(n, framebuffers);
+}
+
+static void APIENTRY capture_glDeleteProgram(GLuint program)
+{
+    CAPTURE(GL_TRACE_DELETE_PROGRAM, program);
+    driver_gl.glDeleteProgram(program);
+}
+
+static void APIENTRY capture_glDeleteQueries(GLsizei n, const GLuint* ids)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_DELETE_QUERIES, ids, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+    driver_gl.glDeleteQueries(n, ids);
+}
+
+static void APIENTRY capture_glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_DELETE_RENDERBUFFERS, renderbuffers, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+    driver_gl.glDeleteRenderbuffers(n, renderbuffers);
+}
+
+static void APIENTRY capture_glDeleteShader(GLuint shader)
+{
+    CAPTURE(GL_TRACE_DELETE_SHADER, shader);
+    driver_gl.glDeleteShader(shader);
+}
+
+static void APIENTRY capture_glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_DELETE_TEXTURES, textures, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+    driver_gl.glDeleteTextures(n, textures);
+}
+
+static void APIENTRY capture_glDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    CAPTURE_PAYLOAD(GL_TRACE_DELETE_VERTEX_ARRAYS, arrays, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+    driver_gl.glDeleteVertexArrays(n, arrays);
+}
+
+static void APIENTRY capture_glDisable(GLenum cap)
+{
+    CAPTURE(GL_TRACE_DISABLE, cap);
+    driver_gl.glDisable(cap);
+}
+
+static void APIENTRY capture_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    CAPTURE(GL_TRACE_DRAW_ARRAYS, mode, (uint32_t)first, (uint32_t)count);
+    driver_gl.glDrawArrays(mode, first, count);
+}
+
+static void APIENTRY capture_glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count)
+{
+    CAPTURE(GL_TRACE_DRAW_ARRAYS_INSTANCED, mode, (uint32_t)first, (uint32_t)count, (uint32_t)instance_count);
+    driver_gl.glDrawArraysInstanced(mode, first, count, instance_count);
+}
+
+static void APIENTRY capture_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    CAPTURE(GL_TRACE_DRAW_ELEMENTS, mode, (uint32_t)count, type, (uint64_t)(uintptr_t)indices);
+    driver_gl.glDrawElements(mode, count, type, indices);
+}
+
+static void APIENTRY capture_glEnable(GLenum cap)
+{
+    CAPTURE(GL_TRACE_ENABLE, cap);
+    driver_gl.glEnable(cap);
+}
+
+static void APIENTRY capture_glEnableVertexAttribArray(GLuint index)
+{
+    CAPTURE(GL_TRACE_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+    driver_gl.glEnableVertexAttribArray(index);
+}
+
+static void APIENTRY capture_glEndQuery(GLenum target)
+{
+    CAPTURE(GL_TRACE_END_QUERY, target);
+    driver_gl.glEndQuery(target);
+}
+
+static void APIENTRY capture_glFramebufferRenderbuffer(
+    GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer)
+{
+    CAPTURE(GL_TRACE_FRAMEBUFFER_RENDERBUFFER, target, attachment, renderbuffer_target, renderbuffer);
+    driver_gl.glFramebufferRenderbuffer(target, attachment, renderbuffer_target, renderbuffer);
+}
+
+static void APIENTRY capture_glFramebufferTexture2D(
+    GLenum target, GLenum attachment, GLenum texture_target, GLuint texture, GLint level)
+{
+    CAPTURE(GL_TRACE_FRAMEBUFFER_TEXTURE_2D, target, attachment, texture_target, texture, (uint32_t)level);
+    driver_gl.glFramebufferTexture2D(target, attachment, texture_target, texture, level);
+}
+
+static void APIENTRY capture_glGenBuffers(GLsizei n, GLuint* buffers)
+{
+    driver_gl.glGenBuffers(n, buffers);
+    CAPTURE_PAYLOAD(GL_TRACE_GEN_BUFFERS, buffers, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+}
+
+static void APIENTRY capture_glGenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+    driver_gl.glGenFramebuffers(n, framebuffers);
+    CAPTURE_PAYLOAD(GL_TRACE_GEN_FRAMEBUFFERS, framebuffers, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+}
+
+static void APIENTRY capture_glGenQueries(GLsizei n, GLuint* ids)
+{
+    driver_gl.glGenQueries(n, ids);
+    CAPTURE_PAYLOAD(GL_TRACE_GEN_QUERIES, ids, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+}
+
+static void APIENTRY capture_glGenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+{
+    driver_gl.glGenRenderbuffers(n, renderbuffers);
+    CAPTURE_PAYLOAD(GL_TRACE_GEN_RENDERBUFFERS, renderbuffers, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+}
+
+static void APIENTRY capture_glGenTextures(GLsizei n, GLuint* textures)
+{
+    driver_gl.glGenTextures(n, textures);
+    CAPTURE_PAYLOAD(GL_TRACE_GEN_TEXTURES, textures, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+}
+
+static void APIENTRY capture_glGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    driver_gl.glGenVertexArrays(n, arrays);
+    CAPTURE_PAYLOAD(GL_TRACE_GEN_VERTEX_ARRAYS, arrays, (uint64_t)n * sizeof(GLuint), (uint32_t)n);
+}
+
+static void APIENTRY capture_glGenerateMipmap(GLenum target)
+{
+    CAPTURE(GL_TRACE_GENERATE_MIPMAP, target);
+    driver_gl.glGenerateMipmap(target);
+}
+
+static GLint APIENTRY capture_glGetUniformLocation(GLuint program, const GLchar* name)
+{
+    GLint location = driver_gl.glGetUniformLocation(program, name);
+    CAPTURE_PAYLOAD(GL_TRACE_GET_UNIFORM_LOCATION, name, strlen(name) + 1, program, (uint32_t)location);
+    return location;
+}
+
+static void APIENTRY capture_glLinkProgram(GLuint program)
+{
+    CAPTURE(GL_TRACE_LINK_PROGRAM, program);
+    driver_gl.glLinkProgram(program);
+}
+
+static void* APIENTRY capture_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    void* pointer = driver_gl.glMapBufferRange(target, offset, length, access);
+    if (pointer && (access & GL_MAP_WRITE_BIT)) {
+        capture_mapping.target  = target;
+        capture_mapping.offset  = offset;
+        capture_mapping.length  = length;
+        capture_mapping.pointer = pointer;
+    }
+    return pointer;
+}
+
+static void APIENTRY capture_glMaxShaderCompilerThreadsKHR(GLuint count)
+{
+    CAPTURE(GL_TRACE_MAX_SHADER_COMPILER_THREADS, count);
+    driver_gl.glMaxShaderCompilerThreadsKHR(count);
+}
+
+static void APIENTRY capture_glPixelStorei(GLenum pname, GLint param)
+{
+    if (pname == GL_UNPACK_ALIGNMENT) { capture_unpack_alignment = param; }
+    CAPTURE(GL_TRACE_PIXEL_STORE_I, pname, (uint32_t)param);
+    driver_gl.glPixelStorei(pname, param);
+}
+
+static void APIENTRY capture_glRenderbufferStorage(GLenum target, GLenum internal_format, GLsizei width, GLsizei height)
+{
+    CAPTURE(GL_TRACE_RENDERBUFFER_STORAGE, target, internal_format, (uint32_t)width, (uint32_t)height);
+    driver_gl.glRenderbufferStorage(target, internal_format, width, height);
+}
+
+// The strings are recorded as one, which is how the replay passes them back.
+static void APIENTRY capture_glShaderSource(
+    GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+{
+    size_t total = 0;
+    for (GLsizei i = 0; i < count; i++) {
+        total += lengths && lengths[i] >= 0 ? (size_t)lengths[i] : strlen(strings[i]);
+    }
+    char* source = (char*)malloc(total + 1);
+    if (source) {
+        size_t offset = 0;
+        for (GLsizei i = 0; i < count; i++) {
+            size_t length = lengths && lengths[i] >= 0 ? (size_t)lengths[i] : strlen(strings[i]);
+            memcpy(source + offset, strings[i], length);
+            offset += length;
+        }
+        CAPTURE_PAYLOAD(GL_TRACE_SHADER_SOURCE, source, total, shader, (uint32_t)count);
+        free(source);
+    }
+    driver_gl.glShaderSource(shader, count, strings, lengths);
+}
+
+static void APIENTRY capture_glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width,
+    GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    uint64_t size = image_upload_size(format, type, width, height, capture_unpack_alignment);
+    CAPTURE_PAYLOAD(GL_TRACE_TEX_IMAGE_2D, pixels, size, target, (uint32_t)level, (uint32_t)internal_format,
+        (uint32_t)width, (uint32_t)height, (uint32_t)border, format, type);
+    driver_gl.glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY capture_glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    CAPTURE(GL_TRACE_TEX_PARAMETER_I, target, pname, (uint32_t)param);
+    driver_gl.glTexParameteri(target, pname, param);
+}
+
+static void APIENTRY capture_glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width,
+    GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    uint64_t size = image_upload_size(format, type, width, height, capture_unpack_alignment);
+    CAPTURE_PAYLOAD(GL_TRACE_TEX_SUB_IMAGE_2D, pixels, size, target, (uint32_t)level, (uint32_t)x, (uint32_t)y,
+        (uint32_t)width, (uint32_t)height, format, type);
+    driver_gl.glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+static void APIENTRY capture_glUniform1f(GLint location, GLfloat v0)
+{
+    CAPTURE(GL_TRACE_UNIFORM_1F, (uint32_t)location, gl_trace_float(v0));
+    driver_gl.glUniform1f(location, v0);
+}
+
+static void APIENTRY capture_glUniform1i(GLint location, GLint v0)
+{
+    CAPTURE(GL_TRACE_UNIFORM_1I, (uint32_t)location, (uint32_t)v0);
+    driver_gl.glUniform1i(location, v0);
+}
+
+static void APIENTRY capture_glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+    CAPTURE(GL_TRACE_UNIFORM_2F, (uint32_t)location, gl_trace_float(v0), gl_trace_float(v1));
+    driver_gl.glUniform2f(location, v0, v1);
+}
+
+static GLboolean APIENTRY capture_glUnmapBuffer(GLenum target)
+{
+    if (capture_mapping.pointer && capture_mapping.target == target) {
+        CAPTURE_PAYLOAD(GL_TRACE_BUFFER_SUB_DATA, capture_mapping.pointer, (uint64_t)capture_mapping.length, target,
+            (uint64_t)capture_mapping.offset, (uint64_t)capture_mapping.length);
+        capture_mapping.pointer = NULL;
+    }
+    return driver_gl.glUnmapBuffer(target);
+}
+
+static void APIENTRY capture_glUseProgram(GLuint program)
+{
+    CAPTURE(GL_TRACE_USE_PROGRAM, program);
+    driver_gl.glUseProgram(program);
+}
+
+static void APIENTRY capture_glVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    CAPTURE(GL_TRACE_VERTEX_ATTRIB_DIVISOR, index, divisor);
+    driver_gl.glVertexAttribDivisor(index, divisor);
+}
+
+static void APIENTRY capture_glVertexAttribPointer(
+    GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    CAPTURE(GL_TRACE_VERTEX_ATTRIB_POINTER, index, (uint32_t)size, type, normalized, (uint32_t)stride,
+        (uint64_t)(uintptr_t)pointer);
+    driver_gl.glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static void APIENTRY capture_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    CAPTURE(GL_TRACE_VIEWPORT, (uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)height);
+    driver_gl.glViewport(x, y, width, height);
+}
+
+bool gl_capture_begin(const GlCaptureDispatch* dispatch, const char* path)
+{
+    if (gl_capture) { return false; }
+    gl_capture = gl_trace_create(path);
+    if (!gl_capture) { return false; }
+
+    capture_dispatch         = *dispatch;
+    capture_unpack_alignment = 4;
+    capture_mapping.pointer  = NULL;
+#define HOOK_ENTRY_POINT(type, name)                                                                                   \
+    if (dispatch->name && *dispatch->name) { driver_gl.name = *dispatch->name, *dispatch->name = capture_##name; }
+    GL_CAPTURE_ENTRY_POINTS(HOOK_ENTRY_POINT)
+#undef HOOK_ENTRY_POINT
+    return true;
+}
+
+bool gl_capture_active(void) { return gl_capture != NULL; }
+
+void gl_capture_frame(void)
+{
+    if (gl_capture) { gl_trace_frame(gl_capture); }
+}
+
+bool gl_capture_end(GlTraceStats* stats)
+{
+    if (!gl_capture) {
+        memset(stats, 0, sizeof(*stats));
+        return false;
+    }
+#define UNHOOK_ENTRY_POINT(type, name)                                                                                 \
+    if (driver_gl.name) { *capture_dispatch.name = driver_gl.name; }
+    GL_CAPTURE_ENTRY_POINTS(UNHOOK_ENTRY_POINT)
+#undef UNHOOK_ENTRY_POINT
+    memset(&driver_gl, 0, sizeof(driver_gl));
+
+    bool ok    = gl_trace_close(gl_capture, stats);
+    gl_capture = NULL;
+    return ok;
+}
+
+// Object names and uniform locations differ between a capture and its replay, so the replay maps the recorded ones to
+// the ones it was given, per kind of object.
+typedef enum ReplayNameKind {
+    REPLAY_BUFFERS,
+    REPLAY_FRAMEBUFFERS,
+    REPLAY_PROGRAMS,
+    REPLAY_QUERIES,
+    REPLAY_RENDERBUFFERS,
+    REPLAY_SHADERS,
+    REPLAY_TEXTURES,
+    REPLAY_VERTEX_ARRAYS,
+    REPLAY_UNIFORMS,
+    REPLAY_NAME_KINDS,
+} ReplayNameKind;
+
+typedef struct ReplayNames {
+    GLuint* names; // by recorded name; 0 (and the default object) where unknown
+    uint32_t capacity;
+} ReplayNames;
+
+static GLuint replay_name(const ReplayNames* map, uint64_t recorded)
+{
+    return recorded < map->capacity ? map->names[recorded] : 0;
+}
+
+static void replay_set_name(ReplayNames* map, uint64_t recorded, GLuint live)
+{
+    if (recorded >= map->capacity) {
+        uint32_t capacity = map->capacity ? map->capacity : 64;
+        while (capacity <= recorded) {
+            capacity *= 2;
+        }
+        GLuint* names = (GLuint*)realloc(map->names, capacity * sizeof(GLuint));
+        if (!names) { return; }
+        memset(names + map->capacity, 0, (capacity - map->capacity) * sizeof(GLuint));
+        map->names    = names;
+        map->capacity = capacity;
+    }
+    map->names[recorded] = live;
+}
+
+static GLint replay_uniform(const ReplayNames* map, uint64_t recorded)
+{
+    return (uint32_t)recorded == 0xFFFFFFFFu ? -1 : (GLint)replay_name(map, recorded);
+}
+
+// Gens make one name at a time, mapping each recorded one to it.
+static void replay_gen(PFNGLGENBUFFERSPROC gen, ReplayNames* map, const GlTraceRecord* record)
+{
+    const GLuint* recorded = (const GLuint*)record->payload;
+    uint64_t count         = record->payload_size / sizeof(GLuint);
+    for (uint64_t i = 0; i < count; i++) {
+        GLuint live = 0;
+        gen(1, &live);
+        replay_set_name(map, recorded[i], live);
+    }
+}
+
+static void replay_delete(PFNGLDELETEBUFFERSPROC delete_names, ReplayNames* map, const GlTraceRecord* record)
+{
+    const GLuint* recorded = (const GLuint*)record->payload;
+    uint64_t count         = record->payload_size / sizeof(GLuint);
+    for (uint64_t i = 0; i < count; i++) {
+        GLuint live = replay_name(map, recorded[i]);
+        if (live) { delete_names(1, &live); }
+        replay_set_name(map, recorded[i], 0);
+    }
+}
+
+// The size a call's arguments say its payload has must be the size it was recorded with, or the driver would read past
+// the payload. Calls whose data is optional may also have none.
+static bool replay_payload_fits(const GlTraceRecord* r, uint32_t arg_count, uint64_t size, bool optional)
+{
+    if (r->arg_count < arg_count) { return false; }
+    return r->payload ? r->payload_size == size : optional;
+}
+
+// glTexImage2D and glTexSubImage2D both end in format and type, and have eight arguments.
+static bool replay_image_fits(const GlTraceRecord* r, uint64_t width, uint64_t height, GLint unpack_alignment,
+    bool optional)
+{
+    if (r->arg_count < 8) { return false; }
+    GLenum format = (GLenum)r->args[6], type = (GLenum)r->args[7];
+    uint64_t size = image_upload_size(format, type, (GLsizei)width, (GLsizei)height, unpack_alignment);
+    return replay_payload_fits(r, 8, size, optional);
+}
+
+struct GlReplay {
+    GlEntryPoints gl;
+    bool loaded[GL_TRACE_CALL_COUNT]; // by call, whether the sample has its entry point
+    ReplayNames maps[REPLAY_NAME_KINDS];
+    GLint unpack_alignment;
+};
+
+GlReplay* gl_replay_create(const GlCaptureDispatch* dispatch)
+{
+    GlReplay* replay         = new GlReplay();
+    replay->unpack_alignment = 4;
+#define LOAD_ENTRY_POINT(type, name)                                                                                   \
+    if (dispatch->name) { replay->gl.name = *dispatch->name; }
+    GL_CAPTURE_ENTRY_POINTS(LOAD_ENTRY_POINT)
+#undef LOAD_ENTRY_POINT
+
+    // Calls are named after their entry points.
+    for (uint32_t call = 0; call < GL_TRACE_CALL_COUNT; call++) {
+        const char* name = gl_trace_call_name((GlTraceCall)call);
+#define FIND_ENTRY_POINT(type, entry_point)                                                                            \
+    if (strcmp(name, #entry_point) == 0) { replay->loaded[call] = replay->gl.entry_point != NULL; }
+        GL_CAPTURE_ENTRY_POINTS(FIND_ENTRY_POINT)
+#undef FIND_ENTRY_POINT
+    }
+    return replay;
+}
+
+void gl_replay_destroy(GlReplay* replay)
+{
+    if (!replay) { return; }
+    for (int i = 0; i < REPLAY_NAME_KINDS; i++) {
+        free(replay->maps[i].names);
+    }
+    delete replay;
+}
+
+bool gl_replay_call(GlReplay* replay, const GlTraceRecord* r)
+{
+    if (r->call >= GL_TRACE_CALL_COUNT || !replay->loaded[r->call]) { return r->call == GL_TRACE_FRAME; }
+
+    const GlEntryPoints* gl = &replay->gl;
+    ReplayNames* maps       = replay->maps;
+    GLint* unpack_alignment = &replay->unpack_alignment;
+    const uint64_t* a = r->args;
+    float f[4];
+    for (uint32_t i = 0; i < 4 && i < r->arg_count; i++) {
+        f[i] = gl_trace_to_float(a[i]);
+    }
+
+    switch (r->call) {
+    case GL_TRACE_ATTACH_SHADER:
+        gl->glAttachShader(replay_name(&maps[REPLAY_PROGRAMS], a[0]), replay_name(&maps[REPLAY_SHADERS], a[1]));
+        break;
+    case GL_TRACE_BEGIN_QUERY: gl->glBeginQuery((GLenum)a[0], replay_name(&maps[REPLAY_QUERIES], a[1])); break;
+    case GL_TRACE_BIND_BUFFER: gl->glBindBuffer((GLenum)a[0], replay_name(&maps[REPLAY_BUFFERS], a[1])); break;
+    case GL_TRACE_BIND_FRAMEBUFFER:
+        gl->glBindFramebuffer((GLenum)a[0], replay_name(&maps[REPLAY_FRAMEBUFFERS], a[1]));
+        break;
+    case GL_TRACE_BIND_RENDERBUFFER:
+        gl->glBindRenderbuffer((GLenum)a[0], replay_name(&maps[REPLAY_RENDERBUFFERS], a[1]));
+        break;
+    case GL_TRACE_BIND_TEXTURE: gl->glBindTexture((GLenum)a[0], replay_name(&maps[REPLAY_TEXTURES], a[1])); break;
+    case GL_TRACE_BIND_VERTEX_ARRAY: gl->glBindVertexArray(replay_name(&maps[REPLAY_VERTEX_ARRAYS], a[0])); break;
+    case GL_TRACE_BLEND_FUNC: gl->glBlendFunc((GLenum)a[0], (GLenum)a[1]); break;
+    case GL_TRACE_BLIT_FRAMEBUFFER:
+        gl->glBlitFramebuffer((GLint)a[0], (GLint)a[1], (GLint)a[2], (GLint)a[3], (GLint)a[4], (GLint)a[5], (GLint)a[6],
+            (GLint)a[7], (GLbitfield)a[8], (GLenum)a[9]);
+        break;
+    case GL_TRACE_BUFFER_DATA:
+        if (!replay_payload_fits(r, 3, a[1], true)) { return false; }
+        gl->glBufferData((GLenum)a[0], (GLsizeiptr)a[1], r->payload, (GLenum)a[2]);
+        break;
+    case GL_TRACE_BUFFER_SUB_DATA:
+        if (!replay_payload_fits(r, 3, a[2], false)) { return false; }
+        gl->glBufferSubData((GLenum)a[0], (GLintptr)a[1], (GLsizeiptr)a[2], r->payload);
+        break;
+    case GL_TRACE_CHECK_FRAMEBUFFER_STATUS: gl->glCheckFramebufferStatus((GLenum)a[0]); break;
+    case GL_TRACE_CLEAR: gl->glClear((GLbitfield)a[0]); break;
+    case GL_TRACE_CLEAR_COLOR: gl->glClearColor(f[0], f[1], f[2], f[3]); break;
+    case GL_TRACE_COMPILE_SHADER: gl->glCompileShader(replay_name(&maps[REPLAY_SHADERS], a[0])); break;
+    case GL_TRACE_CREATE_PROGRAM: replay_set_name(&maps[REPLAY_PROGRAMS], a[0], gl->glCreateProgram()); break;
+    case GL_TRACE_CREATE_SHADER:
+        replay_set_name(&maps[REPLAY_SHADERS], a[1], gl->glCreateShader((GLenum)a[0]));
+        break;
+    case GL_TRACE_DELETE_BUFFERS: replay_delete(gl->glDeleteBuffers, &maps[REPLAY_BUFFERS], r); break;
+    case GL_TRACE_DELETE_FRAMEBUFFERS: replay_delete(gl->glDeleteFramebuffers, &maps[REPLAY_FRAMEBUFFERS], r); break;
+    case GL_TRACE_DELETE_PROGRAM:
+        gl->glDeleteProgram(replay_name(&maps[REPLAY_PROGRAMS], a[0]));
+        replay_set_name(&maps[REPLAY_PROGRAMS], a[0], 0);
+        break;
+    case GL_TRACE_DELETE_QUERIES: replay_delete(gl->glDeleteQueries, &maps[REPLAY_QUERIES], r); break;
+    case GL_TRACE_DELETE_RENDERBUFFERS: replay_delete(gl->glDeleteRenderbuffers, &maps[REPLAY_RENDERBUFFERS], r); break;
+    case GL_TRACE_DELETE_SHADER:
+        gl->glDeleteShader(replay_name(&maps[REPLAY_SHADERS], a[0]));
+        replay_set_name(&maps[REPLAY_SHADERS], a[0], 0);
+        break;
+    case GL_TRACE_DELETE_TEXTURES: replay_delete(gl->glDeleteTextures, &maps[REPLAY_TEXTURES], r); break;
+    case GL_TRACE_DELETE_VERTEX_ARRAYS: replay_delete(gl->glDeleteVertexArrays, &maps[REPLAY_VERTEX_ARRAYS], r); break;
+    case GL_TRACE_DISABLE: gl->glDisable((GLenum)a[0]); break;
+    case GL_TRACE_DRAW_ARRAYS: gl->glDrawArrays((GLenum)a[0], (GLint)a[1], (GLsizei)a[2]); break;
+    case GL_TRACE_DRAW_ARRAYS_INSTANCED:
+        gl->glDrawArraysInstanced((GLenum)a[0], (GLint)a[1], (GLsizei)a[2], (GLsizei)a[3]);
+        break;
+    case GL_TRACE_DRAW_ELEMENTS:
+        gl->glDrawElements((GLenum)a[0], (GLsizei)a[1], (GLenum)a[2], (const void*)(uintptr_t)a[3]);
+        break;
+    case GL_TRACE_ENABLE: gl->glEnable((GLenum)a[0]); break;
+    case GL_TRACE_ENABLE_VERTEX_ATTRIB_ARRAY: gl->glEnableVertexAttribArray((GLuint)a[0]); break;
+    case GL_TRACE_END_QUERY: gl->glEndQuery((GLenum)a[0]); break;
+    case GL_TRACE_FRAMEBUFFER_RENDERBUFFER:
+        gl->glFramebufferRenderbuffer(
+            (GLenum)a[0], (GLenum)a[1], (GLenum)a[2], replay_name(&maps[REPLAY_RENDERBUFFERS], a[3]));
+        break;
+    case GL_TRACE_FRAMEBUFFER_TEXTURE_2D:
+        gl->glFramebufferTexture2D(
+            (GLenum)a[0], (GLenum)a[1], (GLenum)a[2], replay_name(&maps[REPLAY_TEXTURES], a[3]), (GLint)a[4]);
+        break;
+    case GL_TRACE_GEN_BUFFERS: replay_gen(gl->glGenBuffers, &maps[REPLAY_BUFFERS], r); break;
+    case GL_TRACE_GEN_FRAMEBUFFERS: replay_gen(gl->glGenFramebuffers, &maps[REPLAY_FRAMEBUFFERS], r); break;
+    case GL_TRACE_GEN_QUERIES: replay_gen(gl->glGenQueries, &maps[REPLAY_QUERIES], r); break;
+    case GL_TRACE_GEN_RENDERBUFFERS: replay_gen(gl->glGenRenderbuffers, &maps[REPLAY_RENDERBUFFERS], r); break;
+    case GL_TRACE_GEN_TEXTURES: replay_gen(gl->glGenTextures, &maps[REPLAY_TEXTURES], r); break;
+    case GL_TRACE_GEN_VERTEX_ARRAYS: replay_gen(gl->glGenVertexArrays, &maps[REPLAY_VERTEX_ARRAYS], r); break;
+    case GL_TRACE_GENERATE_MIPMAP: gl->glGenerateMipmap((GLenum)a[0]); break;
+    case GL_TRACE_GET_UNIFORM_LOCATION:
+        if (r->payload) {
+            GLuint program = replay_name(&maps[REPLAY_PROGRAMS], a[0]);
+            GLint location = gl->glGetUniformLocation(program, (const GLchar*)r->payload);
+            if ((uint32_t)a[1] != 0xFFFFFFFFu) { replay_set_name(&maps[REPLAY_UNIFORMS], a[1], (GLuint)location); }
+        }
+        break;
+    case GL_TRACE_LINK_PROGRAM: gl->glLinkProgram(replay_name(&maps[REPLAY_PROGRAMS], a[0])); break;
+    case GL_TRACE_MAX_SHADER_COMPILER_THREADS:
+        gl->glMaxShaderCompilerThreadsKHR((GLuint)a[0]);
+        break;
+    case GL_TRACE_PIXEL_STORE_I:
+        if ((GLenum)a[0] == GL_UNPACK_ALIGNMENT) { *unpack_alignment = (GLint)a[1]; }
+        gl->glPixelStorei((GLenum)a[0], (GLint)a[1]);
+        break;
+    case GL_TRACE_RENDERBUFFER_STORAGE:
+        gl->glRenderbufferStorage((GLenum)a[0], (GLenum)a[1], (GLsizei)a[2], (GLsizei)a[3]);
+        break;
+    case GL_TRACE_SHADER_SOURCE:
+        if (r->payload) {
+            const GLchar* source = (const GLchar*)r->payload;
+            GLint length         = (GLint)r->payload_size;
+            gl->glShaderSource(replay_name(&maps[REPLAY_SHADERS], a[0]), 1, &source, &length);
+        }
+        break;
+    case GL_TRACE_TEX_IMAGE_2D:
+        if (!replay_image_fits(r, a[3], a[4], *unpack_alignment, true)) { return false; }
+        gl->glTexImage2D((GLenum)a[0], (GLint)a[1], (GLint)a[2], (GLsizei)a[3], (GLsizei)a[4], (GLint)a[5],
+            (GLenum)a[6], (GLenum)a[7], r->payload);
+        break;
+    case GL_TRACE_TEX_PARAMETER_I: gl->glTexParameteri((GLenum)a[0], (GLenum)a[1], (GLint)a[2]); break;
+    case GL_TRACE_TEX_SUB_IMAGE_2D:
+        if (!replay_image_fits(r, a[4], a[5], *unpack_alignment, false)) { return false; }
+        gl->glTexSubImage2D((GLenum)a[0], (GLint)a[1], (GLint)a[2], (GLint)a[3], (GLsizei)a[4], (GLsizei)a[5],
+            (GLenum)a[6], (GLenum)a[7], r->payload);
+        break;
+    case GL_TRACE_UNIFORM_1F: gl->glUniform1f(replay_uniform(&maps[REPLAY_UNIFORMS], a[0]), f[1]); break;
+    case GL_TRACE_UNIFORM_1I: gl->glUniform1i(replay_uniform(&maps[REPLAY_UNIFORMS], a[0]), (GLint)a[1]); break;
+    case GL_TRACE_UNIFORM_2F: gl->glUniform2f(replay_uniform(&maps[REPLAY_UNIFORMS], a[0]), f[1], f[2]); break;
+    case GL_TRACE_USE_PROGRAM: gl->glUseProgram(replay_name(&maps[REPLAY_PROGRAMS], a[0])); break;
+    case GL_TRACE_VERTEX_ATTRIB_DIVISOR: gl->glVertexAttribDivisor((GLuint)a[0], (GLuint)a[1]); break;
+    case GL_TRACE_VERTEX_ATTRIB_POINTER:
+        gl->glVertexAttribPointer((GLuint)a[0], (GLint)a[1], (GLenum)a[2], (GLboolean)a[3], (GLsizei)a[4],
+            (const void*)(uintptr_t)a[5]);
+        break;
+    case GL_TRACE_VIEWPORT: gl->glViewport((GLint)a[0], (GLint)a[1], (GLsizei)a[2], (GLsizei)a[3]); break;
+    default: break;
+    }
+    return true;
+}
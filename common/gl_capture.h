@@ -0,0 +1,117 @@
+#pragma once
+
+#include <GL/glcorearb.h>
+
+#include "gl_trace.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// GL call capture and replay on top of gl_trace, for samples that call GL through function pointers they load
+// themselves. gl_capture_begin() swaps each entry point below in the sample's dispatch table for a wrapper that records
+// the call, and any data the call reads, before making it through the driver's entry point. Queries that change no
+// state (glGet*) are left out, apart from glGetUniformLocation, whose results replays need. Writes through a buffer
+// mapping are recorded as a glBufferSubData of the mapped range when it is unmapped.
+#define GL_CAPTURE_ENTRY_POINTS(X)                                                                                     \
+    X(PFNGLATTACHSHADERPROC, glAttachShader)                                                                           \
+    X(PFNGLBEGINQUERYPROC, glBeginQuery)                                                                               \
+    X(PFNGLBINDBUFFERPROC, glBindBuffer)                                                                               \
+    X(PFNGLBINDFRAMEBUFFERPROC, glBindFramebuffer)                                                                     \
+    X(PFNGLBINDRENDERBUFFERPROC, glBindRenderbuffer)                                                                   \
+    X(PFNGLBINDTEXTUREPROC, glBindTexture)                                                                             \
+    X(PFNGLBINDVERTEXARRAYPROC, glBindVertexArray)                                                                     \
+    X(PFNGLBLENDFUNCPROC, glBlendFunc)                                                                                 \
+    X(PFNGLBLITFRAMEBUFFERPROC, glBlitFramebuffer)                                                                     \
+    X(PFNGLBUFFERDATAPROC, glBufferData)                                                                               \
+    X(PFNGLBUFFERSUBDATAPROC, glBufferSubData)                                                                         \
+    X(PFNGLCHECKFRAMEBUFFERSTATUSPROC, glCheckFramebufferStatus)                                                       \
+    X(PFNGLCLEARPROC, glClear)                                                                                         \
+    X(PFNGLCLEARCOLORPROC, glClearColor)                                                                               \
+    X(PFNGLCOMPILESHADERPROC, glCompileShader)                                                                         \
+    X(PFNGLCREATEPROGRAMPROC, glCreateProgram)                                                                         \
+    X(PFNGLCREATESHADERPROC, glCreateShader)                                                                           \
+    X(PFNGLDELETEBUFFERSPROC, glDeleteBuffers)                                                                         \
+    X(PFNGLDELETEFRAMEBUFFERSPROC, glDeleteFramebuffers)                                                               \
+    X(PFNGLDELETEPROGRAMPROC, glDeleteProgram)                                                                         \
+    X(PFNGLDELETEQUERIESPROC, glDeleteQueries)                                                                         \
+    X(PFNGLDELETERENDERBUFFERSPROC, glDeleteRenderbuffers)                                                             \
+    X(PFNGLDELETESHADERPROC, glDeleteShader)                                                                           \
+    X(PFNGLDELETETEXTURESPROC, glDeleteTextures)                                                                       \
+    X(PFNGLDELETEVERTEXARRAYSPROC, glDeleteVertexArrays)                                                               \
+    X(PFNGLDISABLEPROC, glDisable)                                                                                     \
+    X(PFNGLDRAWARRAYSPROC, glDrawArrays)                                                                               \
+    X(PFNGLDRAWARRAYSINSTANCEDPROC, glDrawArraysInstanced)                                                             \
+    X(PFNGLDRAWELEMENTSPROC, glDrawElements)                                                                           \
+    X(PFNGLENABLEPROC, glEnable)                                                                                       \
+    X(PFNGLENABLEVERTEXATTRIBARRAYPROC, glEnableVertexAttribArray)                                                     \
+    X(PFNGLENDQUERYPROC, glEndQuery)                                                                                   \
+    X(PFNGLFRAMEBUFFERRENDERBUFFERPROC, glFramebufferRenderbuffer)                                                     \
+    X(PFNGLFRAMEBUFFERTEXTURE2DPROC, glFramebufferTexture2D)                                                           \
+    X(PFNGLGENBUFFERSPROC, glGenBuffers)                                                                               \
+    X(PFNGLGENFRAMEBUFFERSPROC, glGenFramebuffers)                                                                     \
+    X(PFNGLGENQUERIESPROC, glGenQueries)                                                                               \
+    X(PFNGLGENRENDERBUFFERSPROC, glGenRenderbuffers)                                                                   \
+    X(PFNGLGENTEXTURESPROC, glGenTextures)                                                                             \
+    X(PFNGLGENVERTEXARRAYSPROC, glGenVertexArrays)                                                                     \
+    X(PFNGLGENERATEMIPMAPPROC, glGenerateMipmap)                                                                       \
+    X(PFNGLGETUNIFORMLOCATIONPROC, glGetUniformLocation)                                                               \
+    X(PFNGLLINKPROGRAMPROC, glLinkProgram)                                                                             \
+    X(PFNGLMAPBUFFERRANGEPROC, glMapBufferRange)                                                                       \
+    X(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC, glMaxShaderCompilerThreadsKHR)                                             \
+    X(PFNGLPIXELSTOREIPROC, glPixelStorei)                                                                             \
+    X(PFNGLRENDERBUFFERSTORAGEPROC, glRenderbufferStorage)                                                             \
+    X(PFNGLSHADERSOURCEPROC, glShaderSource)                                                                           \
+    X(PFNGLTEXIMAGE2DPROC, glTexImage2D)                                                                               \
+    X(PFNGLTEXPARAMETERIPROC, glTexParameteri)                                                                         \
+    X(PFNGLTEXSUBIMAGE2DPROC, glTexSubImage2D)                                                                         \
+    X(PFNGLUNIFORM1FPROC, glUniform1f)                                                                                 \
+    X(PFNGLUNIFORM1IPROC, glUniform1i)                                                                                 \
+    X(PFNGLUNIFORM2FPROC, glUniform2f)                                                                                 \
+    X(PFNGLUNMAPBUFFERPROC, glUnmapBuffer)                                                                             \
+    X(PFNGLUSEPROGRAMPROC, glUseProgram)                                                                               \
+    X(PFNGLVERTEXATTRIBDIVISORPROC, glVertexAttribDivisor)                                                             \
+    X(PFNGLVERTEXATTRIBPOINTERPROC, glVertexAttribPointer)                                                             \
+    X(PFNGLVIEWPORTPROC, glViewport)
+
+// Where the sample keeps each of its entry points, e.g. `dispatch.glBindBuffer = &glBindBuffer;`. Entry points the
+// sample leaves NULL here, or has not loaded, are neither captured nor replayed.
+#define GL_CAPTURE_DISPATCH_SLOT(type, name) type* name;
+typedef struct GlCaptureDispatch {
+    GL_CAPTURE_ENTRY_POINTS(GL_CAPTURE_DISPATCH_SLOT)
+} GlCaptureDispatch;
+#undef GL_CAPTURE_DISPATCH_SLOT
+
+// Everything from here until gl_capture_end() goes into the trace, so this wants calling before any GL objects are
+// created for the replay to be able to recreate them. Returns false if the trace cannot be created or a capture is
+// already running. The slots the dispatch table points at have to stay put until gl_capture_end().
+bool gl_capture_begin(const GlCaptureDispatch* dispatch, const char* path);
+
+bool gl_capture_active(void);
+
+// Marks a present, ending the captured frame.
+void gl_capture_frame(void);
+
+// Puts the driver's entry points back and closes the trace. Returns false if anything failed to write, or if no
+// capture was running, in which case the stats are zero.
+bool gl_capture_end(GlTraceStats* stats);
+
+// Plays a trace back through the entry points in a dispatch table, as they are when the replay is created. Object
+// names and uniform locations differ between a capture and its replay, so the replay maps the recorded ones to the ones
+// the driver hands out. Uniform locations are mapped from the most recent glGetUniformLocation that returned them,
+// which is how the samples look them up. Presenting on frame markers is left to the sample.
+typedef struct GlReplay GlReplay;
+
+GlReplay* gl_replay_create(const GlCaptureDispatch* dispatch);
+void gl_replay_destroy(GlReplay* replay);
+
+// Makes one recorded call. Returns false for a call skipped because its payload does not match its arguments or
+// because the sample has no such entry point.
+bool gl_replay_call(GlReplay* replay, const GlTraceRecord* record);
+
+#ifdef __cplusplus
+}
+#endif
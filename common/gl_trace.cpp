@@ -0,0 +1,287 @@
+#include "gl_trace.h"
+
+#include "hash.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Records are encoded into memory and written out in chunks of about this size.
+#define GL_TRACE_FLUSH_SIZE (256 * 1024)
+
+static const char* const call_names[] = {
+    "blob",
+    "frame",
+    "glAttachShader",
+    "glBeginQuery",
+    "glBindBuffer",
+    "glBindFramebuffer",
+    "glBindRenderbuffer",
+    "glBindTexture",
+    "glBindVertexArray",
+    "glBlendFunc",
+    "glBlitFramebuffer",
+    "glBufferData",
+    "glBufferSubData",
+    "glCheckFramebufferStatus",
+    "glClear",
+    "glClearColor",
+    "glCompileShader",
+    "glCreateProgram",
+    "glCreateShader",
+    "glDeleteBuffers",
+    "glDeleteFramebuffers",
+    "glDeleteProgram",
+    "glDeleteQueries",
+    "glDeleteRenderbuffers",
+    "glDeleteShader",
+    "glDeleteTextures",
+    "glDeleteVertexArrays",
+    "glDisable",
+    "glDrawArrays",
+    "glDrawArraysInstanced",
+    "glDrawElements",
+    "glEnable",
+    "glEnableVertexAttribArray",
+    "glEndQuery",
+    "glFramebufferRenderbuffer",
+    "glFramebufferTexture2D",
+    "glGenBuffers",
+    "glGenFramebuffers",
+    "glGenQueries",
+    "glGenRenderbuffers",
+    "glGenTextures",
+    "glGenVertexArrays",
+    "glGenerateMipmap",
+    "glGetUniformLocation",
+    "glLinkProgram",
+    "glMaxShaderCompilerThreadsKHR",
+    "glPixelStorei",
+    "glRenderbufferStorage",
+    "glShaderSource",
+    "glTexImage2D",
+    "glTexParameteri",
+    "glTexSubImage2D",
+    "glUniform1f",
+    "glUniform1i",
+    "glUniform2f",
+    "glUseProgram",
+    "glVertexAttribDivisor",
+    "glVertexAttribPointer",
+    "glViewport",
+};
+static_assert(sizeof(call_names) / sizeof(call_names[0]) == GL_TRACE_CALL_COUNT, "a call is missing its name");
+
+typedef struct TraceBlob {
+    uint32_t index;
+    uint64_t size;
+} TraceBlob;
+
+struct GlTraceWriter {
+    FILE* file;
+    bool failed;
+    std::vector<uint8_t> buffer;
+    std::unordered_map<uint64_t, TraceBlob> blobs; // by hash
+    GlTraceStats stats;
+};
+
+struct GlTraceReader {
+    std::vector<uint8_t> data;
+    size_t cursor;
+    bool failed;
+    std::vector<size_t> blob_offsets; // into data, by index - 1
+    std::vector<uint64_t> blob_sizes;
+};
+
+const char* gl_trace_call_name(GlTraceCall call)
+{
+    return (uint32_t)call < GL_TRACE_CALL_COUNT ? call_names[call] : "unknown";
+}
+
+uint64_t gl_trace_float(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float gl_trace_to_float(uint64_t arg)
+{
+    uint32_t bits = (uint32_t)arg;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void put_varint(std::vector<uint8_t>* out, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7) {
+        out->push_back((uint8_t)(value | 0x80));
+    }
+    out->push_back((uint8_t)value);
+}
+
+static void flush(GlTraceWriter* writer)
+{
+    if (writer->buffer.empty()) { return; }
+    if (fwrite(writer->buffer.data(), 1, writer->buffer.size(), writer->file) != writer->buffer.size()) {
+        writer->failed = true;
+    }
+    writer->stats.file_bytes += writer->buffer.size();
+    writer->buffer.clear();
+}
+
+GlTraceWriter* gl_trace_create(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) { return NULL; }
+
+    GlTraceWriter* writer = new GlTraceWriter();
+    writer->file          = file;
+    writer->buffer.reserve(GL_TRACE_FLUSH_SIZE + 1024);
+    uint32_t header[2] = { GL_TRACE_MAGIC, GL_TRACE_VERSION };
+    writer->buffer.insert(writer->buffer.end(), (const uint8_t*)header, (const uint8_t*)(header + 2));
+    return writer;
+}
+
+bool gl_trace_close(GlTraceWriter* writer, GlTraceStats* stats)
+{
+    if (!writer) { return false; }
+    flush(writer);
+    bool ok = !writer->failed && fclose(writer->file) == 0;
+    if (stats) { *stats = writer->stats; }
+    delete writer;
+    return ok;
+}
+
+// Index of the blob holding these bytes, writing it first if this is the first time they have been seen.
+static uint32_t intern_blob(GlTraceWriter* writer, const void* data, uint64_t size)
+{
+    uint64_t hash    = hash_fnv1a(data, (size_t)size, HASH_FNV1A_SEED);
+    auto found       = writer->blobs.find(hash);
+    bool same_length = found != writer->blobs.end() && found->second.size == size;
+    if (same_length) { return found->second.index; }
+
+    // A 64 bit hash collision between two different sizes keeps the newer blob; the older is still in the file.
+    TraceBlob blob      = { ++writer->stats.blobs, size };
+    writer->blobs[hash] = blob;
+    writer->stats.blob_bytes += size;
+    put_varint(&writer->buffer, GL_TRACE_BLOB);
+    put_varint(&writer->buffer, size);
+    flush(writer);
+    if (fwrite(data, 1, (size_t)size, writer->file) != size) { writer->failed = true; }
+    writer->stats.file_bytes += size;
+    return blob.index;
+}
+
+void gl_trace_call(GlTraceWriter* writer, GlTraceCall call, const uint64_t* args, uint32_t arg_count,
+    const void* payload, uint64_t payload_size)
+{
+    if (arg_count > GL_TRACE_MAX_ARGS) { arg_count = GL_TRACE_MAX_ARGS; }
+    uint32_t blob = 0;
+    if (payload) {
+        blob = intern_blob(writer, payload, payload_size);
+        writer->stats.payload_bytes += payload_size;
+    }
+
+    put_varint(&writer->buffer, call);
+    put_varint(&writer->buffer, ((uint64_t)arg_count << 1) | (blob ? 1 : 0));
+    for (uint32_t i = 0; i < arg_count; i++) {
+        put_varint(&writer->buffer, args[i]);
+    }
+    if (blob) { put_varint(&writer->buffer, blob); }
+    writer->stats.calls++;
+    if (writer->buffer.size() >= GL_TRACE_FLUSH_SIZE) { flush(writer); }
+}
+
+void gl_trace_frame(GlTraceWriter* writer)
+{
+    uint64_t frame = writer->stats.frames++;
+    put_varint(&writer->buffer, GL_TRACE_FRAME);
+    put_varint(&writer->buffer, 1 << 1);
+    put_varint(&writer->buffer, frame);
+}
+
+GlTraceReader* gl_trace_open(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) { return NULL; }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    GlTraceReader* reader = new GlTraceReader();
+    reader->data.resize(size > 0 ? (size_t)size : 0);
+    size_t length = reader->data.size();
+    bool read     = length && fread(reader->data.data(), 1, length, file) == length;
+    fclose(file);
+
+    uint32_t header[2] = { 0, 0 };
+    if (read && reader->data.size() >= sizeof(header)) { memcpy(header, reader->data.data(), sizeof(header)); }
+    if (header[0] != GL_TRACE_MAGIC || header[1] != GL_TRACE_VERSION) {
+        delete reader;
+        return NULL;
+    }
+    reader->cursor = sizeof(header);
+    reader->failed = false;
+    return reader;
+}
+
+void gl_trace_reader_close(GlTraceReader* reader) { delete reader; }
+
+static bool get_varint(GlTraceReader* reader, uint64_t* value)
+{
+    *value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (reader->cursor == reader->data.size()) { return false; }
+        uint8_t byte = reader->data[reader->cursor++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
+
+static bool read_record(GlTraceReader* reader, GlTraceRecord* record)
+{
+    uint64_t call, count;
+    for (;;) {
+        if (!get_varint(reader, &call)) { return false; }
+        if (call != GL_TRACE_BLOB) { break; }
+        uint64_t size;
+        if (!get_varint(reader, &size) || size > reader->data.size() - reader->cursor) { return false; }
+        reader->blob_offsets.push_back(reader->cursor);
+        reader->blob_sizes.push_back(size);
+        reader->cursor += (size_t)size;
+    }
+    if (call >= GL_TRACE_CALL_COUNT || !get_varint(reader, &count) || (count >> 1) > GL_TRACE_MAX_ARGS) {
+        return false;
+    }
+
+    record->call         = (GlTraceCall)call;
+    record->arg_count    = (uint32_t)(count >> 1);
+    record->payload      = NULL;
+    record->payload_size = 0;
+    for (uint32_t i = 0; i < record->arg_count; i++) {
+        if (!get_varint(reader, &record->args[i])) { return false; }
+    }
+    if (count & 1) {
+        uint64_t blob;
+        if (!get_varint(reader, &blob) || blob == 0 || blob > reader->blob_offsets.size()) { return false; }
+        record->payload      = reader->data.data() + reader->blob_offsets[(size_t)blob - 1];
+        record->payload_size = reader->blob_sizes[(size_t)blob - 1];
+    }
+    return true;
+}
+
+bool gl_trace_next(GlTraceReader* reader, GlTraceRecord* record)
+{
+    if (reader->failed || reader->cursor == reader->data.size()) { return false; }
+    if (!read_record(reader, record)) {
+        reader->failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool gl_trace_failed(const GlTraceReader* reader) { return reader->failed; }
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A compact binary record of the GL calls a renderer made, for reproducing and analyzing performance problems away
+// from the machine they happened on. Writing and reading a trace needs no GL; the samples record by swapping their
+// dispatch table for recording wrappers, and tools/gl_trace analyzes a trace on any platform.
+//
+// The layout, all little endian:
+//     uint32_t magic, uint32_t version
+//     records, each starting with a varint GlTraceCall
+// A GL_TRACE_BLOB record is a varint size and that many bytes. Every other record is a varint of the argument count
+// shifted left once, with the low bit set if a payload follows the arguments, then each argument as a varint, then the
+// payload as a varint index of an earlier blob, counting from 1. Payloads are deduplicated by hash, so a texture or
+// buffer uploaded each frame with the same contents is stored once.
+//
+// Arguments are stored as the C types the entry point takes: integers as themselves (GLint and GLsizei as 32 bits,
+// so -1 reads back as 0xFFFFFFFF), floats as their bits, pointers into bound buffers as offsets. Calls that return a
+// value have it as their last argument.
+#define GL_TRACE_MAGIC 0x544c4757u // "WGLT"
+#define GL_TRACE_VERSION 2
+#define GL_TRACE_MAX_ARGS 12
+
+typedef enum GlTraceCall {
+    GL_TRACE_BLOB,  // internal; never returned by gl_trace_next()
+    GL_TRACE_FRAME, // a present; args[0] is the number of the frame it ends
+    GL_TRACE_ATTACH_SHADER,
+    GL_TRACE_BEGIN_QUERY,
+    GL_TRACE_BIND_BUFFER,
+    GL_TRACE_BIND_FRAMEBUFFER,
+    GL_TRACE_BIND_RENDERBUFFER,
+    GL_TRACE_BIND_TEXTURE,
+    GL_TRACE_BIND_VERTEX_ARRAY,
+    GL_TRACE_BLEND_FUNC,
+    GL_TRACE_BLIT_FRAMEBUFFER,
+    GL_TRACE_BUFFER_DATA,     // payload: the data, if any
+    GL_TRACE_BUFFER_SUB_DATA, // payload: the data; also what was written through a mapping, when it is unmapped
+    GL_TRACE_CHECK_FRAMEBUFFER_STATUS,
+    GL_TRACE_CLEAR,
+    GL_TRACE_CLEAR_COLOR,
+    GL_TRACE_COMPILE_SHADER,
+    GL_TRACE_CREATE_PROGRAM,
+    GL_TRACE_CREATE_SHADER,
+    GL_TRACE_DELETE_BUFFERS, // payload: the names, for this and the other deletes and gens
+    GL_TRACE_DELETE_FRAMEBUFFERS,
+    GL_TRACE_DELETE_PROGRAM,
+    GL_TRACE_DELETE_QUERIES,
+    GL_TRACE_DELETE_RENDERBUFFERS,
+    GL_TRACE_DELETE_SHADER,
+    GL_TRACE_DELETE_TEXTURES,
+    GL_TRACE_DELETE_VERTEX_ARRAYS,
+    GL_TRACE_DISABLE,
+    GL_TRACE_DRAW_ARRAYS,
+    GL_TRACE_DRAW_ARRAYS_INSTANCED,
+    GL_TRACE_DRAW_ELEMENTS,
+    GL_TRACE_ENABLE,
+    GL_TRACE_ENABLE_VERTEX_ATTRIB_ARRAY,
+    GL_TRACE_END_QUERY,
+    GL_TRACE_FRAMEBUFFER_RENDERBUFFER,
+    GL_TRACE_FRAMEBUFFER_TEXTURE_2D,
+    GL_TRACE_GEN_BUFFERS,
+    GL_TRACE_GEN_FRAMEBUFFERS,
+    GL_TRACE_GEN_QUERIES,
+    GL_TRACE_GEN_RENDERBUFFERS,
+    GL_TRACE_GEN_TEXTURES,
+    GL_TRACE_GEN_VERTEX_ARRAYS,
+    GL_TRACE_GENERATE_MIPMAP,
+    GL_TRACE_GET_UNIFORM_LOCATION, // payload: the name
+    GL_TRACE_LINK_PROGRAM,
+    GL_TRACE_MAX_SHADER_COMPILER_THREADS,
+    GL_TRACE_PIXEL_STORE_I,
+    GL_TRACE_RENDERBUFFER_STORAGE,
+    GL_TRACE_SHADER_SOURCE, // payload: the strings, concatenated
+    GL_TRACE_TEX_IMAGE_2D,  // payload: the pixels, if any
+    GL_TRACE_TEX_PARAMETER_I,
+    GL_TRACE_TEX_SUB_IMAGE_2D, // payload: the pixels
+    GL_TRACE_UNIFORM_1F,
+    GL_TRACE_UNIFORM_1I,
+    GL_TRACE_UNIFORM_2F,
+    GL_TRACE_USE_PROGRAM,
+    GL_TRACE_VERTEX_ATTRIB_DIVISOR,
+    GL_TRACE_VERTEX_ATTRIB_POINTER,
+    GL_TRACE_VIEWPORT,
+    GL_TRACE_CALL_COUNT,
+} GlTraceCall;
+
+typedef struct GlTraceWriter GlTraceWriter;
+typedef struct GlTraceReader GlTraceReader;
+
+typedef struct GlTraceRecord {
+    GlTraceCall call;
+    uint32_t arg_count;
+    uint64_t args[GL_TRACE_MAX_ARGS];
+    const void* payload; // NULL if the call had none; valid until the reader is closed
+    uint64_t payload_size;
+} GlTraceRecord;
+
+typedef struct GlTraceStats {
+    uint64_t calls;
+    uint32_t frames;
+    uint32_t blobs;
+    uint64_t payload_bytes; // passed to gl_trace_call(), before deduplication
+    uint64_t blob_bytes;    // written, after it
+    uint64_t file_bytes;
+} GlTraceStats;
+
+// The entry point's name, e.g. "glBindBuffer".
+const char* gl_trace_call_name(GlTraceCall call);
+
+uint64_t gl_trace_float(float value);
+float gl_trace_to_float(uint64_t arg);
+
+// Returns NULL if the file cannot be created.
+GlTraceWriter* gl_trace_create(const char* path);
+
+// Flushes and closes the file, returning false if anything failed to write.
+bool gl_trace_close(GlTraceWriter* writer, GlTraceStats* stats);
+
+void gl_trace_call(GlTraceWriter* writer, GlTraceCall call, const uint64_t* args, uint32_t arg_count,
+    const void* payload, uint64_t payload_size);
+void gl_trace_frame(GlTraceWriter* writer);
+
+// Reads the whole trace into memory. Returns NULL if the file is missing or is not a trace.
+GlTraceReader* gl_trace_open(const char* path);
+void gl_trace_reader_close(GlTraceReader* reader);
+
+// The next call or frame marker. False at the end of the trace, or at the first malformed record.
+bool gl_trace_next(GlTraceReader* reader, GlTraceRecord* record);
+
+// True if gl_trace_next() stopped on a malformed or truncated record rather than at the end.
+bool gl_trace_failed(const GlTraceReader* reader);
+
+#ifdef __cplusplus
+}
+#endif
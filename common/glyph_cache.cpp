@@ -0,0 +1,390 @@
+#include "glyph_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#define GLYPH_DEFAULT_SDF_SIZE 32u
+#define GLYPH_DEFAULT_SUPERSAMPLE 4u
+#define GLYPH_DEFAULT_SPREAD 4u
+#define GLYPH_DEFAULT_ATLAS_SIZE 512u
+
+// Slots leave a quarter of an em over the em square for accents, descenders and wide glyphs.
+#define GLYPH_SLOT_EMS 1.25f
+
+#define GLYPH_EDT_INF 1e20f
+
+// A rasterized glyph on its way into the atlas. `pixels` is a whole slot, so uploading it also clears whatever the
+// slot held before.
+typedef struct GlyphTile {
+    Glyph glyph;     // slot and UVs are filled in once it is placed
+    uint32_t width;  // of the distance field within the slot
+    uint32_t height;
+    std::vector<uint8_t> pixels;
+} GlyphTile;
+
+typedef struct GlyphSlot {
+    uint32_t codepoint;
+    uint64_t last_used;
+    bool used;
+} GlyphSlot;
+
+typedef struct GlyphEntry {
+    Glyph glyph;
+    bool ready;
+} GlyphEntry;
+
+typedef struct GlyphJob {
+    GlyphCache* cache;
+    uint32_t codepoint;
+} GlyphJob;
+
+struct GlyphCache {
+    GlyphCacheDesc desc;
+    uint32_t slot_size;
+    uint32_t columns;
+    std::unordered_map<uint32_t, GlyphEntry> glyphs;
+    std::vector<GlyphSlot> slots;
+    uint64_t frame;
+    uint64_t generation;
+    std::deque<GlyphTile> waiting;   // rasterized, not in the atlas yet
+    std::vector<GlyphTile> uploaded; // pixels behind the last update's uploads
+    GlyphCacheStats stats;
+
+    // Shared with the jobs.
+    std::mutex mutex;
+    std::condition_variable drained;
+    uint32_t jobs_in_flight;
+    std::deque<GlyphTile> finished;
+};
+
+// Felzenszwalb and Huttenlocher's exact squared distance transform of one line. f is 0 at feature texels and
+// GLYPH_EDT_INF elsewhere; d gets the squared distance from each texel to the nearest feature.
+static void edt_line(const float* f, float* d, uint32_t n, int32_t* v, float* z)
+{
+    int32_t k = 0;
+    v[0]      = 0;
+    z[0]      = -GLYPH_EDT_INF;
+    z[1]      = GLYPH_EDT_INF;
+    for (int32_t q = 1; q < (int32_t)n; q++) {
+        float s;
+        for (;;) {
+            int32_t p = v[k];
+            s         = ((f[q] + (float)(q * q)) - (f[p] + (float)(p * p))) / (float)(2 * q - 2 * p);
+            if (s > z[k] || k == 0) { break; }
+            k--;
+        }
+        k++;
+        v[k]     = q;
+        z[k]     = s;
+        z[k + 1] = GLYPH_EDT_INF;
+    }
+
+    k = 0;
+    for (int32_t q = 0; q < (int32_t)n; q++) {
+        while (z[k + 1] < (float)q) {
+            k++;
+        }
+        float offset = (float)(q - v[k]);
+        d[q]         = offset * offset + f[v[k]];
+    }
+}
+
+// Columns, then rows, in place.
+static void edt_2d(float* grid, uint32_t width, uint32_t height)
+{
+    uint32_t longest = std::max(width, height);
+    std::vector<float> f(longest), d(longest), z(longest + 1);
+    std::vector<int32_t> v(longest);
+
+    for (uint32_t x = 0; x < width; x++) {
+        // Columns without a feature, like most of the padding, stay at infinity.
+        bool any = false;
+        for (uint32_t y = 0; y < height; y++) {
+            f[y] = grid[(size_t)y * width + x];
+            any  = any || f[y] == 0.0f;
+        }
+        if (!any) { continue; }
+        edt_line(f.data(), d.data(), height, v.data(), z.data());
+        for (uint32_t y = 0; y < height; y++) {
+            grid[(size_t)y * width + x] = d[y];
+        }
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        float* row = grid + (size_t)y * width;
+        memcpy(f.data(), row, width * sizeof(float));
+        edt_line(f.data(), row, width, v.data(), z.data());
+    }
+}
+
+void glyph_sdf_generate(const uint8_t* coverage, uint32_t width, uint32_t height, uint32_t supersample,
+    uint32_t spread, uint32_t max_width, uint32_t max_height, uint8_t* sdf, uint32_t* sdf_width, uint32_t* sdf_height)
+{
+    supersample = std::max(supersample, 1u);
+    spread      = std::max(spread, 1u);
+
+    // The bitmap sits `padding` pixels in from the grid's top left corner, with the grid rounded up to whole texels.
+    uint32_t padding = spread * supersample;
+    uint32_t out_w   = std::min((width + 2 * padding + supersample - 1) / supersample, max_width);
+    uint32_t out_h   = std::min((height + 2 * padding + supersample - 1) / supersample, max_height);
+    uint32_t grid_w  = out_w * supersample;
+    uint32_t grid_h  = out_h * supersample;
+    *sdf_width       = out_w;
+    *sdf_height      = out_h;
+    if (!out_w || !out_h) { return; }
+
+    // Two transforms: how far each outside pixel is from the glyph and how far each inside pixel is from the outside.
+    std::vector<uint8_t> inside((size_t)grid_w * grid_h, 0);
+    for (uint32_t y = padding; y < std::min(grid_h, height + padding); y++) {
+        const uint8_t* row = coverage + (size_t)(y - padding) * width;
+        for (uint32_t x = padding; x < std::min(grid_w, width + padding); x++) {
+            inside[(size_t)y * grid_w + x] = row[x - padding] >= 128;
+        }
+    }
+    std::vector<float> to_inside(inside.size()), to_outside(inside.size());
+    for (size_t i = 0; i < inside.size(); i++) {
+        to_inside[i]  = inside[i] ? 0.0f : GLYPH_EDT_INF;
+        to_outside[i] = inside[i] ? GLYPH_EDT_INF : 0.0f;
+    }
+    edt_2d(to_inside.data(), grid_w, grid_h);
+    edt_2d(to_outside.data(), grid_w, grid_h);
+
+    // Each texel takes the mean signed distance of the pixels it covers. Pixel centres sit half a pixel from the
+    // outline at best, hence the 0.5.
+    float scale = 127.0f / (float)(spread * supersample * supersample * supersample);
+    for (uint32_t ty = 0; ty < out_h; ty++) {
+        for (uint32_t tx = 0; tx < out_w; tx++) {
+            float sum = 0.0f;
+            for (uint32_t y = ty * supersample; y < (ty + 1) * supersample; y++) {
+                for (uint32_t x = tx * supersample; x < (tx + 1) * supersample; x++) {
+                    size_t i = (size_t)y * grid_w + x;
+                    sum += inside[i] ? sqrtf(to_outside[i]) - 0.5f : 0.5f - sqrtf(to_inside[i]);
+                }
+            }
+            float value          = 128.0f + sum * scale;
+            sdf[ty * out_w + tx] = (uint8_t)std::min(std::max(value + 0.5f, 0.0f), 255.0f);
+        }
+    }
+}
+
+static void build_tile(const GlyphCache* cache, uint32_t codepoint, GlyphTile* tile)
+{
+    const GlyphCacheDesc* desc = &cache->desc;
+    uint32_t pixel_size        = desc->sdf_size * desc->supersample;
+    tile->glyph                = {};
+    tile->glyph.codepoint      = codepoint;
+    tile->glyph.slot           = GLYPH_NO_SLOT;
+    tile->width                = 0;
+    tile->height               = 0;
+
+    GlyphBitmap bitmap = {};
+    if (!desc->rasterize(desc->user, codepoint, pixel_size, &bitmap)) {
+        free(bitmap.coverage);
+        return;
+    }
+    tile->glyph.advance = bitmap.advance / (float)pixel_size;
+
+    if (bitmap.width && bitmap.height && bitmap.coverage) {
+        std::vector<uint8_t> sdf((size_t)cache->slot_size * cache->slot_size);
+        glyph_sdf_generate(bitmap.coverage, bitmap.width, bitmap.height, desc->supersample, desc->spread,
+            cache->slot_size, cache->slot_size, sdf.data(), &tile->width, &tile->height);
+
+        tile->pixels.assign(sdf.size(), 0);
+        for (uint32_t y = 0; y < tile->height; y++) {
+            memcpy(&tile->pixels[(size_t)y * cache->slot_size], &sdf[(size_t)y * tile->width], tile->width);
+        }
+
+        float padding       = (float)(desc->spread * desc->supersample);
+        tile->glyph.x0      = (bitmap.left - padding) / (float)pixel_size;
+        tile->glyph.y0      = (-bitmap.top - padding) / (float)pixel_size;
+        tile->glyph.x1      = tile->glyph.x0 + (float)tile->width / (float)desc->sdf_size;
+        tile->glyph.y1      = tile->glyph.y0 + (float)tile->height / (float)desc->sdf_size;
+        tile->glyph.visible = true;
+    }
+    free(bitmap.coverage);
+}
+
+static void rasterize_job(void* data)
+{
+    GlyphJob* job     = (GlyphJob*)data;
+    GlyphCache* cache = job->cache;
+    GlyphTile tile;
+    build_tile(cache, job->codepoint, &tile);
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->finished.push_back(std::move(tile));
+    delete job;
+    if (--cache->jobs_in_flight == 0) { cache->drained.notify_all(); }
+}
+
+GlyphCache* glyph_cache_create(const GlyphCacheDesc* desc)
+{
+    if (!desc->rasterize) { return NULL; }
+
+    GlyphCache* cache = new GlyphCache();
+    cache->desc       = *desc;
+    if (!cache->desc.sdf_size) { cache->desc.sdf_size = GLYPH_DEFAULT_SDF_SIZE; }
+    if (!cache->desc.supersample) { cache->desc.supersample = GLYPH_DEFAULT_SUPERSAMPLE; }
+    if (!cache->desc.spread) { cache->desc.spread = GLYPH_DEFAULT_SPREAD; }
+    if (!cache->desc.atlas_width) { cache->desc.atlas_width = GLYPH_DEFAULT_ATLAS_SIZE; }
+    if (!cache->desc.atlas_height) { cache->desc.atlas_height = GLYPH_DEFAULT_ATLAS_SIZE; }
+
+    cache->slot_size = (uint32_t)ceilf((float)cache->desc.sdf_size * GLYPH_SLOT_EMS) + 2 * cache->desc.spread;
+    cache->columns   = cache->desc.atlas_width / cache->slot_size;
+    cache->slots.resize((size_t)cache->columns * (cache->desc.atlas_height / cache->slot_size));
+    cache->frame          = 1;
+    cache->generation     = 0;
+    cache->jobs_in_flight = 0;
+    cache->stats          = {};
+    cache->stats.slots    = (uint32_t)cache->slots.size();
+    return cache;
+}
+
+void glyph_cache_destroy(GlyphCache* cache)
+{
+    {
+        std::unique_lock<std::mutex> lock(cache->mutex);
+        cache->drained.wait(lock, [cache] { return cache->jobs_in_flight == 0; });
+    }
+    delete cache;
+}
+
+void glyph_cache_atlas_size(const GlyphCache* cache, uint32_t* width, uint32_t* height)
+{
+    *width  = cache->desc.atlas_width;
+    *height = cache->desc.atlas_height;
+}
+
+const Glyph* glyph_cache_get(GlyphCache* cache, uint32_t codepoint)
+{
+    auto found = cache->glyphs.find(codepoint);
+    if (found != cache->glyphs.end()) {
+        if (!found->second.ready) { return NULL; }
+        cache->stats.hits++;
+        glyph_cache_touch(cache, found->second.glyph.slot);
+        return &found->second.glyph;
+    }
+
+    cache->stats.misses++;
+    cache->glyphs[codepoint] = {};
+    if (!cache->desc.jobs) {
+        GlyphTile tile;
+        build_tile(cache, codepoint, &tile);
+        cache->waiting.push_back(std::move(tile));
+        return NULL;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->jobs_in_flight++;
+    }
+    job_pool_submit(cache->desc.jobs, rasterize_job, new GlyphJob { cache, codepoint });
+    return NULL;
+}
+
+void glyph_cache_touch(GlyphCache* cache, uint32_t slot)
+{
+    if (slot != GLYPH_NO_SLOT) { cache->slots[slot].last_used = cache->frame; }
+}
+
+uint64_t glyph_cache_generation(const GlyphCache* cache) { return cache->generation; }
+
+// A free slot if there is one, otherwise the least recently used one that was not drawn from last frame.
+static uint32_t claim_slot(GlyphCache* cache)
+{
+    uint32_t oldest = GLYPH_NO_SLOT;
+    for (uint32_t i = 0; i < (uint32_t)cache->slots.size(); i++) {
+        const GlyphSlot& slot = cache->slots[i];
+        if (!slot.used) { return i; }
+        bool older = oldest == GLYPH_NO_SLOT || slot.last_used < cache->slots[oldest].last_used;
+        if (slot.last_used < cache->frame && older) { oldest = i; }
+    }
+    if (oldest == GLYPH_NO_SLOT) { return oldest; }
+
+    cache->glyphs.erase(cache->slots[oldest].codepoint);
+    cache->slots[oldest].used = false;
+    cache->generation++;
+    cache->stats.evictions++;
+    return oldest;
+}
+
+uint32_t glyph_cache_update(GlyphCache* cache, GlyphUpload* uploads, uint32_t max_uploads)
+{
+    cache->uploaded.clear();
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        for (GlyphTile& tile : cache->finished) {
+            cache->waiting.push_back(std::move(tile));
+        }
+        cache->finished.clear();
+    }
+
+    uint32_t count = 0;
+    while (!cache->waiting.empty()) {
+        GlyphTile& tile   = cache->waiting.front();
+        GlyphEntry* entry = &cache->glyphs[tile.glyph.codepoint];
+
+        // Whitespace and missing glyphs only need their advance.
+        if (!tile.glyph.visible) {
+            entry->glyph = tile.glyph;
+            entry->ready = true;
+            cache->stats.rasterized++;
+            cache->waiting.pop_front();
+            continue;
+        }
+
+        if (count == max_uploads) { break; }
+        uint32_t slot = claim_slot(cache);
+        if (slot == GLYPH_NO_SLOT) {
+            cache->stats.full_frames++;
+            break;
+        }
+
+        uint32_t x         = (slot % cache->columns) * cache->slot_size;
+        uint32_t y         = (slot / cache->columns) * cache->slot_size;
+        cache->slots[slot] = { tile.glyph.codepoint, cache->frame, true };
+
+        float atlas_w   = (float)cache->desc.atlas_width;
+        float atlas_h   = (float)cache->desc.atlas_height;
+        tile.glyph.slot = slot;
+        tile.glyph.u0   = (float)x / atlas_w;
+        tile.glyph.v0   = (float)y / atlas_h;
+        tile.glyph.u1   = (float)(x + tile.width) / atlas_w;
+        tile.glyph.v1   = (float)(y + tile.height) / atlas_h;
+        entry->glyph    = tile.glyph;
+        entry->ready    = true;
+
+        uploads[count++] = { x, y, cache->slot_size, cache->slot_size, NULL };
+        cache->uploaded.push_back(std::move(tile));
+        cache->waiting.pop_front();
+        cache->stats.rasterized++;
+        cache->stats.uploads++;
+    }
+    // Moving a tile keeps its pixel buffer where it is, but only take the pointers once every tile has settled.
+    for (uint32_t i = 0; i < count; i++) {
+        uploads[i].pixels = cache->uploaded[i].pixels.data();
+    }
+
+    cache->frame++;
+    return count;
+}
+
+GlyphCacheStats glyph_cache_stats(const GlyphCache* cache)
+{
+    GlyphCacheStats stats = cache->stats;
+    stats.resident        = 0;
+    stats.pending         = 0;
+    for (const GlyphSlot& slot : cache->slots) {
+        stats.resident += slot.used ? 1 : 0;
+    }
+    for (const auto& glyph : cache->glyphs) {
+        stats.pending += glyph.second.ready ? 0 : 1;
+    }
+    return stats;
+}
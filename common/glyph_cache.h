@@ -0,0 +1,120 @@
+#pragma once
+
+#include "job_pool.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Coverage bitmap of one glyph, as produced by the platform's font rasterizer. All metrics are in pixels at the size
+// the glyph was rasterized at. `coverage` is malloc'ed by the rasterizer and freed by the cache.
+typedef struct GlyphBitmap {
+    uint32_t width;
+    uint32_t height;
+    uint8_t* coverage; // width * height bytes, top row first, 0 outside the glyph and 255 inside
+    float left;        // from the pen position to the bitmap's left edge
+    float top;         // from the baseline up to the bitmap's top edge
+    float advance;     // pen movement to the next glyph
+} GlyphBitmap;
+
+// Rasterizes `codepoint` with an em size of pixel_size pixels. Called on worker threads, possibly several at once, so
+// it must not share unsynchronised state between calls. Whitespace returns true with an empty bitmap; returning false
+// marks the glyph as missing from the font.
+typedef bool (*GlyphRasterizeFunc)(void* user, uint32_t codepoint, uint32_t pixel_size, GlyphBitmap* bitmap);
+
+// Turns a coverage bitmap into a signed distance field `supersample` times smaller, padded by `spread` texels on each
+// side. Texels hold 128 on the outline, more inside and less outside, reaching 255 and 0 at `spread` texels from it.
+// The field is written to `sdf`, at most max_width x max_height texels (larger glyphs are cropped on the right and
+// bottom), and its size to *sdf_width and *sdf_height.
+void glyph_sdf_generate(const uint8_t* coverage, uint32_t width, uint32_t height, uint32_t supersample,
+    uint32_t spread, uint32_t max_width, uint32_t max_height, uint8_t* sdf, uint32_t* sdf_width, uint32_t* sdf_height);
+
+// Keeps signed distance fields of the glyphs in use in one single channel atlas texture, so text of any size and any
+// number of strings can be drawn from it with one texture and one draw. A distance field scales up well past the size
+// it was generated at, so one tile per glyph serves every text size.
+//
+// Glyphs are rasterized the first time they are asked for, on the job pool's threads, and turn up in the atlas a frame
+// or more later; until then glyph_cache_get() returns NULL and the text is drawn without them. The atlas is a grid of
+// equally sized slots. When it is full the least recently used glyph is evicted, though never one that was used in
+// the last frame, since the vertices of that frame may still point at it. The cache never touches GL itself:
+// glyph_cache_update() hands back the sub-rects of the atlas that changed, which the platform layer uploads with
+// glTexSubImage2D.
+typedef struct GlyphCache GlyphCache;
+
+typedef struct GlyphCacheDesc {
+    JobPool* jobs; // NULL rasterizes on the calling thread
+    GlyphRasterizeFunc rasterize;
+    void* user;            // passed to rasterize
+    uint32_t sdf_size;     // 0 = 32; em size of the distance field tiles, in texels
+    uint32_t supersample;  // 0 = 4; glyphs are rasterized at sdf_size * supersample pixels
+    uint32_t spread;       // 0 = 4; distance field range either side of the outline, in texels
+    uint32_t atlas_width;  // 0 = 512
+    uint32_t atlas_height; // 0 = 512
+} GlyphCacheDesc;
+
+#define GLYPH_NO_SLOT 0xFFFFFFFFu
+
+// Quad of a glyph relative to the pen position on the baseline, y going down, in ems. Multiply by the text size in
+// pixels to place it.
+typedef struct Glyph {
+    uint32_t codepoint;
+    uint32_t slot; // atlas slot to pass to glyph_cache_touch(), GLYPH_NO_SLOT if not visible
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+    float advance;
+    bool visible; // false for whitespace and glyphs missing from the font, which have no quad
+} Glyph;
+
+// A rect of the atlas to upload. Pixels are tightly packed, one byte per texel, and stay valid until the next
+// glyph_cache_update().
+typedef struct GlyphUpload {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    const uint8_t* pixels;
+} GlyphUpload;
+
+typedef struct GlyphCacheStats {
+    uint32_t slots;
+    uint32_t resident; // glyphs in the atlas, whitespace not included
+    uint32_t pending;  // glyphs being rasterized or waiting for a slot
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t rasterized;
+    uint64_t uploads;
+    uint64_t evictions;
+    uint64_t full_frames; // frames where a finished glyph found every slot in use
+} GlyphCacheStats;
+
+GlyphCache* glyph_cache_create(const GlyphCacheDesc* desc);
+void glyph_cache_destroy(GlyphCache* cache);
+
+void glyph_cache_atlas_size(const GlyphCache* cache, uint32_t* width, uint32_t* height);
+
+// Looks up a glyph and marks it used this frame. Returns NULL while it is still being rasterized, starting that if
+// it has not been asked for before. The pointer stays valid until the next glyph_cache_update().
+const Glyph* glyph_cache_get(GlyphCache* cache, uint32_t codepoint);
+
+// Marks a glyph used this frame without looking it up, for callers that kept it from an earlier frame and have
+// checked glyph_cache_generation() since.
+void glyph_cache_touch(GlyphCache* cache, uint32_t slot);
+
+// Bumped whenever a glyph is evicted. Anything that kept glyph quads or UVs from before a change has to look its
+// glyphs up again.
+uint64_t glyph_cache_generation(const GlyphCache* cache);
+
+// Moves glyphs that finished rasterizing into the atlas, evicting old ones if needed, and advances the frame. Call once
+// per frame before any text is drawn. Returns the number of uploads written; glyphs that did not fit in max_uploads
+// are placed on a later frame.
+uint32_t glyph_cache_update(GlyphCache* cache, GlyphUpload* uploads, uint32_t max_uploads);
+
+GlyphCacheStats glyph_cache_stats(const GlyphCache* cache);
+
+#ifdef __cplusplus
+}
+#endif
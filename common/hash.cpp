@@ -0,0 +1,22 @@
+#include "hash.h"
+
+uint64_t hash_fnv1a(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash        = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t hash_path(const char* path)
+{
+    uint64_t hash = HASH_FNV1A_SEED;
+    for (const char* c = path; *c; c++) {
+        char normalised = *c == '\\' ? '/' : *c;
+        hash            = hash_fnv1a(&normalised, 1, hash);
+    }
+    return hash;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HASH_FNV1A_SEED 0xcbf29ce484222325ull
+
+// 64-bit FNV-1a. Pass the previous result as seed to hash data in pieces.
+uint64_t hash_fnv1a(const void* data, size_t size, uint64_t seed);
+
+// FNV-1a of a relative path with backslashes read as forward slashes, so both spellings of a path hash the same.
+uint64_t hash_path(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,314 @@
+#include "hot_reload.h"
+
+#include "file_watcher.h"
+#include "hash.h"
+#include "image_decode.h"
+#include "shader_preprocess.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define HOT_RELOAD_DEFAULT_DEBOUNCE 100
+
+typedef struct HotReloadAsset {
+    std::string path;
+    HotReloadKind kind;
+    uint32_t define_mask;
+    uint64_t hash;
+    bool in_flight;
+    bool changed_again; // changed while a reload was in flight; reload again once it lands
+} HotReloadAsset;
+
+typedef struct ReloadJob {
+    HotReload* reload;
+    uint32_t asset;
+    HotReloadKind kind;
+    std::string path;
+    uint32_t define_mask;
+} ReloadJob;
+
+struct HotReload {
+    JobPool* jobs;
+    std::string glsl_version;
+    FileWatcher* watcher;
+
+    // Everything below is shared with the jobs.
+    std::mutex mutex;
+    std::condition_variable drained;
+    uint32_t jobs_in_flight;
+    std::vector<HotReloadAsset> assets;
+    std::unordered_map<std::string, std::vector<uint32_t>> dependents; // file -> assets built from it
+    std::unordered_set<std::string> directories;
+    std::vector<std::string> new_directories; // added to the watcher on the main thread
+    std::deque<HotReloadResult> finished;
+};
+
+static std::string directory_of(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+// Callers hold reload->mutex.
+static void add_dependency(HotReload* reload, const std::string& file, uint32_t asset)
+{
+    std::vector<uint32_t>& assets = reload->dependents[file];
+    for (uint32_t existing : assets) {
+        if (existing == asset) { return; }
+    }
+    assets.push_back(asset);
+
+    std::string directory = directory_of(file);
+    if (reload->directories.insert(directory).second) { reload->new_directories.push_back(directory); }
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>* contents)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) { return false; }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents->resize(size > 0 ? (size_t)size : 0);
+    size_t read = contents->empty() ? 0 : fread(contents->data(), 1, contents->size(), file);
+    fclose(file);
+
+    return read == contents->size();
+}
+
+static void reload_texture(ReloadJob* job, HotReloadResult* result)
+{
+    std::vector<uint8_t> contents;
+    if (!read_file(job->path.c_str(), &contents)) {
+        snprintf(result->error, sizeof(result->error), "%s: cannot read file", job->path.c_str());
+        return;
+    }
+    result->hash = hash_fnv1a(contents.data(), contents.size(), HASH_FNV1A_SEED);
+
+    int width, height, channels;
+    // Already on a worker, so decoded on this thread rather than split across the pool.
+    uint8_t* pixels = image_load_from_memory(contents.data(), (int)contents.size(), &width, &height, &channels, 0);
+    if (!pixels) {
+        snprintf(result->error, sizeof(result->error), "%s: %s", job->path.c_str(), image_failure_reason());
+        return;
+    }
+
+    result->ok = mip_chain_build(pixels, width, height, channels, &result->mips);
+    if (!result->ok) { snprintf(result->error, sizeof(result->error), "%s: out of memory", job->path.c_str()); }
+    image_free(pixels);
+}
+
+static void reload_shader(ReloadJob* job, HotReloadResult* result)
+{
+    ShaderPreprocessed shader;
+    bool ok = shader_preprocess(job->path.c_str(), &shader);
+
+    {
+        // Pick up includes that were added by the edit.
+        std::lock_guard<std::mutex> lock(job->reload->mutex);
+        for (uint32_t i = 0; i < shader.file_count; i++) {
+            add_dependency(job->reload, shader.files[i], job->asset);
+        }
+    }
+
+    if (!ok) {
+        snprintf(result->error, sizeof(result->error), "%s", shader.error);
+    } else {
+        result->source = shader_preprocess_variant(
+            &shader, job->reload->glsl_version.c_str(), job->define_mask, &result->source_length);
+        result->hash = shader_source_hash(result->source, result->source_length);
+        result->ok   = true;
+    }
+    shader_preprocess_free(&shader);
+}
+
+static void schedule(HotReload* reload, uint32_t asset);
+
+static void reload_job(void* data)
+{
+    ReloadJob* job         = (ReloadJob*)data;
+    HotReload* reload      = job->reload;
+    HotReloadResult result = {};
+    result.asset           = job->asset;
+    result.kind            = job->kind;
+    snprintf(result.path, sizeof(result.path), "%s", job->path.c_str());
+
+    if (job->kind == HOT_RELOAD_TEXTURE) {
+        reload_texture(job, &result);
+    } else {
+        reload_shader(job, &result);
+    }
+
+    std::lock_guard<std::mutex> lock(reload->mutex);
+    HotReloadAsset* asset = &reload->assets[job->asset];
+    asset->in_flight      = false;
+
+    if (result.ok && result.hash == asset->hash) {
+        hot_reload_release(&result);
+    } else {
+        if (result.ok) { asset->hash = result.hash; }
+        reload->finished.push_back(result);
+    }
+
+    if (asset->changed_again) {
+        asset->changed_again = false;
+        schedule(reload, job->asset);
+    }
+
+    delete job;
+    if (--reload->jobs_in_flight == 0) { reload->drained.notify_all(); }
+}
+
+// Callers hold reload->mutex.
+static void schedule(HotReload* reload, uint32_t asset_index)
+{
+    HotReloadAsset* asset = &reload->assets[asset_index];
+    if (asset->in_flight) {
+        asset->changed_again = true;
+        return;
+    }
+
+    asset->in_flight = true;
+    reload->jobs_in_flight++;
+    job_pool_submit(reload->jobs, reload_job,
+        new ReloadJob { reload, asset_index, asset->kind, asset->path, asset->define_mask });
+}
+
+static void on_file_changed(const char* path, void* user)
+{
+    HotReload* reload = (HotReload*)user;
+
+    std::lock_guard<std::mutex> lock(reload->mutex);
+    auto dependents = reload->dependents.find(path);
+    if (dependents == reload->dependents.end()) { return; }
+    for (uint32_t asset : dependents->second) {
+        schedule(reload, asset);
+    }
+}
+
+static void on_directory_lost(const char* directory, void* user)
+{
+    ((std::vector<std::string>*)user)->push_back(directory);
+}
+
+HotReload* hot_reload_create(const HotReloadDesc* desc)
+{
+    if (!desc->jobs) { return NULL; }
+
+    HotReload* reload    = new HotReload();
+    reload->jobs         = desc->jobs;
+    reload->glsl_version = desc->glsl_version ? desc->glsl_version : "330 core";
+    reload->watcher      = file_watcher_create(desc->debounce_ms ? desc->debounce_ms : HOT_RELOAD_DEFAULT_DEBOUNCE);
+    return reload;
+}
+
+void hot_reload_destroy(HotReload* reload)
+{
+    {
+        std::unique_lock<std::mutex> lock(reload->mutex);
+        reload->drained.wait(lock, [reload] { return reload->jobs_in_flight == 0; });
+    }
+
+    for (HotReloadResult& result : reload->finished) {
+        hot_reload_release(&result);
+    }
+    file_watcher_destroy(reload->watcher);
+    delete reload;
+}
+
+static uint32_t add_asset(HotReload* reload, const char* path, HotReloadKind kind, uint32_t define_mask, uint64_t hash)
+{
+    std::lock_guard<std::mutex> lock(reload->mutex);
+
+    uint32_t index = (uint32_t)reload->assets.size();
+    reload->assets.push_back({ path, kind, define_mask, hash, false, false });
+    add_dependency(reload, path, index);
+    return index;
+}
+
+uint32_t hot_reload_watch_texture(HotReload* reload, const char* path)
+{
+    return add_asset(reload, path, HOT_RELOAD_TEXTURE, 0, 0);
+}
+
+uint32_t hot_reload_watch_shader(HotReload* reload, const char* path, uint32_t define_mask, uint64_t current_hash)
+{
+    uint32_t asset = add_asset(reload, path, HOT_RELOAD_SHADER, define_mask, current_hash);
+
+    // Watch the includes too. Failing to preprocess here is fine, the file list is still filled in.
+    ShaderPreprocessed shader;
+    shader_preprocess(path, &shader);
+    {
+        std::lock_guard<std::mutex> lock(reload->mutex);
+        for (uint32_t i = 0; i < shader.file_count; i++) {
+            add_dependency(reload, shader.files[i], asset);
+        }
+    }
+    shader_preprocess_free(&shader);
+
+    return asset;
+}
+
+uint32_t hot_reload_poll(HotReload* reload)
+{
+    if (!reload->watcher) { return 0; }
+
+    std::vector<std::string> directories;
+    {
+        std::lock_guard<std::mutex> lock(reload->mutex);
+        directories.swap(reload->new_directories);
+    }
+    // A directory that was deleted, or cannot be watched yet, is tried again every poll until it is back.
+    std::vector<std::string> unwatched;
+    for (const std::string& directory : directories) {
+        if (!file_watcher_add_directory(reload->watcher, directory.c_str())) { unwatched.push_back(directory); }
+    }
+
+    uint32_t changed = file_watcher_poll(reload->watcher, file_watcher_now_ms(), on_file_changed, reload);
+    file_watcher_poll_lost(reload->watcher, on_directory_lost, &unwatched);
+    {
+        std::lock_guard<std::mutex> lock(reload->mutex);
+        reload->new_directories.insert(reload->new_directories.end(), unwatched.begin(), unwatched.end());
+    }
+    return changed;
+}
+
+bool hot_reload_next(HotReload* reload, HotReloadResult* result)
+{
+    std::lock_guard<std::mutex> lock(reload->mutex);
+    if (reload->finished.empty()) { return false; }
+    *result = reload->finished.front();
+    reload->finished.pop_front();
+    return true;
+}
+
+void hot_reload_release(HotReloadResult* result)
+{
+    mip_chain_free(&result->mips);
+    free(result->source);
+    result->source = NULL;
+}
+
+uint32_t hot_swap_begin(HotSwapSlot* slot, uint32_t replacement)
+{
+    uint32_t superseded = slot->pending;
+    slot->pending       = replacement;
+    return superseded;
+}
+
+uint32_t hot_swap_finish(HotSwapSlot* slot, bool succeeded)
+{
+    uint32_t retired = succeeded ? slot->active : slot->pending;
+    if (succeeded) { slot->active = slot->pending; }
+    slot->pending = 0;
+    return retired;
+}
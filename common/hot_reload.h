@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "job_pool.h"
+#include "mip_chain.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reloads textures and shaders when their files change on disk. hot_reload_poll() picks up changes from a
+// FileWatcher and queues the expensive part (image decode and mip generation, shader preprocessing) on the job pool.
+// Finished reloads are handed back through hot_reload_next(), which the render loop drains at the start of a frame
+// to swap the new resources in. A shader is also reloaded when any file it includes changes.
+//
+// Reloads whose output hashes the same as what is already in use are dropped, so saving an unchanged file or
+// touching an include that makes no difference costs nothing on the render thread.
+typedef struct HotReload HotReload;
+
+typedef enum HotReloadKind {
+    HOT_RELOAD_TEXTURE,
+    HOT_RELOAD_SHADER,
+} HotReloadKind;
+
+typedef struct HotReloadDesc {
+    JobPool* jobs;
+    const char* glsl_version; // #version for reloaded shaders, the same one the embedded variants were built with
+    uint32_t debounce_ms;     // 0 = 100ms
+} HotReloadDesc;
+
+typedef struct HotReloadResult {
+    uint32_t asset;
+    HotReloadKind kind;
+    bool ok;
+    char path[260];
+    char error[256];
+    uint64_t hash;
+
+    MipChain mips; // HOT_RELOAD_TEXTURE
+
+    char* source;  // HOT_RELOAD_SHADER, the assembled variant
+    size_t source_length;
+} HotReloadResult;
+
+HotReload* hot_reload_create(const HotReloadDesc* desc);
+void hot_reload_destroy(HotReload* reload);
+
+uint32_t hot_reload_watch_texture(HotReload* reload, const char* path);
+
+// current_hash is the hash of the variant in use, usually the one embedded at build time.
+uint32_t hot_reload_watch_shader(HotReload* reload, const char* path, uint32_t define_mask, uint64_t current_hash);
+
+// Checks for changed files and queues reloads for the assets built from them. Returns the number of changed files.
+uint32_t hot_reload_poll(HotReload* reload);
+
+// Pops one finished reload. Call hot_reload_release() once its data has been consumed.
+bool hot_reload_next(HotReload* reload, HotReloadResult* result);
+void hot_reload_release(HotReloadResult* result);
+
+// Swaps a GPU object that takes a while to build (a program compiling in parallel, say) without ever leaving the
+// renderer without one. The replacement stays pending until it is known to be good and is promoted at a frame
+// boundary; whatever gets displaced is handed back so the caller can delete it.
+typedef struct HotSwapSlot {
+    uint32_t active;
+    uint32_t pending; // 0 when nothing is being built
+} HotSwapSlot;
+
+// Starts building a replacement. Returns a replacement that was still pending and is now superseded, or 0.
+uint32_t hot_swap_begin(HotSwapSlot* slot, uint32_t replacement);
+
+// Resolves the pending replacement. On success it becomes active and the old active object is returned, otherwise
+// the failed replacement is returned and the active object is kept.
+uint32_t hot_swap_finish(HotSwapSlot* slot, bool succeeded);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1732 @@
+#include "image_decode.h"
+
+#include "simd.h"
+
+#include <stb_image.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#define JPEG_FAST_BITS 10
+#define JPEG_FAST_EOB 0xFF // run stored for an end of block in HuffmanTable::fast_ac, enough to end any block
+#define JPEG_MAX_COMPONENTS 3
+
+// Rows of output converted per job.
+#define IMAGE_CONVERT_BATCH 32
+
+static thread_local const char* failure_reason = "";
+
+static bool fail(const char* reason)
+{
+    failure_reason = reason;
+    return false;
+}
+
+// YCbCr to RGB in 16 bit fixed point, eight pixels at a time. The BT.601 coefficients are scaled by 4096, and each
+// chroma term is (c - 128) * coefficient >> 8, leaving 4 fractional bits to round away at the end.
+#define YCC_CR_R 5743
+#define YCC_CB_G -1410
+#define YCC_CR_G -2925
+#define YCC_CB_B 7258
+
+#if defined(SIMD_SSE2)
+static inline void ycbcr_to_rgb8(
+    const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, uint32_t channels)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i flip = _mm_set1_epi8((char)0x80);
+    __m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)y), zero);
+    luma         = _mm_add_epi16(_mm_slli_epi16(luma, 4), _mm_set1_epi16(8));
+
+    // Flipping the top bit and unpacking into the high byte gives (c - 128) << 8, which mulhi takes back down.
+    __m128i blue_diff = _mm_unpacklo_epi8(zero, _mm_xor_si128(_mm_loadl_epi64((const __m128i*)cb), flip));
+    __m128i red_diff  = _mm_unpacklo_epi8(zero, _mm_xor_si128(_mm_loadl_epi64((const __m128i*)cr), flip));
+
+    __m128i r = _mm_add_epi16(luma, _mm_mulhi_epi16(red_diff, _mm_set1_epi16(YCC_CR_R)));
+    __m128i g = _mm_add_epi16(luma, _mm_mulhi_epi16(blue_diff, _mm_set1_epi16(YCC_CB_G)));
+    g         = _mm_add_epi16(g, _mm_mulhi_epi16(red_diff, _mm_set1_epi16(YCC_CR_G)));
+    __m128i b = _mm_add_epi16(luma, _mm_mulhi_epi16(blue_diff, _mm_set1_epi16(YCC_CB_B)));
+
+    // Interleave by unpacking: (r, b) and (g, a) bytes, then r g and b a pairs, then whole pixels.
+    __m128i rb = _mm_packus_epi16(_mm_srai_epi16(r, 4), _mm_srai_epi16(b, 4));
+    __m128i ga = _mm_packus_epi16(_mm_srai_epi16(g, 4), _mm_set1_epi16(255));
+    __m128i rg = _mm_unpacklo_epi8(rb, ga);
+    __m128i ba = _mm_unpackhi_epi8(rb, ga);
+
+    alignas(16) uint8_t rgba[32];
+    uint8_t* target = channels == 4 ? out : rgba;
+    _mm_storeu_si128((__m128i*)target, _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i*)(target + 16), _mm_unpackhi_epi16(rg, ba));
+    if (channels == 4) { return; }
+    for (int i = 0; i < 8; i++) {
+        memcpy(out + i * 3, rgba + i * 4, 3);
+    }
+}
+// Fancy upsampling, as libjpeg and stb_image do it, makes each output sample 3/4 the nearest input sample and 1/4 the
+// next nearest, in each direction that was subsampled. vertical_sums() does the vertical step as near * 3 + far, or
+// near * 4 when only the width was halved; upsample_h2() then does the horizontal one, from sums that have a copy of
+// the first and last one on either side. Both work on whole groups of eight input samples, reading up to seven past
+// the end of their rows and writing up to seven sums, or fourteen bytes, past the end of theirs.
+static inline void vertical_sums(const uint8_t* near, const uint8_t* far, uint32_t width, uint16_t* sums)
+{
+    __m128i zero = _mm_setzero_si128();
+    for (uint32_t i = 0; i < width; i += 8) {
+        __m128i n = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(near + i)), zero);
+        __m128i f = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(far + i)), zero);
+        _mm_storeu_si128((__m128i*)(sums + i), _mm_add_epi16(_mm_add_epi16(n, _mm_add_epi16(n, n)), f));
+    }
+}
+
+static inline void upsample_h2(const uint16_t* sums, uint32_t width, uint8_t* out)
+{
+    for (uint32_t i = 0; i < width; i += 8) {
+        __m128i near  = _mm_loadu_si128((const __m128i*)(sums + i));
+        __m128i near3 = _mm_add_epi16(_mm_add_epi16(near, _mm_add_epi16(near, near)), _mm_set1_epi16(8));
+        __m128i even  = _mm_srli_epi16(_mm_add_epi16(near3, _mm_loadu_si128((const __m128i*)(sums + i - 1))), 4);
+        __m128i odd   = _mm_srli_epi16(_mm_add_epi16(near3, _mm_loadu_si128((const __m128i*)(sums + i + 1))), 4);
+        __m128i pairs = _mm_packus_epi16(_mm_unpacklo_epi16(even, odd), _mm_unpackhi_epi16(even, odd));
+        _mm_storeu_si128((__m128i*)(out + i * 2), pairs);
+    }
+}
+#elif defined(SIMD_NEON)
+static inline int16x8_t chroma_term(int16x8_t diff, int16_t coefficient)
+{
+    int32x4_t low  = vmull_n_s16(vget_low_s16(diff), coefficient);
+    int32x4_t high = vmull_n_s16(vget_high_s16(diff), coefficient);
+    return vcombine_s16(vshrn_n_s32(low, 8), vshrn_n_s32(high, 8));
+}
+
+static inline void ycbcr_to_rgb8(
+    const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, uint32_t channels)
+{
+    int16x8_t luma      = vaddq_s16(vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(y), 4)), vdupq_n_s16(8));
+    int16x8_t blue_diff = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(cb), vdup_n_u8(128)));
+    int16x8_t red_diff  = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(cr), vdup_n_u8(128)));
+
+    int16x8_t r = vaddq_s16(luma, chroma_term(red_diff, YCC_CR_R));
+    int16x8_t g = vaddq_s16(vaddq_s16(luma, chroma_term(blue_diff, YCC_CB_G)), chroma_term(red_diff, YCC_CR_G));
+    int16x8_t b = vaddq_s16(luma, chroma_term(blue_diff, YCC_CB_B));
+
+    uint8x8_t r8 = vqmovun_s16(vshrq_n_s16(r, 4));
+    uint8x8_t g8 = vqmovun_s16(vshrq_n_s16(g, 4));
+    uint8x8_t b8 = vqmovun_s16(vshrq_n_s16(b, 4));
+    if (channels == 4) {
+        uint8x8x4_t rgba = { { r8, g8, b8, vdup_n_u8(255) } };
+        vst4_u8(out, rgba);
+    } else {
+        uint8x8x3_t rgb = { { r8, g8, b8 } };
+        vst3_u8(out, rgb);
+    }
+}
+static inline void vertical_sums(const uint8_t* near, const uint8_t* far, uint32_t width, uint16_t* sums)
+{
+    for (uint32_t i = 0; i < width; i += 8) {
+        vst1q_u16(sums + i, vmlaq_n_u16(vmovl_u8(vld1_u8(far + i)), vmovl_u8(vld1_u8(near + i)), 3));
+    }
+}
+
+static inline void upsample_h2(const uint16_t* sums, uint32_t width, uint8_t* out)
+{
+    for (uint32_t i = 0; i < width; i += 8) {
+        uint16x8_t near3 = vmlaq_n_u16(vdupq_n_u16(8), vld1q_u16(sums + i), 3);
+        uint8x8x2_t pairs
+            = { { vshrn_n_u16(vaddq_u16(near3, vld1q_u16(sums + i - 1)), 4),
+                  vshrn_n_u16(vaddq_u16(near3, vld1q_u16(sums + i + 1)), 4) } };
+        vst2_u8(out + i * 2, pairs);
+    }
+}
+#else
+static inline uint8_t clamp_fixed(int32_t value)
+{
+    value >>= 4;
+    return (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+static inline void ycbcr_to_rgb8(
+    const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, uint32_t channels)
+{
+    for (int i = 0; i < 8; i++, out += channels) {
+        int32_t luma      = (y[i] << 4) + 8;
+        int32_t blue_diff = cb[i] - 128;
+        int32_t red_diff  = cr[i] - 128;
+        out[0]            = clamp_fixed(luma + ((red_diff * YCC_CR_R) >> 8));
+        out[1]            = clamp_fixed(luma + ((blue_diff * YCC_CB_G) >> 8) + ((red_diff * YCC_CR_G) >> 8));
+        out[2]            = clamp_fixed(luma + ((blue_diff * YCC_CB_B) >> 8));
+        if (channels == 4) { out[3] = 255; }
+    }
+}
+
+static inline void vertical_sums(const uint8_t* near, const uint8_t* far, uint32_t width, uint16_t* sums)
+{
+    for (uint32_t i = 0; i < width; i++) {
+        sums[i] = (uint16_t)(near[i] * 3 + far[i]);
+    }
+}
+
+static inline void upsample_h2(const uint16_t* sums, uint32_t width, uint8_t* out)
+{
+    const uint16_t* left  = sums - 1;
+    const uint16_t* right = sums + 1;
+    for (uint32_t i = 0; i < width; i++) {
+        uint32_t near3 = sums[i] * 3 + 8;
+        out[i * 2]     = (uint8_t)((near3 + left[i]) >> 4);
+        out[i * 2 + 1] = (uint8_t)((near3 + right[i]) >> 4);
+    }
+}
+#endif
+
+// Natural (row major) position of each coefficient in zigzag order.
+static const uint8_t jpeg_natural_order[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6, 7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22,
+    15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+typedef struct HuffmanTable {
+    uint16_t fast[1 << JPEG_FAST_BITS]; // (length << 8) | symbol for codes of up to JPEG_FAST_BITS, 0 otherwise
+    // For AC codes whose value bits fit in JPEG_FAST_BITS too: (value << 16) | (run << 8) | code and value length. An
+    // end of block has a run of JPEG_FAST_EOB and a zero run length (ZRL) one of 15 with a zero value, so both take the
+    // same path as a coefficient.
+    int32_t fast_ac[1 << JPEG_FAST_BITS];
+    int32_t maxcode[17];                // largest code of each length, -1 if none
+    int32_t delta[17];                  // symbol index = code + delta[length]
+    uint8_t symbols[256];
+    bool present;
+} HuffmanTable;
+
+typedef struct JpegComponent {
+    uint32_t id;
+    uint32_t h, v; // sampling factors
+    uint32_t quant;
+    uint32_t dc_table, ac_table;
+    uint32_t width, height; // in samples
+    std::unique_ptr<uint8_t[]> plane;
+    size_t stride;
+} JpegComponent;
+
+typedef struct JpegSegment {
+    const uint8_t* begin;
+    const uint8_t* end;
+} JpegSegment;
+
+typedef struct Jpeg {
+    uint32_t width, height;
+    uint32_t component_count;
+    JpegComponent components[JPEG_MAX_COMPONENTS];
+    uint32_t h_max, v_max;
+    bool rgb; // components are R, G, B rather than Y, Cb, Cr
+
+    uint16_t quant[4][64]; // zigzag order
+    bool quant_present[4];
+    uint16_t dequant[JPEG_MAX_COMPONENTS][64]; // natural order
+    HuffmanTable dc[4], ac[4];
+
+    uint32_t restart_interval;
+    uint32_t mcus_x, mcus_y;
+    std::vector<JpegSegment> segments;
+    bool adobe;
+    uint32_t adobe_transform;
+} Jpeg;
+
+typedef struct BitReader {
+    const uint8_t* cursor;
+    const uint8_t* end;
+    uint64_t buffer; // MSB first
+    int32_t count;
+} BitReader;
+
+// Tops the buffer up to at least 32 bits, which is always enough for a symbol and the value bits after it. Skipped
+// while there are 32 or more, since those already are.
+static inline void refill(BitReader* bits)
+{
+    if (bits->count >= 32) { return; }
+
+    // Whole bytes at once while none of the next eight is 0xFF, which starts stuffing or a marker.
+    if (bits->end - bits->cursor >= 8) {
+        const uint8_t* p = bits->cursor;
+        uint64_t word    = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40)
+            | ((uint64_t)p[3] << 32) | ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | p[7];
+        uint64_t inverted = ~word;
+        if (!((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull)) {
+            uint32_t bytes = (uint32_t)(63 - bits->count) >> 3;
+            uint32_t total = (uint32_t)bits->count + bytes * 8;
+            bits->buffer |= (word >> bits->count) & ~(~0ull >> total);
+            bits->cursor += bytes;
+            bits->count = (int32_t)total;
+            return;
+        }
+    }
+
+    while (bits->count <= 56) {
+        uint32_t byte = 0;
+        if (bits->cursor < bits->end) {
+            byte = *bits->cursor;
+            if (byte != 0xFF) {
+                bits->cursor++;
+            } else if (bits->cursor + 1 < bits->end && bits->cursor[1] == 0x00) {
+                bits->cursor += 2;
+            } else {
+                // A marker; everything after it reads as zeros.
+                byte         = 0;
+                bits->cursor = bits->end;
+            }
+        }
+        bits->buffer |= (uint64_t)byte << (56 - bits->count);
+        bits->count += 8;
+    }
+}
+
+static inline uint32_t take_bits(BitReader* bits, uint32_t n)
+{
+    uint32_t value = (uint32_t)(bits->buffer >> (64 - n));
+    bits->buffer <<= n;
+    bits->count -= (int32_t)n;
+    return value;
+}
+
+// Refills, so up to 16 more bits can be taken afterwards without refilling.
+static inline int32_t decode_symbol(BitReader* bits, const HuffmanTable* table)
+{
+    refill(bits);
+    uint16_t fast = table->fast[bits->buffer >> (64 - JPEG_FAST_BITS)];
+    if (fast) {
+        take_bits(bits, fast >> 8);
+        return fast & 0xFF;
+    }
+    for (uint32_t length = JPEG_FAST_BITS + 1; length <= 16; length++) {
+        int32_t code = (int32_t)(bits->buffer >> (64 - length));
+        if (code <= table->maxcode[length]) {
+            take_bits(bits, length);
+            return table->symbols[code + table->delta[length]];
+        }
+    }
+    return -1;
+}
+
+static inline int32_t receive_extend(BitReader* bits, uint32_t size)
+{
+    if (!size) { return 0; }
+    int32_t value = (int32_t)take_bits(bits, size);
+    return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+}
+
+static bool build_huffman(HuffmanTable* table, const uint8_t* counts, const uint8_t* symbols, uint32_t symbol_count)
+{
+    memset(table->fast, 0, sizeof(table->fast));
+    memcpy(table->symbols, symbols, symbol_count);
+
+    uint32_t code = 0;
+    uint32_t k    = 0;
+    for (uint32_t length = 1; length <= 16; length++) {
+        table->delta[length] = (int32_t)k - (int32_t)code;
+        for (uint32_t i = 0; i < counts[length - 1]; i++, k++, code++) {
+            if (length > JPEG_FAST_BITS) { continue; }
+            uint32_t first = code << (JPEG_FAST_BITS - length);
+            uint32_t count = 1u << (JPEG_FAST_BITS - length);
+            for (uint32_t j = 0; j < count; j++) {
+                table->fast[first + j] = (uint16_t)((length << 8) | symbols[k]);
+            }
+        }
+        table->maxcode[length] = counts[length - 1] ? (int32_t)code - 1 : -1;
+        if (code > (1u << length)) { return false; }
+        code <<= 1;
+    }
+
+    // The value bits follow the code, so whatever is left of the lookup index after the code is the start of them.
+    for (uint32_t i = 0; i < (1u << JPEG_FAST_BITS); i++) {
+        uint32_t fast      = table->fast[i];
+        uint32_t length    = fast >> 8;
+        uint32_t run       = (fast >> 4) & 15;
+        uint32_t size      = fast & 15;
+        table->fast_ac[i] = 0;
+        if (!fast) { continue; }
+        if (!size) {
+            table->fast_ac[i] = (int32_t)((run == 15 ? 15 : JPEG_FAST_EOB) << 8) + (int32_t)length;
+            continue;
+        }
+        if (length + size > JPEG_FAST_BITS) { continue; }
+        int32_t value = (int32_t)((i << length) & ((1u << JPEG_FAST_BITS) - 1)) >> (JPEG_FAST_BITS - size);
+        if (value < (1 << (size - 1))) { value += 1 - (1 << size); }
+        table->fast_ac[i] = value * 65536 + (int32_t)(run << 8) + (int32_t)(length + size);
+    }
+    table->present = true;
+    return true;
+}
+
+static uint32_t read16(const uint8_t* p) { return ((uint32_t)p[0] << 8) | p[1]; }
+
+static bool parse_dqt(Jpeg* jpeg, const uint8_t* p, uint32_t length)
+{
+    while (length > 0) {
+        uint32_t precision = p[0] >> 4;
+        uint32_t id        = p[0] & 15;
+        uint32_t size      = 1 + 64 * (precision ? 2 : 1);
+        if (id > 3 || precision > 1 || length < size) { return fail("bad quantization table"); }
+        for (uint32_t i = 0; i < 64; i++) {
+            jpeg->quant[id][i] = (uint16_t)(precision ? read16(p + 1 + i * 2) : p[1 + i]);
+        }
+        jpeg->quant_present[id] = true;
+        p += size;
+        length -= size;
+    }
+    return true;
+}
+
+static bool parse_dht(Jpeg* jpeg, const uint8_t* p, uint32_t length)
+{
+    while (length > 0) {
+        if (length < 17) { return fail("bad Huffman table"); }
+        uint32_t table_class = p[0] >> 4;
+        uint32_t id          = p[0] & 15;
+        uint32_t total       = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            total += p[1 + i];
+        }
+        if (table_class > 1 || id > 3 || total > 256 || length < 17 + total) { return fail("bad Huffman table"); }
+        HuffmanTable* table = table_class ? &jpeg->ac[id] : &jpeg->dc[id];
+        if (!build_huffman(table, p + 1, p + 17, total)) { return fail("bad Huffman table"); }
+        p += 17 + total;
+        length -= 17 + total;
+    }
+    return true;
+}
+
+static bool parse_sof(Jpeg* jpeg, const uint8_t* p, uint32_t length)
+{
+    if (length < 6 || p[0] != 8) { return fail("only 8 bit JPEGs are supported"); }
+    jpeg->height          = read16(p + 1);
+    jpeg->width           = read16(p + 3);
+    jpeg->component_count = p[5];
+    if (!jpeg->width || !jpeg->height) { return fail("no image size"); }
+    if (jpeg->component_count != 1 && jpeg->component_count != 3) { return fail("unsupported component count"); }
+    if (length < 6 + jpeg->component_count * 3) { return fail("bad frame header"); }
+
+    jpeg->h_max = jpeg->v_max = 1;
+    for (uint32_t i = 0; i < jpeg->component_count; i++) {
+        JpegComponent* component = &jpeg->components[i];
+        component->id            = p[6 + i * 3];
+        component->h             = p[7 + i * 3] >> 4;
+        component->v             = p[7 + i * 3] & 15;
+        component->quant         = p[8 + i * 3];
+        if (component->h < 1 || component->h > 2 || component->v < 1 || component->v > 2 || component->quant > 3) {
+            return fail("unsupported sampling");
+        }
+        jpeg->h_max = component->h > jpeg->h_max ? component->h : jpeg->h_max;
+        jpeg->v_max = component->v > jpeg->v_max ? component->v : jpeg->v_max;
+    }
+    return true;
+}
+
+static bool parse_sos(Jpeg* jpeg, const uint8_t* p, uint32_t length)
+{
+    uint32_t count = p[0];
+    if (length != 4 + count * 2) { return fail("bad scan header"); }
+    if (count != jpeg->component_count) { return fail("non-interleaved scans are not supported"); }
+    for (uint32_t i = 0; i < count; i++) {
+        JpegComponent* component = &jpeg->components[i];
+        if (p[1 + i * 2] != component->id) { return fail("scan components out of order"); }
+        component->dc_table = p[2 + i * 2] >> 4;
+        component->ac_table = p[2 + i * 2] & 15;
+        if (component->dc_table > 3 || component->ac_table > 3) { return fail("bad scan header"); }
+        if (!jpeg->dc[component->dc_table].present || !jpeg->ac[component->ac_table].present) {
+            return fail("missing Huffman table");
+        }
+    }
+    const uint8_t* spectral = p + 1 + count * 2;
+    if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) { return fail("not a baseline scan"); }
+    return true;
+}
+
+// Splits the entropy coded data at its restart markers. Returns where the scan ends.
+static const uint8_t* find_segments(Jpeg* jpeg, const uint8_t* p, const uint8_t* end)
+{
+    const uint8_t* begin = p;
+    while (p + 1 < end) {
+        const uint8_t* marker = (const uint8_t*)memchr(p, 0xFF, (size_t)(end - p - 1));
+        if (!marker) { break; }
+        uint8_t code = marker[1];
+        if (code == 0x00 || code == 0xFF) {
+            p = marker + (code == 0x00 ? 2 : 1);
+        } else if (code >= 0xD0 && code <= 0xD7) {
+            jpeg->segments.push_back({ begin, marker });
+            begin = p = marker + 2;
+        } else {
+            jpeg->segments.push_back({ begin, marker });
+            return marker;
+        }
+    }
+    jpeg->segments.push_back({ begin, end });
+    return end;
+}
+
+static bool parse(Jpeg* jpeg, const uint8_t* data, size_t size)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) { return fail("not a JPEG"); }
+
+    bool frame         = false;
+    const uint8_t* p   = data + 2;
+    const uint8_t* end = data + size;
+    while (p + 4 <= end) {
+        if (p[0] != 0xFF) { return fail("bad marker"); }
+        uint8_t marker = p[1];
+        if (marker == 0xFF) {
+            p++;
+            continue;
+        }
+        uint32_t length = read16(p + 2);
+        if (length < 2 || p + 2 + length > end) { return fail("truncated segment"); }
+        const uint8_t* body = p + 4;
+        uint32_t body_size  = length - 2;
+
+        bool ok = true;
+        switch (marker) {
+        case 0xC0: // baseline
+        case 0xC1: // extended, Huffman coded, which baseline decoding covers at 8 bits
+            ok    = parse_sof(jpeg, body, body_size);
+            frame = true;
+            break;
+        case 0xC2:
+        case 0xC3:
+        case 0xC5:
+        case 0xC6:
+        case 0xC7:
+        case 0xC9:
+        case 0xCA:
+        case 0xCB:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            return fail("progressive, lossless and arithmetic coded JPEGs are not supported");
+        case 0xC4:
+            ok = parse_dht(jpeg, body, body_size);
+            break;
+        case 0xDB:
+            ok = parse_dqt(jpeg, body, body_size);
+            break;
+        case 0xDD:
+            if (body_size < 2) { return fail("bad restart interval"); }
+            jpeg->restart_interval = read16(body);
+            break;
+        case 0xEE:
+            if (body_size >= 12 && memcmp(body, "Adobe", 5) == 0) {
+                jpeg->adobe           = true;
+                jpeg->adobe_transform = body[11];
+            }
+            break;
+        case 0xDA:
+            if (!frame) { return fail("scan before frame"); }
+            if (!parse_sos(jpeg, body, body_size)) { return false; }
+            find_segments(jpeg, body + body_size, end);
+            return true;
+        default:
+            break;
+        }
+        if (!ok) { return false; }
+        p += 2 + length;
+    }
+    return fail("no scan");
+}
+
+static void build_dequant(Jpeg* jpeg)
+{
+    for (uint32_t c = 0; c < jpeg->component_count; c++) {
+        const uint16_t* quant = jpeg->quant[jpeg->components[c].quant];
+        for (uint32_t k = 0; k < 64; k++) {
+            jpeg->dequant[c][jpeg_natural_order[k]] = quant[k];
+        }
+    }
+}
+
+#if defined(SIMD_SSE2)
+// The integer IDCT of libjpeg's jidctint.c, as stb_image also does it, down eight columns or along eight rows at once
+// in 16 bit lanes. Products are taken in 32 bits with 12 bit constants, two at a time with madd, and the first pass
+// keeps 2 more bits than the input.
+#define IDCT_CONST_BITS 12
+#define IDCT_FIX(x) ((int32_t)((x) * (1 << IDCT_CONST_BITS) + 0.5))
+
+typedef struct IdctWide {
+    __m128i low, high; // lanes 0-3 and 4-7 in 32 bits
+} IdctWide;
+
+static inline IdctWide idct_add(IdctWide a, IdctWide b)
+{
+    return { _mm_add_epi32(a.low, b.low), _mm_add_epi32(a.high, b.high) };
+}
+
+static inline IdctWide idct_sub(IdctWide a, IdctWide b)
+{
+    return { _mm_sub_epi32(a.low, b.low), _mm_sub_epi32(a.high, b.high) };
+}
+
+// x << IDCT_CONST_BITS in 32 bits.
+static inline IdctWide idct_widen(__m128i x)
+{
+    __m128i zero = _mm_setzero_si128();
+    return { _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 16 - IDCT_CONST_BITS),
+        _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 16 - IDCT_CONST_BITS) };
+}
+
+// a * ca + b * cb in 32 bits.
+static inline IdctWide idct_dot(__m128i ab_low, __m128i ab_high, int32_t ca, int32_t cb)
+{
+    __m128i constants = _mm_set1_epi32((int32_t)((uint32_t)(uint16_t)ca | ((uint32_t)cb << 16)));
+    return { _mm_madd_epi16(ab_low, constants), _mm_madd_epi16(ab_high, constants) };
+}
+
+// (a + b + bias) >> shift and (a - b + bias) >> shift, saturated back to 16 bits.
+static inline void idct_butterfly(IdctWide a, IdctWide b, __m128i bias, __m128i shift, __m128i* sum, __m128i* diff)
+{
+    a     = { _mm_add_epi32(a.low, bias), _mm_add_epi32(a.high, bias) };
+    *sum  = _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(a.low, b.low), shift),
+         _mm_sra_epi32(_mm_add_epi32(a.high, b.high), shift));
+    *diff = _mm_packs_epi32(_mm_sra_epi32(_mm_sub_epi32(a.low, b.low), shift),
+        _mm_sra_epi32(_mm_sub_epi32(a.high, b.high), shift));
+}
+
+static inline void idct_pass(__m128i* v, __m128i bias, int32_t shift)
+{
+    // Even part: inputs 0, 2, 4 and 6.
+    __m128i v26_low  = _mm_unpacklo_epi16(v[2], v[6]);
+    __m128i v26_high = _mm_unpackhi_epi16(v[2], v[6]);
+    IdctWide tmp2
+        = idct_dot(v26_low, v26_high, IDCT_FIX(0.541196100), IDCT_FIX(0.541196100) - IDCT_FIX(1.847759065));
+    IdctWide tmp3
+        = idct_dot(v26_low, v26_high, IDCT_FIX(0.541196100) + IDCT_FIX(0.765366865), IDCT_FIX(0.541196100));
+    IdctWide tmp0    = idct_widen(_mm_add_epi16(v[0], v[4]));
+    IdctWide tmp1    = idct_widen(_mm_sub_epi16(v[0], v[4]));
+    IdctWide even0   = idct_add(tmp0, tmp3);
+    IdctWide even3   = idct_sub(tmp0, tmp3);
+    IdctWide even1   = idct_add(tmp1, tmp2);
+    IdctWide even2   = idct_sub(tmp1, tmp2);
+
+    // Odd part: inputs 1, 3, 5 and 7, with jidctint's z1-z5 folded into the constant pairs.
+    __m128i v73_low  = _mm_unpacklo_epi16(v[7], v[3]);
+    __m128i v73_high = _mm_unpackhi_epi16(v[7], v[3]);
+    __m128i v51_low  = _mm_unpacklo_epi16(v[5], v[1]);
+    __m128i v51_high = _mm_unpackhi_epi16(v[5], v[1]);
+    __m128i sum17    = _mm_add_epi16(v[1], v[7]);
+    __m128i sum35    = _mm_add_epi16(v[3], v[5]);
+    __m128i sums_low  = _mm_unpacklo_epi16(sum17, sum35);
+    __m128i sums_high = _mm_unpackhi_epi16(sum17, sum35);
+    IdctWide y0 = idct_dot(v73_low, v73_high, IDCT_FIX(0.298631336) - IDCT_FIX(1.961570560), -IDCT_FIX(1.961570560));
+    IdctWide y2 = idct_dot(v73_low, v73_high, -IDCT_FIX(1.961570560), IDCT_FIX(3.072711026) - IDCT_FIX(1.961570560));
+    IdctWide y1 = idct_dot(v51_low, v51_high, IDCT_FIX(2.053119869) - IDCT_FIX(0.390180644), -IDCT_FIX(0.390180644));
+    IdctWide y3 = idct_dot(v51_low, v51_high, -IDCT_FIX(0.390180644), IDCT_FIX(1.501321110) - IDCT_FIX(0.390180644));
+    IdctWide y4
+        = idct_dot(sums_low, sums_high, IDCT_FIX(1.175875602) - IDCT_FIX(0.899976223), IDCT_FIX(1.175875602));
+    IdctWide y5
+        = idct_dot(sums_low, sums_high, IDCT_FIX(1.175875602), IDCT_FIX(1.175875602) - IDCT_FIX(2.562915447));
+
+    __m128i count = _mm_cvtsi32_si128(shift);
+    idct_butterfly(even0, idct_add(y3, y4), bias, count, &v[0], &v[7]);
+    idct_butterfly(even1, idct_add(y2, y5), bias, count, &v[1], &v[6]);
+    idct_butterfly(even2, idct_add(y1, y5), bias, count, &v[2], &v[5]);
+    idct_butterfly(even3, idct_add(y0, y4), bias, count, &v[3], &v[4]);
+}
+
+// Interleaving each row with the one four below rotates the bits of a row and lane index left by one; three times over
+// swaps them.
+static inline void transpose8(__m128i* v)
+{
+    for (int round = 0; round < 3; round++) {
+        __m128i t[8];
+        for (int i = 0; i < 4; i++) {
+            t[i * 2]     = _mm_unpacklo_epi16(v[i], v[i + 4]);
+            t[i * 2 + 1] = _mm_unpackhi_epi16(v[i], v[i + 4]);
+        }
+        memcpy(v, t, sizeof(t));
+    }
+}
+
+// Dequantized coefficients to pixels, with the level shift and the rounding folded into the second pass's bias. `low`
+// is for the float IDCT below; these passes cost no less with half their inputs zero.
+static void idct_block(const int16_t* coefficients, uint32_t low, uint8_t* out, size_t stride)
+{
+    (void)low;
+    __m128i v[8];
+    for (int r = 0; r < 8; r++) {
+        v[r] = _mm_load_si128((const __m128i*)(coefficients + r * 8));
+    }
+    idct_pass(v, _mm_set1_epi32(1 << (IDCT_CONST_BITS - 3)), IDCT_CONST_BITS - 2);
+    transpose8(v);
+    idct_pass(v, _mm_set1_epi32((1 << (IDCT_CONST_BITS + 4)) + (128 << (IDCT_CONST_BITS + 5))), IDCT_CONST_BITS + 5);
+    transpose8(v);
+    for (int r = 0; r < 8; r += 2) {
+        __m128i pixels = _mm_packus_epi16(v[r], v[r + 1]);
+        _mm_storel_epi64((__m128i*)(out + r * stride), pixels);
+        _mm_storel_epi64((__m128i*)(out + (r + 1) * stride), _mm_unpackhi_epi64(pixels, pixels));
+    }
+}
+#else
+// AAN scale factors, cos(k * pi / 16) * sqrt(2) for k > 0, which the float IDCT expects premultiplied into its input.
+static const float idct_aan[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f,
+    0.275899379f };
+
+// One dimension of the AAN float IDCT (as in libjpeg's jidctflt.c) down four columns at once.
+static inline void idct_pass(f32x4* v)
+{
+    f32x4 tmp10 = f32x4_add(v[0], v[4]);
+    f32x4 tmp11 = f32x4_sub(v[0], v[4]);
+    f32x4 tmp13 = f32x4_add(v[2], v[6]);
+    f32x4 tmp12 = f32x4_sub(f32x4_mul(f32x4_sub(v[2], v[6]), f32x4_splat(1.414213562f)), tmp13);
+
+    f32x4 even0 = f32x4_add(tmp10, tmp13);
+    f32x4 even3 = f32x4_sub(tmp10, tmp13);
+    f32x4 even1 = f32x4_add(tmp11, tmp12);
+    f32x4 even2 = f32x4_sub(tmp11, tmp12);
+
+    f32x4 z13 = f32x4_add(v[5], v[3]);
+    f32x4 z10 = f32x4_sub(v[5], v[3]);
+    f32x4 z11 = f32x4_add(v[1], v[7]);
+    f32x4 z12 = f32x4_sub(v[1], v[7]);
+
+    f32x4 odd7  = f32x4_add(z11, z13);
+    f32x4 odd11 = f32x4_mul(f32x4_sub(z11, z13), f32x4_splat(1.414213562f));
+    f32x4 z5    = f32x4_mul(f32x4_add(z10, z12), f32x4_splat(1.847759065f));
+    f32x4 odd10 = f32x4_sub(z5, f32x4_mul(z12, f32x4_splat(1.082392200f)));
+    f32x4 odd12 = f32x4_sub(z5, f32x4_mul(z10, f32x4_splat(2.613125930f)));
+    f32x4 odd6  = f32x4_sub(odd12, odd7);
+    f32x4 odd5  = f32x4_sub(odd11, odd6);
+    f32x4 odd4  = f32x4_sub(odd10, odd5);
+
+    v[0] = f32x4_add(even0, odd7);
+    v[7] = f32x4_sub(even0, odd7);
+    v[1] = f32x4_add(even1, odd6);
+    v[6] = f32x4_sub(even1, odd6);
+    v[2] = f32x4_add(even2, odd5);
+    v[5] = f32x4_sub(even2, odd5);
+    v[3] = f32x4_add(even3, odd4);
+    v[4] = f32x4_sub(even3, odd4);
+}
+
+// idct_pass() for inputs 4-7 all zero, which they are in most blocks.
+static inline void idct_pass_low(f32x4* v)
+{
+    f32x4 tmp12 = f32x4_mul(v[2], f32x4_splat(0.414213562f));
+
+    f32x4 even0 = f32x4_add(v[0], v[2]);
+    f32x4 even3 = f32x4_sub(v[0], v[2]);
+    f32x4 even1 = f32x4_add(v[0], tmp12);
+    f32x4 even2 = f32x4_sub(v[0], tmp12);
+
+    f32x4 diff  = f32x4_sub(v[1], v[3]);
+    f32x4 odd7  = f32x4_add(v[1], v[3]);
+    f32x4 odd11 = f32x4_mul(diff, f32x4_splat(1.414213562f));
+    f32x4 z5    = f32x4_mul(diff, f32x4_splat(1.847759065f));
+    f32x4 odd10 = f32x4_sub(z5, f32x4_mul(v[1], f32x4_splat(1.082392200f)));
+    f32x4 odd12 = f32x4_add(z5, f32x4_mul(v[3], f32x4_splat(2.613125930f)));
+    f32x4 odd6  = f32x4_sub(odd12, odd7);
+    f32x4 odd5  = f32x4_sub(odd11, odd6);
+    f32x4 odd4  = f32x4_sub(odd10, odd5);
+
+    v[0] = f32x4_add(even0, odd7);
+    v[7] = f32x4_sub(even0, odd7);
+    v[1] = f32x4_add(even1, odd6);
+    v[6] = f32x4_sub(even1, odd6);
+    v[2] = f32x4_add(even2, odd5);
+    v[5] = f32x4_sub(even2, odd5);
+    v[3] = f32x4_add(even3, odd4);
+    v[4] = f32x4_sub(even3, odd4);
+}
+
+// Transposes an 8x8 block held as its left and right halves, four rows of four at a time.
+static inline void transpose8(f32x4* left, f32x4* right)
+{
+    f32x4_transpose(left);
+    f32x4_transpose(left + 4);
+    f32x4_transpose(right);
+    f32x4_transpose(right + 4);
+    for (int i = 0; i < 4; i++) {
+        f32x4 t     = left[4 + i];
+        left[4 + i] = right[i];
+        right[i]    = t;
+    }
+}
+
+// Dequantized coefficients to pixels. `low` has bit 0 set when the coefficients in rows 4-7 are all zero and bit 1 when
+// those in columns 4-7 are; the first pass then skips the right half, which stays zero, and either pass can use the
+// cheaper idct_pass_low().
+static void idct_block(const int16_t* coefficients, uint32_t low, uint8_t* out, size_t stride)
+{
+    alignas(16) float scaled[64];
+    for (int i = 0; i < 64; i++) {
+        scaled[i] = coefficients[i] * idct_aan[i >> 3] * idct_aan[i & 7] * 0.125f;
+    }
+    scaled[0] += 128.0f; // the level shift, which the IDCT of the DC adds to every pixel
+
+    f32x4 left[8], right[8];
+    for (int r = 0; r < 8; r++) {
+        left[r]  = f32x4_load(scaled + r * 8);
+        right[r] = f32x4_load(scaled + r * 8 + 4);
+    }
+    if (low & 1) {
+        idct_pass_low(left);
+        if (!(low & 2)) { idct_pass_low(right); }
+    } else {
+        idct_pass(left);
+        if (!(low & 2)) { idct_pass(right); }
+    }
+    transpose8(left, right);
+    if (low & 2) {
+        idct_pass_low(left);
+        idct_pass_low(right);
+    } else {
+        idct_pass(left);
+        idct_pass(right);
+    }
+    transpose8(left, right);
+    for (int r = 0; r < 8; r++) {
+        f32x4_store_u8x8(out + r * stride, left[r], right[r]);
+    }
+}
+#endif
+
+static bool decode_block(BitReader* bits, const Jpeg* jpeg, uint32_t c, int32_t* dc_pred, uint8_t* out, size_t stride)
+{
+    const JpegComponent* component = &jpeg->components[c];
+    const uint16_t* dequant        = jpeg->dequant[c];
+
+    int32_t size = decode_symbol(bits, &jpeg->dc[component->dc_table]);
+    if (size < 0 || size > 11) { return fail("bad DC coefficient"); }
+    *dc_pred += receive_extend(bits, (uint32_t)size);
+
+    alignas(16) int16_t block[64];
+    memset(block, 0, sizeof(block));
+    block[0]               = (int16_t)(*dc_pred * dequant[0]);
+    uint32_t used          = 0; // natural positions of the AC coefficients, or'd together
+    const HuffmanTable* ac = &jpeg->ac[component->ac_table];
+    for (uint32_t k = 1; k < 64;) {
+        refill(bits);
+        int32_t fast = ac->fast_ac[bits->buffer >> (64 - JPEG_FAST_BITS)];
+        if (fast) {
+            uint32_t run = ((uint32_t)fast >> 8) & 0xFF;
+            take_bits(bits, (uint32_t)fast & 0xFF);
+            k += run;
+            if (k > 63) {
+                if (run >= 15) { break; } // end of block, or zeros running off the end
+                return fail("bad AC coefficient");
+            }
+            uint32_t natural = jpeg_natural_order[k++];
+            block[natural]   = (int16_t)((fast >> 16) * dequant[natural]);
+            used |= natural;
+            continue;
+        }
+
+        int32_t symbol = decode_symbol(bits, ac);
+        if (symbol < 0) { return fail("bad AC coefficient"); }
+        uint32_t run = (uint32_t)symbol >> 4;
+        uint32_t bit = (uint32_t)symbol & 15;
+        if (!bit) {
+            if (run != 15) { break; } // end of block
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) { return fail("bad AC coefficient"); }
+        uint32_t natural = jpeg_natural_order[k++];
+        block[natural]   = (int16_t)(receive_extend(bits, bit) * dequant[natural]);
+        used |= natural;
+    }
+
+    if (!used) {
+        // Flat; the IDCT of a lone DC coefficient is an eighth of it everywhere.
+        int32_t value = ((block[0] + 4) >> 3) + 128;
+        value         = value < 0 ? 0 : value > 255 ? 255 : value;
+        for (int r = 0; r < 8; r++) {
+            memset(out + r * stride, value, 8);
+        }
+        return true;
+    }
+    idct_block(block, (used & 32 ? 0 : 1) | (used & 4 ? 0 : 2), out, stride);
+    return true;
+}
+
+typedef struct SegmentJob {
+    Jpeg* jpeg;
+    std::vector<uint8_t>* ok;
+} SegmentJob;
+
+static void decode_segments(void* data, uint32_t begin, uint32_t end)
+{
+    SegmentJob* job        = (SegmentJob*)data;
+    Jpeg* jpeg             = job->jpeg;
+    uint32_t mcu_count    = jpeg->mcus_x * jpeg->mcus_y;
+    uint32_t mcus_per_part = jpeg->restart_interval ? jpeg->restart_interval : mcu_count;
+
+    for (uint32_t s = begin; s < end; s++) {
+        BitReader bits                       = { jpeg->segments[s].begin, jpeg->segments[s].end, 0, 0 };
+        int32_t dc_pred[JPEG_MAX_COMPONENTS] = { 0 };
+        uint32_t first                       = s * mcus_per_part;
+        uint32_t last                        = first + mcus_per_part < mcu_count ? first + mcus_per_part : mcu_count;
+        bool ok                              = true;
+        for (uint32_t mcu = first; mcu < last && ok; mcu++) {
+            uint32_t mcu_x = mcu % jpeg->mcus_x;
+            uint32_t mcu_y = mcu / jpeg->mcus_x;
+            for (uint32_t c = 0; c < jpeg->component_count && ok; c++) {
+                JpegComponent* component = &jpeg->components[c];
+                // A lone component is not interleaved, and its MCUs are single blocks whatever its sampling.
+                uint32_t h = jpeg->component_count == 1 ? 1 : component->h;
+                uint32_t v = jpeg->component_count == 1 ? 1 : component->v;
+                for (uint32_t y = 0; y < v && ok; y++) {
+                    for (uint32_t x = 0; x < h && ok; x++) {
+                        size_t row   = (size_t)((mcu_y * v + y) * 8) * component->stride;
+                        uint8_t* out = component->plane.get() + row + (mcu_x * h + x) * 8;
+                        ok           = decode_block(&bits, jpeg, c, &dc_pred[c], out, component->stride);
+                    }
+                }
+            }
+        }
+        (*job->ok)[s] = ok;
+    }
+}
+
+// One row of a component at full resolution, upsampled if it was subsampled. `sums` has room for the row's
+// vertical_sums() and eight more.
+static const uint8_t* component_row(
+    const Jpeg* jpeg, const JpegComponent* component, uint32_t y, uint8_t* scratch, uint16_t* sums)
+{
+    uint32_t ratio_x = jpeg->h_max / component->h;
+    uint32_t ratio_y = jpeg->v_max / component->v;
+    uint32_t width   = component->width;
+    const uint8_t* near = component->plane.get() + (size_t)(y / ratio_y) * component->stride;
+    if (ratio_x == 1 && ratio_y == 1) { return near; }
+
+    const uint8_t* far = near;
+    if (ratio_y == 2) {
+        uint32_t in_y  = y / 2;
+        uint32_t far_y = y & 1 ? (in_y + 1 < component->height ? in_y + 1 : in_y) : (in_y ? in_y - 1 : 0);
+        far            = component->plane.get() + (size_t)far_y * component->stride;
+    }
+    if (ratio_x == 1) {
+        for (uint32_t i = 0; i < width; i++) {
+            scratch[i] = (uint8_t)((near[i] * 3 + far[i] + 2) >> 2);
+        }
+        return scratch;
+    }
+
+    // Planes are whole MCUs wide, so the reads past the end of the row stay inside them.
+    vertical_sums(near, far, width, sums + 1);
+    sums[0]         = sums[1];
+    sums[width + 1] = sums[width];
+    upsample_h2(sums + 1, width, scratch);
+    return scratch;
+}
+
+typedef struct ConvertJob {
+    const Jpeg* jpeg;
+    uint8_t* output;
+    size_t stride;
+    uint32_t channels;
+} ConvertJob;
+
+// Writes four pixels worth of R, G and B, or as many of them as are left in the row.
+static inline void write_pixels(
+    uint8_t* out, const uint8_t* r, const uint8_t* g, const uint8_t* b, uint32_t count, uint32_t channels)
+{
+    for (uint32_t i = 0; i < count; i++, out += channels) {
+        if (channels >= 3) {
+            out[0] = r[i];
+            out[1] = g[i];
+            out[2] = b[i];
+            if (channels == 4) { out[3] = 255; }
+        } else {
+            // BT.601 luma, as stb_image computes it.
+            out[0] = (uint8_t)((r[i] * 77 + g[i] * 150 + b[i] * 29) >> 8);
+            if (channels == 2) { out[1] = 255; }
+        }
+    }
+}
+
+static void convert_rows(void* data, uint32_t begin, uint32_t end)
+{
+    ConvertJob* job  = (ConvertJob*)data;
+    const Jpeg* jpeg = job->jpeg;
+    uint32_t width   = jpeg->width;
+
+    // Padded to whole groups of eight, which the color conversion and upsampling read and write past the end of a row.
+    std::vector<uint8_t> scratch((size_t)JPEG_MAX_COMPONENTS * (width + 16));
+    std::vector<uint16_t> sums(width / 2 + 16);
+    for (uint32_t y = begin; y < end; y++) {
+        uint8_t* out = job->output + (size_t)y * job->stride;
+        const uint8_t* rows[JPEG_MAX_COMPONENTS];
+        for (uint32_t c = 0; c < jpeg->component_count; c++) {
+            uint8_t* row_scratch = scratch.data() + (size_t)c * (width + 16);
+            rows[c]              = component_row(jpeg, &jpeg->components[c], y, row_scratch, sums.data());
+        }
+
+        if (jpeg->component_count == 1 || (!jpeg->rgb && job->channels <= 2)) {
+            // Grey, or only the luma of a color image wanted.
+            for (uint32_t x = 0; x < width; x++, out += job->channels) {
+                uint8_t luma = rows[0][x];
+                out[0]       = luma;
+                if (job->channels == 2) { out[1] = 255; }
+                if (job->channels >= 3) { out[1] = out[2] = luma; }
+                if (job->channels == 4) { out[3] = 255; }
+            }
+            continue;
+        }
+
+        if (jpeg->rgb) {
+            for (uint32_t x = 0; x < width; x += 4, out += 4 * job->channels) {
+                uint32_t count = width - x < 4 ? width - x : 4;
+                write_pixels(out, rows[0] + x, rows[1] + x, rows[2] + x, count, job->channels);
+            }
+            continue;
+        }
+
+        uint32_t whole = width & ~7u;
+        for (uint32_t x = 0; x < whole; x += 8, out += 8 * job->channels) {
+            ycbcr_to_rgb8(rows[0] + x, rows[1] + x, rows[2] + x, out, job->channels);
+        }
+        if (whole < width) {
+            uint8_t tail[8 * 4];
+            ycbcr_to_rgb8(rows[0] + whole, rows[1] + whole, rows[2] + whole, tail, job->channels);
+            memcpy(out, tail, (width - whole) * job->channels);
+        }
+    }
+}
+
+static void run_range(JobPool* jobs, uint32_t count, uint32_t batch, JobRangeFunc func, void* data)
+{
+    if (jobs && count > batch) {
+        job_pool_parallel_for(jobs, count, batch, func, data);
+    } else {
+        func(data, 0, count);
+    }
+}
+
+bool image_decode_jpeg(const void* data, size_t size, const ImageDecodeDesc* desc, ImageDecodeResult* result)
+{
+    Jpeg* jpeg = new Jpeg();
+    if (!parse(jpeg, (const uint8_t*)data, size)) {
+        delete jpeg;
+        return false;
+    }
+    for (uint32_t c = 0; c < jpeg->component_count; c++) {
+        if (!jpeg->quant_present[jpeg->components[c].quant]) {
+            delete jpeg;
+            return fail("missing quantization table");
+        }
+    }
+
+    const JpegComponent* ids = jpeg->components;
+    jpeg->rgb                = jpeg->component_count == 3
+        && ((ids[0].id == 'R' && ids[1].id == 'G' && ids[2].id == 'B') || (jpeg->adobe && jpeg->adobe_transform == 0));
+
+    // Planes cover whole MCUs, so blocks can be written without clipping.
+    if (jpeg->component_count == 1) {
+        jpeg->h_max = jpeg->v_max = jpeg->components[0].h = jpeg->components[0].v = 1;
+    }
+    jpeg->mcus_x = (jpeg->width + 8 * jpeg->h_max - 1) / (8 * jpeg->h_max);
+    jpeg->mcus_y = (jpeg->height + 8 * jpeg->v_max - 1) / (8 * jpeg->v_max);
+    for (uint32_t c = 0; c < jpeg->component_count; c++) {
+        JpegComponent* component = &jpeg->components[c];
+        component->width         = (jpeg->width * component->h + jpeg->h_max - 1) / jpeg->h_max;
+        component->height        = (jpeg->height * component->v + jpeg->v_max - 1) / jpeg->v_max;
+        component->stride        = (size_t)jpeg->mcus_x * component->h * 8;
+        component->plane.reset(new uint8_t[component->stride * jpeg->mcus_y * component->v * 8]);
+    }
+
+    uint32_t mcu_count    = jpeg->mcus_x * jpeg->mcus_y;
+    uint32_t restart      = jpeg->restart_interval;
+    uint32_t segment_want = restart ? (mcu_count + restart - 1) / restart : 1;
+    if (jpeg->segments.size() < segment_want) {
+        delete jpeg;
+        return fail("missing restart markers");
+    }
+    jpeg->segments.resize(segment_want);
+    build_dequant(jpeg);
+
+    uint32_t channels = desc->channels ? desc->channels : jpeg->component_count;
+    size_t stride     = desc->stride ? desc->stride : (size_t)jpeg->width * channels;
+    uint8_t* output   = desc->output ? desc->output : (uint8_t*)malloc(stride * jpeg->height);
+    if (channels > 4 || stride < (size_t)jpeg->width * channels || !output) {
+        if (!desc->output) { free(output); }
+        delete jpeg;
+        return fail(channels > 4 ? "bad channel count" : "out of memory");
+    }
+
+    std::vector<uint8_t> ok(segment_want, 0);
+    SegmentJob segment_job = { jpeg, &ok };
+    run_range(desc->jobs, segment_want, 1, decode_segments, &segment_job);
+    for (uint8_t segment_ok : ok) {
+        if (!segment_ok) {
+            if (!desc->output) { free(output); }
+            delete jpeg;
+            return false;
+        }
+    }
+
+    ConvertJob convert_job = { jpeg, output, stride, channels };
+    run_range(desc->jobs, jpeg->height, IMAGE_CONVERT_BATCH, convert_rows, &convert_job);
+
+    result->pixels         = output;
+    result->width          = jpeg->width;
+    result->height         = jpeg->height;
+    result->channels       = channels;
+    result->image_channels = jpeg->component_count;
+    result->fast_path      = true;
+    result->segments       = segment_want;
+    delete jpeg;
+    return true;
+}
+
+// Inflate (RFC 1950 and 1951) for PNG image data. It beats stb_image's, which dominates its PNG decode time, mostly by
+// refilling the bit buffer eight bytes at a time, decoding nearly all codes with one table lookup and copying matches
+// eight bytes at a time. The Adler-32 checksum is not checked, as stb_image does not either.
+#define INFLATE_FAST_BITS 10
+#define INFLATE_MAX_BITS 15
+
+typedef struct InflateTable {
+    uint16_t fast[1 << INFLATE_FAST_BITS]; // (length << 9) | symbol for codes of up to INFLATE_FAST_BITS, 0 otherwise
+    uint16_t counts[INFLATE_MAX_BITS + 1]; // codes of each length
+    uint16_t symbols[288];                 // in code order
+} InflateTable;
+
+typedef struct InflateBits {
+    const uint8_t* cursor;
+    const uint8_t* end;
+    uint64_t buffer; // LSB first
+    uint32_t count;
+    uint32_t padding; // zero bytes added past the end
+} InflateBits;
+
+static const uint16_t inflate_length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51,
+    59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t inflate_length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,
+    4, 5, 5, 5, 5, 0 };
+static const uint16_t inflate_distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+    385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t inflate_distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9,
+    10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Tops the buffer up to at least 56 bits: enough for a length code, a distance code and their extra bits.
+static inline void inflate_refill(InflateBits* bits)
+{
+    if (bits->end - bits->cursor >= 8) {
+        uint64_t word;
+        memcpy(&word, bits->cursor, 8); // little endian
+        bits->buffer |= word << bits->count;
+        bits->cursor += (63 - bits->count) >> 3;
+        bits->count |= 56;
+        return;
+    }
+    while (bits->count <= 56) {
+        if (bits->cursor < bits->end) {
+            bits->buffer |= (uint64_t)*bits->cursor++ << bits->count;
+        } else {
+            bits->padding++;
+        }
+        bits->count += 8;
+    }
+}
+
+static inline uint32_t inflate_take(InflateBits* bits, uint32_t n)
+{
+    uint32_t value = (uint32_t)(bits->buffer & ((1ull << n) - 1));
+    bits->buffer >>= n;
+    bits->count -= n;
+    return value;
+}
+
+// Needs INFLATE_MAX_BITS in the buffer.
+static inline int32_t inflate_symbol(InflateBits* bits, const InflateTable* table)
+{
+    uint32_t fast = table->fast[bits->buffer & ((1u << INFLATE_FAST_BITS) - 1)];
+    if (fast) {
+        inflate_take(bits, fast >> 9);
+        return (int32_t)(fast & 511);
+    }
+
+    // Longer codes a bit at a time, counting through the codes of each length as puff.c does.
+    int32_t code = 0, first = 0, index = 0;
+    for (uint32_t length = 1; length <= INFLATE_MAX_BITS; length++) {
+        code |= (int32_t)((bits->buffer >> (length - 1)) & 1);
+        int32_t count = table->counts[length];
+        if (code - first < count) {
+            inflate_take(bits, length);
+            return table->symbols[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static bool build_inflate_table(InflateTable* table, const uint8_t* lengths, uint32_t count)
+{
+    memset(table, 0, sizeof(*table));
+    for (uint32_t i = 0; i < count; i++) {
+        table->counts[lengths[i]]++;
+    }
+    table->counts[0] = 0;
+
+    // Incomplete codes are allowed, as a lone distance code has to be; oversubscribed ones are not.
+    int32_t left = 1;
+    uint16_t offsets[INFLATE_MAX_BITS + 2] = { 0 };
+    for (uint32_t length = 1; length <= INFLATE_MAX_BITS; length++) {
+        left = (left << 1) - table->counts[length];
+        if (left < 0) { return fail("bad deflate code lengths"); }
+        offsets[length + 1] = (uint16_t)(offsets[length] + table->counts[length]);
+    }
+
+    uint32_t next_code[INFLATE_MAX_BITS + 1];
+    uint32_t code = 0;
+    for (uint32_t length = 1; length <= INFLATE_MAX_BITS; length++) {
+        code              = (code + table->counts[length - 1]) << 1;
+        next_code[length] = code;
+    }
+    for (uint32_t symbol = 0; symbol < count; symbol++) {
+        uint32_t length = lengths[symbol];
+        if (!length) { continue; }
+        table->symbols[offsets[length]++] = (uint16_t)symbol;
+        if (length > INFLATE_FAST_BITS) { continue; }
+
+        // Codes are sent most significant bit first into a stream read from the least significant end.
+        uint32_t reversed = 0;
+        for (uint32_t i = 0, c = next_code[length]++; i < length; i++) {
+            reversed |= ((c >> i) & 1) << (length - 1 - i);
+        }
+        for (uint32_t i = reversed; i < (1u << INFLATE_FAST_BITS); i += 1u << length) {
+            table->fast[i] = (uint16_t)((length << 9) | symbol);
+        }
+    }
+    return true;
+}
+
+static bool read_dynamic_tables(InflateBits* bits, InflateTable* literals, InflateTable* distances)
+{
+    static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    inflate_refill(bits);
+    uint32_t literal_count  = inflate_take(bits, 5) + 257;
+    uint32_t distance_count = inflate_take(bits, 5) + 1;
+    uint32_t length_count   = inflate_take(bits, 4) + 4;
+    if (literal_count > 286 || distance_count > 30) { return fail("bad deflate block"); }
+
+    uint8_t lengths[286 + 30] = { 0 };
+    for (uint32_t i = 0; i < length_count; i++) {
+        inflate_refill(bits);
+        lengths[order[i]] = (uint8_t)inflate_take(bits, 3);
+    }
+    InflateTable length_table;
+    if (!build_inflate_table(&length_table, lengths, 19)) { return false; }
+
+    memset(lengths, 0, sizeof(lengths));
+    uint32_t total = literal_count + distance_count;
+    for (uint32_t i = 0; i < total;) {
+        inflate_refill(bits);
+        int32_t symbol = inflate_symbol(bits, &length_table);
+        if (symbol < 0) { return fail("bad deflate code lengths"); }
+        if (symbol < 16) {
+            lengths[i++] = (uint8_t)symbol;
+            continue;
+        }
+        uint32_t repeat = 0;
+        uint8_t value   = 0;
+        if (symbol == 16) {
+            if (!i) { return fail("bad deflate code lengths"); }
+            value  = lengths[i - 1];
+            repeat = 3 + inflate_take(bits, 2);
+        } else {
+            repeat = symbol == 17 ? 3 + inflate_take(bits, 3) : 11 + inflate_take(bits, 7);
+        }
+        if (repeat > total - i) { return fail("bad deflate code lengths"); }
+        memset(lengths + i, value, repeat);
+        i += repeat;
+    }
+    if (!lengths[256]) { return fail("bad deflate code lengths"); }
+    return build_inflate_table(literals, lengths, literal_count)
+        && build_inflate_table(distances, lengths + literal_count, distance_count);
+}
+
+// Decodes a zlib stream of exactly `size` bytes into `out`, which has room for 8 more that matches may write past it.
+static bool inflate_zlib(const uint8_t* data, size_t data_size, uint8_t* out, size_t size)
+{
+    if (data_size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 || (data[1] & 0x20)) {
+        return fail("bad zlib header");
+    }
+    InflateBits bits = { data + 2, data + data_size, 0, 0, 0 };
+    uint8_t* begin   = out;
+    uint8_t* end     = out + size;
+
+    InflateTable literals, distances;
+    bool final = false;
+    bool ok    = true;
+    while (ok && !final) {
+        inflate_refill(&bits);
+        final         = inflate_take(&bits, 1);
+        uint32_t type = inflate_take(&bits, 2);
+        if (type == 0) {
+            // Stored: back up to the byte boundary after the header and copy the bytes as they are.
+            inflate_take(&bits, bits.count & 7);
+            if (bits.padding * 8 > bits.count) {
+                ok = fail("truncated zlib stream");
+                break;
+            }
+            bits.cursor -= bits.count / 8 - bits.padding;
+            bits.buffer = bits.count = bits.padding = 0;
+            if (bits.end - bits.cursor < 4) {
+                ok = fail("truncated zlib stream");
+                break;
+            }
+            uint32_t length = bits.cursor[0] | (bits.cursor[1] << 8);
+            uint32_t check  = bits.cursor[2] | (bits.cursor[3] << 8);
+            bits.cursor += 4;
+            if ((length ^ 0xFFFF) != check || length > (size_t)(bits.end - bits.cursor)
+                || length > (size_t)(end - out)) {
+                ok = fail("bad stored deflate block");
+                break;
+            }
+            memcpy(out, bits.cursor, length);
+            out += length;
+            bits.cursor += length;
+            continue;
+        }
+
+        if (type == 1) {
+            uint8_t lengths[288 + 30];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 30);
+            ok = build_inflate_table(&literals, lengths, 288) && build_inflate_table(&distances, lengths + 288, 30);
+        } else if (type == 2) {
+            ok = read_dynamic_tables(&bits, &literals, &distances);
+        } else {
+            ok = fail("bad deflate block");
+        }
+
+        while (ok) {
+            inflate_refill(&bits);
+            int32_t symbol = inflate_symbol(&bits, &literals);
+            if (symbol < 256) {
+                if (symbol < 0 || out == end) {
+                    ok = fail("bad zlib stream");
+                    break;
+                }
+                *out++ = (uint8_t)symbol;
+                continue;
+            }
+            if (symbol == 256) { break; }
+            symbol -= 257;
+            if (symbol >= 29) {
+                ok = fail("bad zlib stream");
+                break;
+            }
+            size_t length = inflate_length_base[symbol] + inflate_take(&bits, inflate_length_extra[symbol]);
+            int32_t code  = inflate_symbol(&bits, &distances);
+            if (code < 0 || code >= 30) {
+                ok = fail("bad zlib stream");
+                break;
+            }
+            size_t distance = inflate_distance_base[code] + inflate_take(&bits, inflate_distance_extra[code]);
+            if (distance > (size_t)(out - begin) || length > (size_t)(end - out)) {
+                ok = fail("bad zlib stream");
+                break;
+            }
+
+            const uint8_t* from = out - distance;
+            uint8_t* to         = out;
+            out += length;
+            if (distance >= 8) {
+                // Whole words, up to 7 bytes past the match; a later write or the slack after `end` takes those.
+                for (; to < out; to += 8, from += 8) {
+                    uint64_t word;
+                    memcpy(&word, from, 8);
+                    memcpy(to, &word, 8);
+                }
+            } else {
+                for (; to < out; to++, from++) {
+                    *to = *from;
+                }
+            }
+        }
+        if (ok && bits.padding * 8 > bits.count) { ok = fail("truncated zlib stream"); }
+    }
+    if (ok && out != end) { return fail("truncated zlib stream"); }
+    return ok;
+}
+
+// PNG: inflate_zlib() above, then the row filters. stb_image undoes those a byte at a time; here the Sub, Average and
+// Paeth filters of 3 and 4 channel images, whose bytes depend on the pixel to their left, go a whole pixel at a time
+// with SSE2 or NEON. Palette, 16 bit, interlaced and color keyed images are left to stb_image.
+#define PNG_MAX_DIMENSION (1u << 24)
+
+enum {
+    PNG_FILTER_NONE,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVERAGE,
+    PNG_FILTER_PAETH,
+};
+
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+#if defined(SIMD_SSE2)
+typedef __m128i PngPixel; // one pixel in the low bytes
+
+static inline PngPixel png_pixel(uint32_t bytes) { return _mm_cvtsi32_si128((int)bytes); }
+static inline uint32_t png_bytes(PngPixel pixel) { return (uint32_t)_mm_cvtsi128_si32(pixel); }
+static inline PngPixel png_add(PngPixel a, PngPixel b) { return _mm_add_epi8(a, b); }
+
+// (a + b) >> 1 per byte; avg rounds up, so the carried bit comes off again.
+static inline PngPixel png_average(PngPixel a, PngPixel b)
+{
+    return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+// Whichever of left, up and upper left is closest to left + up - upper left, in that order on ties.
+static inline PngPixel png_paeth(PngPixel left, PngPixel up, PngPixel upper_left)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i a    = _mm_unpacklo_epi8(left, zero);
+    __m128i b    = _mm_unpacklo_epi8(up, zero);
+    __m128i c    = _mm_unpacklo_epi8(upper_left, zero);
+    __m128i pa   = _mm_sub_epi16(b, c);
+    __m128i pb   = _mm_sub_epi16(a, c);
+    __m128i pc   = _mm_add_epi16(pa, pb);
+    pa           = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+    pb           = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+    pc           = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+    __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+    __m128i not_b = _mm_cmpgt_epi16(pb, pc);
+    __m128i bc    = _mm_or_si128(_mm_and_si128(not_b, c), _mm_andnot_si128(not_b, b));
+    return _mm_packus_epi16(_mm_or_si128(_mm_and_si128(not_a, bc), _mm_andnot_si128(not_a, a)), zero);
+}
+#else
+typedef uint8x8_t PngPixel; // one pixel in the low bytes
+
+static inline PngPixel png_pixel(uint32_t bytes) { return vreinterpret_u8_u32(vdup_n_u32(bytes)); }
+static inline uint32_t png_bytes(PngPixel pixel) { return vget_lane_u32(vreinterpret_u32_u8(pixel), 0); }
+static inline PngPixel png_add(PngPixel a, PngPixel b) { return vadd_u8(a, b); }
+static inline PngPixel png_average(PngPixel a, PngPixel b) { return vhadd_u8(a, b); }
+
+// Whichever of left, up and upper left is closest to left + up - upper left, in that order on ties.
+static inline PngPixel png_paeth(PngPixel left, PngPixel up, PngPixel upper_left)
+{
+    int16x8_t a  = vreinterpretq_s16_u16(vmovl_u8(left));
+    int16x8_t b  = vreinterpretq_s16_u16(vmovl_u8(up));
+    int16x8_t c  = vreinterpretq_s16_u16(vmovl_u8(upper_left));
+    int16x8_t pa = vsubq_s16(b, c);
+    int16x8_t pb = vsubq_s16(a, c);
+    int16x8_t pc = vabsq_s16(vaddq_s16(pa, pb));
+    pa           = vabsq_s16(pa);
+    pb           = vabsq_s16(pb);
+
+    uint16x8_t pick_a = vandq_u16(vcleq_s16(pa, pb), vcleq_s16(pa, pc));
+    uint16x8_t pick_b = vcleq_s16(pb, pc);
+    return vmovn_u16(vreinterpretq_u16_s16(vbslq_s16(pick_a, a, vbslq_s16(pick_b, b, c))));
+}
+#endif
+
+static inline PngPixel png_load(const uint8_t* p, uint32_t bpp)
+{
+    uint32_t bytes;
+    if (bpp == 4) {
+        memcpy(&bytes, p, 4);
+    } else {
+        bytes = p[0] | (p[1] << 8) | (p[2] << 16);
+    }
+    return png_pixel(bytes);
+}
+
+static inline void png_store(uint8_t* p, PngPixel pixel, uint32_t bpp)
+{
+    uint32_t bytes = png_bytes(pixel);
+    if (bpp == 4) {
+        memcpy(p, &bytes, 4);
+    } else {
+        p[0] = (uint8_t)bytes;
+        p[1] = (uint8_t)(bytes >> 8);
+        p[2] = (uint8_t)(bytes >> 16);
+    }
+}
+
+// Sub, Average and Paeth for 3 and 4 bytes per pixel, in place.
+static void unfilter_pixels(uint32_t filter, uint8_t* row, const uint8_t* prior, size_t size, uint32_t bpp)
+{
+    PngPixel left = png_pixel(0);
+    if (filter == PNG_FILTER_SUB) {
+        for (size_t i = 0; i < size; i += bpp) {
+            left = png_add(png_load(row + i, bpp), left);
+            png_store(row + i, left, bpp);
+        }
+    } else if (filter == PNG_FILTER_AVERAGE) {
+        for (size_t i = 0; i < size; i += bpp) {
+            left = png_add(png_load(row + i, bpp), png_average(left, png_load(prior + i, bpp)));
+            png_store(row + i, left, bpp);
+        }
+    } else {
+        PngPixel upper_left = png_pixel(0);
+        for (size_t i = 0; i < size; i += bpp) {
+            PngPixel up = png_load(prior + i, bpp);
+            left        = png_add(png_load(row + i, bpp), png_paeth(left, up, upper_left));
+            upper_left  = up;
+            png_store(row + i, left, bpp);
+        }
+    }
+}
+#endif
+
+static inline uint8_t paeth(int32_t a, int32_t b, int32_t c)
+{
+    int32_t pa = abs(b - c);
+    int32_t pb = abs(a - c);
+    int32_t pc = abs(a + b - 2 * c);
+    return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Undoes one row's filter in place. `prior` is the row above, already unfiltered, or zeros for the first.
+static bool unfilter_row(uint32_t filter, uint8_t* row, const uint8_t* prior, size_t size, uint32_t bpp)
+{
+    if (filter > PNG_FILTER_PAETH) { return fail("bad PNG filter"); }
+    if (filter == PNG_FILTER_NONE) { return true; }
+    if (filter == PNG_FILTER_UP) {
+        for (size_t i = 0; i < size; i++) {
+            row[i] = (uint8_t)(row[i] + prior[i]);
+        }
+        return true;
+    }
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+    if (bpp >= 3) {
+        unfilter_pixels(filter, row, prior, size, bpp);
+        return true;
+    }
+#endif
+
+    // The first pixel has nothing to its left.
+    if (filter == PNG_FILTER_SUB) {
+        for (size_t i = bpp; i < size; i++) {
+            row[i] = (uint8_t)(row[i] + row[i - bpp]);
+        }
+    } else if (filter == PNG_FILTER_AVERAGE) {
+        for (size_t i = 0; i < bpp; i++) {
+            row[i] = (uint8_t)(row[i] + (prior[i] >> 1));
+        }
+        for (size_t i = bpp; i < size; i++) {
+            row[i] = (uint8_t)(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+        }
+    } else {
+        for (size_t i = 0; i < bpp; i++) {
+            row[i] = (uint8_t)(row[i] + prior[i]);
+        }
+        for (size_t i = bpp; i < size; i++) {
+            row[i] = (uint8_t)(row[i] + paeth(row[i - bpp], prior[i], prior[i - bpp]));
+        }
+    }
+    return true;
+}
+
+// One unfiltered row into the requested channel count, the way stb_image converts.
+static void write_png_row(uint8_t* out, const uint8_t* row, uint32_t width, uint32_t image_channels, uint32_t channels)
+{
+    if (channels == image_channels) {
+        memcpy(out, row, (size_t)width * channels);
+        return;
+    }
+    if (image_channels == 3 && channels == 4) {
+        for (uint32_t x = 0; x < width; x++, out += 4, row += 3) {
+            out[0] = row[0];
+            out[1] = row[1];
+            out[2] = row[2];
+            out[3] = 255;
+        }
+        return;
+    }
+    for (uint32_t x = 0; x < width; x++, out += channels, row += image_channels) {
+        bool color    = image_channels >= 3;
+        uint8_t alpha = image_channels == 2 ? row[1] : image_channels == 4 ? row[3] : 255;
+        if (channels >= 3) {
+            out[0] = row[0];
+            out[1] = row[color ? 1 : 0];
+            out[2] = row[color ? 2 : 0];
+            if (channels == 4) { out[3] = alpha; }
+        } else {
+            out[0] = color ? (uint8_t)((row[0] * 77 + row[1] * 150 + row[2] * 29) >> 8) : row[0];
+            if (channels == 2) { out[1] = alpha; }
+        }
+    }
+}
+
+static uint32_t read32(const uint8_t* p) { return (read16(p) << 16) | read16(p + 2); }
+
+typedef struct Png {
+    uint32_t width, height;
+    uint32_t channels;
+    std::vector<uint8_t> compressed; // the IDAT chunks' data, joined
+} Png;
+
+static bool parse_png(Png* png, const uint8_t* p, size_t size)
+{
+    static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    if (size < 8 || memcmp(p, signature, 8) != 0) { return fail("not a PNG"); }
+    const uint8_t* end = p + size;
+    p += 8;
+
+    bool header = false;
+    while (end - p >= 12) {
+        uint32_t length = read32(p);
+        const uint8_t* type = p + 4;
+        const uint8_t* body = p + 8;
+        if (length > (size_t)(end - body) - 4) { return fail("truncated PNG chunk"); }
+        p = body + length + 4; // past the CRC, which is not checked
+
+        if (!memcmp(type, "IHDR", 4)) {
+            if (length != 13) { return fail("bad PNG header"); }
+            png->width    = read32(body);
+            png->height   = read32(body + 4);
+            uint32_t kind = body[9];
+            if (!png->width || !png->height || png->width > PNG_MAX_DIMENSION || png->height > PNG_MAX_DIMENSION) {
+                return fail("bad PNG size");
+            }
+            if (body[8] != 8) { return fail("PNG bit depth not supported"); }
+            if (kind == 3) { return fail("palette PNG not supported"); }
+            if (kind != 0 && kind != 2 && kind != 4 && kind != 6) { return fail("bad PNG color type"); }
+            if (body[10] || body[11]) { return fail("bad PNG compression or filter method"); }
+            if (body[12]) { return fail("interlaced PNG not supported"); }
+            png->channels = kind == 0 ? 1 : kind == 2 ? 3 : kind == 4 ? 2 : 4;
+            header        = true;
+        } else if (!header) {
+            return fail("missing PNG header");
+        } else if (!memcmp(type, "IDAT", 4)) {
+            png->compressed.insert(png->compressed.end(), body, body + length);
+        } else if (!memcmp(type, "tRNS", 4)) {
+            return fail("color keyed PNG not supported");
+        } else if (!memcmp(type, "IEND", 4)) {
+            return !png->compressed.empty() || fail("missing PNG image data");
+        } else if (!(type[0] & 0x20)) {
+            return fail("unknown critical PNG chunk");
+        }
+    }
+    return fail("missing PNG end");
+}
+
+bool image_decode_png(const void* data, size_t size, const ImageDecodeDesc* desc, ImageDecodeResult* result)
+{
+    Png png;
+    if (!parse_png(&png, (const uint8_t*)data, size)) { return false; }
+
+    size_t row_size = (size_t)png.width * png.channels;
+    size_t raw_size = (row_size + 1) * png.height; // each row starts with its filter type
+    if (raw_size > INT32_MAX) { return fail("PNG too large"); }
+    std::vector<uint8_t> raw(raw_size + 8); // room for inflate_zlib() to write past the end
+    if (!inflate_zlib(png.compressed.data(), png.compressed.size(), raw.data(), raw_size)) { return false; }
+
+    uint32_t channels = desc->channels ? desc->channels : png.channels;
+    size_t stride     = desc->stride ? desc->stride : (size_t)png.width * channels;
+    uint8_t* output   = desc->output ? desc->output : (uint8_t*)malloc(stride * png.height);
+    if (channels > 4 || stride < (size_t)png.width * channels || !output) {
+        if (!desc->output) { free(output); }
+        return fail(channels > 4 ? "bad channel count" : "out of memory");
+    }
+
+    // Each row is unfiltered against the one above, so this stays on one thread; rows are written out while they are
+    // still in cache.
+    std::vector<uint8_t> zeros(row_size);
+    const uint8_t* prior = zeros.data();
+    for (uint32_t y = 0; y < png.height; y++) {
+        uint8_t* row = raw.data() + y * (row_size + 1);
+        if (!unfilter_row(row[0], row + 1, prior, row_size, png.channels)) {
+            if (!desc->output) { free(output); }
+            return false;
+        }
+        write_png_row(output + y * stride, row + 1, png.width, png.channels, channels);
+        prior = row + 1;
+    }
+
+    result->pixels         = output;
+    result->width          = png.width;
+    result->height         = png.height;
+    result->channels       = channels;
+    result->image_channels = png.channels;
+    result->fast_path      = true;
+    result->segments       = 0;
+    return true;
+}
+
+bool image_info(const void* data, size_t size, uint32_t* width, uint32_t* height, uint32_t* channels)
+{
+    int x, y, comp;
+    if (!stbi_info_from_memory((const stbi_uc*)data, (int)size, &x, &y, &comp)) { return fail(stbi_failure_reason()); }
+    *width    = (uint32_t)x;
+    *height   = (uint32_t)y;
+    *channels = (uint32_t)comp;
+    return true;
+}
+
+bool image_decode(const void* data, size_t size, const ImageDecodeDesc* desc, ImageDecodeResult* result)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    bool jpeg            = size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xD8;
+    bool png             = size >= 8 && !memcmp(bytes, "\x89PNG", 4);
+    if (jpeg && image_decode_jpeg(data, size, desc, result)) { return true; }
+    if (png && image_decode_png(data, size, desc, result)) { return true; }
+
+    int width, height, image_channels;
+    stbi_uc* pixels = stbi_load_from_memory(bytes, (int)size, &width, &height, &image_channels, (int)desc->channels);
+    if (!pixels) { return fail(stbi_failure_reason()); }
+
+    uint32_t channels = desc->channels ? desc->channels : (uint32_t)image_channels;
+    result->pixels    = pixels;
+    if (desc->output) {
+        size_t row    = (size_t)width * channels;
+        size_t stride = desc->stride ? desc->stride : row;
+        for (int y = 0; y < height; y++) {
+            memcpy(desc->output + y * stride, pixels + y * row, row);
+        }
+        stbi_image_free(pixels);
+        result->pixels = desc->output;
+    }
+    result->width          = (uint32_t)width;
+    result->height         = (uint32_t)height;
+    result->channels       = channels;
+    result->image_channels = (uint32_t)image_channels;
+    result->fast_path      = false;
+    result->segments       = 0;
+    return true;
+}
+
+uint8_t* image_load_from_memory(
+    const void* data, int size, int* width, int* height, int* channels, int desired_channels)
+{
+    ImageDecodeDesc desc = { 0 };
+    desc.channels        = (uint32_t)desired_channels;
+    ImageDecodeResult result;
+    if (size <= 0 || !image_decode(data, (size_t)size, &desc, &result)) { return NULL; }
+    *width    = (int)result.width;
+    *height   = (int)result.height;
+    *channels = (int)result.image_channels;
+    return result.pixels;
+}
+
+uint8_t* image_load(const char* path, int* width, int* height, int* channels, int desired_channels)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fail("cannot open file");
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::vector<uint8_t> contents(size > 0 ? (size_t)size : 0);
+    bool read = !contents.empty() && fread(contents.data(), 1, contents.size(), file) == contents.size();
+    fclose(file);
+    if (!read) {
+        fail("cannot read file");
+        return NULL;
+    }
+    return image_load_from_memory(contents.data(), (int)contents.size(), width, height, channels, desired_channels);
+}
+
+// stb_image allocates with malloc too, so whichever path decoded it this frees it.
+void image_free(void* pixels) { free(pixels); }
+
+const char* image_failure_reason(void) { return failure_reason; }
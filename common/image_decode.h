@@ -0,0 +1,61 @@
+#pragma once
+
+#include "job_pool.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Image decoding with fast paths for baseline JPEG, the format most of our textures come in, and 8 bit PNG, with
+// stb_image for everything else (progressive JPEG, palette or 16 bit PNG, TGA, ...).
+//
+// The JPEG path does its IDCT and color conversion with SSE2 or NEON where the target has them, and scalar code
+// otherwise. JPEGs written with restart markers, which split the entropy coded data into independently decodable
+// segments, have their segments decoded in parallel on a JobPool. The PNG path inflates with stb_image and undoes the
+// row filters a pixel at a time with SSE2 or NEON. Pixels are written straight into the output in the requested
+// channel count, which can be a caller provided buffer such as a mapped upload buffer.
+//
+// tools/image_bench checks both against stb_image and times them.
+typedef struct ImageDecodeDesc {
+    JobPool* jobs;     // NULL decodes on the calling thread
+    uint32_t channels; // 1 grey, 2 grey alpha, 3 RGB, 4 RGBA; 0 = the image's own
+    uint8_t* output;   // NULL allocates; otherwise at least stride * height bytes
+    size_t stride;     // bytes per output row; 0 = width * channels
+} ImageDecodeDesc;
+
+typedef struct ImageDecodeResult {
+    uint8_t* pixels; // desc->output, or allocated; free with image_free()
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;       // in pixels
+    uint32_t image_channels; // in the file
+    bool fast_path;          // false if stb_image decoded it
+    uint32_t segments;       // JPEG restart segments decoded in parallel, 1 if there were none; 0 if not a JPEG
+} ImageDecodeResult;
+
+// Reads the size and channel count without decoding.
+bool image_info(const void* data, size_t size, uint32_t* width, uint32_t* height, uint32_t* channels);
+
+bool image_decode(const void* data, size_t size, const ImageDecodeDesc* desc, ImageDecodeResult* result);
+
+// Only the JPEG or PNG fast path, without falling back to stb_image. For comparing the two.
+bool image_decode_jpeg(const void* data, size_t size, const ImageDecodeDesc* desc, ImageDecodeResult* result);
+bool image_decode_png(const void* data, size_t size, const ImageDecodeDesc* desc, ImageDecodeResult* result);
+
+// Drop-in replacements for stbi_load_from_memory() and stbi_load(), decoding on the calling thread.
+uint8_t* image_load_from_memory(
+    const void* data, int size, int* width, int* height, int* channels, int desired_channels);
+uint8_t* image_load(const char* path, int* width, int* height, int* channels, int desired_channels);
+
+void image_free(void* pixels);
+
+// Why the last decode on this thread failed.
+const char* image_failure_reason(void);
+
+#ifdef __cplusplus
+}
+#endif
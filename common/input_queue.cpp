@@ -0,0 +1,210 @@
+#include "input_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#define INPUT_CACHE_LINE 64
+
+// Mouse moves, raw motion and wheel each get their own slot, since on most platforms they arrive interleaved.
+#define INPUT_STAGED_TYPES 3
+
+struct InputQueue {
+    std::vector<InputEvent> events;
+    uint32_t mask;
+
+    // Producer. cached_tail is the producer's last look at `tail`, so it only touches the consumer's cache line when
+    // the ring looks full.
+    alignas(INPUT_CACHE_LINE) std::atomic<uint32_t> head;
+    uint32_t cached_tail;
+    InputEvent staged[INPUT_STAGED_TYPES];
+    bool has_staged[INPUT_STAGED_TYPES];
+    std::atomic<uint64_t> pushed;
+    std::atomic<uint64_t> published;
+    std::atomic<uint64_t> coalesced;
+    std::atomic<uint64_t> dropped;
+
+    // Consumer.
+    alignas(INPUT_CACHE_LINE) std::atomic<uint32_t> tail;
+    uint32_t cached_head;
+};
+
+// Returns the staging slot for event types that coalesce, or -1.
+static int32_t staged_slot(InputEventType type)
+{
+    switch (type) {
+    case INPUT_MOUSE_MOVE:
+        return 0;
+    case INPUT_MOUSE_RAW:
+        return 1;
+    case INPUT_MOUSE_WHEEL:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+static void merge(InputEvent* into, const InputEvent* event)
+{
+    if (event->type == INPUT_MOUSE_MOVE) {
+        into->x = event->x;
+        into->y = event->y;
+    } else {
+        into->x += event->x;
+        into->y += event->y;
+    }
+    into->timestamp_ns = std::min(into->timestamp_ns, event->timestamp_ns);
+    into->count += std::max(event->count, 1u);
+}
+
+static void publish(InputQueue* queue, const InputEvent* event)
+{
+    uint32_t head = queue->head.load(std::memory_order_relaxed);
+    if (head - queue->cached_tail > queue->mask) {
+        queue->cached_tail = queue->tail.load(std::memory_order_acquire);
+        if (head - queue->cached_tail > queue->mask) {
+            queue->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    queue->events[head & queue->mask] = *event;
+    queue->head.store(head + 1, std::memory_order_release);
+    queue->published.fetch_add(1, std::memory_order_relaxed);
+}
+
+InputQueue* input_queue_create(uint32_t capacity)
+{
+    uint32_t size = 2;
+    while (size < capacity && size < 0x80000000u) {
+        size <<= 1;
+    }
+
+    InputQueue* queue = new InputQueue();
+    queue->events.resize(size);
+    queue->mask        = size - 1;
+    queue->cached_tail = 0;
+    queue->cached_head = 0;
+    queue->head.store(0);
+    queue->tail.store(0);
+    return queue;
+}
+
+void input_queue_destroy(InputQueue* queue) { delete queue; }
+
+void input_queue_push(InputQueue* queue, const InputEvent* event)
+{
+    queue->pushed.fetch_add(1, std::memory_order_relaxed);
+
+    int32_t slot = staged_slot(event->type);
+    if (slot >= 0 && queue->has_staged[slot]) {
+        merge(&queue->staged[slot], event);
+        queue->coalesced.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (slot >= 0) {
+        queue->staged[slot]       = *event;
+        queue->staged[slot].count = std::max(event->count, 1u);
+        queue->has_staged[slot]   = true;
+        return;
+    }
+
+    // Keys and buttons are ordered against the motion that came before them.
+    input_queue_flush(queue);
+    InputEvent single = *event;
+    single.count      = std::max(event->count, 1u);
+    publish(queue, &single);
+}
+
+void input_queue_flush(InputQueue* queue)
+{
+    // Oldest first, so the consumer sees timestamps in order.
+    for (;;) {
+        int32_t oldest = -1;
+        for (int32_t slot = 0; slot < INPUT_STAGED_TYPES; slot++) {
+            if (!queue->has_staged[slot]) { continue; }
+            if (oldest < 0 || queue->staged[slot].timestamp_ns < queue->staged[oldest].timestamp_ns) { oldest = slot; }
+        }
+        if (oldest < 0) { return; }
+
+        queue->has_staged[oldest] = false;
+        publish(queue, &queue->staged[oldest]);
+    }
+}
+
+bool input_queue_pop(InputQueue* queue, InputEvent* event)
+{
+    uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    if (tail == queue->cached_head) {
+        queue->cached_head = queue->head.load(std::memory_order_acquire);
+        if (tail == queue->cached_head) { return false; }
+    }
+
+    *event = queue->events[tail & queue->mask];
+    queue->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+InputQueueStats input_queue_stats(const InputQueue* queue)
+{
+    InputQueueStats stats;
+    stats.pushed    = queue->pushed.load(std::memory_order_relaxed);
+    stats.published = queue->published.load(std::memory_order_relaxed);
+    stats.coalesced = queue->coalesced.load(std::memory_order_relaxed);
+    stats.dropped   = queue->dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t input_now_ns(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void input_latency_reset(InputLatency* latency) { *latency = InputLatency {}; }
+
+void input_latency_consume(InputLatency* latency, const InputEvent* event)
+{
+    if (!latency->frame_oldest_ns || event->timestamp_ns < latency->frame_oldest_ns) {
+        latency->frame_oldest_ns = event->timestamp_ns;
+    }
+}
+
+bool input_latency_present(InputLatency* latency, uint64_t present_ns)
+{
+    if (!latency->frame_oldest_ns) { return false; }
+
+    uint64_t elapsed = present_ns > latency->frame_oldest_ns ? present_ns - latency->frame_oldest_ns : 0;
+    latency->history_ms[latency->next] = (float)((double)elapsed / 1000000.0);
+    latency->next                      = (latency->next + 1) % INPUT_LATENCY_HISTORY;
+    latency->count                     = std::min(latency->count + 1, (uint32_t)INPUT_LATENCY_HISTORY);
+    latency->frames++;
+    latency->frame_oldest_ns = 0;
+    return true;
+}
+
+InputLatencyStats input_latency_stats(const InputLatency* latency)
+{
+    InputLatencyStats stats = {};
+    stats.frames            = latency->frames;
+    if (!latency->count) { return stats; }
+
+    std::vector<float> samples(latency->count);
+    for (uint32_t i = 0; i < latency->count; i++) {
+        samples[i] = latency->history_ms[(latency->next + INPUT_LATENCY_HISTORY - 1 - i) % INPUT_LATENCY_HISTORY];
+    }
+    stats.last_ms = samples[0];
+
+    float sum = 0.0f;
+    for (float sample : samples) {
+        sum += sample;
+    }
+    stats.mean_ms = sum / (float)samples.size();
+
+    std::sort(samples.begin(), samples.end());
+    stats.p95_ms = samples[(samples.size() * 95) / 100];
+    stats.max_ms = samples.back();
+    return stats;
+}
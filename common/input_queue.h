@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum InputEventType {
+    INPUT_KEY_DOWN,
+    INPUT_KEY_UP,
+    INPUT_MOUSE_MOVE,  // x, y: cursor position in window pixels
+    INPUT_MOUSE_RAW,   // x, y: relative device motion, unaffected by pointer ballistics
+    INPUT_MOUSE_DOWN,
+    INPUT_MOUSE_UP,
+    INPUT_MOUSE_WHEEL, // x, y: scroll amount in notches
+} InputEventType;
+
+typedef enum InputMouseButton {
+    INPUT_MOUSE_LEFT,
+    INPUT_MOUSE_RIGHT,
+    INPUT_MOUSE_MIDDLE,
+} InputMouseButton;
+
+typedef struct InputEvent {
+    uint64_t timestamp_ns; // input_now_ns() when the platform received it; the earliest one for coalesced events
+    InputEventType type;
+    uint32_t code;         // native key code (virtual key on Windows, key code on macOS) or InputMouseButton
+    float x;
+    float y;
+    uint32_t count;        // OS events merged into this one
+} InputEvent;
+
+// Single producer, single consumer ring of input events. The platform layer pushes from wherever it receives input and
+// the game thread pops at the start of a frame; neither side ever blocks or takes a lock.
+//
+// Mice can report at 1000Hz or more, far faster than frames are drawn, so between two key or button events all mouse
+// moves become one event, as do all raw motion and all wheel events: positions keep the latest value, raw motion and
+// wheel amounts are summed. Keys and buttons are never merged and stay ordered against the motion around them. Merged
+// events are held back by the producer until the next key or button or until input_queue_flush(), so call that after
+// each batch of OS events.
+//
+// When the ring is full new events are dropped and counted rather than overwriting ones the game has not seen.
+typedef struct InputQueue InputQueue;
+
+typedef struct InputQueueStats {
+    uint64_t pushed;    // events handed to input_queue_push
+    uint64_t published; // events that made it into the ring after coalescing
+    uint64_t coalesced; // events merged into an earlier one
+    uint64_t dropped;   // events lost to a full ring
+} InputQueueStats;
+
+// capacity is rounded up to a power of two.
+InputQueue* input_queue_create(uint32_t capacity);
+void input_queue_destroy(InputQueue* queue);
+
+// Producer side.
+void input_queue_push(InputQueue* queue, const InputEvent* event);
+void input_queue_flush(InputQueue* queue);
+
+// Consumer side.
+bool input_queue_pop(InputQueue* queue, InputEvent* event);
+
+// Safe to call from either side.
+InputQueueStats input_queue_stats(const InputQueue* queue);
+
+// Monotonic clock all input timestamps are taken from.
+uint64_t input_now_ns(void);
+
+#define INPUT_LATENCY_HISTORY 256
+
+// Measures how long input takes to reach the screen. The game thread reports the timestamp of every event it acts on
+// during a frame, then the time the frame was presented; the latency of that frame is measured from its oldest
+// input. Frames without input are not counted.
+typedef struct InputLatency {
+    uint64_t frame_oldest_ns; // 0 when no input was consumed this frame
+    uint64_t frames;
+    uint32_t next;
+    uint32_t count;
+    float history_ms[INPUT_LATENCY_HISTORY];
+} InputLatency;
+
+typedef struct InputLatencyStats {
+    uint64_t frames; // frames with input since the tracker was reset
+    float last_ms;
+    float mean_ms;   // the rest over the last INPUT_LATENCY_HISTORY frames with input
+    float p95_ms;
+    float max_ms;
+} InputLatencyStats;
+
+void input_latency_reset(InputLatency* latency);
+void input_latency_consume(InputLatency* latency, const InputEvent* event);
+
+// Returns true if the frame carried input and a latency sample was recorded.
+bool input_latency_present(InputLatency* latency, uint64_t present_ns);
+
+InputLatencyStats input_latency_stats(const InputLatency* latency);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,147 @@
+#include "job_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct Job {
+    JobFunc func;
+    void* data;
+} Job;
+
+struct JobPool {
+    std::vector<std::thread> threads;
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    uint32_t in_flight;
+    bool stopping;
+};
+
+// Shared between the caller of job_pool_parallel_for and the helper jobs it queued. Helpers that only get to run
+// after the range is finished still hold a reference, so this can outlive the call.
+typedef struct ParallelFor {
+    JobRangeFunc func;
+    void* data;
+    uint32_t count;
+    uint32_t batch_size;
+    std::atomic<uint32_t> next;
+    std::atomic<uint32_t> done;
+} ParallelFor;
+
+static void worker_main(JobPool* pool)
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->wake.wait(lock, [pool] { return pool->stopping || !pool->queue.empty(); });
+            if (pool->queue.empty()) { return; }
+            job = pool->queue.front();
+            pool->queue.pop_front();
+        }
+
+        job.func(job.data);
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (--pool->in_flight == 0) { pool->idle.notify_all(); }
+    }
+}
+
+JobPool* job_pool_create(uint32_t thread_count)
+{
+    if (thread_count == 0) {
+        uint32_t hardware = std::thread::hardware_concurrency();
+        thread_count      = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    JobPool* pool = new JobPool();
+    for (uint32_t i = 0; i < thread_count; i++) {
+        pool->threads.emplace_back(worker_main, pool);
+    }
+    return pool;
+}
+
+void job_pool_destroy(JobPool* pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->stopping = true;
+    }
+    pool->wake.notify_all();
+    for (std::thread& thread : pool->threads) {
+        thread.join();
+    }
+    delete pool;
+}
+
+uint32_t job_pool_thread_count(const JobPool* pool) { return (uint32_t)pool->threads.size(); }
+
+void job_pool_submit(JobPool* pool, JobFunc func, void* data)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->queue.push_back({ func, data });
+        pool->in_flight++;
+    }
+    pool->wake.notify_one();
+}
+
+void job_pool_wait(JobPool* pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->idle.wait(lock, [pool] { return pool->in_flight == 0; });
+}
+
+static void run_batches(ParallelFor* work)
+{
+    for (;;) {
+        uint32_t begin = work->next.fetch_add(work->batch_size, std::memory_order_relaxed);
+        if (begin >= work->count) { return; }
+        uint32_t end = begin + work->batch_size < work->count ? begin + work->batch_size : work->count;
+        work->func(work->data, begin, end);
+        work->done.fetch_add(end - begin, std::memory_order_release);
+    }
+}
+
+static void parallel_for_helper(void* data)
+{
+    std::shared_ptr<ParallelFor>* work = (std::shared_ptr<ParallelFor>*)data;
+    run_batches(work->get());
+    delete work;
+}
+
+void job_pool_parallel_for(JobPool* pool, uint32_t count, uint32_t batch_size, JobRangeFunc func, void* data)
+{
+    if (count == 0) { return; }
+    if (batch_size == 0) { batch_size = 1; }
+
+    uint32_t batches = (count + batch_size - 1) / batch_size;
+    if (!pool || batches == 1) {
+        func(data, 0, count);
+        return;
+    }
+
+    std::shared_ptr<ParallelFor> work = std::make_shared<ParallelFor>();
+    work->func                        = func;
+    work->data                        = data;
+    work->count                       = count;
+    work->batch_size                  = batch_size;
+    work->next                        = 0;
+    work->done                        = 0;
+
+    uint32_t helpers = batches - 1 < job_pool_thread_count(pool) ? batches - 1 : job_pool_thread_count(pool);
+    for (uint32_t i = 0; i < helpers; i++) {
+        job_pool_submit(pool, parallel_for_helper, new std::shared_ptr<ParallelFor>(work));
+    }
+
+    run_batches(work.get());
+    while (work->done.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+}
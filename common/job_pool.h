@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fixed set of worker threads fed from one FIFO queue. Fire-and-forget jobs go through job_pool_submit();
+// job_pool_parallel_for() splits a range into batches and has the calling thread work on them too until the whole
+// range is done.
+typedef struct JobPool JobPool;
+
+typedef void (*JobFunc)(void* data);
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+// thread_count 0 picks one thread per hardware thread minus the caller, with a minimum of one.
+JobPool* job_pool_create(uint32_t thread_count);
+void job_pool_destroy(JobPool* pool);
+
+uint32_t job_pool_thread_count(const JobPool* pool);
+
+void job_pool_submit(JobPool* pool, JobFunc func, void* data);
+
+// Blocks until every job submitted so far has finished.
+void job_pool_wait(JobPool* pool);
+
+void job_pool_parallel_for(JobPool* pool, uint32_t count, uint32_t batch_size, JobRangeFunc func, void* data);
+
+#ifdef __cplusplus
+}
+#endif
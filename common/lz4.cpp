@@ -0,0 +1,162 @@
+#include "lz4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 16
+
+// The format requires the last 5 bytes to be literals and the last match to start at least 12 bytes from the end.
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_LIMIT 12
+
+static uint32_t read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Copies in 16 byte blocks, up to 15 bytes past `size`; only for when both sides have that much room to spare.
+static void wild_copy(uint8_t* out, const uint8_t* in, size_t size)
+{
+    for (size_t i = 0; i < size; i += 16) {
+        memcpy(out + i, in + i, 16);
+    }
+}
+
+static uint32_t hash4(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS); }
+
+static uint8_t* write_length(uint8_t* out, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        *out++ = 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+// A match length of 0 writes the final, literals only, sequence.
+static uint8_t* write_sequence(
+    uint8_t* out, const uint8_t* literals, size_t literal_count, size_t offset, size_t match_length)
+{
+    size_t literal_nibble = literal_count < 15 ? literal_count : 15;
+    size_t match_extra    = match_length ? match_length - LZ4_MIN_MATCH : 0;
+    size_t match_nibble   = match_extra < 15 ? match_extra : 15;
+    *out++                = (uint8_t)((literal_nibble << 4) | match_nibble);
+    if (literal_count >= 15) { out = write_length(out, literal_count - 15); }
+    if (literal_count) { memcpy(out, literals, literal_count); }
+    out += literal_count;
+    if (!match_length) { return out; }
+
+    *out++ = (uint8_t)(offset & 0xff);
+    *out++ = (uint8_t)(offset >> 8);
+    if (match_extra >= 15) { out = write_length(out, match_extra - 15); }
+    return out;
+}
+
+static bool read_length(const uint8_t** in, const uint8_t* end, size_t* length)
+{
+    uint8_t byte;
+    do {
+        if (*in == end) { return false; }
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+size_t lz4_compress_bound(size_t size) { return size + size / 255 + 16; }
+
+size_t lz4_compress(const void* source, size_t size, void* destination, size_t capacity)
+{
+    if (capacity < lz4_compress_bound(size)) { return 0; }
+
+    const uint8_t* in = (const uint8_t*)source;
+    uint8_t* out      = (uint8_t*)destination;
+
+    // Most recent position + 1 of each hashed 4 byte sequence; 0 is empty.
+    std::vector<size_t> table((size_t)1 << LZ4_HASH_BITS, 0);
+
+    size_t anchor      = 0;
+    size_t pos         = 0;
+    size_t match_limit = size > LZ4_MATCH_LIMIT ? size - LZ4_MATCH_LIMIT : 0;
+    size_t match_end   = size > LZ4_LAST_LITERALS ? size - LZ4_LAST_LITERALS : 0;
+    while (pos < match_limit) {
+        uint32_t sequence = read32(in + pos);
+        size_t* slot      = &table[hash4(sequence)];
+        size_t candidate  = *slot;
+        *slot             = pos + 1;
+        if (!candidate || pos - (candidate - 1) > LZ4_MAX_OFFSET || read32(in + candidate - 1) != sequence) {
+            pos++;
+            continue;
+        }
+
+        // Grow the match backwards into the pending literals, then forwards as far as it goes.
+        size_t match = candidate - 1;
+        while (pos > anchor && match > 0 && in[pos - 1] == in[match - 1]) {
+            pos--;
+            match--;
+        }
+        size_t length = 0;
+        while (pos + length < match_end && in[pos + length] == in[match + length]) {
+            length++;
+        }
+
+        out    = write_sequence(out, in + anchor, pos - anchor, pos - match, length);
+        pos    = pos + length;
+        anchor = pos;
+    }
+
+    out = write_sequence(out, in + anchor, size - anchor, 0, 0);
+    return (size_t)(out - (uint8_t*)destination);
+}
+
+bool lz4_decompress(const void* source, size_t size, void* destination, size_t destination_size)
+{
+    const uint8_t* in     = (const uint8_t*)source;
+    const uint8_t* in_end = in + size;
+    uint8_t* out          = (uint8_t*)destination;
+    uint8_t* out_start    = out;
+    uint8_t* out_end      = out + destination_size;
+
+    while (in < in_end) {
+        uint8_t token   = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(&in, in_end, &literals)) { return false; }
+        if (literals > (size_t)(in_end - in) || literals > (size_t)(out_end - out)) { return false; }
+        if (literals + 16 <= (size_t)(in_end - in) && literals + 16 <= (size_t)(out_end - out)) {
+            wild_copy(out, in, literals);
+        } else if (literals) {
+            memcpy(out, in, literals);
+        }
+        in += literals;
+        out += literals;
+        if (in == in_end) { break; }
+
+        if (in_end - in < 2) { return false; }
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !read_length(&in, in_end, &length)) { return false; }
+        length += LZ4_MIN_MATCH;
+        if (!offset || offset > (size_t)(out - out_start) || length > (size_t)(out_end - out)) { return false; }
+
+        // Overlapping matches repeat the bytes just written, so those have to go one at a time.
+        const uint8_t* match = out - offset;
+        if (offset >= 16 && length + 16 <= (size_t)(out_end - out)) {
+            wild_copy(out, match, length);
+            out += length;
+        } else if (offset >= length) {
+            memcpy(out, match, length);
+            out += length;
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                *out++ = match[i];
+            }
+        }
+    }
+    return out == out_end;
+}
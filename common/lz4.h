@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The LZ4 block format: byte aligned literal runs and back references into the last 64 KiB, no entropy coding. It
+// compresses worse than deflate but decompresses at memory speed, which is what matters for data read at load time.
+// Output is compatible with the reference implementation's LZ4_decompress_safe().
+
+// Worst case compressed size, for data that does not compress at all.
+size_t lz4_compress_bound(size_t size);
+
+// Greedy single pass compression. `capacity` must be at least lz4_compress_bound(size). Returns the compressed size.
+size_t lz4_compress(const void* source, size_t size, void* destination, size_t capacity);
+
+// Decompresses a whole block. Fails on malformed input, and unless the output exactly fills `destination_size`, so
+// the caller needs to have stored the original size.
+bool lz4_decompress(const void* source, size_t size, void* destination, size_t destination_size);
+
+#ifdef __cplusplus
+}
+#endif
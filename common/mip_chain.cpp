@@ -0,0 +1,84 @@
+#include "mip_chain.h"
+
+#include <cstdlib>
+#include <cstring>
+
+uint32_t mip_count_for_size(uint32_t width, uint32_t height)
+{
+    uint32_t largest = width > height ? width : height;
+    uint32_t count   = 1;
+    while (largest > 1 && count < MIP_CHAIN_MAX_LEVELS) {
+        largest >>= 1;
+        count++;
+    }
+    return count;
+}
+
+size_t mip_level_size(uint32_t width, uint32_t height, uint32_t bytes_per_pixel, uint32_t level)
+{
+    uint32_t w = width >> level;
+    uint32_t h = height >> level;
+    if (w == 0) w = 1;
+    if (h == 0) h = 1;
+    return (size_t)w * h * bytes_per_pixel;
+}
+
+static void downsample(const MipLevel* src, MipLevel* dst, uint32_t channels)
+{
+    for (uint32_t y = 0; y < dst->height; y++) {
+        uint32_t y0 = y * 2 < src->height ? y * 2 : src->height - 1;
+        uint32_t y1 = y * 2 + 1 < src->height ? y * 2 + 1 : src->height - 1;
+
+        const uint8_t* row0 = src->pixels + (size_t)y0 * src->width * channels;
+        const uint8_t* row1 = src->pixels + (size_t)y1 * src->width * channels;
+        uint8_t* out        = dst->pixels + (size_t)y * dst->width * channels;
+
+        for (uint32_t x = 0; x < dst->width; x++) {
+            uint32_t x0 = x * 2 < src->width ? x * 2 : src->width - 1;
+            uint32_t x1 = x * 2 + 1 < src->width ? x * 2 + 1 : src->width - 1;
+
+            for (uint32_t c = 0; c < channels; c++) {
+                uint32_t sum = row0[x0 * channels + c] + row0[x1 * channels + c] + row1[x0 * channels + c]
+                    + row1[x1 * channels + c];
+                out[x * channels + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+bool mip_chain_build(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, MipChain* chain)
+{
+    memset(chain, 0, sizeof(*chain));
+    if (!pixels || width == 0 || height == 0 || channels == 0) { return false; }
+
+    chain->channels    = channels;
+    chain->level_count = mip_count_for_size(width, height);
+
+    for (uint32_t i = 0; i < chain->level_count; i++) {
+        MipLevel* level = &chain->levels[i];
+        level->width    = width >> i ? width >> i : 1;
+        level->height   = height >> i ? height >> i : 1;
+        level->size     = mip_level_size(width, height, channels, i);
+        level->pixels   = (uint8_t*)malloc(level->size);
+        if (!level->pixels) {
+            mip_chain_free(chain);
+            return false;
+        }
+
+        if (i == 0) {
+            memcpy(level->pixels, pixels, level->size);
+        } else {
+            downsample(&chain->levels[i - 1], level, channels);
+        }
+    }
+
+    return true;
+}
+
+void mip_chain_free(MipChain* chain)
+{
+    for (uint32_t i = 0; i < chain->level_count; i++) {
+        free(chain->levels[i].pixels);
+    }
+    memset(chain, 0, sizeof(*chain));
+}
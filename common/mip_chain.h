@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIP_CHAIN_MAX_LEVELS 16
+
+typedef struct MipLevel {
+    uint32_t width;
+    uint32_t height;
+    size_t size;
+    uint8_t* pixels;
+} MipLevel;
+
+// A full mip chain built on the CPU from a decoded image. Level 0 is a copy of the source, each following level is a
+// 2x2 box filter of the one above it, down to 1x1.
+typedef struct MipChain {
+    uint32_t channels;
+    uint32_t level_count;
+    MipLevel levels[MIP_CHAIN_MAX_LEVELS];
+} MipChain;
+
+uint32_t mip_count_for_size(uint32_t width, uint32_t height);
+size_t mip_level_size(uint32_t width, uint32_t height, uint32_t bytes_per_pixel, uint32_t level);
+
+bool mip_chain_build(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, MipChain* chain);
+void mip_chain_free(MipChain* chain);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,516 @@
+#include "particle_system.h"
+
+#include "simd.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#define PARTICLE_DEFAULT_BATCH 16384
+#define PARTICLE_CURVE_SAMPLES 256
+#define PARTICLE_PI 3.14159265f
+
+// Within 0.001 of sin(x) for x in [-pi, pi]: a parabola through the zeros and peaks, then squared towards the curve.
+static inline f32x4 sin_approx(f32x4 x)
+{
+    f32x4 y = f32x4_mul(x, f32x4_sub(f32x4_splat(4.0f / PARTICLE_PI),
+                               f32x4_mul(f32x4_abs(x), f32x4_splat(4.0f / (PARTICLE_PI * PARTICLE_PI)))));
+    return f32x4_add(y, f32x4_mul(f32x4_splat(0.225f), f32x4_sub(f32x4_mul(y, f32x4_abs(y)), y)));
+}
+
+// Brings any angle into [-pi, pi].
+static inline f32x4 wrap_angle(f32x4 x)
+{
+    f32x4 turns = f32x4_round(f32x4_mul(x, f32x4_splat(0.5f / PARTICLE_PI)));
+    return f32x4_sub(x, f32x4_mul(turns, f32x4_splat(2.0f * PARTICLE_PI)));
+}
+
+static inline void sin_cos(f32x4 angle, f32x4* s, f32x4* c)
+{
+    angle = wrap_angle(angle);
+    *s    = sin_approx(angle);
+    *c    = sin_approx(wrap_angle(f32x4_add(angle, f32x4_splat(PARTICLE_PI * 0.5f))));
+}
+
+// xorshift32 in every lane.
+static inline f32x4 random_unit(u32x4* state)
+{
+    u32x4 x = *state;
+    x       = u32x4_xor(x, u32x4_shl(x, 13));
+    x       = u32x4_xor(x, u32x4_shr(x, 17));
+    x       = u32x4_xor(x, u32x4_shl(x, 5));
+    *state  = x;
+    return u32x4_unit(x);
+}
+
+// Finalizer of MurmurHash3, to spread seeds that differ in a few bits over the whole word.
+static uint32_t mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Each particle's state, one array per stream. Age runs from 0 at emission to 1 at death, and aging is one over the
+// particle's lifetime, so that a particle's curves can be looked up from its age alone.
+enum ParticleStream {
+    STREAM_X,
+    STREAM_Y,
+    STREAM_VX,
+    STREAM_VY,
+    STREAM_AGE,
+    STREAM_AGING,
+    STREAM_COUNT,
+};
+
+struct ParticleEmitter {
+    ParticleEmitterDesc desc;
+    // Two sets of streams; each frame packs the survivors of one into the other. A stream is stride floats, which is
+    // max_particles rounded up to whole vectors plus one spare, so a partial vector at the end can be stored whole.
+    std::vector<float> buffers[2];
+    uint32_t stride;
+    uint32_t live_buffer;
+    uint32_t count;
+    float emit_debt; // fractions of a particle carried to the next frame
+    uint32_t burst;
+    uint32_t frame;
+    float damping;
+
+    // Filled by the update for the write.
+    uint32_t survivors;
+    uint32_t emit_count;
+    uint32_t first_instance;
+
+    uint32_t colors[PARTICLE_CURVE_SAMPLES];
+    float sizes[PARTICLE_CURVE_SAMPLES];
+};
+
+// A batch of one emitter's particles. An update task steps [begin, end) of the live buffer and counts its survivors,
+// which the write packs into the other buffer from `out`. An emit task fills [begin, end) of the other buffer.
+typedef struct ParticleTask {
+    ParticleEmitter* emitter;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t survivors;
+    uint32_t out;
+    bool emit;
+} ParticleTask;
+
+struct ParticleSystem {
+    JobPool* jobs;
+    uint32_t batch_size;
+    std::vector<ParticleEmitter*> emitters;
+    std::vector<ParticleTask> tasks;
+    uint32_t update_tasks; // the first tasks; the rest are emits
+    float dt;
+    ParticleInstance* instances;
+    ParticleSystemStats stats;
+};
+
+static float* stream(ParticleEmitter* emitter, uint32_t buffer, ParticleStream s)
+{
+    return emitter->buffers[buffer].data() + (size_t)s * emitter->stride;
+}
+
+static uint32_t lerp_color(uint32_t a, uint32_t b, float t)
+{
+    uint32_t color = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        float from = (float)((a >> shift) & 0xFF);
+        float to   = (float)((b >> shift) & 0xFF);
+        color |= (uint32_t)(from + (to - from) * t + 0.5f) << shift;
+    }
+    return color;
+}
+
+// Samples the keys into a table the kernels index by age.
+static void sample_curves(ParticleEmitter* emitter)
+{
+    const ParticleEmitterDesc* desc = &emitter->desc;
+    for (uint32_t i = 0; i < PARTICLE_CURVE_SAMPLES; i++) {
+        float t = (float)i / (PARTICLE_CURVE_SAMPLES - 1);
+
+        uint32_t color = 0xFFFFFFFFu;
+        if (desc->color_count) {
+            uint32_t k = 0;
+            while (k + 1 < desc->color_count && desc->colors[k + 1].t <= t) {
+                k++;
+            }
+            color = desc->colors[k].color;
+            if (k + 1 < desc->color_count && t > desc->colors[k].t) {
+                float span = desc->colors[k + 1].t - desc->colors[k].t;
+                color      = lerp_color(color, desc->colors[k + 1].color, (t - desc->colors[k].t) / span);
+            }
+        }
+        emitter->colors[i] = color;
+
+        float size = 4.0f;
+        if (desc->size_count) {
+            uint32_t k = 0;
+            while (k + 1 < desc->size_count && desc->sizes[k + 1].t <= t) {
+                k++;
+            }
+            size = desc->sizes[k].size;
+            if (k + 1 < desc->size_count && t > desc->sizes[k].t) {
+                float span = desc->sizes[k + 1].t - desc->sizes[k].t;
+                size += (desc->sizes[k + 1].size - size) * (t - desc->sizes[k].t) / span;
+            }
+        }
+        emitter->sizes[i] = size;
+    }
+}
+
+ParticleSystem* particle_system_create(const ParticleSystemDesc* desc)
+{
+    ParticleSystem* system = new ParticleSystem();
+    system->jobs           = desc->jobs;
+    // Whole vectors, so that tasks never store into each other's particles.
+    system->batch_size = desc->batch_size ? (desc->batch_size + 3) & ~3u : PARTICLE_DEFAULT_BATCH;
+    return system;
+}
+
+void particle_system_destroy(ParticleSystem* system)
+{
+    if (!system) { return; }
+    for (ParticleEmitter* emitter : system->emitters) {
+        delete emitter;
+    }
+    delete system;
+}
+
+ParticleEmitter* particle_emitter_create(ParticleSystem* system, const ParticleEmitterDesc* desc)
+{
+    if (!desc->max_particles) { return NULL; }
+
+    ParticleEmitter* emitter = new ParticleEmitter();
+    emitter->desc            = *desc;
+    emitter->stride          = ((desc->max_particles + 3) & ~3u) + 4;
+    emitter->buffers[0].resize((size_t)emitter->stride * STREAM_COUNT);
+    emitter->buffers[1].resize((size_t)emitter->stride * STREAM_COUNT);
+
+    ParticleEmitterDesc* d = &emitter->desc;
+    if (d->color_count > PARTICLE_MAX_KEYS) { d->color_count = PARTICLE_MAX_KEYS; }
+    if (d->size_count > PARTICLE_MAX_KEYS) { d->size_count = PARTICLE_MAX_KEYS; }
+    if (d->life_min < 0.001f) { d->life_min = 0.001f; }
+    if (d->life_max < d->life_min) { d->life_max = d->life_min; }
+    if (d->speed_max < d->speed_min) { d->speed_max = d->speed_min; }
+    sample_curves(emitter);
+
+    system->emitters.push_back(emitter);
+    return emitter;
+}
+
+void particle_emitter_destroy(ParticleSystem* system, ParticleEmitter* emitter)
+{
+    for (size_t i = 0; i < system->emitters.size(); i++) {
+        if (system->emitters[i] == emitter) {
+            system->emitters.erase(system->emitters.begin() + i);
+            delete emitter;
+            return;
+        }
+    }
+}
+
+void particle_emitter_move(ParticleEmitter* emitter, float x, float y)
+{
+    emitter->desc.x = x;
+    emitter->desc.y = y;
+}
+
+void particle_emitter_set_rate(ParticleEmitter* emitter, float rate) { emitter->desc.rate = rate; }
+
+void particle_emitter_burst(ParticleEmitter* emitter, uint32_t count) { emitter->burst += count; }
+
+// Bits set for the lanes of the vector at i that are before end.
+static inline uint32_t lanes_before(uint32_t i, uint32_t end) { return end - i >= 4 ? 0xF : (1u << (end - i)) - 1; }
+
+// Ages the batch and counts the particles that outlive the frame; everything else is left to the write, so the update
+// only touches two of the streams.
+static void update_task(ParticleTask* task, float dt)
+{
+    ParticleEmitter* emitter = task->emitter;
+    float* age               = stream(emitter, emitter->live_buffer, STREAM_AGE);
+    const float* aging       = stream(emitter, emitter->live_buffer, STREAM_AGING);
+
+    f32x4 step       = f32x4_splat(dt);
+    f32x4 one        = f32x4_splat(1.0f);
+    uint32_t counted = 0;
+    for (uint32_t i = task->begin; i < task->end; i += 4) {
+        f32x4 older = f32x4_add(f32x4_load(age + i), f32x4_mul(f32x4_load(aging + i), step));
+        f32x4_store(age + i, older);
+        uint32_t alive = f32x4_less(older, one) & lanes_before(i, task->end);
+        counted += (alive & 1) + ((alive >> 1) & 1) + ((alive >> 2) & 1) + (alive >> 3);
+    }
+    task->survivors = counted;
+}
+
+// Writes the instances of the particles in lanes `lanes` of the four vectors, in lane order.
+static inline void write_instances(ParticleInstance* out, const ParticleEmitter* emitter, f32x4 x, f32x4 y, f32x4 age,
+    uint32_t lanes)
+{
+    int32_t index[4];
+    f32x4 scaled = f32x4_mul(f32x4_min(f32x4_max(age, f32x4_splat(0.0f)), f32x4_splat(1.0f)),
+        f32x4_splat((float)(PARTICLE_CURVE_SAMPLES - 1)));
+    f32x4_store_index(index, scaled);
+
+    float sizes[4];
+    uint32_t colors[4];
+    for (int i = 0; i < 4; i++) {
+        sizes[i]  = emitter->sizes[index[i]];
+        colors[i] = emitter->colors[index[i]];
+    }
+    float color_bits[4];
+    memcpy(color_bits, colors, sizeof(color_bits));
+
+    f32x4 rows[4] = { x, y, f32x4_load(sizes), f32x4_load(color_bits) };
+    f32x4_transpose(rows);
+    for (int i = 0; i < 4; i++) {
+        if (lanes & (1u << i)) { f32x4_store((float*)out++, rows[i]); }
+    }
+}
+
+// Moves the survivors of the task's batch under the emitter's forces and packs them into the other buffer, and into
+// the instances if there are any.
+static void advance_task(ParticleSystem* system, const ParticleTask* task)
+{
+    ParticleEmitter* emitter        = task->emitter;
+    const ParticleEmitterDesc* desc = &emitter->desc;
+    float* from[STREAM_COUNT];
+    float* to[STREAM_COUNT];
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        from[s] = stream(emitter, emitter->live_buffer, (ParticleStream)s);
+        to[s]   = stream(emitter, emitter->live_buffer ^ 1, (ParticleStream)s);
+    }
+    ParticleInstance* instances = system->instances ? system->instances + emitter->first_instance : NULL;
+
+    f32x4 step      = f32x4_splat(system->dt);
+    f32x4 damping   = f32x4_splat(emitter->damping);
+    f32x4 gravity_x = f32x4_splat(desc->gravity_x * system->dt);
+    f32x4 gravity_y = f32x4_splat(desc->gravity_y * system->dt);
+    f32x4 attract_x = f32x4_splat(desc->attractor_x);
+    f32x4 attract_y = f32x4_splat(desc->attractor_y);
+    f32x4 pull      = f32x4_splat(desc->attractor_strength * system->dt);
+    f32x4 one       = f32x4_splat(1.0f);
+    bool attracted  = desc->attractor_strength != 0.0f;
+
+    uint32_t out = task->out;
+    for (uint32_t i = task->begin; i < task->end; i += 4) {
+        f32x4 age      = f32x4_load(from[STREAM_AGE] + i);
+        uint32_t alive = f32x4_less(age, one) & lanes_before(i, task->end);
+        if (!alive) { continue; }
+
+        f32x4 v[STREAM_COUNT];
+        v[STREAM_X]     = f32x4_load(from[STREAM_X] + i);
+        v[STREAM_Y]     = f32x4_load(from[STREAM_Y] + i);
+        v[STREAM_VX]    = f32x4_add(f32x4_load(from[STREAM_VX] + i), gravity_x);
+        v[STREAM_VY]    = f32x4_add(f32x4_load(from[STREAM_VY] + i), gravity_y);
+        v[STREAM_AGE]   = age;
+        v[STREAM_AGING] = f32x4_load(from[STREAM_AGING] + i);
+        if (attracted) {
+            // Towards the attractor, softened by a pixel so that particles on top of it do not blow up.
+            f32x4 to_x     = f32x4_sub(attract_x, v[STREAM_X]);
+            f32x4 to_y     = f32x4_sub(attract_y, v[STREAM_Y]);
+            f32x4 distance = f32x4_add(f32x4_add(f32x4_mul(to_x, to_x), f32x4_mul(to_y, to_y)), one);
+            f32x4 scale    = f32x4_mul(f32x4_rsqrt(distance), pull);
+            v[STREAM_VX]   = f32x4_add(v[STREAM_VX], f32x4_mul(to_x, scale));
+            v[STREAM_VY]   = f32x4_add(v[STREAM_VY], f32x4_mul(to_y, scale));
+        }
+        v[STREAM_VX] = f32x4_mul(v[STREAM_VX], damping);
+        v[STREAM_VY] = f32x4_mul(v[STREAM_VY], damping);
+        v[STREAM_X]  = f32x4_add(v[STREAM_X], f32x4_mul(v[STREAM_VX], step));
+        v[STREAM_Y]  = f32x4_add(v[STREAM_Y], f32x4_mul(v[STREAM_VY], step));
+
+        if (instances) { write_instances(instances + out, emitter, v[STREAM_X], v[STREAM_Y], age, alive); }
+        if (alive == 0xF) {
+            // Nearly every vector in a frame; particles only die a few at a time.
+            for (int s = 0; s < STREAM_COUNT; s++) {
+                f32x4_store(to[s] + out, v[s]);
+            }
+            out += 4;
+            continue;
+        }
+        float lanes[STREAM_COUNT][4];
+        for (int s = 0; s < STREAM_COUNT; s++) {
+            f32x4_store(lanes[s], v[s]);
+        }
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            if (!(alive & (1u << lane))) { continue; }
+            for (int s = 0; s < STREAM_COUNT; s++) {
+                to[s][out] = lanes[s][lane];
+            }
+            out++;
+        }
+    }
+}
+
+static void emit_task(ParticleSystem* system, const ParticleTask* task)
+{
+    ParticleEmitter* emitter        = task->emitter;
+    const ParticleEmitterDesc* desc = &emitter->desc;
+    uint32_t buffer                 = emitter->live_buffer ^ 1;
+    float* px                       = stream(emitter, buffer, STREAM_X);
+    float* py                       = stream(emitter, buffer, STREAM_Y);
+    float* vx                       = stream(emitter, buffer, STREAM_VX);
+    float* vy                       = stream(emitter, buffer, STREAM_VY);
+    float* age                      = stream(emitter, buffer, STREAM_AGE);
+    float* aging                    = stream(emitter, buffer, STREAM_AGING);
+    ParticleInstance* instances     = system->instances ? system->instances + emitter->first_instance : NULL;
+
+    // Seeded from the emitter, the frame and the batch, so a run is the same however the batches land on threads.
+    uint32_t seeds[4];
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        uint32_t seed = mix32(desc->seed ^ mix32(emitter->frame * 4 + lane) ^ mix32(task->begin + 0x9E3779B9u));
+        seeds[lane]   = seed ? seed : 1;
+    }
+    u32x4 rng = u32x4_load(seeds);
+
+    f32x4 origin_x   = f32x4_splat(desc->x);
+    f32x4 origin_y   = f32x4_splat(desc->y);
+    f32x4 radius     = f32x4_splat(desc->radius);
+    f32x4 turn       = f32x4_splat(2.0f * PARTICLE_PI);
+    f32x4 half_turn  = f32x4_splat(PARTICLE_PI);
+    f32x4 direction  = f32x4_splat(desc->direction - desc->spread);
+    f32x4 spread     = f32x4_splat(2.0f * desc->spread);
+    f32x4 speed_min  = f32x4_splat(desc->speed_min);
+    f32x4 speed_span = f32x4_splat(desc->speed_max - desc->speed_min);
+    f32x4 life_min   = f32x4_splat(desc->life_min);
+    f32x4 life_span  = f32x4_splat(desc->life_max - desc->life_min);
+    f32x4 one        = f32x4_splat(1.0f);
+    f32x4 zero       = f32x4_splat(0.0f);
+
+    for (uint32_t i = task->begin; i < task->end; i += 4) {
+        // Uniform over the disc: the square root keeps the centre from getting more than its share.
+        f32x4 s, c;
+        sin_cos(f32x4_sub(f32x4_mul(random_unit(&rng), turn), half_turn), &s, &c);
+        f32x4 r = f32x4_mul(f32x4_sqrt(random_unit(&rng)), radius);
+        f32x4 x = f32x4_add(origin_x, f32x4_mul(r, c));
+        f32x4 y = f32x4_add(origin_y, f32x4_mul(r, s));
+
+        sin_cos(f32x4_add(direction, f32x4_mul(random_unit(&rng), spread)), &s, &c);
+        f32x4 speed = f32x4_add(speed_min, f32x4_mul(random_unit(&rng), speed_span));
+        f32x4 life  = f32x4_add(life_min, f32x4_mul(random_unit(&rng), life_span));
+
+        f32x4_store(px + i, x);
+        f32x4_store(py + i, y);
+        f32x4_store(vx + i, f32x4_mul(c, speed));
+        f32x4_store(vy + i, f32x4_mul(s, speed));
+        f32x4_store(age + i, zero);
+        f32x4_store(aging + i, f32x4_div(one, life));
+        if (instances) { write_instances(instances + i, emitter, x, y, zero, lanes_before(i, task->end)); }
+    }
+}
+
+static void update_range(void* data, uint32_t begin, uint32_t end)
+{
+    ParticleSystem* system = (ParticleSystem*)data;
+    for (uint32_t i = begin; i < end; i++) {
+        update_task(&system->tasks[i], system->dt);
+    }
+}
+
+static void write_range(void* data, uint32_t begin, uint32_t end)
+{
+    ParticleSystem* system = (ParticleSystem*)data;
+    for (uint32_t i = begin; i < end; i++) {
+        const ParticleTask* task = &system->tasks[i];
+        if (task->emit) {
+            emit_task(system, task);
+        } else {
+            advance_task(system, task);
+        }
+    }
+}
+
+// End of the batch starting at begin, of particles up to end.
+static uint32_t batch_end(const ParticleSystem* system, uint32_t begin, uint32_t end)
+{
+    return end - begin < system->batch_size ? end : begin + system->batch_size;
+}
+
+uint32_t particle_system_update(ParticleSystem* system, float dt)
+{
+    system->dt = dt;
+    system->tasks.clear();
+    for (ParticleEmitter* emitter : system->emitters) {
+        float drag       = emitter->desc.drag;
+        emitter->damping = drag <= 0.0f ? 1.0f : drag >= 1.0f ? 0.0f : powf(1.0f - drag, dt);
+        for (uint32_t begin = 0; begin < emitter->count; begin += system->batch_size) {
+            ParticleTask task = { emitter, begin, batch_end(system, begin, emitter->count), 0, 0, false };
+            system->tasks.push_back(task);
+        }
+    }
+    system->update_tasks = (uint32_t)system->tasks.size();
+    job_pool_parallel_for(system->jobs, system->update_tasks, 1, update_range, system);
+
+    // Where each batch's survivors go, then the new particles after them.
+    uint32_t total = 0;
+    size_t task    = 0;
+    for (ParticleEmitter* emitter : system->emitters) {
+        uint32_t survivors = 0;
+        for (; task < system->update_tasks && system->tasks[task].emitter == emitter; task++) {
+            system->tasks[task].out = survivors;
+            survivors += system->tasks[task].survivors;
+        }
+        system->stats.expired += emitter->count - survivors;
+
+        emitter->emit_debt += emitter->desc.rate * dt;
+        uint32_t wanted = (uint32_t)emitter->emit_debt;
+        emitter->emit_debt -= (float)wanted;
+        wanted += emitter->burst;
+        emitter->burst = 0;
+
+        uint32_t room       = emitter->desc.max_particles - survivors;
+        emitter->survivors  = survivors;
+        emitter->emit_count = wanted < room ? wanted : room;
+        system->stats.dropped += wanted - emitter->emit_count;
+        system->stats.emitted += emitter->emit_count;
+
+        emitter->first_instance = total;
+        total += survivors + emitter->emit_count;
+        emitter->frame++;
+    }
+
+    for (ParticleEmitter* emitter : system->emitters) {
+        uint32_t end = emitter->survivors + emitter->emit_count;
+        for (uint32_t begin = emitter->survivors; begin < end; begin += system->batch_size) {
+            ParticleTask emit = { emitter, begin, batch_end(system, begin, end), 0, 0, true };
+            system->tasks.push_back(emit);
+        }
+    }
+    return total;
+}
+
+uint32_t particle_system_write(
+    ParticleSystem* system, ParticleInstance* instances, ParticleDraw* draws, uint32_t max_draws)
+{
+    system->instances = instances;
+    job_pool_parallel_for(system->jobs, (uint32_t)system->tasks.size(), 1, write_range, system);
+    system->tasks.clear();
+    system->instances = NULL;
+
+    uint32_t draw_count = 0;
+    system->stats.live  = 0;
+    for (ParticleEmitter* emitter : system->emitters) {
+        emitter->live_buffer ^= 1;
+        emitter->count = emitter->survivors + emitter->emit_count;
+        system->stats.live += emitter->count;
+        if (emitter->count && draw_count < max_draws) {
+            ParticleDraw* draw = &draws[draw_count++];
+            draw->emitter      = emitter;
+            draw->first        = emitter->first_instance;
+            draw->count        = emitter->count;
+            draw->blend        = emitter->desc.blend;
+        }
+    }
+    return draw_count;
+}
+
+ParticleSystemStats particle_system_stats(const ParticleSystem* system)
+{
+    ParticleSystemStats stats = system->stats;
+    stats.emitters            = (uint32_t)system->emitters.size();
+    return stats;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "job_pool.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 2D particles for large dynamic effects. Each emitter keeps its particles as separate arrays of x, y, velocity and
+// age, and every stage of a frame (forces and integration, dropping the dead, emitting new particles, color and size
+// over their lifetime) runs on four particles at a time in SIMD, in batches spread over a JobPool.
+//
+// A frame is two calls. particle_system_update() ages every particle and works out how many instances the frame will
+// have. particle_system_write() then moves the survivors, packs them together with the newly emitted particles and
+// writes each one as a ParticleInstance, in order and without reading back, so the instances can go straight into a
+// mapped vertex buffer. Each emitter's instances are contiguous, one instanced draw per emitter.
+typedef struct ParticleSystem ParticleSystem;
+typedef struct ParticleEmitter ParticleEmitter;
+
+#define PARTICLE_MAX_KEYS 8
+
+typedef enum ParticleBlend {
+    PARTICLE_BLEND_ALPHA,
+    PARTICLE_BLEND_ADDITIVE,
+} ParticleBlend;
+
+// Color and size over a particle's life, from 0 when emitted to 1 when it dies. Keys are in increasing t order, and
+// the values between them are interpolated. Color is RGBA, red in the lowest byte.
+typedef struct ParticleColorKey {
+    float t;
+    uint32_t color;
+} ParticleColorKey;
+
+typedef struct ParticleSizeKey {
+    float t;
+    float size;
+} ParticleSizeKey;
+
+typedef struct ParticleSystemDesc {
+    JobPool* jobs;       // NULL runs everything on the calling thread
+    uint32_t batch_size; // 0 = 16384; particles per job
+} ParticleSystemDesc;
+
+// Positions are in pixels, like the text renderer's; angles are in radians, with positive y pointing down the screen.
+typedef struct ParticleEmitterDesc {
+    uint32_t max_particles; // particles past it are not emitted
+    float rate;             // particles per second
+    float x, y;
+    float radius;           // emitted anywhere in a disc this big around x, y
+    float direction;        // launched at direction +- spread
+    float spread;
+    float speed_min, speed_max;
+    float life_min, life_max; // seconds
+    float gravity_x, gravity_y;
+    float drag; // share of the velocity lost per second
+    // Pulls every particle towards a point with a constant acceleration; 0 turns it off.
+    float attractor_x, attractor_y;
+    float attractor_strength;
+    ParticleColorKey colors[PARTICLE_MAX_KEYS];
+    uint32_t color_count; // 0 = opaque white throughout
+    ParticleSizeKey sizes[PARTICLE_MAX_KEYS];
+    uint32_t size_count; // 0 = 4 pixels throughout
+    ParticleBlend blend;
+    uint32_t seed;
+} ParticleEmitterDesc;
+
+// One per live particle, 16 bytes, for a vertex buffer with an attribute divisor of one.
+typedef struct ParticleInstance {
+    float x, y;
+    float size;
+    uint32_t color;
+} ParticleInstance;
+
+// The instances of one emitter, from particle_system_write().
+typedef struct ParticleDraw {
+    const ParticleEmitter* emitter;
+    uint32_t first;
+    uint32_t count;
+    ParticleBlend blend;
+} ParticleDraw;
+
+typedef struct ParticleSystemStats {
+    uint32_t emitters;
+    uint32_t live;
+    uint64_t emitted;
+    uint64_t expired;
+    uint64_t dropped; // not emitted because their emitter was full
+} ParticleSystemStats;
+
+ParticleSystem* particle_system_create(const ParticleSystemDesc* desc);
+void particle_system_destroy(ParticleSystem* system);
+
+// Returns NULL if max_particles is 0. Emitters must not be created or destroyed between an update and its write.
+ParticleEmitter* particle_emitter_create(ParticleSystem* system, const ParticleEmitterDesc* desc);
+void particle_emitter_destroy(ParticleSystem* system, ParticleEmitter* emitter);
+
+// Particles already emitted keep moving where they were going.
+void particle_emitter_move(ParticleEmitter* emitter, float x, float y);
+void particle_emitter_set_rate(ParticleEmitter* emitter, float rate);
+
+// Emits count particles on top of the rate at the next update.
+void particle_emitter_burst(ParticleEmitter* emitter, uint32_t count);
+
+// Ages every particle dt seconds and counts those that outlive it, and how many each emitter emits. Returns how many
+// instances the following particle_system_write() writes, at most the sum of every emitter's max_particles.
+uint32_t particle_system_update(ParticleSystem* system, float dt);
+
+// Must follow every update. Moves the live particles dt on under their emitter's forces, packs them, emits new ones
+// and writes every instance to `instances`, which must hold as many as the update returned, or may be NULL to only
+// simulate. Fills up to max_draws draws, one for each emitter with live particles, and returns how many it filled.
+uint32_t particle_system_write(
+    ParticleSystem* system, ParticleInstance* instances, ParticleDraw* draws, uint32_t max_draws);
+
+ParticleSystemStats particle_system_stats(const ParticleSystem* system);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,326 @@
+#include "resource_manager.h"
+
+#include "hash.h"
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#define RESOURCE_DEFAULT_FRAMES_IN_FLIGHT 2u
+
+#define RESOURCE_INDEX_BITS 20
+#define RESOURCE_INDEX_MASK ((1u << RESOURCE_INDEX_BITS) - 1)
+#define RESOURCE_GENERATION_MASK 0xFFFu
+
+typedef struct ResourceRecord {
+    uint32_t object;
+    uint32_t refs;
+    uint64_t bytes;
+    uint64_t key;
+    void* data;
+} ResourceRecord;
+
+// Handles index the sparse arrays, which say where in the dense array the record is. Index 0 of both is a null
+// record with object 0, which stale and out of range handles resolve to, so a lookup needs no branches.
+typedef struct ResourcePool {
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> dense;
+    std::vector<uint32_t> free_indices;
+    std::vector<ResourceRecord> records;
+    std::vector<uint32_t> sparse; // handle index of each record
+    std::unordered_map<uint64_t, uint32_t> keys;
+    ResourceTypeStats stats;
+} ResourcePool;
+
+typedef struct RetiredResource {
+    ResourceDestroy destroy;
+    uint64_t bytes;
+    uint64_t frame;
+} RetiredResource;
+
+struct ResourceManager {
+    uint32_t frames_in_flight;
+    uint64_t frame;
+    ResourcePool pools[RESOURCE_TYPE_COUNT];
+    std::deque<RetiredResource> retired;
+};
+
+static uint32_t dense_index(const ResourcePool* pool, uint32_t handle)
+{
+    uint32_t index      = handle & RESOURCE_INDEX_MASK;
+    uint32_t generation = handle >> RESOURCE_INDEX_BITS;
+    index               = index < pool->generations.size() ? index : 0;
+    return pool->generations[index] == generation ? pool->dense[index] : 0;
+}
+
+static void retire(ResourceManager* resources, ResourceType type, const ResourceRecord* record)
+{
+    ResourcePool* pool = &resources->pools[type];
+    pool->stats.retired++;
+    pool->stats.retired_bytes += record->bytes;
+    resources->retired.push_back({ { type, record->object, record->data }, record->bytes, resources->frame });
+}
+
+ResourceManager* resource_manager_create(const ResourceManagerDesc* desc)
+{
+    ResourceManager* resources  = new ResourceManager();
+    resources->frames_in_flight = desc->frames_in_flight ? desc->frames_in_flight : RESOURCE_DEFAULT_FRAMES_IN_FLIGHT;
+    resources->frame            = 0;
+    for (ResourcePool& pool : resources->pools) {
+        pool.generations.push_back(0);
+        pool.dense.push_back(0);
+        pool.records.push_back({});
+        pool.sparse.push_back(0);
+        pool.stats = {};
+    }
+    return resources;
+}
+
+void resource_manager_destroy(ResourceManager* resources) { delete resources; }
+
+uint32_t resource_add(
+    ResourceManager* resources, ResourceType type, uint32_t object, uint64_t bytes, uint64_t key, void* data)
+{
+    ResourcePool* pool = &resources->pools[type];
+
+    uint32_t index;
+    if (!pool->free_indices.empty()) {
+        index = pool->free_indices.back();
+        pool->free_indices.pop_back();
+    } else {
+        if (pool->generations.size() > RESOURCE_INDEX_MASK) { return 0; }
+        index = (uint32_t)pool->generations.size();
+        pool->generations.push_back(1);
+        pool->dense.push_back(0);
+    }
+
+    pool->dense[index] = (uint32_t)pool->records.size();
+    pool->records.push_back({ object, 1, bytes, key, data });
+    pool->sparse.push_back(index);
+
+    uint32_t handle = (pool->generations[index] << RESOURCE_INDEX_BITS) | index;
+    if (key) { pool->keys[key] = handle; }
+    pool->stats.live++;
+    pool->stats.bytes += bytes;
+    pool->stats.created++;
+    return handle;
+}
+
+uint32_t resource_find(ResourceManager* resources, ResourceType type, uint64_t key)
+{
+    ResourcePool* pool = &resources->pools[type];
+    auto found         = pool->keys.find(key);
+    if (!key || found == pool->keys.end()) { return 0; }
+
+    pool->records[dense_index(pool, found->second)].refs++;
+    pool->stats.dedup_hits++;
+    return found->second;
+}
+
+void resource_acquire(ResourceManager* resources, ResourceType type, uint32_t handle)
+{
+    ResourcePool* pool = &resources->pools[type];
+    uint32_t dense     = dense_index(pool, handle);
+    if (dense) { pool->records[dense].refs++; }
+}
+
+void resource_release(ResourceManager* resources, ResourceType type, uint32_t handle)
+{
+    ResourcePool* pool = &resources->pools[type];
+    uint32_t dense     = dense_index(pool, handle);
+    if (!dense || --pool->records[dense].refs > 0) { return; }
+
+    ResourceRecord record = pool->records[dense];
+    retire(resources, type, &record);
+    auto key = pool->keys.find(record.key);
+    if (key != pool->keys.end() && key->second == handle) { pool->keys.erase(key); }
+    pool->stats.live--;
+    pool->stats.bytes -= record.bytes;
+
+    // Move the last record into the hole so the live ones stay packed.
+    uint32_t index = handle & RESOURCE_INDEX_MASK;
+    uint32_t last  = (uint32_t)pool->records.size() - 1;
+    uint32_t moved = pool->sparse[last];
+
+    pool->records[dense] = pool->records[last];
+    pool->sparse[dense]  = moved;
+    pool->dense[moved]   = dense;
+    pool->records.pop_back();
+    pool->sparse.pop_back();
+
+    uint32_t generation      = (pool->generations[index] + 1) & RESOURCE_GENERATION_MASK;
+    pool->generations[index] = generation ? generation : 1;
+    pool->dense[index]       = 0;
+    pool->free_indices.push_back(index);
+}
+
+bool resource_replace(
+    ResourceManager* resources, ResourceType type, uint32_t handle, uint32_t object, uint64_t bytes, void* data)
+{
+    ResourcePool* pool = &resources->pools[type];
+    uint32_t dense     = dense_index(pool, handle);
+    if (!dense) { return false; }
+
+    ResourceRecord* record = &pool->records[dense];
+    retire(resources, type, record);
+    pool->stats.bytes += bytes - record->bytes;
+    record->object = object;
+    record->bytes  = bytes;
+    record->data   = data;
+    return true;
+}
+
+uint32_t resource_object(const ResourceManager* resources, ResourceType type, uint32_t handle)
+{
+    const ResourcePool* pool = &resources->pools[type];
+    return pool->records[dense_index(pool, handle)].object;
+}
+
+void* resource_data(const ResourceManager* resources, ResourceType type, uint32_t handle)
+{
+    const ResourcePool* pool = &resources->pools[type];
+    return pool->records[dense_index(pool, handle)].data;
+}
+
+uint32_t resource_texture(const ResourceManager* resources, TextureHandle handle)
+{
+    return resource_object(resources, RESOURCE_TEXTURE, handle.id);
+}
+
+uint32_t resource_buffer(const ResourceManager* resources, BufferHandle handle)
+{
+    return resource_object(resources, RESOURCE_BUFFER, handle.id);
+}
+
+uint32_t resource_vertex_array(const ResourceManager* resources, VertexArrayHandle handle)
+{
+    return resource_object(resources, RESOURCE_VERTEX_ARRAY, handle.id);
+}
+
+uint32_t resource_program(const ResourceManager* resources, ProgramHandle handle)
+{
+    return resource_object(resources, RESOURCE_PROGRAM, handle.id);
+}
+
+TextureHandle resource_add_texture(
+    ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data)
+{
+    TextureHandle handle = { resource_add(resources, RESOURCE_TEXTURE, object, bytes, key, data) };
+    return handle;
+}
+
+BufferHandle resource_add_buffer(ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data)
+{
+    BufferHandle handle = { resource_add(resources, RESOURCE_BUFFER, object, bytes, key, data) };
+    return handle;
+}
+
+VertexArrayHandle resource_add_vertex_array(
+    ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data)
+{
+    VertexArrayHandle handle = { resource_add(resources, RESOURCE_VERTEX_ARRAY, object, bytes, key, data) };
+    return handle;
+}
+
+ProgramHandle resource_add_program(
+    ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data)
+{
+    ProgramHandle handle = { resource_add(resources, RESOURCE_PROGRAM, object, bytes, key, data) };
+    return handle;
+}
+
+void resource_release_texture(ResourceManager* resources, TextureHandle handle)
+{
+    resource_release(resources, RESOURCE_TEXTURE, handle.id);
+}
+
+void resource_release_buffer(ResourceManager* resources, BufferHandle handle)
+{
+    resource_release(resources, RESOURCE_BUFFER, handle.id);
+}
+
+void resource_release_vertex_array(ResourceManager* resources, VertexArrayHandle handle)
+{
+    resource_release(resources, RESOURCE_VERTEX_ARRAY, handle.id);
+}
+
+void resource_release_program(ResourceManager* resources, ProgramHandle handle)
+{
+    resource_release(resources, RESOURCE_PROGRAM, handle.id);
+}
+
+bool resource_replace_texture(
+    ResourceManager* resources, TextureHandle handle, uint32_t object, uint64_t bytes, void* data)
+{
+    return resource_replace(resources, RESOURCE_TEXTURE, handle.id, object, bytes, data);
+}
+
+bool resource_replace_buffer(
+    ResourceManager* resources, BufferHandle handle, uint32_t object, uint64_t bytes, void* data)
+{
+    return resource_replace(resources, RESOURCE_BUFFER, handle.id, object, bytes, data);
+}
+
+bool resource_replace_vertex_array(
+    ResourceManager* resources, VertexArrayHandle handle, uint32_t object, uint64_t bytes, void* data)
+{
+    return resource_replace(resources, RESOURCE_VERTEX_ARRAY, handle.id, object, bytes, data);
+}
+
+bool resource_replace_program(
+    ResourceManager* resources, ProgramHandle handle, uint32_t object, uint64_t bytes, void* data)
+{
+    return resource_replace(resources, RESOURCE_PROGRAM, handle.id, object, bytes, data);
+}
+
+uint64_t resource_path_key(const char* path) { return hash_path(path); }
+
+static uint32_t hand_back(ResourceManager* resources, ResourceDestroy* destroys, uint32_t max_destroys, uint64_t before)
+{
+    uint32_t count = 0;
+    while (count < max_destroys && !resources->retired.empty() && resources->retired.front().frame < before) {
+        const RetiredResource& retired = resources->retired.front();
+        ResourcePool* pool             = &resources->pools[retired.destroy.type];
+        pool->stats.retired--;
+        pool->stats.retired_bytes -= retired.bytes;
+        pool->stats.destroyed++;
+        destroys[count++] = retired.destroy;
+        resources->retired.pop_front();
+    }
+    return count;
+}
+
+uint32_t resource_manager_end_frame(ResourceManager* resources, ResourceDestroy* destroys, uint32_t max_destroys)
+{
+    resources->frame++;
+    if (resources->frame < resources->frames_in_flight) { return 0; }
+    return hand_back(resources, destroys, max_destroys, resources->frame - resources->frames_in_flight + 1);
+}
+
+uint32_t resource_manager_drain(ResourceManager* resources, ResourceDestroy* destroys, uint32_t max_destroys)
+{
+    return hand_back(resources, destroys, max_destroys, UINT64_MAX);
+}
+
+void resource_manager_stats(const ResourceManager* resources, ResourceTypeStats stats[RESOURCE_TYPE_COUNT])
+{
+    for (uint32_t type = 0; type < RESOURCE_TYPE_COUNT; type++) {
+        stats[type] = resources->pools[type].stats;
+    }
+}
+
+const char* resource_type_name(ResourceType type)
+{
+    switch (type) {
+    case RESOURCE_TEXTURE:
+        return "textures";
+    case RESOURCE_BUFFER:
+        return "buffers";
+    case RESOURCE_VERTEX_ARRAY:
+        return "vertex arrays";
+    case RESOURCE_PROGRAM:
+        return "programs";
+    default:
+        return "unknown";
+    }
+}
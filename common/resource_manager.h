@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Owns the GL objects behind typed 32-bit handles. A handle is a pool index in the low 20 bits and a generation in the
+// high 12; the generation changes every time a slot is reused, so a handle to something that has been destroyed
+// resolves to 0 instead of to whatever took its place. Handle 0 is never valid.
+//
+// Resources are reference counted and can be given a key, the hash of their path or contents; loading something with
+// a key that is already live hands back the existing resource with another reference instead of loading it twice.
+//
+// The manager never touches GL itself. When the last reference goes, or a resource's object is replaced, the old
+// object is kept for frames_in_flight frames, since the GPU may still be drawing with it, and only then handed back
+// by resource_manager_end_frame() for the platform layer to delete.
+typedef struct ResourceManager ResourceManager;
+
+typedef enum ResourceType {
+    RESOURCE_TEXTURE,
+    RESOURCE_BUFFER,
+    RESOURCE_VERTEX_ARRAY,
+    RESOURCE_PROGRAM,
+    RESOURCE_TYPE_COUNT,
+} ResourceType;
+
+typedef struct TextureHandle {
+    uint32_t id;
+} TextureHandle;
+
+typedef struct BufferHandle {
+    uint32_t id;
+} BufferHandle;
+
+typedef struct VertexArrayHandle {
+    uint32_t id;
+} VertexArrayHandle;
+
+typedef struct ProgramHandle {
+    uint32_t id;
+} ProgramHandle;
+
+typedef struct ResourceManagerDesc {
+    uint32_t frames_in_flight; // 0 = 2
+} ResourceManagerDesc;
+
+// An object the GPU is done with. `data` is whatever was attached to it.
+typedef struct ResourceDestroy {
+    ResourceType type;
+    uint32_t object;
+    void* data;
+} ResourceDestroy;
+
+typedef struct ResourceTypeStats {
+    uint32_t live;
+    uint32_t retired;       // released, waiting for the GPU to finish with them
+    uint64_t bytes;         // of the live ones
+    uint64_t retired_bytes;
+    uint64_t created;
+    uint64_t destroyed;
+    uint64_t dedup_hits;    // loads that found the resource already live
+} ResourceTypeStats;
+
+ResourceManager* resource_manager_create(const ResourceManagerDesc* desc);
+
+// Anything still live or retired is forgotten without being handed back; drain first.
+void resource_manager_destroy(ResourceManager* resources);
+
+// Takes over `object` with one reference. key 0 means no deduplication; `data` is the caller's, handed back when the
+// object is destroyed. Returns 0 if the pool is full.
+uint32_t resource_add(
+    ResourceManager* resources, ResourceType type, uint32_t object, uint64_t bytes, uint64_t key, void* data);
+
+// Returns the live resource with this key with a new reference, or 0.
+uint32_t resource_find(ResourceManager* resources, ResourceType type, uint64_t key);
+
+void resource_acquire(ResourceManager* resources, ResourceType type, uint32_t handle);
+void resource_release(ResourceManager* resources, ResourceType type, uint32_t handle);
+
+// Points a live handle at a new object, for reloads; the old object and data are retired. Returns false if the handle
+// is stale.
+bool resource_replace(
+    ResourceManager* resources, ResourceType type, uint32_t handle, uint32_t object, uint64_t bytes, void* data);
+
+// 0 and NULL for stale handles.
+uint32_t resource_object(const ResourceManager* resources, ResourceType type, uint32_t handle);
+void* resource_data(const ResourceManager* resources, ResourceType type, uint32_t handle);
+
+uint32_t resource_texture(const ResourceManager* resources, TextureHandle handle);
+uint32_t resource_buffer(const ResourceManager* resources, BufferHandle handle);
+uint32_t resource_vertex_array(const ResourceManager* resources, VertexArrayHandle handle);
+uint32_t resource_program(const ResourceManager* resources, ProgramHandle handle);
+
+// Typed forms of resource_add(), resource_release() and resource_replace(). The adds return a handle of 0 if the pool
+// is full.
+TextureHandle resource_add_texture(
+    ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data);
+BufferHandle resource_add_buffer(ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data);
+VertexArrayHandle resource_add_vertex_array(
+    ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data);
+ProgramHandle resource_add_program(
+    ResourceManager* resources, uint32_t object, uint64_t bytes, uint64_t key, void* data);
+
+void resource_release_texture(ResourceManager* resources, TextureHandle handle);
+void resource_release_buffer(ResourceManager* resources, BufferHandle handle);
+void resource_release_vertex_array(ResourceManager* resources, VertexArrayHandle handle);
+void resource_release_program(ResourceManager* resources, ProgramHandle handle);
+
+bool resource_replace_texture(
+    ResourceManager* resources, TextureHandle handle, uint32_t object, uint64_t bytes, void* data);
+bool resource_replace_buffer(
+    ResourceManager* resources, BufferHandle handle, uint32_t object, uint64_t bytes, void* data);
+bool resource_replace_vertex_array(
+    ResourceManager* resources, VertexArrayHandle handle, uint32_t object, uint64_t bytes, void* data);
+bool resource_replace_program(
+    ResourceManager* resources, ProgramHandle handle, uint32_t object, uint64_t bytes, void* data);
+
+// Key for a file, the same whichever way its path separators go.
+uint64_t resource_path_key(const char* path);
+
+// Advances the frame and writes out objects retired at least frames_in_flight frames ago. Returns the number written;
+// the rest come out on a later call.
+uint32_t resource_manager_end_frame(ResourceManager* resources, ResourceDestroy* destroys, uint32_t max_destroys);
+
+// Writes out every retired object regardless of age, for shutdown once the GPU is idle.
+uint32_t resource_manager_drain(ResourceManager* resources, ResourceDestroy* destroys, uint32_t max_destroys);
+
+void resource_manager_stats(const ResourceManager* resources, ResourceTypeStats stats[RESOURCE_TYPE_COUNT]);
+
+const char* resource_type_name(ResourceType type);
+
+#ifdef __cplusplus
+}
+#endif
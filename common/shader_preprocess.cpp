@@ -0,0 +1,174 @@
+#include "shader_preprocess.h"
+
+#include "hash.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef struct PreprocessState {
+    std::vector<std::string> stack;
+    std::vector<std::string> files;
+    std::vector<std::string> defines;
+    std::string body;
+    std::string error;
+} PreprocessState;
+
+static bool read_file(const std::string& path, std::string* contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) { return false; }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    *contents = ss.str();
+    return true;
+}
+
+static std::string directory_of(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static std::string trim(const std::string& s)
+{
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) { return std::string(); }
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+static bool starts_with(const std::string& s, const char* prefix) { return s.compare(0, strlen(prefix), prefix) == 0; }
+
+static bool fail(PreprocessState* state, const std::string& path, uint32_t line, const char* message)
+{
+    state->error = path + ":" + std::to_string(line) + ": " + message;
+    return false;
+}
+
+// #line directives keep compiler messages pointing at the original files; the second argument is the index of the file
+// in `files`.
+static bool resolve(PreprocessState* state, const std::string& path)
+{
+    for (const std::string& open : state->stack) {
+        if (open == path) { return fail(state, path, 0, "include cycle"); }
+    }
+
+    std::string contents;
+    if (!read_file(path, &contents)) { return fail(state, path, 0, "cannot read file"); }
+
+    uint32_t file_index = (uint32_t)state->files.size();
+    state->files.push_back(path);
+    state->stack.push_back(path);
+
+    std::istringstream lines(contents);
+    std::string line;
+    uint32_t line_number = 0;
+    while (std::getline(lines, line)) {
+        line_number++;
+        std::string directive = trim(line);
+
+        if (starts_with(directive, "#version")) {
+            return fail(state, path, line_number, "remove #version, it is set per platform");
+        }
+
+        if (starts_with(directive, "#pragma variant")) {
+            if (state->stack.size() > 1) {
+                return fail(state, path, line_number, "#pragma variant is only allowed in top level shaders");
+            }
+            std::string name = trim(directive.substr(strlen("#pragma variant")));
+            if (name.empty()) { return fail(state, path, line_number, "#pragma variant needs a name"); }
+            if (state->defines.size() == SHADER_MAX_DEFINES) {
+                return fail(state, path, line_number, "too many variant defines");
+            }
+            state->defines.push_back(name);
+            state->body += "\n";
+            continue;
+        }
+
+        if (starts_with(directive, "#include")) {
+            size_t open  = directive.find('"');
+            size_t close = open == std::string::npos ? open : directive.find('"', open + 1);
+            if (close == std::string::npos) { return fail(state, path, line_number, "expected #include \"file\""); }
+
+            std::string include = directory_of(path) + directive.substr(open + 1, close - open - 1);
+            state->body += "#line 1 " + std::to_string(state->files.size()) + "\n";
+            if (!resolve(state, include)) { return false; }
+            state->body += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+            continue;
+        }
+
+        state->body += line;
+        state->body += "\n";
+    }
+
+    state->stack.pop_back();
+    return true;
+}
+
+static char* copy_string(const std::string& s)
+{
+    char* copy = (char*)malloc(s.size() + 1);
+    memcpy(copy, s.c_str(), s.size() + 1);
+    return copy;
+}
+
+bool shader_preprocess(const char* path, ShaderPreprocessed* shader)
+{
+    memset(shader, 0, sizeof(*shader));
+
+    PreprocessState state;
+    bool ok = resolve(&state, path);
+
+    // The file list is filled in even on failure so callers can keep watching a file that is mid-edit.
+    shader->file_count = (uint32_t)state.files.size();
+    shader->files      = (char**)calloc(shader->file_count ? shader->file_count : 1, sizeof(char*));
+    for (uint32_t i = 0; i < shader->file_count; i++) {
+        shader->files[i] = copy_string(state.files[i]);
+    }
+
+    if (!ok) {
+        snprintf(shader->error, sizeof(shader->error), "%s", state.error.c_str());
+        return false;
+    }
+
+    shader->body         = copy_string(state.body);
+    shader->define_count = (uint32_t)state.defines.size();
+    for (uint32_t i = 0; i < shader->define_count; i++) {
+        shader->defines[i] = copy_string(state.defines[i]);
+    }
+    return true;
+}
+
+void shader_preprocess_free(ShaderPreprocessed* shader)
+{
+    free(shader->body);
+    for (uint32_t i = 0; i < shader->define_count; i++) {
+        free(shader->defines[i]);
+    }
+    for (uint32_t i = 0; i < shader->file_count; i++) {
+        free(shader->files[i]);
+    }
+    free(shader->files);
+    memset(shader, 0, sizeof(*shader));
+}
+
+char* shader_preprocess_variant(
+    const ShaderPreprocessed* shader, const char* glsl_version, uint32_t define_mask, size_t* length)
+{
+    std::string source = std::string("#version ") + glsl_version + "\n";
+    for (uint32_t i = 0; i < shader->define_count; i++) {
+        if (define_mask & (1u << i)) { source += std::string("#define ") + shader->defines[i] + " 1\n"; }
+    }
+    source += "#line 1 0\n";
+    source += shader->body;
+
+    if (length) { *length = source.size(); }
+    return copy_string(source);
+}
+
+uint64_t shader_source_hash(const char* source, size_t length) { return hash_fnv1a(source, length, HASH_FNV1A_SEED); }
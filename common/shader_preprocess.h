@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "shader_variants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The preprocessing half of tools/shader_embed, shared with hot reload so a shader rebuilt from disk at runtime comes
+// out byte for byte the same as the one embedded at build time.
+//
+// #include "file" is resolved relative to the including file and inlined with #line directives. `#pragma variant NAME`
+// lines declare the defines that variants are built from. Shader files must not have a #version line; it is added
+// per platform when a variant is assembled.
+typedef struct ShaderPreprocessed {
+    char* body;
+    char* defines[SHADER_MAX_DEFINES];
+    uint32_t define_count;
+    char** files; // files[0] is the shader itself, the rest are the files it includes
+    uint32_t file_count;
+    char error[256];
+} ShaderPreprocessed;
+
+bool shader_preprocess(const char* path, ShaderPreprocessed* shader);
+void shader_preprocess_free(ShaderPreprocessed* shader);
+
+// Returns a malloc'd, NUL terminated variant with the #version and the defines selected by define_mask prepended.
+char* shader_preprocess_variant(
+    const ShaderPreprocessed* shader, const char* glsl_version, uint32_t define_mask, size_t* length);
+
+uint64_t shader_source_hash(const char* source, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
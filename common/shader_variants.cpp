@@ -0,0 +1,64 @@
+#include "shader_variants.h"
+
+#include <atomic>
+#include <cstdio>
+
+static std::atomic<uint8_t> shader_usage[SHADER_USAGE_MAX];
+
+const ShaderVariant* shader_variant(const ShaderSource* source, uint32_t define_mask)
+{
+    uint32_t index = define_mask & ((1u << source->define_count) - 1);
+    shader_usage[(source->usage_index + index) % SHADER_USAGE_MAX].store(1, std::memory_order_relaxed);
+
+    const ShaderVariant* variant = &source->variants[index];
+    return variant->source ? variant : NULL;
+}
+
+static bool variant_used(const ShaderSource* source, uint32_t mask)
+{
+    return shader_usage[(source->usage_index + mask) % SHADER_USAGE_MAX].load(std::memory_order_relaxed) != 0;
+}
+
+static size_t append(char* buffer, size_t size, size_t offset, const char* format, const char* name, uint32_t mask)
+{
+    if (offset >= size) { return offset; }
+    int written = snprintf(buffer + offset, size - offset, format, name, mask);
+    return written > 0 ? offset + written : offset;
+}
+
+uint32_t shader_usage_report(const ShaderSource* const* sources, uint32_t count, char* buffer, size_t size)
+{
+    uint32_t unused = 0;
+    size_t offset   = 0;
+    if (buffer && size) { buffer[0] = '\0'; }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const ShaderSource* source = sources[i];
+        for (uint32_t mask = 0; mask < (1u << source->define_count); mask++) {
+            if (!source->variants[mask].source) { continue; }
+
+            bool used = variant_used(source, mask);
+            if (!used) { unused++; }
+            if (buffer) {
+                offset = append(buffer, size, offset, used ? "%s 0x%x used\n" : "%s 0x%x unused\n", source->name, mask);
+            }
+        }
+    }
+
+    return unused;
+}
+
+bool shader_usage_write(const char* path, const ShaderSource* const* sources, uint32_t count)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) { return false; }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const ShaderSource* source = sources[i];
+        for (uint32_t mask = 0; mask < (1u << source->define_count); mask++) {
+            if (variant_used(source, mask)) { fprintf(file, "%s %u\n", source->name, mask); }
+        }
+    }
+
+    return fclose(file) == 0;
+}
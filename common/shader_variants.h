@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shaders live as files under shaders/ and are turned into headers at build time by tools/shader_embed. Every
+// combination of a shader's `#pragma variant NAME` defines is preprocessed ahead of time, so at runtime picking a
+// variant is just an index into a table with the define bits as the index.
+
+#ifdef __cplusplus
+#define SHADER_DATA static constexpr
+#else
+#define SHADER_DATA static const
+#endif
+
+#define SHADER_MAX_DEFINES 8
+#define SHADER_USAGE_MAX 4096
+
+typedef struct ShaderVariant {
+    const char* source; // NULL when the variant was pruned at build time
+    uint32_t length;
+    uint64_t hash;      // FNV-1a of the final source, handy as a program cache key
+} ShaderVariant;
+
+typedef struct ShaderSource {
+    const char* name;
+    const char* const* defines;
+    uint32_t define_count;
+    uint32_t usage_index; // first slot of this shader's variants in the usage table
+    const ShaderVariant* variants;
+} ShaderSource;
+
+// define_mask has bit i set for defines[i]. Marks the variant as used for shader_usage_report().
+const ShaderVariant* shader_variant(const ShaderSource* source, uint32_t define_mask);
+
+// Writes one line per variant, flagging the ones that were never requested. Returns the number of unused variants.
+uint32_t shader_usage_report(const ShaderSource* const* sources, uint32_t count, char* buffer, size_t size);
+
+// Writes the used variants as "<name> <mask>" lines. Pass the file back to shader_embed with --used to prune the rest.
+bool shader_usage_write(const char* path, const ShaderSource* const* sources, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,219 @@
+#pragma once
+
+// Four lane float and integer vectors for the CPU kernels in common/, in whichever registers the target has: SSE2 on
+// x86-64, NEON on ARM and plain arrays everywhere else, so every target runs the same arithmetic. C++ only, and only
+// for use inside the library's translation units. Comparisons return a bit per lane, lane 0 in the lowest bit.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_NEON
+#endif
+
+#if defined(SIMD_SSE2)
+typedef __m128 f32x4;
+typedef __m128i u32x4;
+
+static inline f32x4 f32x4_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void f32x4_store(float* p, f32x4 v) { _mm_storeu_ps(p, v); }
+static inline f32x4 f32x4_splat(float v) { return _mm_set1_ps(v); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b) { return _mm_div_ps(a, b); }
+static inline f32x4 f32x4_min(f32x4 a, f32x4 b) { return _mm_min_ps(a, b); }
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b) { return _mm_max_ps(a, b); }
+static inline f32x4 f32x4_abs(f32x4 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+static inline f32x4 f32x4_sqrt(f32x4 v) { return _mm_sqrt_ps(v); }
+static inline f32x4 f32x4_rsqrt(f32x4 v) { return _mm_rsqrt_ps(v); }
+static inline f32x4 f32x4_round(f32x4 v) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(v)); }
+static inline uint32_t f32x4_less(f32x4 a, f32x4 b) { return (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+static inline void f32x4_store_index(int32_t* p, f32x4 v) { _mm_storeu_si128((__m128i*)p, _mm_cvttps_epi32(v)); }
+static inline void f32x4_transpose(f32x4* r) { _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]); }
+
+// Rounds, saturates to 0-255 and writes eight bytes, the four lanes of `low` and then those of `high`.
+static inline void f32x4_store_u8x8(uint8_t* p, f32x4 low, f32x4 high)
+{
+    __m128i i = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+    _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(i, i));
+}
+
+static inline u32x4 u32x4_load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline u32x4 u32x4_xor(u32x4 a, u32x4 b) { return _mm_xor_si128(a, b); }
+static inline u32x4 u32x4_shl(u32x4 v, int n) { return _mm_sll_epi32(v, _mm_cvtsi32_si128(n)); }
+static inline u32x4 u32x4_shr(u32x4 v, int n) { return _mm_srl_epi32(v, _mm_cvtsi32_si128(n)); }
+
+// The top 23 bits as a float in [0, 1).
+static inline f32x4 u32x4_unit(u32x4 v)
+{
+    __m128i one = _mm_or_si128(_mm_srli_epi32(v, 9), _mm_set1_epi32(0x3F800000));
+    return _mm_sub_ps(_mm_castsi128_ps(one), _mm_set1_ps(1.0f));
+}
+#elif defined(SIMD_NEON)
+typedef float32x4_t f32x4;
+typedef uint32x4_t u32x4;
+
+static inline f32x4 f32x4_load(const float* p) { return vld1q_f32(p); }
+static inline void f32x4_store(float* p, f32x4 v) { vst1q_f32(p, v); }
+static inline f32x4 f32x4_splat(float v) { return vdupq_n_f32(v); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return vaddq_f32(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return vsubq_f32(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return vmulq_f32(a, b); }
+static inline f32x4 f32x4_min(f32x4 a, f32x4 b) { return vminq_f32(a, b); }
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b) { return vmaxq_f32(a, b); }
+static inline f32x4 f32x4_abs(f32x4 v) { return vabsq_f32(v); }
+static inline f32x4 f32x4_round(f32x4 v) { return vcvtq_f32_s32(vcvtnq_s32_f32(v)); }
+static inline void f32x4_store_index(int32_t* p, f32x4 v) { vst1q_s32(p, vcvtq_s32_f32(v)); }
+
+// One Newton step on the estimate, which on its own is only good to 8 bits.
+static inline f32x4 f32x4_rsqrt(f32x4 v)
+{
+    float32x4_t r = vrsqrteq_f32(v);
+    return vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(v, r), r));
+}
+
+static inline f32x4 f32x4_sqrt(f32x4 v)
+{
+    // rsqrt of 0 is infinity; keep the lanes that were 0 at 0.
+    uint32x4_t zero = vceqq_f32(v, vdupq_n_f32(0.0f));
+    float32x4_t s   = vmulq_f32(v, f32x4_rsqrt(v));
+    return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(s), zero));
+}
+
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b)
+{
+    float32x4_t r = vrecpeq_f32(b);
+    r             = vmulq_f32(r, vrecpsq_f32(b, r));
+    r             = vmulq_f32(r, vrecpsq_f32(b, r));
+    return vmulq_f32(a, r);
+}
+
+static inline uint32_t f32x4_less(f32x4 a, f32x4 b)
+{
+    static const uint32_t bits[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(vcltq_f32(a, b), vld1q_u32(bits)));
+}
+
+static inline void f32x4_transpose(f32x4* r)
+{
+    float32x4x2_t t01 = vtrnq_f32(r[0], r[1]);
+    float32x4x2_t t23 = vtrnq_f32(r[2], r[3]);
+    r[0]              = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r[1]              = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r[2]              = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r[3]              = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+static inline void f32x4_store_u8x8(uint8_t* p, f32x4 low, f32x4 high)
+{
+    // Adding a half and truncating rounds everything that does not end up clamped to 0 anyway.
+    float32x4_t half = vdupq_n_f32(0.5f);
+    int16x4_t s_low  = vqmovn_s32(vcvtq_s32_f32(vaddq_f32(low, half)));
+    int16x4_t s_high = vqmovn_s32(vcvtq_s32_f32(vaddq_f32(high, half)));
+    vst1_u8(p, vqmovun_s16(vcombine_s16(s_low, s_high)));
+}
+
+static inline u32x4 u32x4_load(const uint32_t* p) { return vld1q_u32(p); }
+static inline u32x4 u32x4_xor(u32x4 a, u32x4 b) { return veorq_u32(a, b); }
+static inline u32x4 u32x4_shl(u32x4 v, int n) { return vshlq_u32(v, vdupq_n_s32(n)); }
+static inline u32x4 u32x4_shr(u32x4 v, int n) { return vshlq_u32(v, vdupq_n_s32(-n)); }
+
+static inline f32x4 u32x4_unit(u32x4 v)
+{
+    uint32x4_t one = vorrq_u32(vshrq_n_u32(v, 9), vdupq_n_u32(0x3F800000));
+    return vsubq_f32(vreinterpretq_f32_u32(one), vdupq_n_f32(1.0f));
+}
+#else
+typedef struct f32x4 {
+    float v[4];
+} f32x4;
+
+typedef struct u32x4 {
+    uint32_t v[4];
+} u32x4;
+
+#define F32X4_MAP(expr)                                                                                                \
+    f32x4 r;                                                                                                           \
+    for (int i = 0; i < 4; i++) {                                                                                      \
+        r.v[i] = expr;                                                                                                 \
+    }                                                                                                                  \
+    return r
+
+static inline f32x4 f32x4_load(const float* p)
+{
+    f32x4 r;
+    memcpy(r.v, p, sizeof(r.v));
+    return r;
+}
+
+static inline void f32x4_store(float* p, f32x4 v) { memcpy(p, v.v, sizeof(v.v)); }
+static inline f32x4 f32x4_splat(float v) { return { { v, v, v, v } }; }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { F32X4_MAP(a.v[i] + b.v[i]); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { F32X4_MAP(a.v[i] - b.v[i]); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { F32X4_MAP(a.v[i] * b.v[i]); }
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b) { F32X4_MAP(a.v[i] / b.v[i]); }
+static inline f32x4 f32x4_min(f32x4 a, f32x4 b) { F32X4_MAP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b) { F32X4_MAP(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+static inline f32x4 f32x4_abs(f32x4 v) { F32X4_MAP(fabsf(v.v[i])); }
+static inline f32x4 f32x4_sqrt(f32x4 v) { F32X4_MAP(sqrtf(v.v[i])); }
+static inline f32x4 f32x4_rsqrt(f32x4 v) { F32X4_MAP(1.0f / sqrtf(v.v[i])); }
+static inline f32x4 f32x4_round(f32x4 v) { F32X4_MAP(nearbyintf(v.v[i])); }
+
+static inline uint32_t f32x4_less(f32x4 a, f32x4 b)
+{
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        bits |= (uint32_t)(a.v[i] < b.v[i]) << i;
+    }
+    return bits;
+}
+
+static inline void f32x4_store_index(int32_t* p, f32x4 v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (int32_t)v.v[i];
+    }
+}
+
+static inline void f32x4_transpose(f32x4* r)
+{
+    for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4; j++) {
+            float t   = r[i].v[j];
+            r[i].v[j] = r[j].v[i];
+            r[j].v[i] = t;
+        }
+    }
+}
+
+static inline void f32x4_store_u8x8(uint8_t* p, f32x4 low, f32x4 high)
+{
+    for (int i = 0; i < 8; i++) {
+        float rounded = floorf((i < 4 ? low.v[i] : high.v[i - 4]) + 0.5f);
+        p[i]          = (uint8_t)(rounded < 0.0f ? 0.0f : rounded > 255.0f ? 255.0f : rounded);
+    }
+}
+
+static inline u32x4 u32x4_load(const uint32_t* p)
+{
+    u32x4 r;
+    memcpy(r.v, p, sizeof(r.v));
+    return r;
+}
+
+static inline u32x4 u32x4_xor(u32x4 a, u32x4 b)
+{
+    return { { a.v[0] ^ b.v[0], a.v[1] ^ b.v[1], a.v[2] ^ b.v[2], a.v[3] ^ b.v[3] } };
+}
+
+static inline u32x4 u32x4_shl(u32x4 v, int n) { return { { v.v[0] << n, v.v[1] << n, v.v[2] << n, v.v[3] << n } }; }
+static inline u32x4 u32x4_shr(u32x4 v, int n) { return { { v.v[0] >> n, v.v[1] >> n, v.v[2] >> n, v.v[3] >> n } }; }
+
+static inline f32x4 u32x4_unit(u32x4 v) { F32X4_MAP((float)(v.v[i] >> 8) * (1.0f / 16777216.0f)); }
+#endif
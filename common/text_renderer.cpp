@@ -0,0 +1,181 @@
+#include "text_renderer.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TEXT_DEFAULT_MAX_GLYPHS 4096u
+#define TEXT_DEFAULT_RUN_LIFETIME 60u
+
+// In ems. There are no font wide metrics to go on, so these suit most UI fonts.
+#define TEXT_ASCENT 0.8f
+#define TEXT_LINE_HEIGHT 1.2f
+
+#define TEXT_REPLACEMENT_CHARACTER 0xFFFDu
+
+// A string laid out at 1 pixel per em with its top left at the origin. Colors are filled in when it is drawn.
+typedef struct TextRun {
+    std::string text;
+    std::vector<TextVertex> vertices;
+    std::vector<uint32_t> slots; // glyph cache slots to keep alive while the run is drawn
+    uint64_t generation;         // of the glyph cache when laid out
+    uint64_t last_used;
+    bool complete;               // false while some glyph was still being rasterized
+} TextRun;
+
+struct TextRenderer {
+    TextRendererDesc desc;
+    std::unordered_map<uint64_t, TextRun> runs;
+    std::vector<TextVertex> vertices;
+    uint64_t frame;
+    TextRendererStats stats;
+};
+
+static uint32_t decode_utf8(const unsigned char** cursor, const unsigned char* end)
+{
+    const unsigned char* s = *cursor;
+    uint32_t lead          = *s++;
+    uint32_t length        = lead < 0x80 ? 0 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 4;
+    if (length == 4 || (size_t)(end - s) < length) {
+        *cursor = s;
+        return lead < 0x80 ? lead : TEXT_REPLACEMENT_CHARACTER;
+    }
+
+    uint32_t codepoint = length ? lead & (0x3Fu >> length) : lead;
+    for (uint32_t i = 0; i < length; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *cursor = s + i;
+            return TEXT_REPLACEMENT_CHARACTER;
+        }
+        codepoint = (codepoint << 6) | (s[i] & 0x3F);
+    }
+    *cursor = s + length;
+    return codepoint;
+}
+
+static void push_quad(std::vector<TextVertex>* vertices, float x0, float y0, float x1, float y1, const Glyph* glyph)
+{
+    TextVertex top_left     = { x0, y0, glyph->u0, glyph->v0, 0 };
+    TextVertex top_right    = { x1, y0, glyph->u1, glyph->v0, 0 };
+    TextVertex bottom_left  = { x0, y1, glyph->u0, glyph->v1, 0 };
+    TextVertex bottom_right = { x1, y1, glyph->u1, glyph->v1, 0 };
+    vertices->insert(vertices->end(), { top_left, top_right, bottom_right, top_left, bottom_right, bottom_left });
+}
+
+static void layout(TextRenderer* text, TextRun* run)
+{
+    run->vertices.clear();
+    run->slots.clear();
+    run->generation = glyph_cache_generation(text->desc.glyphs);
+    run->complete   = true;
+
+    float pen_x    = 0.0f;
+    float baseline = TEXT_ASCENT;
+
+    const unsigned char* cursor = (const unsigned char*)run->text.data();
+    const unsigned char* end    = cursor + run->text.size();
+    while (cursor < end) {
+        uint32_t codepoint = decode_utf8(&cursor, end);
+        if (codepoint == '\n') {
+            pen_x = 0.0f;
+            baseline += TEXT_LINE_HEIGHT;
+            continue;
+        }
+
+        const Glyph* glyph = glyph_cache_get(text->desc.glyphs, codepoint);
+        if (!glyph) {
+            // Not rasterized yet; leave a gap and lay the string out again once it is.
+            run->complete = false;
+            pen_x += 0.5f;
+            continue;
+        }
+        if (glyph->visible) {
+            push_quad(&run->vertices, pen_x + glyph->x0, baseline + glyph->y0, pen_x + glyph->x1,
+                baseline + glyph->y1, glyph);
+            run->slots.push_back(glyph->slot);
+        }
+        pen_x += glyph->advance;
+    }
+}
+
+TextRenderer* text_renderer_create(const TextRendererDesc* desc)
+{
+    if (!desc->glyphs) { return NULL; }
+
+    TextRenderer* text = new TextRenderer();
+    text->desc         = *desc;
+    text->frame        = 0;
+    text->stats        = {};
+    if (!text->desc.max_glyphs) { text->desc.max_glyphs = TEXT_DEFAULT_MAX_GLYPHS; }
+    if (!text->desc.run_lifetime) { text->desc.run_lifetime = TEXT_DEFAULT_RUN_LIFETIME; }
+    text->vertices.reserve((size_t)text->desc.max_glyphs * 6);
+    return text;
+}
+
+void text_renderer_destroy(TextRenderer* text) { delete text; }
+
+void text_draw(TextRenderer* text, const char* utf8, float x, float y, float size, uint32_t color)
+{
+    size_t length = strlen(utf8);
+    TextRun* run  = &text->runs[hash_fnv1a(utf8, length, HASH_FNV1A_SEED)];
+
+    bool same_text = run->text.size() == length && memcmp(run->text.data(), utf8, length) == 0;
+    if (!same_text) {
+        // New, or a hash collision with a string that is no longer drawn; either way start over.
+        run->text.assign(utf8, length);
+        layout(text, run);
+        text->stats.run_misses++;
+    } else if (!run->complete || run->generation != glyph_cache_generation(text->desc.glyphs)) {
+        layout(text, run);
+        text->stats.run_rebuilds++;
+    } else {
+        for (uint32_t slot : run->slots) {
+            glyph_cache_touch(text->desc.glyphs, slot);
+        }
+        text->stats.run_hits++;
+    }
+    run->last_used = text->frame;
+
+    size_t room  = (size_t)text->desc.max_glyphs * 6 - text->vertices.size();
+    size_t count = std::min(run->vertices.size(), room);
+    text->stats.dropped_glyphs += (run->vertices.size() - count) / 6;
+    for (size_t i = 0; i < count; i++) {
+        TextVertex vertex = run->vertices[i];
+        vertex.x          = x + vertex.x * size;
+        vertex.y          = y + vertex.y * size;
+        vertex.color      = color;
+        text->vertices.push_back(vertex);
+    }
+}
+
+const TextVertex* text_renderer_vertices(const TextRenderer* text, uint32_t* vertex_count)
+{
+    *vertex_count = (uint32_t)text->vertices.size();
+    return text->vertices.data();
+}
+
+void text_renderer_end_frame(TextRenderer* text)
+{
+    text->stats.glyphs = (uint32_t)(text->vertices.size() / 6);
+    text->vertices.clear();
+
+    for (auto run = text->runs.begin(); run != text->runs.end();) {
+        if (text->frame - run->second.last_used >= text->desc.run_lifetime) {
+            run = text->runs.erase(run);
+        } else {
+            ++run;
+        }
+    }
+    text->frame++;
+}
+
+TextRendererStats text_renderer_stats(const TextRenderer* text)
+{
+    TextRendererStats stats = text->stats;
+    stats.runs              = (uint32_t)text->runs.size();
+    return stats;
+}
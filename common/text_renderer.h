@@ -0,0 +1,62 @@
+#pragma once
+
+#include "glyph_cache.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lays out UTF-8 strings with glyphs from a GlyphCache and collects the quads of everything drawn in a frame into one
+// vertex array, so all text goes out in a single draw call.
+//
+// Laid out strings are cached by content. Drawing a string that was drawn recently only copies its quads into the
+// batch, moved and scaled into place; it is laid out again only when it contains glyphs that were still being
+// rasterized, or when the glyph cache evicted something since. Strings that are not drawn for run_lifetime frames are
+// forgotten.
+//
+// Layout is deliberately simple: one glyph per codepoint, left to right, no kerning, and '\n' starts a new line.
+typedef struct TextRenderer TextRenderer;
+
+typedef struct TextRendererDesc {
+    GlyphCache* glyphs;
+    uint32_t max_glyphs;   // 0 = 4096; per frame, glyphs past it are dropped
+    uint32_t run_lifetime; // 0 = 60 frames
+} TextRendererDesc;
+
+// Six vertices, two triangles, per glyph. Positions are in pixels from the top left of the screen; color is RGBA,
+// red in the lowest byte.
+typedef struct TextVertex {
+    float x, y;
+    float u, v;
+    uint32_t color;
+} TextVertex;
+
+typedef struct TextRendererStats {
+    uint32_t runs;       // strings cached
+    uint32_t glyphs;     // in the last frame's batch
+    uint64_t run_hits;   // strings drawn from the cache
+    uint64_t run_misses; // strings laid out for the first time
+    uint64_t run_rebuilds;
+    uint64_t dropped_glyphs;
+} TextRendererStats;
+
+TextRenderer* text_renderer_create(const TextRendererDesc* desc);
+void text_renderer_destroy(TextRenderer* text);
+
+// x, y is the top left of the first line, size the em size, both in pixels.
+void text_draw(TextRenderer* text, const char* utf8, float x, float y, float size, uint32_t color);
+
+// Everything drawn since the last text_renderer_end_frame().
+const TextVertex* text_renderer_vertices(const TextRenderer* text, uint32_t* vertex_count);
+
+// Empties the batch and forgets strings that have not been drawn for a while. Call after the batch was submitted.
+void text_renderer_end_frame(TextRenderer* text);
+
+TextRendererStats text_renderer_stats(const TextRenderer* text);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,372 @@
+#include "texture_residency.h"
+
+#include "mip_chain.h"
+
+#include <algorithm>
+#include <vector>
+
+#define RESIDENCY_DEFAULT_BUDGET (256ull * 1024 * 1024)
+#define RESIDENCY_DEFAULT_UPLOAD (16ull * 1024 * 1024)
+#define RESIDENCY_DEFAULT_TAIL 64u
+
+typedef struct ResidencyTexture {
+    bool live;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;
+    uint32_t mip_count;
+    uint32_t tail_mip;
+    uint32_t resident_top;
+    uint32_t wanted_top;
+    uint64_t last_used_frame;
+    uint64_t resident_bytes;
+
+    // Intrusive LRU list, most recently used at the head.
+    uint32_t lru_prev;
+    uint32_t lru_next;
+} ResidencyTexture;
+
+typedef struct ResidencyBuffer {
+    bool live;
+    uint64_t size;
+} ResidencyBuffer;
+
+typedef struct OpWriter {
+    ResidencyOp* ops;
+    uint32_t count;
+    uint32_t max;
+} OpWriter;
+
+struct TextureResidency {
+    ResidencyDesc desc;
+
+    std::vector<ResidencyTexture> textures;
+    std::vector<uint32_t> free_textures;
+    std::vector<ResidencyBuffer> buffers;
+    std::vector<uint32_t> free_buffers;
+    std::vector<uint32_t> streaming;
+
+    uint32_t lru_head;
+    uint32_t lru_tail;
+    uint64_t frame;
+
+    uint64_t texture_bytes;
+    uint64_t buffer_bytes;
+    uint32_t resident_mips;
+
+    uint32_t loads_last_frame;
+    uint32_t evictions_last_frame;
+    uint64_t total_loads;
+    uint64_t total_evictions;
+    uint64_t over_budget_frames;
+};
+
+static uint64_t used_bytes(const TextureResidency* r) { return r->texture_bytes + r->buffer_bytes; }
+
+static void lru_unlink(TextureResidency* r, uint32_t id)
+{
+    ResidencyTexture* tex = &r->textures[id];
+    if (tex->lru_prev != RESIDENCY_INVALID_ID) {
+        r->textures[tex->lru_prev].lru_next = tex->lru_next;
+    } else {
+        r->lru_head = tex->lru_next;
+    }
+    if (tex->lru_next != RESIDENCY_INVALID_ID) {
+        r->textures[tex->lru_next].lru_prev = tex->lru_prev;
+    } else {
+        r->lru_tail = tex->lru_prev;
+    }
+    tex->lru_prev = RESIDENCY_INVALID_ID;
+    tex->lru_next = RESIDENCY_INVALID_ID;
+}
+
+static void lru_push_front(TextureResidency* r, uint32_t id)
+{
+    ResidencyTexture* tex = &r->textures[id];
+    tex->lru_prev         = RESIDENCY_INVALID_ID;
+    tex->lru_next         = r->lru_head;
+    if (r->lru_head != RESIDENCY_INVALID_ID) { r->textures[r->lru_head].lru_prev = id; }
+    r->lru_head = id;
+    if (r->lru_tail == RESIDENCY_INVALID_ID) { r->lru_tail = id; }
+}
+
+static bool emit_op(OpWriter* writer, ResidencyOpType type, uint32_t texture, uint32_t mip)
+{
+    if (writer->count >= writer->max) { return false; }
+    writer->ops[writer->count++] = { type, texture, mip };
+    return true;
+}
+
+static bool load_next_mip(TextureResidency* r, uint32_t id, OpWriter* writer)
+{
+    ResidencyTexture* tex = &r->textures[id];
+    uint32_t mip          = tex->resident_top - 1;
+    if (!emit_op(writer, RESIDENCY_OP_LOAD_MIP, id, mip)) { return false; }
+
+    uint64_t size = mip_level_size(tex->width, tex->height, tex->bytes_per_pixel, mip);
+    tex->resident_top = mip;
+    tex->resident_bytes += size;
+    r->texture_bytes += size;
+    r->resident_mips++;
+    r->loads_last_frame++;
+    r->total_loads++;
+    return true;
+}
+
+static bool evict_top_mip(TextureResidency* r, uint32_t id, OpWriter* writer)
+{
+    ResidencyTexture* tex = &r->textures[id];
+    uint32_t mip          = tex->resident_top;
+    if (!emit_op(writer, RESIDENCY_OP_EVICT_MIP, id, mip)) { return false; }
+
+    uint64_t size = mip_level_size(tex->width, tex->height, tex->bytes_per_pixel, mip);
+    tex->resident_top = mip + 1;
+    tex->resident_bytes -= size;
+    r->texture_bytes -= size;
+    r->resident_mips--;
+    r->evictions_last_frame++;
+    r->total_evictions++;
+    return true;
+}
+
+static bool is_evictable(const TextureResidency* r, const ResidencyTexture* tex)
+{
+    if (tex->resident_top >= tex->tail_mip) { return false; }
+    // Anything drawn this frame only gives up mips it holds beyond what it asked for.
+    return tex->last_used_frame < r->frame || tex->resident_top < tex->wanted_top;
+}
+
+// Evicts top mips, least recently used first, until `needed` more bytes fit in the budget.
+static bool make_room(TextureResidency* r, uint64_t needed, uint32_t exclude, OpWriter* writer)
+{
+    uint32_t id = r->lru_tail;
+    while (used_bytes(r) + needed > r->desc.budget_bytes) {
+        while (id != RESIDENCY_INVALID_ID && (id == exclude || !is_evictable(r, &r->textures[id]))) {
+            id = r->textures[id].lru_prev;
+        }
+        if (id == RESIDENCY_INVALID_ID) { return false; }
+        if (!evict_top_mip(r, id, writer)) { return false; }
+    }
+    return true;
+}
+
+TextureResidency* residency_create(const ResidencyDesc* desc)
+{
+    TextureResidency* r = new TextureResidency();
+    if (desc) { r->desc = *desc; }
+    if (r->desc.budget_bytes == 0) { r->desc.budget_bytes = RESIDENCY_DEFAULT_BUDGET; }
+    if (r->desc.max_upload_bytes_per_frame == 0) { r->desc.max_upload_bytes_per_frame = RESIDENCY_DEFAULT_UPLOAD; }
+    if (r->desc.tail_dimension == 0) { r->desc.tail_dimension = RESIDENCY_DEFAULT_TAIL; }
+    r->lru_head = RESIDENCY_INVALID_ID;
+    r->lru_tail = RESIDENCY_INVALID_ID;
+    return r;
+}
+
+void residency_destroy(TextureResidency* residency) { delete residency; }
+
+void residency_set_budget(TextureResidency* residency, uint64_t budget_bytes)
+{
+    residency->desc.budget_bytes = budget_bytes ? budget_bytes : RESIDENCY_DEFAULT_BUDGET;
+}
+
+uint32_t residency_register_texture(
+    TextureResidency* residency, uint32_t width, uint32_t height, uint32_t bytes_per_pixel, uint32_t mip_count)
+{
+    if (width == 0 || height == 0 || bytes_per_pixel == 0) { return RESIDENCY_INVALID_ID; }
+
+    uint32_t full_count = mip_count_for_size(width, height);
+    if (mip_count == 0 || mip_count > full_count) { mip_count = full_count; }
+
+    uint32_t id;
+    if (!residency->free_textures.empty()) {
+        id = residency->free_textures.back();
+        residency->free_textures.pop_back();
+    } else {
+        id = (uint32_t)residency->textures.size();
+        residency->textures.push_back({});
+    }
+
+    ResidencyTexture* tex = &residency->textures[id];
+    *tex                  = {};
+    tex->live             = true;
+    tex->width            = width;
+    tex->height           = height;
+    tex->bytes_per_pixel  = bytes_per_pixel;
+    tex->mip_count        = mip_count;
+    tex->resident_top     = mip_count;
+    tex->last_used_frame  = residency->frame;
+
+    tex->tail_mip = mip_count - 1;
+    for (uint32_t mip = 0; mip < mip_count; mip++) {
+        uint32_t w = width >> mip;
+        uint32_t h = height >> mip;
+        if (w <= residency->desc.tail_dimension && h <= residency->desc.tail_dimension) {
+            tex->tail_mip = mip;
+            break;
+        }
+    }
+    tex->wanted_top = tex->tail_mip;
+
+    lru_push_front(residency, id);
+    return id;
+}
+
+void residency_unregister_texture(TextureResidency* residency, uint32_t texture)
+{
+    if (texture >= residency->textures.size() || !residency->textures[texture].live) { return; }
+
+    ResidencyTexture* tex = &residency->textures[texture];
+    residency->texture_bytes -= tex->resident_bytes;
+    residency->resident_mips -= tex->mip_count - tex->resident_top;
+    lru_unlink(residency, texture);
+    tex->live = false;
+    residency->free_textures.push_back(texture);
+}
+
+uint32_t residency_register_buffer(TextureResidency* residency, uint64_t size)
+{
+    uint32_t id;
+    if (!residency->free_buffers.empty()) {
+        id = residency->free_buffers.back();
+        residency->free_buffers.pop_back();
+    } else {
+        id = (uint32_t)residency->buffers.size();
+        residency->buffers.push_back({});
+    }
+
+    residency->buffers[id] = { true, size };
+    residency->buffer_bytes += size;
+    return id;
+}
+
+void residency_unregister_buffer(TextureResidency* residency, uint32_t buffer)
+{
+    if (buffer >= residency->buffers.size() || !residency->buffers[buffer].live) { return; }
+
+    residency->buffer_bytes -= residency->buffers[buffer].size;
+    residency->buffers[buffer].live = false;
+    residency->free_buffers.push_back(buffer);
+}
+
+void residency_request_texture(
+    TextureResidency* residency, uint32_t texture, uint32_t screen_width, uint32_t screen_height)
+{
+    if (texture >= residency->textures.size() || !residency->textures[texture].live) { return; }
+
+    ResidencyTexture* tex = &residency->textures[texture];
+
+    // Coarsest mip that still has at least one texel per covered pixel on both axes.
+    uint32_t wanted = 0;
+    while (wanted < tex->tail_mip && (tex->width >> (wanted + 1)) >= screen_width
+        && (tex->height >> (wanted + 1)) >= screen_height) {
+        wanted++;
+    }
+
+    if (tex->last_used_frame != residency->frame || wanted < tex->wanted_top) { tex->wanted_top = wanted; }
+    tex->last_used_frame = residency->frame;
+
+    lru_unlink(residency, texture);
+    lru_push_front(residency, texture);
+}
+
+uint32_t residency_texture_top_mip(const TextureResidency* residency, uint32_t texture)
+{
+    if (texture >= residency->textures.size() || !residency->textures[texture].live) { return RESIDENCY_NO_MIP; }
+    return residency->textures[texture].resident_top;
+}
+
+uint32_t residency_update(TextureResidency* residency, ResidencyOp* ops, uint32_t max_ops)
+{
+    OpWriter writer                 = { ops, 0, max_ops };
+    residency->loads_last_frame     = 0;
+    residency->evictions_last_frame = 0;
+
+    bool tails_fit                  = true;
+
+    // Textures that were not drawn this frame no longer want more than their tail. Their finer mips stay cached until
+    // something else needs the room, but they are not streamed in again, nor fought over by two off-screen textures.
+    for (ResidencyTexture& tex : residency->textures) {
+        if (tex.live && tex.last_used_frame < residency->frame) { tex.wanted_top = tex.tail_mip; }
+    }
+
+    // The budget may have shrunk since last frame.
+    make_room(residency, 0, RESIDENCY_INVALID_ID, &writer);
+
+    // Tails first, most recently used textures first, so everything has something to draw with. When even the tails
+    // do not fit, the rest wait for a later frame rather than going over budget, and nothing finer is streamed.
+    for (uint32_t id = residency->lru_head; id != RESIDENCY_INVALID_ID; id = residency->textures[id].lru_next) {
+        ResidencyTexture* tex = &residency->textures[id];
+        while (tex->resident_top > tex->tail_mip) {
+            uint64_t size = mip_level_size(tex->width, tex->height, tex->bytes_per_pixel, tex->resident_top - 1);
+            if (!make_room(residency, size, id, &writer)) {
+                tails_fit = false;
+                goto done;
+            }
+            if (!load_next_mip(residency, id, &writer)) { goto done; }
+        }
+    }
+
+    {
+        // Stream finer mips in rounds of one mip per texture, most recently used first and then biggest deficit, so
+        // every visible texture sharpens at the same pace.
+        std::vector<uint32_t>& streaming = residency->streaming;
+        streaming.clear();
+        for (uint32_t id = 0; id < (uint32_t)residency->textures.size(); id++) {
+            const ResidencyTexture* tex = &residency->textures[id];
+            if (tex->live && tex->wanted_top < tex->resident_top) { streaming.push_back(id); }
+        }
+        std::sort(streaming.begin(), streaming.end(), [residency](uint32_t a, uint32_t b) {
+            const ResidencyTexture* ta = &residency->textures[a];
+            const ResidencyTexture* tb = &residency->textures[b];
+            if (ta->last_used_frame != tb->last_used_frame) { return ta->last_used_frame > tb->last_used_frame; }
+            return ta->resident_top - ta->wanted_top > tb->resident_top - tb->wanted_top;
+        });
+
+        uint64_t uploaded = 0;
+        bool progress     = true;
+        while (progress) {
+            progress = false;
+            for (uint32_t id : streaming) {
+                ResidencyTexture* tex = &residency->textures[id];
+                if (tex->wanted_top >= tex->resident_top) { continue; }
+
+                uint64_t size = mip_level_size(tex->width, tex->height, tex->bytes_per_pixel, tex->resident_top - 1);
+                if (uploaded > 0 && uploaded + size > residency->desc.max_upload_bytes_per_frame) { goto done; }
+                if (!make_room(residency, size, id, &writer)) { continue; }
+                if (!load_next_mip(residency, id, &writer)) { goto done; }
+
+                uploaded += size;
+                progress = true;
+            }
+        }
+    }
+
+done:
+    if (!tails_fit || used_bytes(residency) > residency->desc.budget_bytes) { residency->over_budget_frames++; }
+    residency->frame++;
+    return writer.count;
+}
+
+void residency_get_metrics(const TextureResidency* residency, ResidencyMetrics* metrics)
+{
+    *metrics                      = {};
+    metrics->budget_bytes         = residency->desc.budget_bytes;
+    metrics->used_bytes           = used_bytes(residency);
+    metrics->texture_bytes        = residency->texture_bytes;
+    metrics->buffer_bytes         = residency->buffer_bytes;
+    metrics->resident_mips        = residency->resident_mips;
+    metrics->loads_last_frame     = residency->loads_last_frame;
+    metrics->evictions_last_frame = residency->evictions_last_frame;
+    metrics->total_loads          = residency->total_loads;
+    metrics->total_evictions      = residency->total_evictions;
+    metrics->over_budget_frames   = residency->over_budget_frames;
+
+    for (const ResidencyTexture& tex : residency->textures) {
+        if (!tex.live) { continue; }
+        metrics->textures++;
+        if (tex.wanted_top < tex.resident_top) { metrics->textures_waiting++; }
+    }
+    for (const ResidencyBuffer& buffer : residency->buffers) {
+        if (buffer.live) { metrics->buffers++; }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESIDENCY_INVALID_ID 0xFFFFFFFFu
+// Past the end of any mip chain, so a texture with this as GL_TEXTURE_BASE_LEVEL is incomplete rather than sampled.
+#define RESIDENCY_NO_MIP 1000u
+
+// Tracks every texture and buffer against a video memory budget and decides which texture mips should be resident.
+// The manager never touches GL itself: residency_update() hands back a list of ops (upload this mip, drop that mip)
+// which the platform layer applies, so the policy stays the same on every backend.
+//
+// The smallest mips of a texture (the "tail", everything no larger than tail_dimension) are loaded as soon as it is
+// registered so it can be drawn straight away. Finer mips are streamed in, coarse to fine, as draws ask for more
+// screen-space resolution. When a load would go over budget, the top mips of the least recently used textures are
+// evicted first. Tail mips and buffers are never evicted; when the tails alone do not fit, textures further down the
+// LRU wait for theirs instead. A texture that is not requested in a frame drops back to wanting only its tail.
+typedef struct TextureResidency TextureResidency;
+
+typedef struct ResidencyDesc {
+    uint64_t budget_bytes;               // 0 = 256 MiB
+    uint64_t max_upload_bytes_per_frame; // 0 = 16 MiB; at least one mip is always streamed per frame
+    uint32_t tail_dimension;             // 0 = 64 texels
+} ResidencyDesc;
+
+typedef enum ResidencyOpType {
+    RESIDENCY_OP_LOAD_MIP,
+    RESIDENCY_OP_EVICT_MIP,
+} ResidencyOpType;
+
+typedef struct ResidencyOp {
+    ResidencyOpType type;
+    uint32_t texture;
+    uint32_t mip;
+} ResidencyOp;
+
+typedef struct ResidencyMetrics {
+    uint64_t budget_bytes;
+    uint64_t used_bytes;
+    uint64_t texture_bytes;
+    uint64_t buffer_bytes;
+    uint32_t textures;
+    uint32_t buffers;
+    uint32_t resident_mips;
+    uint32_t textures_waiting;   // textures with fewer mips resident than requested
+    uint32_t loads_last_frame;
+    uint32_t evictions_last_frame;
+    uint64_t total_loads;
+    uint64_t total_evictions;
+    uint64_t over_budget_frames; // frames where the tail mips alone could not fit
+} ResidencyMetrics;
+
+TextureResidency* residency_create(const ResidencyDesc* desc);
+void residency_destroy(TextureResidency* residency);
+
+void residency_set_budget(TextureResidency* residency, uint64_t budget_bytes);
+
+uint32_t residency_register_texture(
+    TextureResidency* residency, uint32_t width, uint32_t height, uint32_t bytes_per_pixel, uint32_t mip_count);
+void residency_unregister_texture(TextureResidency* residency, uint32_t texture);
+
+uint32_t residency_register_buffer(TextureResidency* residency, uint64_t size);
+void residency_unregister_buffer(TextureResidency* residency, uint32_t buffer);
+
+// Ask for enough resolution to cover a screen_width x screen_height pixel area this frame. Also marks the texture
+// as used for LRU purposes.
+void residency_request_texture(
+    TextureResidency* residency, uint32_t texture, uint32_t screen_width, uint32_t screen_height);
+
+// Finest mip currently resident, or the mip count when nothing is resident yet. Use it as GL_TEXTURE_BASE_LEVEL. An id
+// that is not registered has nothing resident either, and returns RESIDENCY_NO_MIP.
+uint32_t residency_texture_top_mip(const TextureResidency* residency, uint32_t texture);
+
+// Plans this frame's loads and evictions and advances the frame counter. Returns the number of ops written; ops the
+// caller had no room for are planned again next frame.
+uint32_t residency_update(TextureResidency* residency, ResidencyOp* ops, uint32_t max_ops);
+
+void residency_get_metrics(const TextureResidency* residency, ResidencyMetrics* metrics);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,276 @@
+#include "tilemap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#define TILEMAP_DEFAULT_TILE_SIZE 16.0f
+#define TILEMAP_DEFAULT_CHUNK_SIZE 32u
+#define TILEMAP_DEFAULT_MAX_RESIDENT 256u
+
+// Vertices are 16 bit tile positions, and a chunk's quads are indexed with 16 bit indices.
+#define TILEMAP_MAX_EXTENT 65535u
+#define TILEMAP_MAX_CHUNK_SIZE 64u
+
+#define TILEMAP_NO_SLOT 0xFFFFFFFFu
+
+typedef struct TileRect {
+    uint16_t u0, v0, u1, v1;
+} TileRect;
+
+typedef struct TilemapChunk {
+    uint32_t slot;         // TILEMAP_NO_SLOT when it holds none
+    uint32_t tiles;        // non-empty tiles
+    uint32_t quads;        // in the slot's buffer, when built
+    uint64_t last_visible; // update it last overlapped the camera in
+    bool built;            // the slot's buffer holds the chunk's current tiles
+} TilemapChunk;
+
+typedef struct ChunkBuild {
+    uint32_t chunk;
+    uint32_t draw;
+    uint32_t quads;
+} ChunkBuild;
+
+struct Tilemap {
+    TilemapDesc desc;
+    uint32_t chunks_x;
+    uint32_t chunks_y;
+    std::vector<Tile> tiles;     // row major, the whole map
+    std::vector<TileRect> rects; // by tile, rects[0] unused
+    std::vector<TilemapChunk> chunks;
+    std::vector<uint32_t> slot_chunks; // by slot, TILEMAP_NO_SLOT when free
+    std::vector<uint32_t> free_slots;
+    std::vector<ChunkBuild> builds;   // this update's
+    std::vector<TileVertex> vertices; // chunk_size * chunk_size quads per build
+    uint64_t frame;
+    TilemapStats stats;
+};
+
+Tilemap* tilemap_create(const TilemapDesc* desc)
+{
+    if (!desc->width || !desc->height || desc->width > TILEMAP_MAX_EXTENT || desc->height > TILEMAP_MAX_EXTENT) {
+        return NULL;
+    }
+    if (!desc->atlas_columns || !desc->atlas_rows) { return NULL; }
+
+    Tilemap* map = new Tilemap();
+    map->desc    = *desc;
+    if (!(map->desc.tile_size > 0.0f)) { map->desc.tile_size = TILEMAP_DEFAULT_TILE_SIZE; }
+    if (!map->desc.chunk_size) { map->desc.chunk_size = TILEMAP_DEFAULT_CHUNK_SIZE; }
+    if (!map->desc.max_resident) { map->desc.max_resident = TILEMAP_DEFAULT_MAX_RESIDENT; }
+    map->desc.chunk_size = std::min(map->desc.chunk_size, TILEMAP_MAX_CHUNK_SIZE);
+
+    uint32_t chunk_size = map->desc.chunk_size;
+    map->chunks_x       = (desc->width + chunk_size - 1) / chunk_size;
+    map->chunks_y       = (desc->height + chunk_size - 1) / chunk_size;
+    map->tiles.assign((size_t)desc->width * desc->height, TILE_EMPTY);
+    map->chunks.assign((size_t)map->chunks_x * map->chunks_y, TilemapChunk { TILEMAP_NO_SLOT, 0, 0, 0, false });
+    map->slot_chunks.assign(map->desc.max_resident, TILEMAP_NO_SLOT);
+    for (uint32_t slot = map->desc.max_resident; slot > 0; slot--) {
+        map->free_slots.push_back(slot - 1);
+    }
+
+    // Tiles are sampled with nearest filtering, so UVs run right up to the tile's edges.
+    uint32_t tile_count = std::min(desc->atlas_columns * desc->atlas_rows, 65535u);
+    map->rects.resize(tile_count + 1);
+    for (uint32_t tile = 1; tile <= tile_count; tile++) {
+        uint32_t column  = (tile - 1) % desc->atlas_columns;
+        uint32_t row     = (tile - 1) / desc->atlas_columns;
+        map->rects[tile] = { (uint16_t)(column * 65535u / desc->atlas_columns),
+            (uint16_t)(row * 65535u / desc->atlas_rows), (uint16_t)((column + 1) * 65535u / desc->atlas_columns),
+            (uint16_t)((row + 1) * 65535u / desc->atlas_rows) };
+    }
+
+    map->frame        = 0;
+    map->stats        = {};
+    map->stats.chunks = (uint32_t)map->chunks.size();
+    return map;
+}
+
+void tilemap_destroy(Tilemap* map) { delete map; }
+
+static TilemapChunk* chunk_at(Tilemap* map, uint32_t x, uint32_t y)
+{
+    return &map->chunks[(size_t)(y / map->desc.chunk_size) * map->chunks_x + x / map->desc.chunk_size];
+}
+
+static void set_tile(Tilemap* map, uint32_t x, uint32_t y, Tile tile)
+{
+    Tile* cell = &map->tiles[(size_t)y * map->desc.width + x];
+    if (*cell == tile) { return; }
+
+    TilemapChunk* chunk = chunk_at(map, x, y);
+    chunk->tiles += (tile != TILE_EMPTY) - (*cell != TILE_EMPTY);
+    chunk->built = false;
+    *cell        = tile;
+    map->stats.tiles_changed++;
+}
+
+void tilemap_set(Tilemap* map, uint32_t x, uint32_t y, Tile tile)
+{
+    if (x < map->desc.width && y < map->desc.height) { set_tile(map, x, y, tile); }
+}
+
+Tile tilemap_get(const Tilemap* map, uint32_t x, uint32_t y)
+{
+    if (x >= map->desc.width || y >= map->desc.height) { return TILE_EMPTY; }
+    return map->tiles[(size_t)y * map->desc.width + x];
+}
+
+void tilemap_fill(Tilemap* map, uint32_t x, uint32_t y, uint32_t width, uint32_t height, Tile tile)
+{
+    if (x >= map->desc.width || y >= map->desc.height) { return; }
+    uint32_t x1 = x + std::min(width, map->desc.width - x);
+    uint32_t y1 = y + std::min(height, map->desc.height - y);
+    for (uint32_t row = y; row < y1; row++) {
+        for (uint32_t column = x; column < x1; column++) {
+            set_tile(map, column, row, tile);
+        }
+    }
+}
+
+// Takes a free slot, or the one of the chunk that has been out of view the longest. Chunks visible in this update keep
+// theirs, so this fails when they hold every slot.
+static uint32_t acquire_slot(Tilemap* map)
+{
+    if (!map->free_slots.empty()) {
+        uint32_t slot = map->free_slots.back();
+        map->free_slots.pop_back();
+        return slot;
+    }
+
+    uint32_t oldest = TILEMAP_NO_SLOT;
+    uint64_t seen   = map->frame;
+    for (uint32_t slot = 0; slot < map->desc.max_resident; slot++) {
+        const TilemapChunk* chunk = &map->chunks[map->slot_chunks[slot]];
+        if (chunk->last_visible < seen) {
+            oldest = slot;
+            seen   = chunk->last_visible;
+        }
+    }
+    if (oldest == TILEMAP_NO_SLOT) { return TILEMAP_NO_SLOT; }
+
+    TilemapChunk* evicted = &map->chunks[map->slot_chunks[oldest]];
+    evicted->slot         = TILEMAP_NO_SLOT;
+    evicted->built        = false;
+    map->stats.evictions++;
+    return oldest;
+}
+
+static void build_chunks(void* data, uint32_t begin, uint32_t end)
+{
+    Tilemap* map          = (Tilemap*)data;
+    uint32_t chunk_size   = map->desc.chunk_size;
+    uint32_t tile_count   = (uint32_t)map->rects.size() - 1;
+    size_t chunk_vertices = (size_t)chunk_size * chunk_size * 4;
+    for (uint32_t i = begin; i < end; i++) {
+        ChunkBuild* build = &map->builds[i];
+        uint32_t x0       = build->chunk % map->chunks_x * chunk_size;
+        uint32_t y0       = build->chunk / map->chunks_x * chunk_size;
+        uint32_t x1       = std::min(x0 + chunk_size, map->desc.width);
+        uint32_t y1       = std::min(y0 + chunk_size, map->desc.height);
+
+        TileVertex* out = map->vertices.data() + chunk_vertices * i;
+        TileVertex* v   = out;
+        for (uint32_t y = y0; y < y1; y++) {
+            const Tile* row = &map->tiles[(size_t)y * map->desc.width];
+            for (uint32_t x = x0; x < x1; x++) {
+                Tile tile = row[x];
+                if (tile == TILE_EMPTY || tile > tile_count) { continue; }
+                TileRect rect = map->rects[tile];
+                uint16_t left = (uint16_t)x, top = (uint16_t)y;
+                v[0]          = { left, top, rect.u0, rect.v0 };
+                v[1]          = { (uint16_t)(left + 1), top, rect.u1, rect.v0 };
+                v[2]          = { (uint16_t)(left + 1), (uint16_t)(top + 1), rect.u1, rect.v1 };
+                v[3]          = { left, (uint16_t)(top + 1), rect.u0, rect.v1 };
+                v += 4;
+            }
+        }
+        build->quads = (uint32_t)(v - out) / 4;
+    }
+}
+
+uint32_t tilemap_update(Tilemap* map, float camera_x, float camera_y, float camera_width, float camera_height,
+    TilemapDraw* draws, uint32_t max_draws)
+{
+    map->frame++;
+    map->builds.clear();
+    map->stats.visible = 0;
+    map->stats.drawn   = 0;
+    map->stats.rebuilt = 0;
+    map->stats.skipped = 0;
+
+    // Chunks touching the camera rect, clamped to the map.
+    float chunk_pixels = map->desc.tile_size * map->desc.chunk_size;
+    float left         = std::max(std::floor(camera_x / chunk_pixels), 0.0f);
+    float top          = std::max(std::floor(camera_y / chunk_pixels), 0.0f);
+    float right        = std::min(std::ceil((camera_x + camera_width) / chunk_pixels), (float)map->chunks_x);
+    float bottom       = std::min(std::ceil((camera_y + camera_height) / chunk_pixels), (float)map->chunks_y);
+    if (!(left < right && top < bottom)) { return 0; }
+    uint32_t x0 = (uint32_t)left, x1 = (uint32_t)right;
+    uint32_t y0 = (uint32_t)top, y1 = (uint32_t)bottom;
+
+    // Marked first, so none of them is picked for eviction while the others look for slots.
+    for (uint32_t y = y0; y < y1; y++) {
+        for (uint32_t x = x0; x < x1; x++) {
+            map->chunks[(size_t)y * map->chunks_x + x].last_visible = map->frame;
+        }
+    }
+    map->stats.visible = (x1 - x0) * (y1 - y0);
+
+    uint32_t draw_count = 0;
+    for (uint32_t y = y0; y < y1; y++) {
+        for (uint32_t x = x0; x < x1; x++) {
+            uint32_t index      = y * map->chunks_x + x;
+            TilemapChunk* chunk = &map->chunks[index];
+            if (!chunk->tiles) { continue; }
+            if (draw_count == max_draws) {
+                map->stats.skipped++;
+                continue;
+            }
+            if (chunk->slot == TILEMAP_NO_SLOT) {
+                chunk->slot = acquire_slot(map);
+                if (chunk->slot == TILEMAP_NO_SLOT) {
+                    map->stats.skipped++;
+                    continue;
+                }
+                map->slot_chunks[chunk->slot] = index;
+                chunk->built                  = false;
+            }
+            if (!chunk->built) { map->builds.push_back({ index, draw_count, 0 }); }
+            draws[draw_count++] = { chunk->slot, chunk->quads, NULL };
+        }
+    }
+
+    // Each chunk is built into its own stretch of vertices, so they can all be built at once.
+    uint32_t build_count  = (uint32_t)map->builds.size();
+    size_t chunk_vertices = (size_t)map->desc.chunk_size * map->desc.chunk_size * 4;
+    if (map->vertices.size() < chunk_vertices * build_count) { map->vertices.resize(chunk_vertices * build_count); }
+    job_pool_parallel_for(map->desc.jobs, build_count, 1, build_chunks, map);
+
+    for (uint32_t i = 0; i < build_count; i++) {
+        const ChunkBuild* build = &map->builds[i];
+        TilemapChunk* chunk     = &map->chunks[build->chunk];
+        chunk->quads            = build->quads;
+        chunk->built            = true;
+        draws[build->draw]      = { chunk->slot, build->quads, map->vertices.data() + chunk_vertices * i };
+    }
+    map->stats.rebuilt = build_count;
+    map->stats.total_rebuilt += build_count;
+
+    // Chunks whose only tiles are past the end of the tileset have nothing to draw.
+    uint32_t drawn = 0;
+    for (uint32_t i = 0; i < draw_count; i++) {
+        if (draws[i].quad_count) { draws[drawn++] = draws[i]; }
+    }
+    map->stats.drawn = drawn;
+    return drawn;
+}
+
+TilemapStats tilemap_stats(const Tilemap* map)
+{
+    TilemapStats stats = map->stats;
+    stats.resident     = map->desc.max_resident - (uint32_t)map->free_slots.size();
+    return stats;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "job_pool.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A large 2D grid of tiles, drawn from a tileset laid out as a grid of equally sized tiles in one texture.
+//
+// The map is split into square chunks, and the quads of each chunk are baked once into a vertex buffer of its own that
+// is drawn as it is until one of its tiles changes. tilemap_update() is given the camera rect each frame. It only
+// returns the chunks that overlap it, and only rebuilds the ones among them whose tiles changed since they were last
+// built, all on the job pool at once. Changed chunks out of view are left alone until they come into view.
+//
+// Only a bounded number of chunks keep a vertex buffer. Each one that does is given a slot, 0 to max_resident - 1,
+// which the platform layer maps to a GL buffer. When every slot is taken the chunk that has been out of view the
+// longest gives its slot up, and is rebuilt when it next comes into view. The tilemap never touches GL itself.
+typedef struct Tilemap Tilemap;
+
+typedef struct TilemapDesc {
+    JobPool* jobs;          // NULL builds chunks on the calling thread
+    uint32_t width;         // in tiles, up to 65535
+    uint32_t height;        // in tiles, up to 65535
+    float tile_size;        // 0 = 16; pixels along each side of a tile
+    uint32_t chunk_size;    // 0 = 32; tiles along each side of a chunk, up to 64
+    uint32_t max_resident;  // 0 = 256; chunks holding a vertex buffer at once
+    uint32_t atlas_columns; // tiles across the tileset texture
+    uint32_t atlas_rows;    // tiles down the tileset texture
+} TilemapDesc;
+
+// Tile 0 is empty and drawn as nothing. Tile n is the nth tile of the tileset, counting left to right from the top
+// left starting at 1. Tiles past the end of the tileset are drawn as nothing too.
+typedef uint16_t Tile;
+
+#define TILE_EMPTY 0
+
+// Four per non-empty tile, in the order top left, top right, bottom right, bottom left, for two triangles of indices
+// 0, 1, 2 and 2, 3, 0. Positions are in tiles from the top left of the map, UVs are normalized to 0-65535 with v
+// going down the texture. 8 bytes, so a chunk of 32 x 32 tiles is at most 32 KiB.
+typedef struct TileVertex {
+    uint16_t x, y;
+    uint16_t u, v;
+} TileVertex;
+
+// A chunk overlapping the camera with at least one tile in it. When it was rebuilt by this update, `vertices` holds
+// its new quads, valid until the next update, and they have to be uploaded into the slot's buffer before drawing it.
+typedef struct TilemapDraw {
+    uint32_t slot;
+    uint32_t quad_count;
+    const TileVertex* vertices; // NULL when the slot's buffer already holds this chunk
+} TilemapDraw;
+
+typedef struct TilemapStats {
+    uint32_t chunks;   // in the whole map
+    uint32_t resident; // chunks holding a slot
+    uint32_t visible;  // chunks overlapping the camera in the last update, empty ones included
+    uint32_t drawn;    // draws returned by the last update
+    uint32_t rebuilt;  // chunks built by the last update
+    uint32_t skipped;  // visible chunks in the last update that found every slot in use by another visible chunk
+    uint64_t total_rebuilt;
+    uint64_t evictions;
+    uint64_t tiles_changed;
+} TilemapStats;
+
+// Returns NULL if the map or the tileset is empty, or larger than 65535 tiles across. Every tile starts empty.
+Tilemap* tilemap_create(const TilemapDesc* desc);
+void tilemap_destroy(Tilemap* map);
+
+// Tiles outside the map are ignored on set and read as TILE_EMPTY.
+void tilemap_set(Tilemap* map, uint32_t x, uint32_t y, Tile tile);
+Tile tilemap_get(const Tilemap* map, uint32_t x, uint32_t y);
+
+// Sets every tile in the rect, clipped to the map.
+void tilemap_fill(Tilemap* map, uint32_t x, uint32_t y, uint32_t width, uint32_t height, Tile tile);
+
+// Rebuilds the changed chunks overlapping the camera rect, given in pixels from the top left of the map, and writes a
+// draw for each chunk overlapping it that has tiles, up to max_draws; chunks past that are neither drawn nor rebuilt.
+// Returns how many draws it wrote. Call once per frame.
+uint32_t tilemap_update(Tilemap* map, float camera_x, float camera_y, float camera_width, float camera_height,
+    TilemapDraw* draws, uint32_t max_draws);
+
+TilemapStats tilemap_stats(const Tilemap* map);
+
+#ifdef __cplusplus
+}
+#endif
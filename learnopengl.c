@@ -2,24 +2,49 @@
 /* and https://riptutorial.com/opengl/example/5305/manual-opengl-setup-on-windows */
 
 #include <windows.h>
+#include <windowsx.h>
 
 #include <GL/glcorearb.h>
 #include <GL/wglext.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 
+#include "asset_pack.h"
+#include "dynamic_resolution.h"
+#include "gl_capture.h"
+#include "glyph_cache.h"
+#include "hot_reload.h"
+#include "image_decode.h"
+#include "input_queue.h"
+#include "job_pool.h"
+#include "mip_chain.h"
+#include "particle_system.h"
+#include "resource_manager.h"
+#include "shaders.h"
+#include "text_renderer.h"
+#include "texture_residency.h"
+#include "tilemap.h"
+
+#include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 PFNWGLGETEXTENSIONSSTRINGARBPROC wglGetExtensionsStringARB;
 PFNWGLCHOOSEPIXELFORMATARBPROC wglChoosePixelFormatARB;
 PFNWGLCREATECONTEXTATTRIBSARBPROC wglCreateContextAttribsARB;
 PFNGLATTACHSHADERPROC glAttachShader;
+PFNGLBEGINQUERYPROC glBeginQuery;
 PFNGLBINDBUFFERPROC glBindBuffer;
+PFNGLBINDFRAMEBUFFERPROC glBindFramebuffer;
+PFNGLBINDRENDERBUFFERPROC glBindRenderbuffer;
 PFNGLBINDTEXTUREPROC glBindTexture;
 PFNGLBINDVERTEXARRAYPROC glBindVertexArray;
+PFNGLBLENDFUNCPROC glBlendFunc;
+PFNGLBLITFRAMEBUFFERPROC glBlitFramebuffer;
 PFNGLBUFFERDATAPROC glBufferData;
+PFNGLBUFFERSUBDATAPROC glBufferSubData;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC glCheckFramebufferStatus;
 PFNGLCLEARPROC glClear;
 PFNGLCLEARCOLORPROC glClearColor;
 PFNGLCOMPILESHADERPROC glCompileShader;
@@ -27,30 +52,54 @@ PFNGLCREATEPROGRAMPROC glCreateProgram;
 PFNGLCREATESHADERPROC glCreateShader;
 PFNGLDEBUGMESSAGECALLBACKPROC glDebugMessageCallback;
 PFNGLDELETEBUFFERSPROC glDeleteBuffers;
+PFNGLDELETEFRAMEBUFFERSPROC glDeleteFramebuffers;
 PFNGLDELETEPROGRAMPROC glDeleteProgram;
+PFNGLDELETEQUERIESPROC glDeleteQueries;
+PFNGLDELETERENDERBUFFERSPROC glDeleteRenderbuffers;
 PFNGLDELETESHADERPROC glDeleteShader;
+PFNGLDELETETEXTURESPROC glDeleteTextures;
 PFNGLDELETEVERTEXARRAYSPROC glDeleteVertexArrays;
+PFNGLDISABLEPROC glDisable;
 PFNGLDRAWARRAYSPROC glDrawArrays;
+PFNGLDRAWARRAYSINSTANCEDPROC glDrawArraysInstanced;
 PFNGLDRAWELEMENTSPROC glDrawElements;
 PFNGLENABLEPROC glEnable;
 PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArray;
+PFNGLENDQUERYPROC glEndQuery;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC glFramebufferRenderbuffer;
+PFNGLFRAMEBUFFERTEXTURE2DPROC glFramebufferTexture2D;
 PFNGLGENERATEMIPMAPPROC glGenerateMipmap;
 PFNGLGENBUFFERSPROC glGenBuffers;
+PFNGLGENFRAMEBUFFERSPROC glGenFramebuffers;
+PFNGLGENQUERIESPROC glGenQueries;
+PFNGLGENRENDERBUFFERSPROC glGenRenderbuffers;
 PFNGLGENTEXTURESPROC glGenTextures;
 PFNGLGENVERTEXARRAYSPROC glGenVertexArrays;
 PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
 PFNGLGETPROGRAMIVPROC glGetProgramiv;
+PFNGLGETQUERYOBJECTIVPROC glGetQueryObjectiv;
+PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v;
 PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog;
+PFNGLGETINTEGERVPROC glGetIntegerv;
 PFNGLGETSHADERIVPROC glGetShaderiv;
 PFNGLGETSTRINGPROC glGetString;
+PFNGLGETSTRINGIPROC glGetStringi;
 PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
 PFNGLLINKPROGRAMPROC glLinkProgram;
+PFNGLMAPBUFFERRANGEPROC glMapBufferRange;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+PFNGLPIXELSTOREIPROC glPixelStorei;
+PFNGLRENDERBUFFERSTORAGEPROC glRenderbufferStorage;
 PFNGLSHADERSOURCEPROC glShaderSource;
 PFNGLTEXIMAGE2DPROC glTexImage2D;
 PFNGLTEXPARAMETERIPROC glTexParameteri;
+PFNGLTEXSUBIMAGE2DPROC glTexSubImage2D;
 PFNGLUNIFORM1FPROC glUniform1f;
 PFNGLUNIFORM1IPROC glUniform1i;
+PFNGLUNIFORM2FPROC glUniform2f;
+PFNGLUNMAPBUFFERPROC glUnmapBuffer;
 PFNGLUSEPROGRAMPROC glUseProgram;
+PFNGLVERTEXATTRIBDIVISORPROC glVertexAttribDivisor;
 PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer;
 PFNGLVIEWPORTPROC glViewport;
 
@@ -100,7 +149,7 @@ void shader_create(const char* v, const char* f, Shader* shader)
 
     program = glCreateProgram();
     if (program == 0) {
-        shader = 0;
+        shader->id = 0;
         return;
     }
 
@@ -121,7 +170,7 @@ void shader_create(const char* v, const char* f, Shader* shader)
             free(info_log);
         }
         glDeleteProgram(program);
-        shader = 0;
+        shader->id = 0;
         return;
     }
 
@@ -148,6 +197,940 @@ void shader_set_float(Shader* shader, const char* name, float value)
     glUniform1f(glGetUniformLocation(shader->id, name), value);
 }
 
+void shader_set_vec2(Shader* shader, const char* name, float x, float y)
+{
+    glUniform2f(glGetUniformLocation(shader->id, name), x, y);
+}
+
+static bool has_gl_extension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) { return true; }
+    }
+    return false;
+}
+
+// A program that can be rebuilt from reloaded sources while the current one keeps drawing.
+typedef struct ReloadableProgram {
+    HotSwapSlot slot;
+    ProgramHandle handle;   // follows slot.active
+    const char* sources[2]; // vertex, fragment
+    char* owned[2];         // sources that came from a reload
+    uint32_t assets[2];
+    bool parallel_compile;
+} ReloadableProgram;
+
+// Issues the compile and link without asking for any status back, so with KHR_parallel_shader_compile the driver
+// builds the program on its own threads and this returns straight away.
+static GLuint program_build_begin(const char* v, const char* f)
+{
+    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader, 1, &v, NULL);
+    glCompileShader(vertex_shader);
+
+    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader, 1, &f, NULL);
+    glCompileShader(fragment_shader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+
+    // Only flagged for deletion while attached; they go away with the program.
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    return program;
+}
+
+static bool program_build_done(GLuint program, bool parallel_compile)
+{
+    if (!parallel_compile) { return true; }
+    GLint done = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+static bool program_build_succeeded(GLuint program)
+{
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char info_log[1024];
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        non_fatal_error("Reloaded shader failed to build, keeping the old one:\n");
+        non_fatal_error(info_log);
+    }
+    return linked;
+}
+
+static void reloadable_program_update(ReloadableProgram* program, HotReloadResult* result)
+{
+    uint32_t stage = result->asset == program->assets[0] ? 0 : 1;
+    free(program->owned[stage]);
+    program->owned[stage]   = result->source;
+    program->sources[stage] = result->source;
+    result->source          = NULL;
+
+    GLuint superseded = hot_swap_begin(&program->slot, program_build_begin(program->sources[0], program->sources[1]));
+    if (superseded) { glDeleteProgram(superseded); }
+}
+
+// Promotes the rebuilt program once the driver is done with it. Call at the start of a frame. The program it replaces
+// may still be in use by frames in flight, so the resource manager holds on to it until they are done.
+static void reloadable_program_swap(ReloadableProgram* program, ResourceManager* resources)
+{
+    if (!program->slot.pending || !program_build_done(program->slot.pending, program->parallel_compile)) { return; }
+
+    bool built     = program_build_succeeded(program->slot.pending);
+    GLuint retired = hot_swap_finish(&program->slot, built);
+    if (built) {
+        resource_replace_program(resources, program->handle, program->slot.active, 0, NULL);
+    } else if (retired) {
+        glDeleteProgram(retired);
+    }
+}
+
+typedef struct StreamedTexture {
+    GLuint id;
+    GLenum format;
+    uint32_t residency_id;
+    MipChain mips;
+} StreamedTexture;
+
+// Takes ownership of the mip chain.
+static bool streamed_texture_create(TextureResidency* residency, MipChain* mips, StreamedTexture* texture)
+{
+    if (mips->channels != 3 && mips->channels != 4) { return false; }
+
+    texture->mips = *mips;
+    memset(mips, 0, sizeof(*mips));
+
+    const MipLevel* top   = &texture->mips.levels[0];
+    texture->format       = texture->mips.channels == 4 ? GL_RGBA : GL_RGB;
+    texture->residency_id = residency_register_texture(
+        residency, top->width, top->height, texture->mips.channels, texture->mips.level_count);
+
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->mips.level_count - 1);
+
+    return true;
+}
+
+// Uploads or releases the mip levels the residency manager asked for, then clamps the base level to the finest mip
+// that is actually resident so the texture stays complete while it streams.
+static void apply_residency_ops(
+    TextureResidency* residency, const ResidencyOp* ops, uint32_t op_count, StreamedTexture* textures, uint32_t count)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (uint32_t i = 0; i < op_count; i++) {
+        StreamedTexture* texture = NULL;
+        for (uint32_t j = 0; j < count; j++) {
+            if (textures[j].residency_id == ops[i].texture) { texture = &textures[j]; }
+        }
+        if (!texture) { continue; }
+
+        const MipLevel* level = &texture->mips.levels[ops[i].mip];
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+        if (ops[i].type == RESIDENCY_OP_LOAD_MIP) {
+            glTexImage2D(GL_TEXTURE_2D, ops[i].mip, texture->format, level->width, level->height, 0, texture->format,
+                GL_UNSIGNED_BYTE, level->pixels);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, ops[i].mip, texture->format, 0, 0, 0, texture->format, GL_UNSIGNED_BYTE, NULL);
+        }
+        glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residency_texture_top_mip(residency, texture->residency_id));
+    }
+}
+
+static void streamed_texture_destroy(TextureResidency* residency, StreamedTexture* texture)
+{
+    residency_unregister_texture(residency, texture->residency_id);
+    glDeleteTextures(1, &texture->id);
+    mip_chain_free(&texture->mips);
+    texture->id           = 0;
+    texture->residency_id = RESIDENCY_INVALID_ID;
+}
+
+// The whole mip chain kept on the CPU, which is what the resource manager accounts a texture by. The GPU holds only the
+// mips residency has loaded.
+static uint64_t streamed_texture_bytes(const StreamedTexture* texture)
+{
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < texture->mips.level_count; i++) {
+        bytes += texture->mips.levels[i].size;
+    }
+    return bytes;
+}
+
+// Packs are looked for next to the executable, so they are found whatever the working directory.
+static AssetPack* open_asset_pack(const char* name)
+{
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) { return NULL; }
+
+    char* slash      = strrchr(path, '\\');
+    size_t directory = slash ? (size_t)(slash - path) + 1 : 0;
+    if (directory + strlen(name) >= MAX_PATH) { return NULL; }
+    strcpy(path + directory, name);
+    return asset_pack_open(path);
+}
+
+// Decodes an image from the pack if it has it, straight out of the mapping when it is stored raw, and from the loose
+// file otherwise. JPEGs with restart markers decode in parallel on the job pool.
+static unsigned char* load_image(
+    AssetPack* pack, JobPool* jobs, const char* path, int* width, int* height, int* channels)
+{
+    uint32_t entry = pack ? asset_pack_find(pack, path) : ASSET_PACK_NOT_FOUND;
+    if (entry == ASSET_PACK_NOT_FOUND) { return image_load(path, width, height, channels, 0); }
+
+    AssetPackEntry info = asset_pack_entry(pack, entry);
+    const void* bytes   = asset_pack_view(pack, entry);
+    void* buffer        = NULL;
+    if (!bytes) {
+        buffer = malloc((size_t)info.size);
+        if (buffer && asset_pack_read(pack, entry, buffer, info.size)) { bytes = buffer; }
+    }
+
+    ImageDecodeDesc desc     = { 0 };
+    desc.jobs                = jobs;
+    ImageDecodeResult result = { 0 };
+    bool ok                  = bytes && image_decode(bytes, (size_t)info.size, &desc, &result);
+    free(buffer);
+    if (!ok) { return NULL; }
+    *width    = (int)result.width;
+    *height   = (int)result.height;
+    *channels = (int)result.channels;
+    return result.pixels;
+}
+
+// Textures are loaded once however many places ask for them, keyed by path. The StreamedTexture is the resource's
+// data, freed along with it.
+static TextureHandle texture_load(
+    ResourceManager* resources, TextureResidency* residency, AssetPack* pack, JobPool* jobs, const char* path)
+{
+    TextureHandle handle = { resource_find(resources, RESOURCE_TEXTURE, resource_path_key(path)) };
+    if (handle.id) { return handle; }
+
+    int width, height, channels;
+    unsigned char* data      = load_image(pack, jobs, path, &width, &height, &channels);
+    StreamedTexture* texture = (StreamedTexture*)calloc(1, sizeof(StreamedTexture));
+    MipChain mips            = { 0 };
+    bool loaded              = data && mip_chain_build(data, width, height, channels, &mips)
+        && streamed_texture_create(residency, &mips, texture);
+    image_free(data);
+    if (!loaded) {
+        mip_chain_free(&mips);
+        free(texture);
+        return handle;
+    }
+
+    return resource_add_texture(
+        resources, texture->id, streamed_texture_bytes(texture), resource_path_key(path), texture);
+}
+
+// Deletes the objects the resource manager says the GPU is done with.
+static void destroy_resources(TextureResidency* residency, const ResourceDestroy* destroys, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        switch (destroys[i].type) {
+        case RESOURCE_TEXTURE:
+            if (destroys[i].data) {
+                streamed_texture_destroy(residency, (StreamedTexture*)destroys[i].data);
+                free(destroys[i].data);
+            } else {
+                glDeleteTextures(1, &destroys[i].object);
+            }
+            break;
+        case RESOURCE_BUFFER:
+            glDeleteBuffers(1, &destroys[i].object);
+            break;
+        case RESOURCE_VERTEX_ARRAY:
+            glDeleteVertexArrays(1, &destroys[i].object);
+            break;
+        case RESOURCE_PROGRAM:
+            glDeleteProgram(destroys[i].object);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void log_residency_metrics(const TextureResidency* residency)
+{
+    ResidencyMetrics metrics;
+    residency_get_metrics(residency, &metrics);
+    if (metrics.loads_last_frame == 0 && metrics.evictions_last_frame == 0) { return; }
+
+    char buff[256];
+    sprintf(buff, "Residency: %llu/%llu KiB used, %u mips resident, %u loaded, %u evicted, %u textures waiting\n",
+        (unsigned long long)(metrics.used_bytes / 1024), (unsigned long long)(metrics.budget_bytes / 1024),
+        metrics.resident_mips, metrics.loads_last_frame, metrics.evictions_last_frame, metrics.textures_waiting);
+    non_fatal_error(buff);
+}
+
+// The scene is drawn into the bottom left corner of an offscreen target the size of the window, at whatever scale the
+// dynamic resolution controller picked, and then stretched over the backbuffer. Changing the scale only changes the
+// viewport; the target itself is reallocated only when the window size changes.
+typedef struct RenderTarget {
+    GLuint framebuffer;
+    GLuint color;
+    GLuint depth_stencil;
+    TextureHandle color_handle; // owns color
+    uint32_t residency_id;      // color and depth stencil, against the video memory budget
+    int32_t width;
+    int32_t height;
+} RenderTarget;
+
+// A resize makes a new color texture and retires the old one, which frames in flight may still be drawing into.
+static bool render_target_resize(
+    RenderTarget* target, int32_t width, int32_t height, ResourceManager* resources, TextureResidency* residency)
+{
+    if (!target->framebuffer) {
+        glGenFramebuffers(1, &target->framebuffer);
+        glGenRenderbuffers(1, &target->depth_stencil);
+    }
+    target->width  = width;
+    target->height = height;
+
+    // RGBA8 color and a D24S8 depth stencil, four bytes a pixel each.
+    uint64_t color_bytes = (uint64_t)width * height * 4;
+    glGenTextures(1, &target->color);
+    if (target->color_handle.id) {
+        resource_replace_texture(resources, target->color_handle, target->color, color_bytes, NULL);
+        residency_unregister_buffer(residency, target->residency_id);
+    } else {
+        target->color_handle = resource_add_texture(resources, target->color, color_bytes, 0, NULL);
+    }
+    target->residency_id = residency_register_buffer(residency, color_bytes * 2);
+
+    glBindTexture(GL_TEXTURE_2D, target->color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, target->depth_stencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target->depth_stencil);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return complete;
+}
+
+static void render_target_destroy(RenderTarget* target, ResourceManager* resources, TextureResidency* residency)
+{
+    glDeleteFramebuffers(1, &target->framebuffer);
+    glDeleteRenderbuffers(1, &target->depth_stencil);
+    resource_release_texture(resources, target->color_handle);
+    residency_unregister_buffer(residency, target->residency_id);
+    memset(target, 0, sizeof(*target));
+}
+
+// Upscales the scaled_width x scaled_height corner that was drawn this frame to the whole backbuffer.
+static void render_target_present(const RenderTarget* target, int32_t scaled_width, int32_t scaled_height)
+{
+    GLenum filter = scaled_width == target->width && scaled_height == target->height ? GL_NEAREST : GL_LINEAR;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(
+        0, 0, scaled_width, scaled_height, 0, 0, target->width, target->height, GL_COLOR_BUFFER_BIT, filter);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+#define GPU_TIMER_QUERIES 4
+
+// Time elapsed queries only have a result a frame or two after they were issued, so keep a few in flight and read
+// them back once they are available rather than stalling on the latest one.
+typedef struct GpuTimer {
+    GLuint queries[GPU_TIMER_QUERIES];
+    uint32_t next;    // query to issue next
+    uint32_t pending; // issued and not read back yet
+    bool timing;      // a query is open for this frame
+} GpuTimer;
+
+static void gpu_timer_begin(GpuTimer* timer)
+{
+    // Every query is still in flight; let this frame go untimed.
+    timer->timing = timer->pending < GPU_TIMER_QUERIES;
+    if (timer->timing) { glBeginQuery(GL_TIME_ELAPSED, timer->queries[timer->next]); }
+}
+
+static void gpu_timer_end(GpuTimer* timer)
+{
+    if (!timer->timing) { return; }
+    glEndQuery(GL_TIME_ELAPSED);
+    timer->next = (timer->next + 1) % GPU_TIMER_QUERIES;
+    timer->pending++;
+}
+
+static bool gpu_timer_read(GpuTimer* timer, float* ms)
+{
+    if (!timer->pending) { return false; }
+
+    GLuint query    = timer->queries[(timer->next + GPU_TIMER_QUERIES - timer->pending) % GPU_TIMER_QUERIES];
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) { return false; }
+
+    GLuint64 ns;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    timer->pending--;
+    *ms = (float)((double)ns / 1000000.0);
+    return true;
+}
+
+// Latency is measured up to SwapBuffers returning; the frame reaches the display up to a refresh later.
+static void log_input_latency(const InputLatency* latency, const InputQueue* input)
+{
+    if (latency->frames % INPUT_LATENCY_HISTORY != 0) { return; }
+
+    InputLatencyStats stats = input_latency_stats(latency);
+    InputQueueStats queue   = input_queue_stats(input);
+    char msg[256];
+    snprintf(msg, sizeof(msg),
+        "input: latency mean %.2fms p95 %.2fms max %.2fms, %llu events -> %llu after coalescing, %llu dropped\n",
+        stats.mean_ms, stats.p95_ms, stats.max_ms, (unsigned long long)queue.pushed,
+        (unsigned long long)queue.published, (unsigned long long)queue.dropped);
+    non_fatal_error(msg);
+}
+
+// Rasterizes glyphs for the glyph cache with GDI. This runs on the job pool's threads and GDI objects must not be
+// shared between them, so every call makes its own DC and font; it only happens the first time a glyph is used.
+static bool gdi_rasterize_glyph(void* user, uint32_t codepoint, uint32_t pixel_size, GlyphBitmap* bitmap)
+{
+    // GetGlyphOutlineW takes a UTF-16 code unit.
+    if (codepoint > 0xFFFF) { return false; }
+
+    HDC dc           = CreateCompatibleDC(NULL);
+    HFONT font       = CreateFontA(-(int)pixel_size, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+        OUT_TT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, (const char*)user);
+    HGDIOBJ previous = SelectObject(dc, font);
+
+    MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+    GLYPHMETRICS metrics;
+    DWORD size = GetGlyphOutlineW(dc, codepoint, GGO_GRAY8_BITMAP, &metrics, 0, NULL, &identity);
+    bool ok    = size != GDI_ERROR;
+    if (ok) { bitmap->advance = (float)metrics.gmCellIncX; }
+    if (ok && size > 0) {
+        // 65 levels of grey, rows padded to four bytes.
+        uint8_t* grey = (uint8_t*)malloc(size);
+        GetGlyphOutlineW(dc, codepoint, GGO_GRAY8_BITMAP, &metrics, size, grey, &identity);
+
+        uint32_t pitch   = (metrics.gmBlackBoxX + 3) & ~3u;
+        bitmap->width    = metrics.gmBlackBoxX;
+        bitmap->height   = metrics.gmBlackBoxY;
+        bitmap->left     = (float)metrics.gmptGlyphOrigin.x;
+        bitmap->top      = (float)metrics.gmptGlyphOrigin.y;
+        bitmap->coverage = (uint8_t*)malloc((size_t)bitmap->width * bitmap->height);
+        for (uint32_t y = 0; y < bitmap->height; y++) {
+            for (uint32_t x = 0; x < bitmap->width; x++) {
+                bitmap->coverage[y * bitmap->width + x] = (uint8_t)(grey[y * pitch + x] * 255 / 64);
+            }
+        }
+        free(grey);
+    }
+
+    SelectObject(dc, previous);
+    DeleteObject(font);
+    DeleteDC(dc);
+    return ok;
+}
+
+#define TEXT_MAX_GLYPHS 4096
+#define GLYPH_UPLOADS_PER_FRAME 64
+
+// GL side of the text renderer: the glyph atlas texture and one vertex buffer that is refilled every frame with the
+// quads of all the text drawn in it.
+typedef struct TextPass {
+    Shader shader;
+    GLuint atlas;
+    GLuint vao;
+    GLuint vbo;
+    TextureHandle atlas_handle;
+    BufferHandle vbo_handle;
+    uint32_t atlas_residency;
+    uint32_t vbo_residency;
+} TextPass;
+
+static void text_pass_create(
+    TextPass* pass, const GlyphCache* glyphs, ResourceManager* resources, TextureResidency* residency)
+{
+    const ShaderVariant* v_shader = shader_variant(&text_vert, 0);
+    const ShaderVariant* f_shader = shader_variant(&text_frag, 0);
+    if (!v_shader || !f_shader) { fatal_error("Shader variant was pruned from the build."); }
+    shader_create(v_shader->source, f_shader->source, &pass->shader);
+    if (!pass->shader.id) { fatal_error("Failed to build the text shader."); }
+
+    // Cleared, so slots that have not been filled yet read as far outside any glyph.
+    uint32_t width, height;
+    glyph_cache_atlas_size(glyphs, &width, &height);
+    uint8_t* zeros = (uint8_t*)calloc((size_t)width * height, 1);
+    glGenTextures(1, &pass->atlas);
+    glBindTexture(GL_TEXTURE_2D, pass->atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, zeros);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    free(zeros);
+
+    // The atlas is filled in place and never evicted, so residency only counts it against the budget.
+    uint64_t atlas_bytes  = (uint64_t)width * height;
+    uint64_t vbo_bytes    = TEXT_MAX_GLYPHS * 6 * sizeof(TextVertex);
+    pass->atlas_handle    = resource_add_texture(resources, pass->atlas, atlas_bytes, 0, NULL);
+    pass->atlas_residency = residency_register_buffer(residency, atlas_bytes);
+
+    glGenVertexArrays(1, &pass->vao);
+    glGenBuffers(1, &pass->vbo);
+    glBindVertexArray(pass->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pass->vbo);
+    glBufferData(GL_ARRAY_BUFFER, vbo_bytes, NULL, GL_STREAM_DRAW);
+    pass->vbo_handle    = resource_add_buffer(resources, pass->vbo, vbo_bytes, 0, NULL);
+    pass->vbo_residency = residency_register_buffer(residency, vbo_bytes);
+
+    // position attribute
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, x));
+    glEnableVertexAttribArray(0);
+    // texture coord attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, u));
+    glEnableVertexAttribArray(1);
+    // color attribute
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)offsetof(TextVertex, color));
+    glEnableVertexAttribArray(2);
+}
+
+static void text_pass_upload(TextPass* pass, const GlyphUpload* uploads, uint32_t count)
+{
+    if (!count) { return; }
+
+    glBindTexture(GL_TEXTURE_2D, pass->atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < count; i++) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, uploads[i].x, uploads[i].y, uploads[i].width, uploads[i].height, GL_RED,
+            GL_UNSIGNED_BYTE, uploads[i].pixels);
+    }
+}
+
+// Draws all the text queued this frame in one draw call, blended over whatever is bound.
+static void text_pass_draw(TextPass* pass, const TextRenderer* text, int32_t width, int32_t height)
+{
+    uint32_t vertex_count;
+    const TextVertex* vertices = text_renderer_vertices(text, &vertex_count);
+    if (!vertex_count) { return; }
+
+    // Orphan last frame's storage so the upload does not wait for the GPU to finish drawing from it.
+    glBindBuffer(GL_ARRAY_BUFFER, pass->vbo);
+    glBufferData(GL_ARRAY_BUFFER, TEXT_MAX_GLYPHS * 6 * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * sizeof(TextVertex), vertices);
+
+    glViewport(0, 0, width, height);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    shader_use(&pass->shader);
+    shader_set_vec2(&pass->shader, "screenSize", (float)width, (float)height);
+    glBindTexture(GL_TEXTURE_2D, pass->atlas);
+    glBindVertexArray(pass->vao);
+    glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+    glDisable(GL_BLEND);
+}
+
+static void text_pass_destroy(TextPass* pass, ResourceManager* resources, TextureResidency* residency)
+{
+    glDeleteVertexArrays(1, &pass->vao);
+    resource_release_buffer(resources, pass->vbo_handle);
+    resource_release_texture(resources, pass->atlas_handle);
+    residency_unregister_buffer(residency, pass->vbo_residency);
+    residency_unregister_buffer(residency, pass->atlas_residency);
+    glDeleteProgram(pass->shader.id);
+    memset(pass, 0, sizeof(*pass));
+}
+
+#define PARTICLE_MAX_DRAWS 8
+#define FOUNTAIN_PARTICLES 60000
+#define SPARK_PARTICLES 20000
+#define SPARK_BURST 2000
+
+// GL side of the particle system: one stream buffer that the particle system writes every live particle into through
+// a mapping, and one instanced draw per emitter with the instance attributes pointed at that emitter's particles.
+typedef struct ParticlePass {
+    Shader shader;
+    GLuint vao;
+    GLuint vbo;
+    BufferHandle vbo_handle;
+    uint32_t vbo_residency;
+    uint32_t capacity;
+} ParticlePass;
+
+static void particle_pass_create(
+    ParticlePass* pass, uint32_t capacity, ResourceManager* resources, TextureResidency* residency)
+{
+    const ShaderVariant* v_shader = shader_variant(&particle_vert, 0);
+    const ShaderVariant* f_shader = shader_variant(&particle_frag, 0);
+    if (!v_shader || !f_shader) { fatal_error("Shader variant was pruned from the build."); }
+    shader_create(v_shader->source, f_shader->source, &pass->shader);
+    if (!pass->shader.id) { fatal_error("Failed to build the particle shader."); }
+
+    pass->capacity = capacity;
+    glGenVertexArrays(1, &pass->vao);
+    glGenBuffers(1, &pass->vbo);
+    glBindVertexArray(pass->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pass->vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(ParticleInstance), NULL, GL_STREAM_DRAW);
+    pass->vbo_handle    = resource_add_buffer(resources, pass->vbo, capacity * sizeof(ParticleInstance), 0, NULL);
+    pass->vbo_residency = residency_register_buffer(residency, capacity * sizeof(ParticleInstance));
+
+    // position, size and color attributes, each advancing once per particle; the corners come from gl_VertexID
+    for (GLuint attribute = 0; attribute < 3; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+}
+
+// Finishes the particle frame that particle_system_update() started, writing the instances straight into the vertex
+// buffer, and draws them blended over whatever is bound. width and height are the window's, which particle positions
+// are relative to.
+static void particle_pass_draw(
+    ParticlePass* pass, ParticleSystem* particles, uint32_t instance_count, int32_t width, int32_t height)
+{
+    // Invalidating the buffer lets the driver hand out fresh storage rather than wait for last frame's draws.
+    glBindBuffer(GL_ARRAY_BUFFER, pass->vbo);
+    ParticleInstance* instances = NULL;
+    if (instance_count && instance_count <= pass->capacity) {
+        instances = (ParticleInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, instance_count * sizeof(ParticleInstance),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+    ParticleDraw draws[PARTICLE_MAX_DRAWS];
+    uint32_t draw_count = particle_system_write(particles, instances, draws, PARTICLE_MAX_DRAWS);
+    // Unmapping fails if the contents were lost meanwhile, on a display mode change say; skip drawing this frame.
+    if (!instances || !glUnmapBuffer(GL_ARRAY_BUFFER)) { return; }
+
+    glEnable(GL_BLEND);
+    shader_use(&pass->shader);
+    shader_set_vec2(&pass->shader, "screenSize", (float)width, (float)height);
+    glBindVertexArray(pass->vao);
+    for (uint32_t i = 0; i < draw_count; i++) {
+        glBlendFunc(GL_SRC_ALPHA, draws[i].blend == PARTICLE_BLEND_ADDITIVE ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+        size_t first = draws[i].first * sizeof(ParticleInstance);
+        GLsizei size = sizeof(ParticleInstance);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, size, (void*)(first + offsetof(ParticleInstance, x)));
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, size, (void*)(first + offsetof(ParticleInstance, size)));
+        glVertexAttribPointer(
+            2, 4, GL_UNSIGNED_BYTE, GL_TRUE, size, (void*)(first + offsetof(ParticleInstance, color)));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, draws[i].count);
+    }
+    glDisable(GL_BLEND);
+}
+
+static void particle_pass_destroy(ParticlePass* pass, ResourceManager* resources, TextureResidency* residency)
+{
+    glDeleteVertexArrays(1, &pass->vao);
+    resource_release_buffer(resources, pass->vbo_handle);
+    residency_unregister_buffer(residency, pass->vbo_residency);
+    glDeleteProgram(pass->shader.id);
+    memset(pass, 0, sizeof(*pass));
+}
+
+// A fountain rising from the bottom of the window.
+static ParticleEmitter* create_fountain(ParticleSystem* particles)
+{
+    ParticleEmitterDesc desc = { 0 };
+    desc.max_particles       = FOUNTAIN_PARTICLES;
+    desc.rate                = FOUNTAIN_PARTICLES / 2.6f;
+    desc.radius              = 6.0f;
+    desc.direction           = -1.5708f;
+    desc.spread              = 0.25f;
+    desc.speed_min           = 350.0f;
+    desc.speed_max           = 550.0f;
+    desc.life_min            = 2.0f;
+    desc.life_max            = 3.0f;
+    desc.gravity_y           = 350.0f;
+    desc.drag                = 0.1f;
+    desc.colors[0]           = (ParticleColorKey) { 0.0f, 0xFFFFF0E0u };
+    desc.colors[1]           = (ParticleColorKey) { 0.4f, 0xC0F0A040u };
+    desc.colors[2]           = (ParticleColorKey) { 1.0f, 0x00C06020u };
+    desc.color_count         = 3;
+    desc.sizes[0]            = (ParticleSizeKey) { 0.0f, 3.0f };
+    desc.sizes[1]            = (ParticleSizeKey) { 1.0f, 7.0f };
+    desc.size_count          = 2;
+    desc.blend               = PARTICLE_BLEND_ALPHA;
+    desc.seed                = 1;
+    return particle_emitter_create(particles, &desc);
+}
+
+// Sparks that follow the cursor, and burst on a click.
+static ParticleEmitter* create_sparks(ParticleSystem* particles)
+{
+    ParticleEmitterDesc desc = { 0 };
+    desc.max_particles       = SPARK_PARTICLES;
+    desc.rate                = 3000.0f;
+    desc.radius              = 3.0f;
+    desc.spread              = 3.1416f;
+    desc.speed_min           = 40.0f;
+    desc.speed_max           = 220.0f;
+    desc.life_min            = 0.4f;
+    desc.life_max            = 1.2f;
+    desc.gravity_y           = 120.0f;
+    desc.drag                = 0.8f;
+    desc.colors[0]           = (ParticleColorKey) { 0.0f, 0xFF80E0FFu };
+    desc.colors[1]           = (ParticleColorKey) { 1.0f, 0x002040FFu };
+    desc.color_count         = 2;
+    desc.sizes[0]            = (ParticleSizeKey) { 0.0f, 5.0f };
+    desc.sizes[1]            = (ParticleSizeKey) { 1.0f, 1.0f };
+    desc.size_count          = 2;
+    desc.blend               = PARTICLE_BLEND_ADDITIVE;
+    desc.seed                = 2;
+    return particle_emitter_create(particles, &desc);
+}
+
+#define TILEMAP_SIZE 2048
+#define TILEMAP_CHUNK_SIZE 32
+#define TILEMAP_RESIDENT_CHUNKS 128
+#define TILEMAP_MAX_DRAWS 128
+#define TILEMAP_PAN_SPEED 800.0f
+#define TILESET_COLUMNS 4
+#define TILESET_ROWS 4
+#define TILESET_TILE_PIXELS 16
+#define TILEMAP_PAINT_TILE 10
+
+// GL side of the tilemap: one static vertex buffer per tilemap slot, refilled only when the chunk in it was rebuilt,
+// and one index buffer shared by every chunk since their quads all index the same way.
+typedef struct TilemapPass {
+    Shader shader;
+    GLuint tileset;
+    GLuint vao;
+    GLuint ebo;
+    GLuint buffers[TILEMAP_RESIDENT_CHUNKS];
+    BufferHandle ebo_handle;
+    BufferHandle buffer_handles[TILEMAP_RESIDENT_CHUNKS];
+    uint32_t ebo_residency;
+    uint32_t buffers_residency; // every slot, at the most a chunk can need
+} TilemapPass;
+
+// Drawn in code rather than loaded: flat colors with a little per-pixel noise and a darker top and left edge, so tile
+// boundaries are easy to see.
+static GLuint create_tileset_texture(void)
+{
+    static const uint32_t colors[TILESET_COLUMNS * TILESET_ROWS] = {
+        0xFF3C9A4Au, 0xFF2E7A3Au, 0xFFC87A2Eu, 0xFF8A4E20u, // grass, dark grass, shallow water, deep water
+        0xFF8CD2E0u, 0xFF808080u, 0xFF3A5A7Au, 0xFF48B0F0u, // sand, stone, dirt, flowers
+        0xFF404040u, 0xFFE0E0E0u, 0xFF2040C0u, 0xFF20A0C0u, // the rest are left for painting
+        0xFFC040A0u, 0xFF40C0C0u, 0xFF6060E0u, 0xFF101010u,
+    };
+    uint32_t width   = TILESET_COLUMNS * TILESET_TILE_PIXELS;
+    uint32_t height  = TILESET_ROWS * TILESET_TILE_PIXELS;
+    uint32_t* pixels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t color = colors[(y / TILESET_TILE_PIXELS) * TILESET_COLUMNS + x / TILESET_TILE_PIXELS];
+            uint32_t noise = ((x * 73856093u) ^ (y * 19349663u)) * 2654435761u >> 28;
+            uint32_t scale = x % TILESET_TILE_PIXELS == 0 || y % TILESET_TILE_PIXELS == 0 ? 200 : 240 + noise;
+            uint32_t out   = color & 0xFF000000u;
+            for (uint32_t shift = 0; shift < 24; shift += 8) {
+                uint32_t channel = ((color >> shift) & 0xFF) * scale / 255;
+                out |= (channel > 255 ? 255 : channel) << shift;
+            }
+            pixels[(size_t)y * width + x] = out;
+        }
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    free(pixels);
+    return texture;
+}
+
+static void tilemap_pass_create(TilemapPass* pass, ResourceManager* resources, TextureResidency* residency)
+{
+    const ShaderVariant* v_shader = shader_variant(&tilemap_vert, 0);
+    const ShaderVariant* f_shader = shader_variant(&tilemap_frag, 0);
+    if (!v_shader || !f_shader) { fatal_error("Shader variant was pruned from the build."); }
+    shader_create(v_shader->source, f_shader->source, &pass->shader);
+    if (!pass->shader.id) { fatal_error("Failed to build the tilemap shader."); }
+    pass->tileset = create_tileset_texture();
+
+    // Quad n of a chunk is vertices 4n to 4n + 3, so one index buffer serves them all.
+    uint32_t quad_count = TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE;
+    uint16_t* indices   = (uint16_t*)malloc(quad_count * 6 * sizeof(uint16_t));
+    for (uint32_t i = 0; i < quad_count; i++) {
+        uint16_t first   = (uint16_t)(i * 4);
+        uint16_t quad[6] = { first, first + 1, first + 2, first + 2, first + 3, first };
+        memcpy(&indices[i * 6], quad, sizeof(quad));
+    }
+
+    glGenVertexArrays(1, &pass->vao);
+    glGenBuffers(1, &pass->ebo);
+    glGenBuffers(TILEMAP_RESIDENT_CHUNKS, pass->buffers);
+    glBindVertexArray(pass->vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pass->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, quad_count * 6 * sizeof(uint16_t), indices, GL_STATIC_DRAW);
+    free(indices);
+
+    // Chunk buffers are refilled at whatever size the chunk's quads take, so they are accounted at a full chunk, which
+    // is what they come to hold as the camera moves around.
+    uint64_t chunk_bytes = quad_count * 4 * sizeof(TileVertex);
+    pass->ebo_handle     = resource_add_buffer(resources, pass->ebo, quad_count * 6 * sizeof(uint16_t), 0, NULL);
+    pass->ebo_residency  = residency_register_buffer(residency, quad_count * 6 * sizeof(uint16_t));
+    for (uint32_t i = 0; i < TILEMAP_RESIDENT_CHUNKS; i++) {
+        pass->buffer_handles[i] = resource_add_buffer(resources, pass->buffers[i], chunk_bytes, 0, NULL);
+    }
+    pass->buffers_residency = residency_register_buffer(residency, chunk_bytes * TILEMAP_RESIDENT_CHUNKS);
+
+    // position and texture coord attributes, pointed at each chunk's buffer as it is drawn
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+}
+
+// Uploads the chunks tilemap_update() rebuilt and draws every chunk it returned, opaque, under whatever is drawn next.
+// width and height are the window's, which the camera is sized to.
+static void tilemap_pass_draw(TilemapPass* pass, const TilemapDraw* draws, uint32_t draw_count, float camera_x,
+    float camera_y, int32_t width, int32_t height)
+{
+    if (!draw_count) { return; }
+
+    shader_use(&pass->shader);
+    shader_set_vec2(&pass->shader, "screenSize", (float)width, (float)height);
+    shader_set_vec2(&pass->shader, "camera", camera_x, camera_y);
+    shader_set_float(&pass->shader, "tileSize", TILESET_TILE_PIXELS);
+    glBindTexture(GL_TEXTURE_2D, pass->tileset);
+    glBindVertexArray(pass->vao);
+    for (uint32_t i = 0; i < draw_count; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, pass->buffers[draws[i].slot]);
+        if (draws[i].vertices) {
+            glBufferData(GL_ARRAY_BUFFER, draws[i].quad_count * 4 * sizeof(TileVertex), draws[i].vertices,
+                GL_STATIC_DRAW);
+        }
+        glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(TileVertex), (void*)offsetof(TileVertex, x));
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(TileVertex), (void*)offsetof(TileVertex, u));
+        glDrawElements(GL_TRIANGLES, draws[i].quad_count * 6, GL_UNSIGNED_SHORT, 0);
+    }
+}
+
+static void tilemap_pass_destroy(TilemapPass* pass, ResourceManager* resources, TextureResidency* residency)
+{
+    glDeleteVertexArrays(1, &pass->vao);
+    resource_release_buffer(resources, pass->ebo_handle);
+    for (uint32_t i = 0; i < TILEMAP_RESIDENT_CHUNKS; i++) {
+        resource_release_buffer(resources, pass->buffer_handles[i]);
+    }
+    residency_unregister_buffer(residency, pass->ebo_residency);
+    residency_unregister_buffer(residency, pass->buffers_residency);
+    glDeleteTextures(1, &pass->tileset);
+    glDeleteProgram(pass->shader.id);
+    memset(pass, 0, sizeof(*pass));
+}
+
+// Water in the hollows, then sand, grass and stone going up, with some flowers scattered over the grass.
+static Tile terrain_tile(float height, uint32_t scatter)
+{
+    if (height < -1.2f) { return 4; }
+    if (height < -0.6f) { return 3; }
+    if (height < -0.4f) { return 5; }
+    if (height < 0.8f) { return scatter < 8 ? 8 : 1; }
+    if (height < 1.5f) { return 2; }
+    return 6;
+}
+
+// Rolling terrain from a few overlapping waves.
+static Tilemap* create_tilemap(JobPool* jobs)
+{
+    TilemapDesc desc   = { 0 };
+    desc.jobs          = jobs;
+    desc.width         = TILEMAP_SIZE;
+    desc.height        = TILEMAP_SIZE;
+    desc.tile_size     = TILESET_TILE_PIXELS;
+    desc.chunk_size    = TILEMAP_CHUNK_SIZE;
+    desc.max_resident  = TILEMAP_RESIDENT_CHUNKS;
+    desc.atlas_columns = TILESET_COLUMNS;
+    desc.atlas_rows    = TILESET_ROWS;
+    Tilemap* map       = tilemap_create(&desc);
+
+    for (uint32_t y = 0; y < TILEMAP_SIZE; y++) {
+        for (uint32_t x = 0; x < TILEMAP_SIZE; x++) {
+            float height = sinf(x * 0.031f) + sinf(y * 0.027f) + 0.6f * sinf((x + y) * 0.071f)
+                + 0.4f * sinf((x - 2.0f * y) * 0.113f);
+            uint32_t scatter = (x * 73856093u ^ y * 19349663u) * 2654435761u >> 24;
+            tilemap_set(map, x, y, terrain_tile(height, scatter));
+        }
+    }
+    return map;
+}
+
+#define DEBUG_STATS_INTERVAL 30
+
+// Refreshed every DEBUG_STATS_INTERVAL frames rather than every frame, so the text stays cached in between.
+static void format_debug_stats(char* out, size_t size, const DynamicResolution* drs, int32_t scene_width,
+    int32_t scene_height, const InputLatency* latency, const GlyphCache* glyphs, const TextRenderer* text,
+    const ResourceManager* resources, const TextureResidency* residency, const AssetPack* pack,
+    const ParticleSystem* particles, float particle_ms, const Tilemap* tilemap)
+{
+    InputLatencyStats input            = input_latency_stats(latency);
+    GlyphCacheStats glyph_stats        = glyph_cache_stats(glyphs);
+    TextRendererStats text_stats       = text_renderer_stats(text);
+    ParticleSystemStats particle_stats = particle_system_stats(particles);
+    TilemapStats map_stats             = tilemap_stats(tilemap);
+    int written = snprintf(out, size,
+        "scene %dx%d (%.0f%%), gpu %.2fms\ninput latency p95 %.2fms\nglyphs %u/%u, %u strings cached\n"
+        "particles %u, cpu %.2fms\nchunks %u drawn, %u rebuilt (%llu total), %u resident",
+        scene_width, scene_height, drs->scale * 100.0f, drs->smoothed_ms, input.p95_ms, glyph_stats.resident,
+        glyph_stats.slots, text_stats.runs, particle_stats.live, particle_ms, map_stats.drawn,
+        map_stats.rebuilt, (unsigned long long)map_stats.total_rebuilt, map_stats.resident);
+
+    // A texture's resource bytes are its whole mip chain, kept on the CPU for streaming; what is on the GPU is
+    // whichever of those mips the residency manager has loaded.
+    ResidencyMetrics residency_metrics;
+    residency_get_metrics(residency, &residency_metrics);
+    ResourceTypeStats resource_stats[RESOURCE_TYPE_COUNT];
+    resource_manager_stats(resources, resource_stats);
+    for (uint32_t type = 0; type < RESOURCE_TYPE_COUNT && written > 0 && (size_t)written < size; type++) {
+        const char* name = resource_type_name((ResourceType)type);
+        uint64_t kib     = resource_stats[type].bytes / 1024;
+        if (type == RESOURCE_TEXTURE) {
+            written += snprintf(out + written, size - written, "\n%s %u (%llu KiB resident, %llu KiB CPU), %u retired",
+                name, resource_stats[type].live, (unsigned long long)(residency_metrics.texture_bytes / 1024),
+                (unsigned long long)kib, resource_stats[type].retired);
+        } else {
+            written += snprintf(out + written, size - written, "\n%s %u (%llu KiB), %u retired", name,
+                resource_stats[type].live, (unsigned long long)kib, resource_stats[type].retired);
+        }
+    }
+    if (written > 0 && (size_t)written < size) {
+        written += snprintf(out + written, size - written, "\ngpu %llu/%llu KiB",
+            (unsigned long long)(residency_metrics.used_bytes / 1024),
+            (unsigned long long)(residency_metrics.budget_bytes / 1024));
+    }
+
+    if (pack && written > 0 && (size_t)written < size) {
+        AssetPackStats pack_stats = asset_pack_stats(pack);
+        double read_mib           = pack_stats.read_bytes / (1024.0 * 1024.0);
+        snprintf(out + written, size - written, "\npack %llu reads, %llu views, %.2f MiB at %.0f MiB/s",
+            (unsigned long long)pack_stats.reads, (unsigned long long)pack_stats.views, read_mib,
+            pack_stats.read_ns ? read_mib / (pack_stats.read_ns / 1e9) : 0.0);
+    }
+}
+
 static void* get_proc_address(HMODULE module, const char* proc_name)
 {
     void* proc = (void*)wglGetProcAddress(proc_name);
@@ -213,10 +1196,17 @@ static void init_opengl_extensions()
     wglChoosePixelFormatARB    = (PFNWGLCHOOSEPIXELFORMATARBPROC)get_proc_address(gl, "wglChoosePixelFormatARB");
     wglCreateContextAttribsARB = (PFNWGLCREATECONTEXTATTRIBSARBPROC)get_proc_address(gl, "wglCreateContextAttribsARB");
     glAttachShader             = (PFNGLATTACHSHADERPROC)get_proc_address(gl, "glAttachShader");
+    glBeginQuery               = (PFNGLBEGINQUERYPROC)get_proc_address(gl, "glBeginQuery");
     glBindBuffer               = (PFNGLBINDBUFFERPROC)get_proc_address(gl, "glBindBuffer");
+    glBindFramebuffer          = (PFNGLBINDFRAMEBUFFERPROC)get_proc_address(gl, "glBindFramebuffer");
+    glBindRenderbuffer         = (PFNGLBINDRENDERBUFFERPROC)get_proc_address(gl, "glBindRenderbuffer");
     glBindTexture              = (PFNGLBINDTEXTUREPROC)get_proc_address(gl, "glBindTexture");
     glBindVertexArray          = (PFNGLBINDVERTEXARRAYPROC)get_proc_address(gl, "glBindVertexArray");
+    glBlendFunc                = (PFNGLBLENDFUNCPROC)get_proc_address(gl, "glBlendFunc");
+    glBlitFramebuffer          = (PFNGLBLITFRAMEBUFFERPROC)get_proc_address(gl, "glBlitFramebuffer");
     glBufferData               = (PFNGLBUFFERDATAPROC)get_proc_address(gl, "glBufferData");
+    glBufferSubData            = (PFNGLBUFFERSUBDATAPROC)get_proc_address(gl, "glBufferSubData");
+    glCheckFramebufferStatus   = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)get_proc_address(gl, "glCheckFramebufferStatus");
     glClear                    = (PFNGLCLEARPROC)get_proc_address(gl, "glClear");
     glClearColor               = (PFNGLCLEARCOLORPROC)get_proc_address(gl, "glClearColor");
     glCompileShader            = (PFNGLCOMPILESHADERPROC)get_proc_address(gl, "glCompileShader");
@@ -224,30 +1214,55 @@ static void init_opengl_extensions()
     glCreateShader             = (PFNGLCREATESHADERPROC)get_proc_address(gl, "glCreateShader");
     glDebugMessageCallback     = (PFNGLDEBUGMESSAGECALLBACKPROC)get_proc_address(gl, "glDebugMessageCallback");
     glDeleteBuffers            = (PFNGLDELETEBUFFERSPROC)get_proc_address(gl, "glDeleteBuffers");
+    glDeleteFramebuffers       = (PFNGLDELETEFRAMEBUFFERSPROC)get_proc_address(gl, "glDeleteFramebuffers");
     glDeleteProgram            = (PFNGLDELETEPROGRAMPROC)get_proc_address(gl, "glDeleteProgram");
+    glDeleteQueries            = (PFNGLDELETEQUERIESPROC)get_proc_address(gl, "glDeleteQueries");
+    glDeleteRenderbuffers      = (PFNGLDELETERENDERBUFFERSPROC)get_proc_address(gl, "glDeleteRenderbuffers");
     glDeleteShader             = (PFNGLDELETESHADERPROC)get_proc_address(gl, "glDeleteShader");
+    glDeleteTextures           = (PFNGLDELETETEXTURESPROC)get_proc_address(gl, "glDeleteTextures");
     glDeleteVertexArrays       = (PFNGLDELETEVERTEXARRAYSPROC)get_proc_address(gl, "glDeleteVertexArrays");
+    glDisable                  = (PFNGLDISABLEPROC)get_proc_address(gl, "glDisable");
     glDrawArrays               = (PFNGLDRAWARRAYSPROC)get_proc_address(gl, "glDrawArrays");
+    glDrawArraysInstanced      = (PFNGLDRAWARRAYSINSTANCEDPROC)get_proc_address(gl, "glDrawArraysInstanced");
     glDrawElements             = (PFNGLDRAWELEMENTSPROC)get_proc_address(gl, "glDrawElements");
     glEnable                   = (PFNGLENABLEPROC)get_proc_address(gl, "glEnable");
     glEnableVertexAttribArray  = (PFNGLENABLEVERTEXATTRIBARRAYPROC)get_proc_address(gl, "glEnableVertexAttribArray");
+    glEndQuery                 = (PFNGLENDQUERYPROC)get_proc_address(gl, "glEndQuery");
+    glFramebufferRenderbuffer  = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)get_proc_address(gl, "glFramebufferRenderbuffer");
+    glFramebufferTexture2D     = (PFNGLFRAMEBUFFERTEXTURE2DPROC)get_proc_address(gl, "glFramebufferTexture2D");
     glGenBuffers               = (PFNGLGENBUFFERSPROC)get_proc_address(gl, "glGenBuffers");
+    glGenFramebuffers          = (PFNGLGENFRAMEBUFFERSPROC)get_proc_address(gl, "glGenFramebuffers");
+    glGenQueries               = (PFNGLGENQUERIESPROC)get_proc_address(gl, "glGenQueries");
+    glGenRenderbuffers         = (PFNGLGENRENDERBUFFERSPROC)get_proc_address(gl, "glGenRenderbuffers");
     glGenTextures              = (PFNGLGENTEXTURESPROC)get_proc_address(gl, "glGenTextures");
     glGenVertexArrays          = (PFNGLGENVERTEXARRAYSPROC)get_proc_address(gl, "glGenVertexArrays");
     glGenerateMipmap           = (PFNGLGENERATEMIPMAPPROC)get_proc_address(gl, "glGenerateMipmap");
     glGetProgramInfoLog        = (PFNGLGETPROGRAMINFOLOGPROC)get_proc_address(gl, "glGetProgramInfoLog");
     glGetProgramiv             = (PFNGLGETPROGRAMIVPROC)get_proc_address(gl, "glGetProgramiv");
+    glGetQueryObjectiv         = (PFNGLGETQUERYOBJECTIVPROC)get_proc_address(gl, "glGetQueryObjectiv");
+    glGetQueryObjectui64v      = (PFNGLGETQUERYOBJECTUI64VPROC)get_proc_address(gl, "glGetQueryObjectui64v");
     glGetShaderInfoLog         = (PFNGLGETSHADERINFOLOGPROC)get_proc_address(gl, "glGetShaderInfoLog");
+    glGetIntegerv              = (PFNGLGETINTEGERVPROC)get_proc_address(gl, "glGetIntegerv");
     glGetShaderiv              = (PFNGLGETSHADERIVPROC)get_proc_address(gl, "glGetShaderiv");
     glGetString                = (PFNGLGETSTRINGPROC)get_proc_address(gl, "glGetString");
-    glGetUniformLocation       = (PFNGLGETUNIFORMLOCATIONPROC)get_proc_address(gl, "glGetuniformLocation");
+    glGetStringi               = (PFNGLGETSTRINGIPROC)get_proc_address(gl, "glGetStringi");
+    glGetUniformLocation       = (PFNGLGETUNIFORMLOCATIONPROC)get_proc_address(gl, "glGetUniformLocation");
     glLinkProgram              = (PFNGLLINKPROGRAMPROC)get_proc_address(gl, "glLinkProgram");
+    glMapBufferRange           = (PFNGLMAPBUFFERRANGEPROC)get_proc_address(gl, "glMapBufferRange");
+    glMaxShaderCompilerThreadsKHR
+        = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)get_proc_address(gl, "glMaxShaderCompilerThreadsKHR");
+    glPixelStorei              = (PFNGLPIXELSTOREIPROC)get_proc_address(gl, "glPixelStorei");
+    glRenderbufferStorage      = (PFNGLRENDERBUFFERSTORAGEPROC)get_proc_address(gl, "glRenderbufferStorage");
     glShaderSource             = (PFNGLSHADERSOURCEPROC)get_proc_address(gl, "glShaderSource");
     glTexImage2D               = (PFNGLTEXIMAGE2DPROC)get_proc_address(gl, "glTexImage2D");
     glTexParameteri            = (PFNGLTEXPARAMETERIPROC)get_proc_address(gl, "glTexParameteri");
+    glTexSubImage2D            = (PFNGLTEXSUBIMAGE2DPROC)get_proc_address(gl, "glTexSubImage2D");
     glUniform1f                = (PFNGLUNIFORM1FPROC)get_proc_address(gl, "glUniform1f");
     glUniform1i                = (PFNGLUNIFORM1IPROC)get_proc_address(gl, "glUniform1i");
+    glUniform2f                = (PFNGLUNIFORM2FPROC)get_proc_address(gl, "glUniform2f");
+    glUnmapBuffer              = (PFNGLUNMAPBUFFERPROC)get_proc_address(gl, "glUnmapBuffer");
     glUseProgram               = (PFNGLUSEPROGRAMPROC)get_proc_address(gl, "glUseProgram");
+    glVertexAttribDivisor      = (PFNGLVERTEXATTRIBDIVISORPROC)get_proc_address(gl, "glVertexAttribDivisor");
     glVertexAttribPointer      = (PFNGLVERTEXATTRIBPOINTERPROC)get_proc_address(gl, "glVertexAttribPointer");
     glViewport                 = (PFNGLVIEWPORTPROC)get_proc_address(gl, "glViewport");
 
@@ -299,17 +1314,91 @@ static HGLRC init_opengl(HDC real_dc)
     return gl33_context;
 }
 
+// Shared between the window procedure and the render loop through GWLP_USERDATA. Messages that arrive while the
+// window is being created, before it is set, fall through to DefWindowProc, except for closing the window, which has
+// to work without it too: --replay never sets it.
+typedef struct WindowState {
+    SurfaceSize surface;
+    InputQueue* input;
+} WindowState;
+
+static void push_input(WindowState* state, InputEventType type, uint32_t code, float x, float y)
+{
+    InputEvent event   = { 0 };
+    event.timestamp_ns = input_now_ns();
+    event.type         = type;
+    event.code         = code;
+    event.x            = x;
+    event.y            = y;
+    input_queue_push(state->input, &event);
+}
+
+static void push_mouse_button(WindowState* state, InputEventType type, InputMouseButton button, LPARAM lparam)
+{
+    push_input(state, type, button, (float)GET_X_LPARAM(lparam), (float)GET_Y_LPARAM(lparam));
+}
+
 static LRESULT CALLBACK window_callback(HWND window, UINT msg, WPARAM wparam, LPARAM lparam)
 {
-    LRESULT result = 0;
+    LRESULT result     = 0;
+    WindowState* state = (WindowState*)GetWindowLongPtr(window, GWLP_USERDATA);
+    if (msg == WM_CLOSE) {
+        DestroyWindow(window);
+        return 0;
+    }
+    if (msg == WM_DESTROY) {
+        PostQuitMessage(0);
+        return 0;
+    }
+    if (!state) { return DefWindowProc(window, msg, wparam, lparam); }
 
     switch (msg) {
-    case WM_CLOSE:
-        DestroyWindow(window);
+    case WM_SIZE:
+        // Only recorded here; the render loop applies the latest size once per frame.
+        surface_size_request(&state->surface, LOWORD(lparam), HIWORD(lparam));
         break;
-    case WM_DESTROY:
-        PostQuitMessage(0);
+    case WM_KEYDOWN:
+        // Auto-repeat is left to the game.
+        if (!(lparam & (1 << 30))) { push_input(state, INPUT_KEY_DOWN, (uint32_t)wparam, 0.0f, 0.0f); }
+        break;
+    case WM_KEYUP:
+        push_input(state, INPUT_KEY_UP, (uint32_t)wparam, 0.0f, 0.0f);
+        break;
+    case WM_MOUSEMOVE:
+        push_input(state, INPUT_MOUSE_MOVE, 0, (float)GET_X_LPARAM(lparam), (float)GET_Y_LPARAM(lparam));
+        break;
+    case WM_LBUTTONDOWN:
+        push_mouse_button(state, INPUT_MOUSE_DOWN, INPUT_MOUSE_LEFT, lparam);
+        break;
+    case WM_LBUTTONUP:
+        push_mouse_button(state, INPUT_MOUSE_UP, INPUT_MOUSE_LEFT, lparam);
+        break;
+    case WM_RBUTTONDOWN:
+        push_mouse_button(state, INPUT_MOUSE_DOWN, INPUT_MOUSE_RIGHT, lparam);
+        break;
+    case WM_RBUTTONUP:
+        push_mouse_button(state, INPUT_MOUSE_UP, INPUT_MOUSE_RIGHT, lparam);
+        break;
+    case WM_MBUTTONDOWN:
+        push_mouse_button(state, INPUT_MOUSE_DOWN, INPUT_MOUSE_MIDDLE, lparam);
+        break;
+    case WM_MBUTTONUP:
+        push_mouse_button(state, INPUT_MOUSE_UP, INPUT_MOUSE_MIDDLE, lparam);
+        break;
+    case WM_MOUSEWHEEL:
+        push_input(state, INPUT_MOUSE_WHEEL, 0, 0.0f, (float)GET_WHEEL_DELTA_WPARAM(wparam) / WHEEL_DELTA);
+        break;
+    case WM_INPUT: {
+        RAWINPUT raw;
+        UINT size = sizeof(raw);
+        if (GetRawInputData((HRAWINPUT)lparam, RID_INPUT, &raw, &size, sizeof(RAWINPUTHEADER)) != (UINT)-1
+            && raw.header.dwType == RIM_TYPEMOUSE && !(raw.data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE)) {
+            push_input(state, INPUT_MOUSE_RAW, 0, (float)raw.data.mouse.lLastX, (float)raw.data.mouse.lLastY);
+        }
+        // DefWindowProc cleans up after WM_INPUT.
+        result = DefWindowProc(window, msg, wparam, lparam);
         break;
+    }
     default:
         result = DefWindowProc(window, msg, wparam, lparam);
         break;
@@ -347,37 +1436,113 @@ static HWND create_window(HINSTANCE inst, int32_t width, int32_t height, const c
     return window;
 }
 
+// The dispatch table gl_capture hooks and replays through: every captured entry point, as the globals above.
+static GlCaptureDispatch gl_dispatch()
+{
+    GlCaptureDispatch dispatch;
+#define DISPATCH_SLOT(type, name) dispatch.name = &name;
+    GL_CAPTURE_ENTRY_POINTS(DISPATCH_SLOT)
+#undef DISPATCH_SLOT
+    return dispatch;
+}
+
+static void end_capture()
+{
+    if (!gl_capture_active()) { return; }
+    GlTraceStats stats;
+    bool ok = gl_capture_end(&stats);
+    char report[256];
+    snprintf(report, sizeof(report),
+        "GL capture %s: %u frames, %llu calls, %.2f of %.2f MiB of payload after deduplication, %.2f MiB trace\n",
+        ok ? "written" : "failed to write", stats.frames, (unsigned long long)stats.calls,
+        stats.blob_bytes / (1024.0 * 1024.0), stats.payload_bytes / (1024.0 * 1024.0),
+        stats.file_bytes / (1024.0 * 1024.0));
+    non_fatal_error(report);
+}
+
+// Plays a capture back as fast as the driver takes it, one recorded frame per present, then reports the frame times.
+static void replay_capture(HDC dc, const char* path)
+{
+    GlTraceReader* reader = gl_trace_open(path);
+    if (!reader) {
+        non_fatal_error("Not a GL trace, nothing to replay.\n");
+        return;
+    }
+
+    GlCaptureDispatch dispatch = gl_dispatch();
+    GlReplay* replay           = gl_replay_create(&dispatch);
+    uint32_t frames            = 0;
+    uint32_t skipped           = 0;
+    double total_ms = 0.0, min_ms = 1e9, max_ms = 0.0;
+    uint64_t frame_start = input_now_ns();
+    bool running         = true;
+    GlTraceRecord record;
+    while (running && gl_trace_next(reader, &record)) {
+        if (record.call != GL_TRACE_FRAME) {
+            skipped += !gl_replay_call(replay, &record);
+            continue;
+        }
+
+        SwapBuffers(dc);
+        uint64_t now = input_now_ns();
+        double ms    = (now - frame_start) / 1e6;
+        frame_start  = now;
+        total_ms += ms;
+        min_ms = ms < min_ms ? ms : min_ms;
+        max_ms = ms > max_ms ? ms : max_ms;
+        frames++;
+
+        MSG msg;
+        while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) { running = false; }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+
+    char report[320];
+    snprintf(report, sizeof(report),
+        "GL replay%s: %u frames, %.2fms average, %.2fms best, %.2fms worst, %u calls skipped\n",
+        gl_trace_failed(reader) ? " stopped at a malformed record" : "", frames, frames ? total_ms / frames : 0.0,
+        frames ? min_ms : 0.0, max_ms, skipped);
+    non_fatal_error(report);
+    gl_replay_destroy(replay);
+    gl_trace_reader_close(reader);
+}
+
+typedef struct LaunchOptions {
+    const char* capture_path; // --capture <trace> [frames]
+    uint32_t capture_frames;
+    const char* replay_path; // --replay <trace>
+} LaunchOptions;
+
+// Splits the command line in place, so paths cannot contain spaces.
+static LaunchOptions parse_command_line(char* cmd_line, uint32_t default_capture_frames)
+{
+    LaunchOptions options  = { 0 };
+    options.capture_frames = default_capture_frames;
+    for (char* arg = strtok(cmd_line, " "); arg; arg = strtok(NULL, " ")) {
+        if (strcmp(arg, "--capture") == 0) {
+            options.capture_path = strtok(NULL, " ");
+        } else if (strcmp(arg, "--replay") == 0) {
+            options.replay_path = strtok(NULL, " ");
+        } else if (options.capture_path && arg[0] >= '0' && arg[0] <= '9') {
+            options.capture_frames = (uint32_t)strtoul(arg, NULL, 10);
+        }
+    }
+    return options;
+}
+
 const uint32_t SCR_WIDTH  = 800;
 const uint32_t SCR_HEIGHT = 600;
 
-const char* v_shader = "#version 330 core\n"
-                       "layout (location = 0) in vec3 aPos;\n"
-                       "layout (location = 1) in vec3 aColor;\n"
-                       "layout (location = 2) in vec2 aTexCoord;\n"
-                       "\n"
-                       "out vec3 ourColor;\n"
-                       "out vec2 TexCoord;\n"
-                       "\n"
-                       "void main()\n"
-                       "{\n"
-                       "	gl_Position = vec4(aPos, 1.0);\n"
-                       "	ourColor = aColor;\n"
-                       "	TexCoord = vec2(aTexCoord.x, aTexCoord.y);\n"
-                       "}\n";
-
-const char* f_shader = "#version 330 core\n"
-                       "out vec4 FragColor;\n"
-                       "\n"
-                       "in vec3 ourColor;\n"
-                       "in vec2 TexCoord;\n"
-                       "\n"
-                       "// texture sampler\n"
-                       "uniform sampler2D texture1;\n"
-                       "\n"
-                       "void main()\n"
-                       "{\n"
-                       "	FragColor = texture(texture1, TexCoord);\n"
-                       "}\n";
+const uint64_t TEXTURE_BUDGET_BYTES = 64ull * 1024 * 1024;
+
+// How many frames the driver may queue ahead of us; released GL objects are kept alive this long.
+const uint32_t FRAMES_IN_FLIGHT = 3;
+
+// Frames recorded by --capture when it is not given a count.
+const uint32_t CAPTURE_FRAMES = 300;
 
 int WINAPI WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmd_line, int cmd_show)
 {
@@ -385,10 +1550,129 @@ int WINAPI WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmd_line, int cmd_show)
     HDC dc      = GetDC(window);
     HGLRC rc    = init_opengl(dc);
 
-    // How to deal with resizes?
+    // --replay plays a trace back instead of running the sample. --capture records one from before the first object is
+    // created, so that a replay can recreate everything the frames use.
+    LaunchOptions options = parse_command_line(cmd_line, CAPTURE_FRAMES);
+    if (options.replay_path) {
+        ShowWindow(window, cmd_show);
+        replay_capture(dc, options.replay_path);
+        wglMakeCurrent(dc, 0);
+        wglDeleteContext(rc);
+        ReleaseDC(window, dc);
+        // Already gone if the replay was stopped by closing it.
+        if (IsWindow(window)) { DestroyWindow(window); }
+        return 0;
+    }
+    GlCaptureDispatch dispatch = gl_dispatch();
+    if (options.capture_path && !gl_capture_begin(&dispatch, options.capture_path)) {
+        non_fatal_error("Failed to create the GL capture file.\n");
+    }
+    uint32_t captured_frames = 0;
+
+    RECT client;
+    GetClientRect(window, &client);
+    WindowState window_state = { 0 };
+    SurfaceSize* surface     = &window_state.surface;
+    surface_size_init(surface, client.right - client.left, client.bottom - client.top);
+    window_state.input = input_queue_create(1024);
+    SetWindowLongPtr(window, GWLP_USERDATA, (LONG_PTR)&window_state);
+
+    // Raw mouse motion arrives at the device's polling rate and without pointer acceleration, unlike WM_MOUSEMOVE.
+    RAWINPUTDEVICE mouse = { 0 };
+    mouse.usUsagePage    = 0x01; // generic desktop
+    mouse.usUsage        = 0x02; // mouse
+    mouse.hwndTarget     = window;
+    if (!RegisterRawInputDevices(&mouse, 1, sizeof(mouse))) {
+        non_fatal_error("Failed to register for raw mouse input.\n");
+    }
+
+    InputLatency input_latency;
+    input_latency_reset(&input_latency);
+
+    DynamicResolutionDesc drs_desc = { 0 };
+    DynamicResolution drs;
+    dynamic_resolution_init(&drs, &drs_desc);
+
+    GpuTimer gpu_timer = { 0 };
+    glGenQueries(GPU_TIMER_QUERIES, gpu_timer.queries);
+
+    const ShaderVariant* v_shader = shader_variant(&textured_vert, 0);
+    const ShaderVariant* f_shader = shader_variant(&textured_frag, 0);
+    if (!v_shader || !f_shader) { fatal_error("Shader variant was pruned from the build."); }
 
     Shader shader;
-    shader_create(v_shader, f_shader, &shader);
+    shader_create(v_shader->source, f_shader->source, &shader);
+    if (!shader.id) { fatal_error("Failed to build the textured shader."); }
+
+    // GL objects are owned by handle from here on, and only deleted once the frames that may use them are done.
+    ResourceManagerDesc resource_desc = { 0 };
+    resource_desc.frames_in_flight    = FRAMES_IN_FLIGHT;
+    ResourceManager* resources        = resource_manager_create(&resource_desc);
+    ResourceDestroy resource_destroys[64];
+
+    ResidencyDesc residency_desc = { 0 };
+    residency_desc.budget_bytes  = TEXTURE_BUDGET_BYTES;
+    TextureResidency* residency  = residency_create(&residency_desc);
+
+    RenderTarget scene_target = { 0 };
+    if (!render_target_resize(&scene_target, surface->width, surface->height, resources, residency)) {
+        fatal_error("Failed to create the scene render target.");
+    }
+
+    // Changed assets are decoded and preprocessed on worker threads and swapped in at the start of a frame.
+    JobPool* jobs             = job_pool_create(0);
+    HotReloadDesc reload_desc = { 0 };
+    reload_desc.jobs          = jobs;
+    reload_desc.glsl_version  = "330 core";
+    HotReload* reload         = hot_reload_create(&reload_desc);
+
+    ReloadableProgram program = { 0 };
+    program.slot.active       = shader.id;
+    program.sources[0]        = v_shader->source;
+    program.sources[1]        = f_shader->source;
+    program.assets[0]         = hot_reload_watch_shader(reload, "shaders/textured.vert", 0, v_shader->hash);
+    program.assets[1]         = hot_reload_watch_shader(reload, "shaders/textured.frag", 0, f_shader->hash);
+    program.parallel_compile  = has_gl_extension("GL_KHR_parallel_shader_compile") && glMaxShaderCompilerThreadsKHR;
+    program.handle            = resource_add_program(resources, shader.id, 0, 0, NULL);
+    if (program.parallel_compile) { glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); }
+
+    // Glyphs are rasterized and turned into distance fields on the job pool, then uploaded as they land.
+    GlyphCacheDesc glyph_desc = { 0 };
+    glyph_desc.jobs           = jobs;
+    glyph_desc.rasterize      = gdi_rasterize_glyph;
+    glyph_desc.user           = (void*)"Consolas";
+    GlyphCache* glyphs        = glyph_cache_create(&glyph_desc);
+
+    TextRendererDesc text_desc = { 0 };
+    text_desc.glyphs           = glyphs;
+    text_desc.max_glyphs       = TEXT_MAX_GLYPHS;
+    TextRenderer* text         = text_renderer_create(&text_desc);
+
+    TextPass text_pass = { 0 };
+    text_pass_create(&text_pass, glyphs, resources, residency);
+    GlyphUpload glyph_uploads[GLYPH_UPLOADS_PER_FRAME];
+    char debug_stats[768] = "";
+    uint64_t frame_index  = 0;
+
+    // Simulated on the job pool alongside the rest of the frame's CPU work, and drawn into the scene.
+    ParticleSystemDesc particle_desc = { 0 };
+    particle_desc.jobs               = jobs;
+    ParticleSystem* particles        = particle_system_create(&particle_desc);
+    ParticleEmitter* fountain        = create_fountain(particles);
+    ParticleEmitter* sparks          = create_sparks(particles);
+    ParticlePass particle_pass       = { 0 };
+    particle_pass_create(&particle_pass, FOUNTAIN_PARTICLES + SPARK_PARTICLES, resources, residency);
+    uint64_t last_frame_ns = input_now_ns();
+    float particle_ms      = 0.0f;
+
+    // The arrow keys pan a window sized camera over the map; chunks are rebuilt on the job pool as they change.
+    Tilemap* tilemap         = create_tilemap(jobs);
+    TilemapPass tilemap_pass = { 0 };
+    tilemap_pass_create(&tilemap_pass, resources, residency);
+    TilemapDraw tilemap_draws[TILEMAP_MAX_DRAWS];
+    bool arrows_held[4] = { false }; // left, up, right, down
+    float camera_x      = 0.0f;
+    float camera_y      = 0.0f;
 
     float vertices[] = {
         // clang-format off
@@ -414,12 +1698,16 @@ int WINAPI WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmd_line, int cmd_show)
 
     glBindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
+    VertexArrayHandle quad_vao = resource_add_vertex_array(resources, vao, 0, 0, NULL);
+    BufferHandle quad_vbo      = resource_add_buffer(resources, vbo, sizeof(vertices), 0, NULL);
+    BufferHandle quad_ebo      = resource_add_buffer(resources, ebo, sizeof(indices), 0, NULL);
+
     // position attribute
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -430,23 +1718,18 @@ int WINAPI WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmd_line, int cmd_show)
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    uint32_t vbo_residency = residency_register_buffer(residency, sizeof(vertices));
+    uint32_t ebo_residency = residency_register_buffer(residency, sizeof(indices));
 
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load("resources/container.jpg", &width, &height, &nrChannels, 0);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        non_fatal_error("Failed to load texture\n");
-    }
-    stbi_image_free(data);
+    // Built by the resources_pack target. Without it, assets are loose files relative to the working directory.
+    AssetPack* pack = open_asset_pack("assets.pack");
+    if (!pack) { non_fatal_error("No assets.pack next to the executable, loading loose files.\n"); }
+
+    TextureHandle texture = texture_load(resources, residency, pack, jobs, "resources/container.jpg");
+    if (!texture.id) { non_fatal_error("Failed to load texture\n"); }
+    uint32_t texture_asset = hot_reload_watch_texture(reload, "resources/container.jpg");
+
+    ResidencyOp residency_ops[64];
 
     ShowWindow(window, cmd_show);
     UpdateWindow(window);
@@ -462,25 +1745,186 @@ int WINAPI WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmd_line, int cmd_show)
                 DispatchMessage(&msg);
             }
         }
+        input_queue_flush(window_state.input);
+
+        // Swap in anything that finished reloading since last frame.
+        hot_reload_poll(reload);
+        HotReloadResult reloaded;
+        while (hot_reload_next(reload, &reloaded)) {
+            if (!reloaded.ok) {
+                non_fatal_error(reloaded.error);
+                non_fatal_error("\n");
+            } else if (reloaded.asset == texture_asset && texture.id) {
+                // The old texture may still be sampled by frames in flight, so it is retired rather than deleted.
+                StreamedTexture* replacement = (StreamedTexture*)calloc(1, sizeof(StreamedTexture));
+                if (streamed_texture_create(residency, &reloaded.mips, replacement)) {
+                    resource_replace_texture(
+                        resources, texture, replacement->id, streamed_texture_bytes(replacement), replacement);
+                } else {
+                    free(replacement);
+                }
+            } else {
+                reloadable_program_update(&program, &reloaded);
+            }
+            hot_reload_release(&reloaded);
+        }
+        reloadable_program_swap(&program, resources);
+        shader.id = program.slot.active;
+
+        if (surface_size_apply(surface) && surface->width > 0 && surface->height > 0) {
+            if (!render_target_resize(&scene_target, surface->width, surface->height, resources, residency)) {
+                fatal_error("Failed to resize the scene render target.");
+            }
+        }
+        if (surface->width == 0 || surface->height == 0) {
+            // Minimised; nothing to draw until the window comes back.
+            WaitMessage();
+            continue;
+        }
+
+        float gpu_ms;
+        while (gpu_timer_read(&gpu_timer, &gpu_ms)) {
+            dynamic_resolution_update(&drs, gpu_ms);
+        }
+        int32_t scene_width, scene_height;
+        dynamic_resolution_scaled_size(&drs, surface->width, surface->height, &scene_width, &scene_height);
 
         // Update logic here.
+        InputEvent event;
+        while (input_queue_pop(window_state.input, &event)) {
+            input_latency_consume(&input_latency, &event);
+            if (event.type == INPUT_KEY_DOWN && event.code == VK_ESCAPE) { PostMessage(window, WM_CLOSE, 0, 0); }
+            if (event.type == INPUT_MOUSE_MOVE) { particle_emitter_move(sparks, event.x, event.y); }
+            if (event.type == INPUT_MOUSE_DOWN) { particle_emitter_burst(sparks, SPARK_BURST); }
+            if ((event.type == INPUT_KEY_DOWN || event.type == INPUT_KEY_UP) && event.code >= VK_LEFT
+                && event.code <= VK_DOWN) {
+                arrows_held[event.code - VK_LEFT] = event.type == INPUT_KEY_DOWN;
+            }
+            if (event.type == INPUT_MOUSE_DOWN && event.code == INPUT_MOUSE_RIGHT) {
+                // Paints a block of tiles under the cursor, which rebuilds the chunks it touches.
+                uint32_t x = (uint32_t)((camera_x + event.x) / TILESET_TILE_PIXELS);
+                uint32_t y = (uint32_t)((camera_y + event.y) / TILESET_TILE_PIXELS);
+                tilemap_fill(tilemap, x > 2 ? x - 2 : 0, y > 2 ? y - 2 : 0, 5, 5, TILEMAP_PAINT_TILE);
+            }
+        }
+
+        // Long stalls, like dragging the window, are stepped as a tenth of a second rather than all at once.
+        uint64_t now_ns = input_now_ns();
+        float dt        = fminf((float)((now_ns - last_frame_ns) / 1e9), 0.1f);
+        last_frame_ns   = now_ns;
+        particle_emitter_move(fountain, surface->width * 0.5f, surface->height - 16.0f);
+        uint32_t particle_count = particle_system_update(particles, dt);
+        uint64_t particle_ns    = input_now_ns() - now_ns;
 
+        float map_pixels = TILEMAP_SIZE * TILESET_TILE_PIXELS;
+        camera_x += (arrows_held[2] - arrows_held[0]) * TILEMAP_PAN_SPEED * dt;
+        camera_y += (arrows_held[3] - arrows_held[1]) * TILEMAP_PAN_SPEED * dt;
+        camera_x = fmaxf(fminf(camera_x, map_pixels - surface->width), 0.0f);
+        camera_y = fmaxf(fminf(camera_y, map_pixels - surface->height), 0.0f);
+
+        uint32_t tilemap_draw_count = tilemap_update(tilemap, camera_x, camera_y, (float)surface->width,
+            (float)surface->height, tilemap_draws, TILEMAP_MAX_DRAWS);
+
+        gpu_timer_begin(&gpu_timer);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, scene_target.framebuffer);
+        glViewport(0, 0, scene_width, scene_height);
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glBindTexture(GL_TEXTURE_2D, texture);
+        tilemap_pass_draw(&tilemap_pass, tilemap_draws, tilemap_draw_count, camera_x, camera_y, surface->width,
+            surface->height);
+
+        // The quad covers half the scene in each direction.
+        StreamedTexture* streamed = (StreamedTexture*)resource_data(resources, RESOURCE_TEXTURE, texture.id);
+        if (streamed) {
+            residency_request_texture(residency, streamed->residency_id, scene_width / 2, scene_height / 2);
+        }
+        uint32_t op_count = residency_update(residency, residency_ops, 64);
+        apply_residency_ops(residency, residency_ops, op_count, streamed, streamed ? 1 : 0);
+        log_residency_metrics(residency);
+
+        glBindTexture(GL_TEXTURE_2D, resource_texture(resources, texture));
 
         shader_use(&shader);
-        glBindVertexArray(vao);
+        glBindVertexArray(resource_vertex_array(resources, quad_vao));
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+        uint64_t particle_start = input_now_ns();
+        particle_pass_draw(&particle_pass, particles, particle_count, surface->width, surface->height);
+        particle_ns += input_now_ns() - particle_start;
+        particle_ms = particle_ms * 0.9f + (float)(particle_ns / 1e6) * 0.1f;
+
+        render_target_present(&scene_target, scene_width, scene_height);
+
+        // Text goes straight onto the backbuffer, at the window's resolution whatever the scene was drawn at.
+        if (frame_index++ % DEBUG_STATS_INTERVAL == 0) {
+            format_debug_stats(debug_stats, sizeof(debug_stats), &drs, scene_width, scene_height, &input_latency,
+                glyphs, text, resources, residency, pack, particles, particle_ms, tilemap);
+        }
+        uint32_t upload_count = glyph_cache_update(glyphs, glyph_uploads, GLYPH_UPLOADS_PER_FRAME);
+        text_pass_upload(&text_pass, glyph_uploads, upload_count);
+        text_draw(text, debug_stats, 8.0f, 8.0f, 16.0f, 0xFFFFFFFFu);
+        text_pass_draw(&text_pass, text, surface->width, surface->height);
+        text_renderer_end_frame(text);
+
+        gpu_timer_end(&gpu_timer);
+
         SwapBuffers(dc);
+        if (gl_capture_active()) {
+            gl_capture_frame();
+            if (++captured_frames == options.capture_frames) { end_capture(); }
+        }
+        uint32_t destroy_count = resource_manager_end_frame(resources, resource_destroys, 64);
+        destroy_resources(residency, resource_destroys, destroy_count);
+        if (input_latency_present(&input_latency, input_now_ns())) {
+            log_input_latency(&input_latency, window_state.input);
+        }
     }
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-
+    if (program.slot.pending) { glDeleteProgram(program.slot.pending); }
+    resource_release_program(resources, program.handle);
+    resource_release_vertex_array(resources, quad_vao);
+    resource_release_buffer(resources, quad_vbo);
+    resource_release_buffer(resources, quad_ebo);
+    resource_release_texture(resources, texture);
+    render_target_destroy(&scene_target, resources, residency);
+    text_pass_destroy(&text_pass, resources, residency);
+    particle_pass_destroy(&particle_pass, resources, residency);
+    tilemap_pass_destroy(&tilemap_pass, resources, residency);
+    uint32_t destroy_count;
+    while ((destroy_count = resource_manager_drain(resources, resource_destroys, 64)) > 0) {
+        destroy_resources(residency, resource_destroys, destroy_count);
+    }
+    resource_manager_destroy(resources);
+    asset_pack_close(pack);
+    SetWindowLongPtr(window, GWLP_USERDATA, 0);
+    input_queue_destroy(window_state.input);
+    glDeleteQueries(GPU_TIMER_QUERIES, gpu_timer.queries);
+
+    residency_unregister_buffer(residency, vbo_residency);
+    residency_unregister_buffer(residency, ebo_residency);
+    residency_destroy(residency);
+
+    text_renderer_destroy(text);
+    particle_system_destroy(particles);
+    tilemap_destroy(tilemap);
+    glyph_cache_destroy(glyphs);
+
+    free(program.owned[0]);
+    free(program.owned[1]);
+    hot_reload_destroy(reload);
+    job_pool_destroy(jobs);
+
+#ifndef NDEBUG
+    // Feed this back to the build with -DWGL_SHADER_USAGE=... to stop embedding variants nothing uses.
+    char usage[1024];
+    shader_usage_report(shader_sources, SHADER_SOURCE_COUNT, usage, sizeof(usage));
+    non_fatal_error(usage);
+    shader_usage_write("shader_usage.txt", shader_sources, SHADER_SOURCE_COUNT);
+#endif
+
+    end_capture();
     wglMakeCurrent(dc, 0);
     wglDeleteContext(rc);
     ReleaseDC(window, dc);
@@ -0,0 +1,629 @@
+/* Linux counterpart of win32_hello_triangle.cpp: an X11 window with an EGL context, or no window at all. */
+/* Usage: linux_hello_triangle [--headless] [--frames 0] [--draws 1] [--width 1024] [--height 576] */
+/*                             [--screenshot out.ppm] [--capture out.trace | --replay in.trace] */
+/* --headless renders into an EGL pbuffer on Mesa's surfaceless platform, so it needs neither an X server nor a GPU */
+/* (Mesa falls back to llvmpipe), and reports how long context creation, shader builds and frames took. */
+/* Built with LINUX_HEADLESS_ONLY, when X11 is missing or WGL_LINUX_WINDOWED is off, it always runs headless. */
+/* --capture records the GL calls of every frame into a trace for tools/gl_trace; --replay plays one back instead of */
+/* drawing, one recorded frame per frame. */
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#if !defined(LINUX_HEADLESS_ONLY)
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#endif
+
+#include <GL/glcorearb.h>
+
+#include "gl_capture.h"
+#include "shaders.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+PFNGLATTACHSHADERPROC glAttachShader;
+PFNGLBINDVERTEXARRAYPROC glBindVertexArray;
+PFNGLCLEARPROC glClear;
+PFNGLCLEARCOLORPROC glClearColor;
+PFNGLCOMPILESHADERPROC glCompileShader;
+PFNGLCREATEPROGRAMPROC glCreateProgram;
+PFNGLCREATESHADERPROC glCreateShader;
+PFNGLDEBUGMESSAGECALLBACKPROC glDebugMessageCallback;
+PFNGLDELETEPROGRAMPROC glDeleteProgram;
+PFNGLDELETESHADERPROC glDeleteShader;
+PFNGLDELETEVERTEXARRAYSPROC glDeleteVertexArrays;
+PFNGLDRAWARRAYSPROC glDrawArrays;
+PFNGLENABLEPROC glEnable;
+PFNGLFINISHPROC glFinish;
+PFNGLGENVERTEXARRAYSPROC glGenVertexArrays;
+PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
+PFNGLGETPROGRAMIVPROC glGetProgramiv;
+PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog;
+PFNGLGETSHADERIVPROC glGetShaderiv;
+PFNGLGETSTRINGPROC glGetString;
+PFNGLLINKPROGRAMPROC glLinkProgram;
+PFNGLPIXELSTOREIPROC glPixelStorei;
+PFNGLREADPIXELSPROC glReadPixels;
+PFNGLSHADERSOURCEPROC glShaderSource;
+PFNGLUSEPROGRAMPROC glUseProgram;
+PFNGLVIEWPORTPROC glViewport;
+
+typedef struct {
+    GLuint program;
+    GLuint vao;
+    uint32_t draws; // triangles submitted per frame, one draw call each
+} UserData;
+
+typedef struct TargetState {
+    int32_t width;
+    int32_t height;
+    bool headless;
+
+#if !defined(LINUX_HEADLESS_ONLY)
+    Display* x_display; // NULL when headless
+    Window window;
+    Atom wm_delete_window;
+#endif
+    EGLDisplay display;
+    EGLSurface surface; // a pbuffer when headless
+    EGLContext context;
+
+    UserData* user_data;
+    void (*draw_func)(struct TargetState*);
+} TargetState;
+
+typedef struct LaunchOptions {
+    bool headless;
+    uint32_t frames; // 0 runs until the window is closed, or 300 frames when headless
+    uint32_t draws;
+    int32_t width;
+    int32_t height;
+    const char* screenshot_path; // PPM of the last frame
+    const char* capture_path;
+    const char* replay_path;
+} LaunchOptions;
+
+static void fatal_error(const char* msg);
+static void* get_proc_address(const char* proc_name);
+static void debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+    const GLchar* message, const void* userParam);
+static bool has_extension(const char* extensions, const char* name);
+static LaunchOptions parse_command_line(int argc, char** argv);
+static EGLConfig init_egl(TargetState* state);
+#if !defined(LINUX_HEADLESS_ONLY)
+static Window create_window(TargetState* state, EGLConfig config, const char* title);
+#endif
+static EGLSurface create_pbuffer(TargetState* state, EGLConfig config);
+static void init_opengl_extensions();
+static EGLContext init_opengl(TargetState* state, EGLConfig config);
+static bool pump_events(TargetState* state);
+static void deinit_opengl(TargetState* state);
+static bool init(TargetState* state);
+static GLuint load_shader(GLenum type, const char* shader_src);
+static void draw(TargetState* state);
+static bool write_screenshot(TargetState* state, const char* path);
+static GlCaptureDispatch gl_dispatch();
+static void replay_trace(TargetState* state, const char* path);
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    LaunchOptions options = parse_command_line(argc, argv);
+    UserData user_data    = { 0 };
+    user_data.draws       = options.draws;
+    TargetState state     = { 0 };
+    state.user_data       = &user_data;
+    state.width           = options.width;
+    state.height          = options.height;
+    state.headless        = options.headless;
+#if defined(LINUX_HEADLESS_ONLY)
+    // Built without X11, so there is no window to open.
+    state.headless = true;
+#endif
+
+    auto start = std::chrono::steady_clock::now();
+#if !defined(LINUX_HEADLESS_ONLY)
+    if (!state.headless) {
+        state.x_display = XOpenDisplay(NULL);
+        if (!state.x_display) { fatal_error("Failed to open the X display; set DISPLAY or pass --headless."); }
+    }
+#endif
+    EGLConfig config = init_egl(&state);
+    if (state.headless) {
+        state.surface = create_pbuffer(&state, config);
+    } else {
+#if !defined(LINUX_HEADLESS_ONLY)
+        state.window  = create_window(&state, config, "Hello Triangle");
+        state.surface = eglCreateWindowSurface(state.display, config, (EGLNativeWindowType)state.window, NULL);
+        if (state.surface == EGL_NO_SURFACE) { fatal_error("Failed to create the EGL window surface."); }
+#endif
+    }
+    state.context     = init_opengl(&state, config);
+    double context_ms = elapsed_ms(start);
+
+    if (options.replay_path) {
+        replay_trace(&state, options.replay_path);
+        bool ok = !options.screenshot_path || write_screenshot(&state, options.screenshot_path);
+        deinit_opengl(&state);
+        return ok ? 0 : 1;
+    }
+    GlCaptureDispatch dispatch = gl_dispatch();
+    if (options.capture_path && !gl_capture_begin(&dispatch, options.capture_path)) {
+        fatal_error("Failed to create the GL capture file.");
+    }
+
+    start = std::chrono::steady_clock::now();
+    if (!init(&state)) { fatal_error("Failed to initialise user data."); }
+    double program_ms = elapsed_ms(start);
+
+    state.draw_func = draw;
+
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+    printf("context %.1fms, program %.1fms\n", context_ms, program_ms);
+
+    // Headless frames end in glFinish() rather than a swap, so the frame time includes the rendering itself, which a
+    // software rasterizer does on threads of its own.
+    uint32_t frames  = options.frames ? options.frames : state.headless ? 300 : 0;
+    double submit_ms = 0.0, frame_ms = 0.0, worst_ms = 0.0;
+    uint32_t frame   = 0;
+    while ((!frames || frame < frames) && pump_events(&state)) {
+        start = std::chrono::steady_clock::now();
+        state.draw_func(&state);
+        submit_ms += elapsed_ms(start);
+        if (state.headless) {
+            glFinish();
+        } else {
+            eglSwapBuffers(state.display, state.surface);
+        }
+        gl_capture_frame();
+        double ms = elapsed_ms(start);
+        frame_ms += ms;
+        worst_ms = ms > worst_ms ? ms : worst_ms;
+        frame++;
+    }
+
+    if (frame) {
+        printf("%u frames of %u draws at %dx%d: submit %.3fms, frame %.3fms (worst %.3fms)\n", frame, user_data.draws,
+            state.width, state.height, submit_ms / frame, frame_ms / frame, worst_ms);
+    }
+    bool ok = !options.screenshot_path || write_screenshot(&state, options.screenshot_path);
+    if (gl_capture_active()) {
+        GlTraceStats stats;
+        bool written = gl_capture_end(&stats);
+        printf("GL capture %s: %u frames, %llu calls, %.1f KiB trace\n", written ? "written" : "failed to write",
+            stats.frames, (unsigned long long)stats.calls, stats.file_bytes / 1024.0);
+        ok = ok && written;
+    }
+
+    deinit_opengl(&state);
+    state.user_data = NULL;
+
+    return ok ? 0 : 1;
+}
+
+static void fatal_error(const char* msg)
+{
+    fprintf(stderr, "%s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+// EGL 1.5 hands out core GL functions as well as extensions, so there is no need to link libGL.
+static void* get_proc_address(const char* proc_name) { return (void*)eglGetProcAddress(proc_name); }
+
+static void debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+    const GLchar* message, const void* userParam)
+{
+    fprintf(stderr, "GL CALLBACK: %s type = 0x%x, severity = 0x%x, message = %s\n",
+        (type == GL_DEBUG_TYPE_ERROR ? "** GL ERROR **" : ""), type, severity, message);
+}
+
+static bool has_extension(const char* extensions, const char* name)
+{
+    size_t length = strlen(name);
+    for (const char* at = extensions; at && (at = strstr(at, name)) != NULL; at += length) {
+        bool starts = at == extensions || at[-1] == ' ';
+        bool ends   = at[length] == ' ' || at[length] == '\0';
+        if (starts && ends) { return true; }
+    }
+    return false;
+}
+
+static LaunchOptions parse_command_line(int argc, char** argv)
+{
+    LaunchOptions options = { 0 };
+    options.draws         = 1;
+    options.width         = 1024;
+    options.height        = 576;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--draws" && i + 1 < argc) {
+            options.draws = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--width" && i + 1 < argc) {
+            options.width = (int32_t)strtol(argv[++i], NULL, 10);
+        } else if (arg == "--height" && i + 1 < argc) {
+            options.height = (int32_t)strtol(argv[++i], NULL, 10);
+        } else if (arg == "--screenshot" && i + 1 < argc) {
+            options.screenshot_path = argv[++i];
+        } else if (arg == "--capture" && i + 1 < argc) {
+            options.capture_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replay_path = argv[++i];
+        } else {
+            fatal_error("usage: linux_hello_triangle [--headless] [--frames 0] [--draws 1] [--width 1024] "
+                        "[--height 576] [--screenshot out.ppm] [--capture out.trace | --replay in.trace]");
+        }
+    }
+    if (options.width <= 0 || options.height <= 0) { fatal_error("The size has to be at least 1x1."); }
+    return options;
+}
+
+static EGLConfig init_egl(TargetState* state)
+{
+    // Displays come from the platform extensions when there are any, so that a headless display never goes looking
+    // for an X server; Mesa's surfaceless platform renders with whatever driver it finds, llvmpipe without a GPU.
+    const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display
+        = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (state->headless) {
+        if (get_platform_display && has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+            state->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        } else {
+            state->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+    } else {
+#if !defined(LINUX_HEADLESS_ONLY)
+        if (get_platform_display && has_extension(client_extensions, "EGL_EXT_platform_x11")) {
+            state->display = get_platform_display(EGL_PLATFORM_X11_EXT, state->x_display, NULL);
+        } else {
+            state->display = eglGetDisplay((EGLNativeDisplayType)state->x_display);
+        }
+#endif
+    }
+    if (state->display == EGL_NO_DISPLAY) { fatal_error("Failed to get an EGL display."); }
+
+    EGLint major, minor;
+    if (!eglInitialize(state->display, &major, &minor)) { fatal_error("Failed to initialise EGL."); }
+    if (major == 1 && minor < 5) { fatal_error("EGL 1.5 is required to load core GL functions."); }
+    if (!eglBindAPI(EGL_OPENGL_API)) { fatal_error("EGL does not support desktop OpenGL."); }
+
+    // The same buffers as the WGL pixel format asks for.
+    EGLint config_attribs[] = { EGL_SURFACE_TYPE, state->headless ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8, EGL_NONE };
+
+    EGLConfig config;
+    EGLint num_configs;
+    if (!eglChooseConfig(state->display, config_attribs, &config, 1, &num_configs) || !num_configs) {
+        fatal_error("Failed to find a suitable EGL config.");
+    }
+    return config;
+}
+
+#if !defined(LINUX_HEADLESS_ONLY)
+static Window create_window(TargetState* state, EGLConfig config, const char* title)
+{
+    // The window has to use the visual the EGL config renders with.
+    EGLint visual_id;
+    eglGetConfigAttrib(state->display, config, EGL_NATIVE_VISUAL_ID, &visual_id);
+    XVisualInfo visual_template = { 0 };
+    visual_template.visualid    = (VisualID)visual_id;
+    int visual_count;
+    XVisualInfo* visual = XGetVisualInfo(state->x_display, VisualIDMask, &visual_template, &visual_count);
+    if (!visual) { fatal_error("Failed to find the X visual of the EGL config."); }
+
+    Window root                = DefaultRootWindow(state->x_display);
+    XSetWindowAttributes attrs = { 0 };
+    attrs.colormap             = XCreateColormap(state->x_display, root, visual->visual, AllocNone);
+    attrs.event_mask           = StructureNotifyMask | KeyPressMask;
+
+    Window window = XCreateWindow(state->x_display, root, 0, 0, state->width, state->height, 0, visual->depth,
+        InputOutput, visual->visual, CWColormap | CWEventMask, &attrs);
+    XFree(visual);
+    if (!window) { fatal_error("Failed to create window."); }
+
+    // Closing the window sends a message rather than killing the connection.
+    state->wm_delete_window = XInternAtom(state->x_display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(state->x_display, window, &state->wm_delete_window, 1);
+    XStoreName(state->x_display, window, title);
+    XMapWindow(state->x_display, window);
+
+    return window;
+}
+#endif
+
+static EGLSurface create_pbuffer(TargetState* state, EGLConfig config)
+{
+    EGLint pbuffer_attribs[] = { EGL_WIDTH, state->width, EGL_HEIGHT, state->height, EGL_NONE };
+    EGLSurface surface       = eglCreatePbufferSurface(state->display, config, pbuffer_attribs);
+    if (surface == EGL_NO_SURFACE) { fatal_error("Failed to create the EGL pbuffer."); }
+    return surface;
+}
+
+static void init_opengl_extensions()
+{
+    glAttachShader            = (PFNGLATTACHSHADERPROC)get_proc_address("glAttachShader");
+    glBindVertexArray         = (PFNGLBINDVERTEXARRAYPROC)get_proc_address("glBindVertexArray");
+    glClear                   = (PFNGLCLEARPROC)get_proc_address("glClear");
+    glClearColor              = (PFNGLCLEARCOLORPROC)get_proc_address("glClearColor");
+    glCompileShader           = (PFNGLCOMPILESHADERPROC)get_proc_address("glCompileShader");
+    glCreateProgram           = (PFNGLCREATEPROGRAMPROC)get_proc_address("glCreateProgram");
+    glCreateShader            = (PFNGLCREATESHADERPROC)get_proc_address("glCreateShader");
+    glDebugMessageCallback    = (PFNGLDEBUGMESSAGECALLBACKPROC)get_proc_address("glDebugMessageCallback");
+    glDeleteProgram           = (PFNGLDELETEPROGRAMPROC)get_proc_address("glDeleteProgram");
+    glDeleteShader            = (PFNGLDELETESHADERPROC)get_proc_address("glDeleteShader");
+    glDeleteVertexArrays      = (PFNGLDELETEVERTEXARRAYSPROC)get_proc_address("glDeleteVertexArrays");
+    glDrawArrays              = (PFNGLDRAWARRAYSPROC)get_proc_address("glDrawArrays");
+    glEnable                  = (PFNGLENABLEPROC)get_proc_address("glEnable");
+    glFinish                  = (PFNGLFINISHPROC)get_proc_address("glFinish");
+    glGenVertexArrays         = (PFNGLGENVERTEXARRAYSPROC)get_proc_address("glGenVertexArrays");
+    glGetProgramInfoLog       = (PFNGLGETPROGRAMINFOLOGPROC)get_proc_address("glGetProgramInfoLog");
+    glGetProgramiv            = (PFNGLGETPROGRAMIVPROC)get_proc_address("glGetProgramiv");
+    glGetShaderInfoLog        = (PFNGLGETSHADERINFOLOGPROC)get_proc_address("glGetShaderInfoLog");
+    glGetShaderiv             = (PFNGLGETSHADERIVPROC)get_proc_address("glGetShaderiv");
+    glGetString               = (PFNGLGETSTRINGPROC)get_proc_address("glGetString");
+    glLinkProgram             = (PFNGLLINKPROGRAMPROC)get_proc_address("glLinkProgram");
+    glPixelStorei             = (PFNGLPIXELSTOREIPROC)get_proc_address("glPixelStorei");
+    glReadPixels              = (PFNGLREADPIXELSPROC)get_proc_address("glReadPixels");
+    glShaderSource            = (PFNGLSHADERSOURCEPROC)get_proc_address("glShaderSource");
+    glUseProgram              = (PFNGLUSEPROGRAMPROC)get_proc_address("glUseProgram");
+    glViewport                = (PFNGLVIEWPORTPROC)get_proc_address("glViewport");
+}
+
+static EGLContext init_opengl(TargetState* state, EGLConfig config)
+{
+    // Specify that we want to create an OpenGL 3.3 core profile context
+    EGLint gl33_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        3,
+        EGL_CONTEXT_MINOR_VERSION,
+        3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+
+    EGLContext gl33_context = eglCreateContext(state->display, config, EGL_NO_CONTEXT, gl33_attribs);
+    if (gl33_context == EGL_NO_CONTEXT) { fatal_error("Failed to create OpenGL 3.3 context."); }
+
+    if (!eglMakeCurrent(state->display, state->surface, state->surface, gl33_context)) {
+        fatal_error("Failed to activate OpenGL 3.3 rendering context.");
+    }
+
+    init_opengl_extensions();
+
+    // Only there with GL 4.3 or KHR_debug.
+    if (glDebugMessageCallback) {
+        glEnable(GL_DEBUG_OUTPUT);
+        glDebugMessageCallback(debug_message_callback, 0);
+    }
+
+    return gl33_context;
+}
+
+// Handles every pending X event. Returns false once the window has been closed, or Escape pressed.
+static bool pump_events(TargetState* state)
+{
+    if (state->headless) { return true; }
+
+#if !defined(LINUX_HEADLESS_ONLY)
+    while (XPending(state->x_display)) {
+        XEvent event;
+        XNextEvent(state->x_display, &event);
+        switch (event.type) {
+        case ConfigureNotify:
+            // draw() sets the viewport from these every frame, and EGL resizes the surface along with the window.
+            state->width  = event.xconfigure.width;
+            state->height = event.xconfigure.height;
+            break;
+        case ClientMessage:
+            if ((Atom)event.xclient.data.l[0] == state->wm_delete_window) { return false; }
+            break;
+        case KeyPress:
+            if (XLookupKeysym(&event.xkey, 0) == XK_Escape) { return false; }
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+    return true;
+}
+
+static void deinit_opengl(TargetState* state)
+{
+    glDeleteVertexArrays(1, &state->user_data->vao);
+    glDeleteProgram(state->user_data->program);
+
+    eglMakeCurrent(state->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(state->display, state->context);
+    eglDestroySurface(state->display, state->surface);
+    eglTerminate(state->display);
+#if !defined(LINUX_HEADLESS_ONLY)
+    if (state->x_display) {
+        XDestroyWindow(state->x_display, state->window);
+        XCloseDisplay(state->x_display);
+    }
+#endif
+}
+
+static bool init(TargetState* state)
+{
+    const ShaderVariant* v_shader = shader_variant(&triangle_vert, 0);
+    const ShaderVariant* f_shader = shader_variant(&triangle_frag, 0);
+    if (!v_shader || !f_shader) { return false; }
+
+    GLuint program, vertex_shader, fragment_shader;
+
+    vertex_shader   = load_shader(GL_VERTEX_SHADER, v_shader->source);
+    fragment_shader = load_shader(GL_FRAGMENT_SHADER, f_shader->source);
+    if (!vertex_shader || !fragment_shader) { return false; }
+
+    program = glCreateProgram();
+    if (program == 0) { return false; }
+
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+
+    glLinkProgram(program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    // Asking for the status waits for the link, so the time init() takes covers the whole shader build.
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint info_len = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_len);
+        if (info_len > 1) {
+            char* info_log = (char*)malloc(sizeof(char) * info_len);
+            glGetProgramInfoLog(program, info_len, NULL, info_log);
+            fprintf(stderr, "Error linking program:\n%s\n", info_log);
+            free(info_log);
+        }
+        glDeleteProgram(program);
+        return false;
+    }
+
+    state->user_data->program = program;
+
+    // The triangle's corners come from gl_VertexID, but core profile draws still need a vertex array bound.
+    glGenVertexArrays(1, &state->user_data->vao);
+
+    return true;
+}
+
+static GLuint load_shader(GLenum type, const char* shader_src)
+{
+    GLuint shader = glCreateShader(type);
+
+    if (shader == 0) { return 0; }
+    glShaderSource(shader, 1, &shader_src, NULL);
+    glCompileShader(shader);
+
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        GLint info_len = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_len);
+        if (info_len > 1) {
+            char* info_log = (char*)malloc(sizeof(char) * info_len);
+            glGetShaderInfoLog(shader, info_len, NULL, info_log);
+            fprintf(stderr, "Error compiling this shader:\n%s\n", info_log);
+            free(info_log);
+        }
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static void draw(TargetState* state)
+{
+    glViewport(0, 0, state->width, state->height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(state->user_data->program);
+    glBindVertexArray(state->user_data->vao);
+    for (uint32_t i = 0; i < state->user_data->draws; i++) {
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindVertexArray(0);
+}
+
+// Binary PPM, top row first, so a render farm can check what was drawn.
+static bool write_screenshot(TargetState* state, const char* path)
+{
+    size_t row_size = (size_t)state->width * 3;
+    uint8_t* pixels = (uint8_t*)malloc(row_size * state->height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, state->width, state->height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+    FILE* file = fopen(path, "wb");
+    bool ok    = file != NULL;
+    if (ok) {
+        fprintf(file, "P6\n%d %d\n255\n", state->width, state->height);
+        for (int32_t y = state->height - 1; y >= 0 && ok; y--) {
+            ok = fwrite(pixels + row_size * y, 1, row_size, file) == row_size;
+        }
+        ok = fclose(file) == 0 && ok;
+    }
+    if (!ok) { fprintf(stderr, "Failed to write %s\n", path); }
+    free(pixels);
+    return ok;
+}
+
+// The entry points this sample loads that gl_capture knows; the others stay NULL, so they are neither captured nor
+// replayed.
+static GlCaptureDispatch gl_dispatch()
+{
+    GlCaptureDispatch dispatch    = {};
+    dispatch.glAttachShader       = &glAttachShader;
+    dispatch.glBindVertexArray    = &glBindVertexArray;
+    dispatch.glClear              = &glClear;
+    dispatch.glClearColor         = &glClearColor;
+    dispatch.glCompileShader      = &glCompileShader;
+    dispatch.glCreateProgram      = &glCreateProgram;
+    dispatch.glCreateShader       = &glCreateShader;
+    dispatch.glDeleteProgram      = &glDeleteProgram;
+    dispatch.glDeleteShader       = &glDeleteShader;
+    dispatch.glDeleteVertexArrays = &glDeleteVertexArrays;
+    dispatch.glDrawArrays         = &glDrawArrays;
+    dispatch.glEnable             = &glEnable;
+    dispatch.glGenVertexArrays    = &glGenVertexArrays;
+    dispatch.glLinkProgram        = &glLinkProgram;
+    dispatch.glPixelStorei        = &glPixelStorei;
+    dispatch.glShaderSource       = &glShaderSource;
+    dispatch.glUseProgram         = &glUseProgram;
+    dispatch.glViewport           = &glViewport;
+    return dispatch;
+}
+
+// Plays a trace back through the same entry points, ending each recorded frame the way the frame loop does.
+static void replay_trace(TargetState* state, const char* path)
+{
+    GlTraceReader* reader = gl_trace_open(path);
+    if (!reader) { fatal_error("Not a GL trace, nothing to replay."); }
+
+    GlCaptureDispatch dispatch = gl_dispatch();
+    GlReplay* replay           = gl_replay_create(&dispatch);
+    uint32_t frames            = 0;
+    uint32_t skipped           = 0;
+    double frame_ms = 0.0, worst_ms = 0.0;
+    auto start      = std::chrono::steady_clock::now();
+    GlTraceRecord record;
+    while (gl_trace_next(reader, &record) && pump_events(state)) {
+        if (record.call != GL_TRACE_FRAME) {
+            skipped += !gl_replay_call(replay, &record);
+            continue;
+        }
+        if (state->headless) {
+            glFinish();
+        } else {
+            eglSwapBuffers(state->display, state->surface);
+        }
+        double ms = elapsed_ms(start);
+        start     = std::chrono::steady_clock::now();
+        frame_ms += ms;
+        worst_ms = ms > worst_ms ? ms : worst_ms;
+        frames++;
+    }
+
+    printf("GL replay%s: %u frames, frame %.3fms (worst %.3fms), %u calls skipped\n",
+        gl_trace_failed(reader) ? " stopped at a malformed record" : "", frames, frames ? frame_ms / frames : 0.0,
+        worst_ms, skipped);
+    gl_replay_destroy(replay);
+    gl_trace_reader_close(reader);
+}
@@ -1,34 +1,25 @@
 #include "application.h"
 
+#include "shaders.h"
+
+#include <cstdlib>
+
 Application::Application()
 {
-    static const char* vs_source[] = { "#version 410 core                                                 \n"
-                                       "                                                                  \n"
-                                       "void main(void)                                                   \n"
-                                       "{                                                                 \n"
-                                       "    const vec4 vertices[] = vec4[](vec4( 0.25, -0.25, 0.5, 1.0),  \n"
-                                       "                                   vec4(-0.25, -0.25, 0.5, 1.0),  \n"
-                                       "                                   vec4( 0.25,  0.25, 0.5, 1.0)); \n"
-                                       "                                                                  \n"
-                                       "    gl_Position = vertices[gl_VertexID];                          \n"
-                                       "}                                                                 \n" };
-
-    static const char* fs_source[] = { "#version 410 core                                                 \n"
-                                       "                                                                  \n"
-                                       "out vec4 color;                                                   \n"
-                                       "                                                                  \n"
-                                       "void main(void)                                                   \n"
-                                       "{                                                                 \n"
-                                       "    color = vec4(0.0, 0.8, 1.0, 1.0);                             \n"
-                                       "}                                                                 \n" };
+    const ShaderVariant* vs_source = shader_variant(&triangle_vert, 0);
+    const ShaderVariant* fs_source = shader_variant(&triangle_frag, 0);
+    if (!vs_source || !fs_source) {
+        std::cerr << "Shader variant was pruned from the build." << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
     program   = glCreateProgram();
     GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, fs_source, NULL);
+    glShaderSource(fs, 1, &fs_source->source, NULL);
     glCompileShader(fs);
 
     GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, vs_source, NULL);
+    glShaderSource(vs, 1, &vs_source->source, NULL);
     glCompileShader(vs);
 
     glAttachShader(program, vs);
@@ -38,10 +29,18 @@ Application::Application()
 
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
+
+    input_queue = input_queue_create(1024);
+    input_latency_reset(&input_latency);
 }
 
 void Application::update()
 {
+    InputEvent event;
+    while (input_queue_pop(input_queue, &event)) {
+        input_latency_consume(&input_latency, &event);
+    }
+
     static const GLfloat green[] = { 0.0f, 0.25f, 0.0f, 1.0f };
     glClearBufferfv(GL_COLOR, 0, green);
 
@@ -49,8 +48,22 @@ void Application::update()
     glDrawArrays(GL_TRIANGLES, 0, 3);
 }
 
+// Call once the frame has been handed to the display.
+void Application::presented()
+{
+    if (!input_latency_present(&input_latency, input_now_ns())) { return; }
+    if (input_latency.frames % INPUT_LATENCY_HISTORY != 0) { return; }
+
+    InputLatencyStats stats = input_latency_stats(&input_latency);
+    InputQueueStats queue   = input_queue_stats(input_queue);
+    std::cout << "input: latency mean " << stats.mean_ms << "ms p95 " << stats.p95_ms << "ms max " << stats.max_ms
+              << "ms, " << queue.pushed << " events -> " << queue.published << " after coalescing, " << queue.dropped
+              << " dropped" << std::endl;
+}
+
 Application::~Application()
 {
     glDeleteVertexArrays(1, &vao);
     glDeleteProgram(program);
+    input_queue_destroy(input_queue);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "input_queue.h"
+
 #include <OpenGL/gl3.h>
 #include <iostream>
 
@@ -7,9 +9,13 @@ class Application {
 private:
     GLuint program;
     GLuint vao;
+    InputQueue* input_queue;
+    InputLatency input_latency;
 
 public:
     Application();
     void update();
+    void presented();
+    InputQueue* input() { return input_queue; }
     ~Application();
 };
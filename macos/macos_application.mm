@@ -66,12 +66,63 @@ BOOL shouldStop = NO;
         return;
     }
     if ([self isVisible]) {
+        input_queue_flush(appInstance->input());
         appInstance->update();
         [glView update];
         [[glView openGLContext] flushBuffer];
+        appInstance->presented();
     }
 }
 
+// Input is queued here, on the main thread's event loop, and consumed by Application::update().
+- (void)pushInput:(InputEventType)type code:(uint32_t)code x:(float)x y:(float)y
+{
+    InputEvent event   = {};
+    event.timestamp_ns = input_now_ns();
+    event.type         = type;
+    event.code         = code;
+    event.x            = x;
+    event.y            = y;
+    input_queue_push(appInstance->input(), &event);
+}
+
+- (void)pushMouse:(InputEventType)type button:(InputMouseButton)button event:(NSEvent*)event
+{
+    // Window pixels with the origin at the top left, the same as on Windows.
+    NSPoint point = [glView convertPointToBacking:[glView convertPoint:[event locationInWindow] fromView:nil]];
+    NSRect bounds = [glView convertRectToBacking:[glView bounds]];
+    [self pushInput:type code:button x:point.x y:bounds.size.height - point.y];
+}
+
+- (void)keyDown:(NSEvent*)event
+{
+    if (![event isARepeat]) { [self pushInput:INPUT_KEY_DOWN code:[event keyCode] x:0 y:0]; }
+}
+
+- (void)keyUp:(NSEvent*)event { [self pushInput:INPUT_KEY_UP code:[event keyCode] x:0 y:0]; }
+
+- (void)mouseMoved:(NSEvent*)event
+{
+    [self pushMouse:INPUT_MOUSE_MOVE button:INPUT_MOUSE_LEFT event:event];
+    [self pushInput:INPUT_MOUSE_RAW code:0 x:[event deltaX] y:[event deltaY]];
+}
+
+- (void)mouseDragged:(NSEvent*)event { [self mouseMoved:event]; }
+- (void)rightMouseDragged:(NSEvent*)event { [self mouseMoved:event]; }
+- (void)otherMouseDragged:(NSEvent*)event { [self mouseMoved:event]; }
+
+- (void)mouseDown:(NSEvent*)event { [self pushMouse:INPUT_MOUSE_DOWN button:INPUT_MOUSE_LEFT event:event]; }
+- (void)mouseUp:(NSEvent*)event { [self pushMouse:INPUT_MOUSE_UP button:INPUT_MOUSE_LEFT event:event]; }
+- (void)rightMouseDown:(NSEvent*)event { [self pushMouse:INPUT_MOUSE_DOWN button:INPUT_MOUSE_RIGHT event:event]; }
+- (void)rightMouseUp:(NSEvent*)event { [self pushMouse:INPUT_MOUSE_UP button:INPUT_MOUSE_RIGHT event:event]; }
+- (void)otherMouseDown:(NSEvent*)event { [self pushMouse:INPUT_MOUSE_DOWN button:INPUT_MOUSE_MIDDLE event:event]; }
+- (void)otherMouseUp:(NSEvent*)event { [self pushMouse:INPUT_MOUSE_UP button:INPUT_MOUSE_MIDDLE event:event]; }
+
+- (void)scrollWheel:(NSEvent*)event
+{
+    [self pushInput:INPUT_MOUSE_WHEEL code:0 x:[event deltaX] y:[event deltaY]];
+}
+
 - (void)applicationDidFinishLaunching:(NSNotification*)notification
 {
     [NSTimer scheduledTimerWithTimeInterval:0.000001
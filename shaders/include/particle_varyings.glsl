@@ -0,0 +1,4 @@
+// Interface between particle.vert and particle.frag. Define VARYING as `out` in the vertex stage and `in` in the
+// fragment stage before including.
+VARYING vec2 Corner;
+VARYING vec4 Color;
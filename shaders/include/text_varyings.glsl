@@ -0,0 +1,4 @@
+// Interface between text.vert and text.frag. Define VARYING as `out` in the vertex stage and `in` in the fragment
+// stage before including.
+VARYING vec2 TexCoord;
+VARYING vec4 Color;
@@ -0,0 +1,4 @@
+// Interface between textured.vert and textured.frag. Define VARYING as `out` in the vertex stage and `in` in the
+// fragment stage before including.
+VARYING vec3 ourColor;
+VARYING vec2 TexCoord;
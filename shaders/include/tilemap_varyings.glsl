@@ -0,0 +1,3 @@
+// Interface between tilemap.vert and tilemap.frag. Define VARYING as `out` in the vertex stage and `in` in the
+// fragment stage before including.
+VARYING vec2 TexCoord;
@@ -0,0 +1,11 @@
+out vec4 FragColor;
+
+#define VARYING in
+#include "include/particle_varyings.glsl"
+
+void main()
+{
+	// A soft round dot filling the quad.
+	float alpha = 1.0 - smoothstep(0.5, 1.0, length(Corner));
+	FragColor = vec4(Color.rgb, Color.a * alpha);
+}
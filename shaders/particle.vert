@@ -0,0 +1,18 @@
+// one ParticleInstance per instance, drawn as a four vertex triangle strip
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in float aSize;
+layout (location = 2) in vec4 aColor;
+
+#define VARYING out
+#include "include/particle_varyings.glsl"
+
+// window size in pixels; particle positions are pixels from the top left
+uniform vec2 screenSize;
+
+void main()
+{
+	Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	vec2 pos = aPos + Corner * aSize * 0.5;
+	gl_Position = vec4(pos.x / screenSize.x * 2.0 - 1.0, 1.0 - pos.y / screenSize.y * 2.0, 0.0, 1.0);
+	Color = aColor;
+}
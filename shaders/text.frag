@@ -0,0 +1,16 @@
+out vec4 FragColor;
+
+#define VARYING in
+#include "include/text_varyings.glsl"
+
+// signed distance field glyph atlas, 0.5 on the outline
+uniform sampler2D glyphAtlas;
+
+void main()
+{
+	// Fade over about one pixel across the outline whatever size the text is drawn at.
+	float distance = texture(glyphAtlas, TexCoord).r;
+	float width = length(vec2(dFdx(distance), dFdy(distance))) * 0.7071;
+	float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+	FragColor = vec4(Color.rgb, Color.a * alpha);
+}
@@ -0,0 +1,16 @@
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+
+#define VARYING out
+#include "include/text_varyings.glsl"
+
+// window size in pixels; text positions are pixels from the top left
+uniform vec2 screenSize;
+
+void main()
+{
+	gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);
+	TexCoord = aTexCoord;
+	Color = aColor;
+}
@@ -0,0 +1,17 @@
+#pragma variant VERTEX_COLOR
+
+out vec4 FragColor;
+
+#define VARYING in
+#include "include/textured_varyings.glsl"
+
+// texture sampler
+uniform sampler2D texture1;
+
+void main()
+{
+	FragColor = texture(texture1, TexCoord);
+#ifdef VERTEX_COLOR
+	FragColor.rgb *= ourColor;
+#endif
+}
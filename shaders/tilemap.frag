@@ -0,0 +1,12 @@
+out vec4 FragColor;
+
+#define VARYING in
+#include "include/tilemap_varyings.glsl"
+
+// tileset sampler, with nearest filtering since UVs run right up to the edges of each tile
+uniform sampler2D tileset;
+
+void main()
+{
+	FragColor = texture(tileset, TexCoord);
+}
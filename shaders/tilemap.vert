@@ -0,0 +1,18 @@
+// one TileVertex per vertex, from a chunk's static buffer; positions are in tiles from the top left of the map
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+#define VARYING out
+#include "include/tilemap_varyings.glsl"
+
+// window size in pixels, the top left of the camera in map pixels and the size of a tile in pixels
+uniform vec2 screenSize;
+uniform vec2 camera;
+uniform float tileSize;
+
+void main()
+{
+	vec2 pos = aPos * tileSize - camera;
+	gl_Position = vec4(pos.x / screenSize.x * 2.0 - 1.0, 1.0 - pos.y / screenSize.y * 2.0, 0.0, 1.0);
+	TexCoord = aTexCoord;
+}
@@ -0,0 +1,423 @@
+/* Packs files into a memory mapped asset pack, benchmarks reading one back and checks the LZ4 codec. */
+/* Usage: asset_pack --output assets.pack [--root dir] [--compress] files... */
+/*        asset_pack --benchmark assets.pack [--iterations 10] */
+/*        asset_pack --verify [--iterations 10] */
+
+#include "asset_pack.h"
+#include "hash.h"
+#include "lz4.h"
+#include "tool_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+typedef struct PackedFile {
+    std::string name;
+    uint64_t key;
+    uint64_t size;
+    AssetCompression compression;
+    std::vector<uint8_t> stored;
+} PackedFile;
+
+static bool starts_with(const std::string& s, const char* prefix) { return s.compare(0, strlen(prefix), prefix) == 0; }
+
+static double mib(uint64_t bytes) { return (double)bytes / (1024.0 * 1024.0); }
+
+static bool read_file(const char* path, std::vector<uint8_t>* contents)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) { return false; }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents->resize(size > 0 ? (size_t)size : 0);
+    bool ok = contents->empty() || fread(contents->data(), 1, contents->size(), file) == contents->size();
+    fclose(file);
+    return ok;
+}
+
+static uint64_t align_up(uint64_t value)
+{
+    return (value + ASSET_PACK_ALIGNMENT - 1) & ~(uint64_t)(ASSET_PACK_ALIGNMENT - 1);
+}
+
+static int write_pack(const std::string& output, const std::string& root, const std::vector<std::string>& inputs,
+    bool compress)
+{
+    std::vector<PackedFile> files;
+    uint64_t raw_bytes = 0;
+    for (const std::string& input : inputs) {
+        PackedFile file;
+        file.name = starts_with(input, root.c_str()) ? input.substr(root.size()) : input;
+        std::replace(file.name.begin(), file.name.end(), '\\', '/');
+        file.key         = hash_path(file.name.c_str());
+        file.compression = ASSET_COMPRESSION_NONE;
+        if (!read_file(input.c_str(), &file.stored)) {
+            fprintf(stderr, "%s: cannot read file\n", input.c_str());
+            return 1;
+        }
+        file.size = file.stored.size();
+        raw_bytes += file.size;
+
+        // Only worth decompressing if it saves at least an eighth; already compressed images mostly do not.
+        if (compress) {
+            std::vector<uint8_t> compressed(lz4_compress_bound(file.stored.size()));
+            size_t size = lz4_compress(file.stored.data(), file.stored.size(), compressed.data(), compressed.size());
+            if (size < file.stored.size() - file.stored.size() / 8) {
+                compressed.resize(size);
+                file.stored      = std::move(compressed);
+                file.compression = ASSET_COMPRESSION_LZ4;
+            }
+        }
+        files.push_back(std::move(file));
+    }
+
+    std::sort(files.begin(), files.end(),
+        [](const PackedFile& a, const PackedFile& b) { return a.key != b.key ? a.key < b.key : a.name < b.name; });
+    for (size_t i = 1; i < files.size(); i++) {
+        if (files[i].name == files[i - 1].name) {
+            fprintf(stderr, "%s: packed twice\n", files[i].name.c_str());
+            return 1;
+        }
+    }
+
+    std::string names;
+    std::vector<AssetPackRecord> records(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        records[i].key         = files[i].key;
+        records[i].stored_size = files[i].stored.size();
+        records[i].size        = files[i].size;
+        records[i].compression = files[i].compression;
+        records[i].name        = (uint32_t)names.size();
+        names += files[i].name;
+        names += '\0';
+    }
+
+    uint64_t offset = align_up(sizeof(AssetPackHeader) + records.size() * sizeof(AssetPackRecord) + names.size());
+    for (AssetPackRecord& record : records) {
+        record.offset = offset;
+        offset        = align_up(offset + record.stored_size);
+    }
+
+    AssetPackHeader header = { 0 };
+    header.magic           = ASSET_PACK_MAGIC;
+    header.version         = ASSET_PACK_VERSION;
+    header.entry_count     = (uint32_t)records.size();
+    header.names_size      = (uint32_t)names.size();
+    header.file_size       = offset;
+
+    FILE* out = fopen(output.c_str(), "wb");
+    if (!out) {
+        fprintf(stderr, "%s: cannot write file\n", output.c_str());
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(records.data(), sizeof(AssetPackRecord), records.size(), out);
+    fwrite(names.data(), 1, names.size(), out);
+    static const uint8_t padding[ASSET_PACK_ALIGNMENT] = { 0 };
+    for (size_t i = 0; i < files.size(); i++) {
+        fwrite(padding, 1, (size_t)(records[i].offset - (uint64_t)ftell(out)), out);
+        fwrite(files[i].stored.data(), 1, files[i].stored.size(), out);
+    }
+    fwrite(padding, 1, (size_t)(header.file_size - (uint64_t)ftell(out)), out);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "%s: cannot write file\n", output.c_str());
+        return 1;
+    }
+
+    uint32_t compressed = 0;
+    for (const PackedFile& file : files) {
+        compressed += file.compression == ASSET_COMPRESSION_LZ4;
+    }
+    printf("%zu entries (%u compressed), %.2f MiB of files in a %.2f MiB pack\n", files.size(), compressed,
+        mib(raw_bytes), mib(header.file_size));
+    return 0;
+}
+
+// Best effort: asks the OS to forget the file's cached pages so the next read comes from the disk. Clean pages only,
+// which is all a pack ever has once written.
+static bool drop_page_cache(const char* path)
+{
+#if defined(_WIN32)
+    // Opening a file unbuffered flushes it from the system cache.
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+    CloseHandle(file);
+    return true;
+#elif defined(__linux__)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Opens the pack and reads every entry into memory, as a load screen would.
+static bool read_all(const char* path, double* ms, AssetPackStats* stats)
+{
+    auto start      = std::chrono::steady_clock::now();
+    AssetPack* pack = asset_pack_open(path);
+    if (!pack) { return false; }
+
+    std::vector<uint8_t> buffer;
+    bool ok = true;
+    for (uint32_t i = 0; i < asset_pack_count(pack) && ok; i++) {
+        AssetPackEntry entry = asset_pack_entry(pack, i);
+        buffer.resize((size_t)entry.size);
+        ok = asset_pack_read(pack, i, buffer.data(), entry.size);
+    }
+    *ms    = elapsed_ms(start);
+    *stats = asset_pack_stats(pack);
+    asset_pack_close(pack);
+    return ok;
+}
+
+static void print_read(const char* label, double ms, const AssetPackStats* stats)
+{
+    printf("%s %u entries, %.2f MiB in %.2fms (%.0f MiB/s overall, %.0f MiB/s in asset_pack_read)\n", label,
+        stats->entries, mib(stats->read_bytes), ms, mib(stats->read_bytes) / (ms / 1000.0),
+        stats->read_ns ? mib(stats->read_bytes) / ((double)stats->read_ns / 1e9) : 0.0);
+}
+
+static int benchmark(const char* path, uint32_t iterations)
+{
+    double ms;
+    AssetPackStats stats;
+    bool cold = drop_page_cache(path);
+    if (!read_all(path, &ms, &stats)) {
+        fprintf(stderr, "%s: not a valid asset pack\n", path);
+        return 1;
+    }
+    print_read(cold ? "cold:" : "first (page cache not dropped):", ms, &stats);
+
+    double best = ms, total = 0.0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        read_all(path, &ms, &stats);
+        best = std::min(best, ms);
+        total += ms;
+    }
+    if (iterations) {
+        printf("warm: %u iterations, %.2fms average, ", iterations, total / iterations);
+        print_read("best", best, &stats);
+    }
+    return 0;
+}
+
+enum {
+    LZ4_VERIFY_RANDOM,     // incompressible
+    LZ4_VERIFY_PERIODIC,   // a pattern of 1-15 bytes repeated, so every match overlaps the bytes it copies
+    LZ4_VERIFY_WORDS,      // text-like, with matches at all sorts of offsets and lengths
+    LZ4_VERIFY_KIND_COUNT,
+};
+
+static const char* const lz4_verify_kinds[LZ4_VERIFY_KIND_COUNT] = { "random", "periodic", "words" };
+
+static void fill_buffer(std::vector<uint8_t>* buffer, size_t size, int kind, uint32_t* state)
+{
+    static const char* const words[] = { "the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog\n" };
+    buffer->resize(size);
+    uint32_t period = 1 + next_random(state) % 15;
+    for (size_t i = 0; i < size;) {
+        if (kind == LZ4_VERIFY_RANDOM) {
+            (*buffer)[i++] = (uint8_t)next_random(state);
+        } else if (kind == LZ4_VERIFY_PERIODIC) {
+            (*buffer)[i] = i < period ? (uint8_t)next_random(state) : (*buffer)[i - period];
+            i++;
+        } else {
+            for (const char* c = words[next_random(state) % 8]; *c && i < size; c++) {
+                (*buffer)[i++] = (uint8_t)*c;
+            }
+        }
+    }
+}
+
+// Where the first match's offset is in a block, or 0 if the block is literals only, and how many literals come before.
+static size_t first_match_offset(const std::vector<uint8_t>& block, size_t* literal_count)
+{
+    size_t pos      = 0;
+    size_t literals = block[pos] >> 4;
+    for (pos++; literals >= 15 && pos < block.size(); pos++) {
+        literals += block[pos];
+        if (block[pos] != 255) {
+            pos++;
+            break;
+        }
+    }
+    *literal_count = literals;
+    return pos + literals + 2 <= block.size() ? pos + literals : 0;
+}
+
+// Decompresses into a buffer with guard bytes past its end, which have to survive whether or not it succeeds.
+static bool decompress_guarded(const std::vector<uint8_t>& block, size_t block_size, std::vector<uint8_t>* output,
+    size_t size, bool* overran)
+{
+    output->assign(size + 64, 0xA5);
+    bool ok = lz4_decompress(block.data(), block_size, output->data(), size);
+    for (size_t i = size; i < output->size(); i++) {
+        if ((*output)[i] != 0xA5) { *overran = true; }
+    }
+    return ok;
+}
+
+// Round-trips buffers of every size up to 256 bytes and a few large ones through lz4_compress() and lz4_decompress(),
+// then checks that truncated and corrupted blocks are rejected without writing past the output.
+static int verify_lz4(uint32_t iterations)
+{
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size <= 256; size++) {
+        sizes.push_back(size);
+    }
+    for (size_t size : { 4095, 65536, 65537, 300000 }) {
+        sizes.push_back(size);
+    }
+
+    uint32_t state = 0x9E3779B9u, blocks = 0, truncated = 0, corrupted = 0, rejected = 0;
+    std::vector<uint8_t> input, block, output;
+    bool overran = false;
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (int kind = 0; kind < LZ4_VERIFY_KIND_COUNT; kind++) {
+            for (size_t size : sizes) {
+                fill_buffer(&input, size, kind, &state);
+                block.assign(lz4_compress_bound(size), 0);
+                size_t block_size = lz4_compress(input.data(), size, block.data(), block.size());
+                blocks++;
+                if (!block_size || block_size > lz4_compress_bound(size)) {
+                    fprintf(stderr, "lz4: %s buffer of %zu bytes compressed to %zu bytes\n", lz4_verify_kinds[kind],
+                        size, block_size);
+                    return 1;
+                }
+                if (!decompress_guarded(block, block_size, &output, size, &overran)
+                    || memcmp(output.data(), input.data(), size) != 0) {
+                    fprintf(stderr, "lz4: %s buffer of %zu bytes did not round-trip\n", lz4_verify_kinds[kind], size);
+                    return 1;
+                }
+                if (kind == LZ4_VERIFY_PERIODIC && size >= 4095 && block_size > size / 100) {
+                    fprintf(stderr, "lz4: %zu periodic bytes only compressed to %zu\n", size, block_size);
+                    return 1;
+                }
+
+                // The original size has to be exact, and every prefix of a block is missing some of it.
+                block.resize(block_size);
+                bool accepted = decompress_guarded(block, block_size, &output, size + 1, &overran)
+                    || (size && decompress_guarded(block, block_size, &output, size - 1, &overran));
+                size_t step = block_size > 512 ? block_size / 61 : 1;
+                for (size_t length = 0; length < block_size && !accepted && size; length += step, truncated++) {
+                    accepted = decompress_guarded(block, length, &output, size, &overran);
+                }
+                if (accepted) {
+                    fprintf(stderr, "lz4: a truncated block of %zu %s bytes, or one of the wrong size, was accepted\n",
+                        size, lz4_verify_kinds[kind]);
+                    return 1;
+                }
+
+                // A zero offset, an offset reaching before the start of the output and a sequence past the end of the
+                // block are all malformed.
+                size_t literals, offset = first_match_offset(block, &literals);
+                if (offset) {
+                    std::vector<uint8_t> bad = block;
+                    bad[offset]              = 0;
+                    bad[offset + 1]          = 0;
+                    accepted                 = decompress_guarded(bad, block_size, &output, size, &overran);
+                    corrupted++;
+                    if (literals < 65535) {
+                        bad[offset]     = (uint8_t)((literals + 1) & 0xff);
+                        bad[offset + 1] = (uint8_t)((literals + 1) >> 8);
+                        accepted        = decompress_guarded(bad, block_size, &output, size, &overran) || accepted;
+                        corrupted++;
+                    }
+                }
+                block.push_back(0x10);
+                accepted = decompress_guarded(block, block_size + 1, &output, size, &overran) || accepted;
+                corrupted++;
+                if (accepted) {
+                    fprintf(stderr, "lz4: a corrupted block of %zu %s bytes was accepted\n", size,
+                        lz4_verify_kinds[kind]);
+                    return 1;
+                }
+
+                // Random damage may still decode to something, but never outside the output.
+                block.pop_back();
+                for (uint32_t i = 0; i < 4 && block_size; i++) {
+                    std::vector<uint8_t> bad = block;
+                    bad[next_random(&state) % block_size] ^= (uint8_t)(1 + next_random(&state) % 255);
+                    rejected += !decompress_guarded(bad, block_size, &output, size, &overran);
+                    corrupted++;
+                }
+                if (overran) {
+                    fprintf(stderr, "lz4: decompressing a %s block of %zu bytes wrote past the output\n",
+                        lz4_verify_kinds[kind], size);
+                    return 1;
+                }
+            }
+        }
+    }
+    printf("lz4: %u blocks round-tripped, %u truncations rejected, %u corrupted blocks decoded within bounds (%u of "
+           "the randomly damaged ones rejected)\n",
+        blocks, truncated, corrupted, rejected);
+    return 0;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: asset_pack --output <path> [--root <dir>] [--compress] files...\n"
+        "       asset_pack --benchmark <pack> [--iterations <n>]\n"
+        "       asset_pack --verify [--iterations <n>]\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string output, root, benchmark_path;
+    std::vector<std::string> inputs;
+    uint32_t iterations = 10;
+    bool compress       = false;
+    bool verify         = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--root" && i + 1 < argc) {
+            root = argv[++i];
+            if (!root.empty() && root.back() != '/' && root.back() != '\\') { root += '/'; }
+        } else if (arg == "--compress") {
+            compress = true;
+        } else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmark_path = argv[++i];
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (starts_with(arg, "--")) {
+            usage();
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (verify) { return verify_lz4(iterations); }
+    if (!benchmark_path.empty()) { return benchmark(benchmark_path.c_str(), iterations); }
+    if (output.empty() || inputs.empty()) {
+        usage();
+        return 1;
+    }
+    return write_pack(output, root, inputs, compress);
+}
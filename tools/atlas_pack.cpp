@@ -0,0 +1,378 @@
+/* Packs images into texture atlas pages plus a header of UV rects, and benchmarks the packer. */
+/* Usage: atlas_pack --output atlas [--root resources] [--page-size 2048] [--padding 4] [--rotate] images... */
+/*        atlas_pack --benchmark 10000 [--page-size 2048] [--padding 4] [--rotate] */
+
+#include "atlas_packer.h"
+#include "tool_common.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef struct Image {
+    std::string name;
+    uint32_t width;
+    uint32_t height;
+    stbi_uc* pixels;
+} Image;
+
+static bool starts_with(const std::string& s, const char* prefix) { return s.compare(0, strlen(prefix), prefix) == 0; }
+
+static std::string make_ident(const std::string& name)
+{
+    std::string ident = name;
+    for (char& c : ident) {
+        c = isalnum((unsigned char)c) ? (char)tolower((unsigned char)c) : '_';
+    }
+    if (!ident.empty() && isdigit((unsigned char)ident[0])) { ident = "_" + ident; }
+    return ident;
+}
+
+static std::string upper(std::string s)
+{
+    for (char& c : s) {
+        c = (char)toupper((unsigned char)c);
+    }
+    return s;
+}
+
+static std::string file_name(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Uncompressed 32-bit TGA, top-left origin. stb_image reads it back.
+static bool write_tga(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) { return false; }
+
+    uint8_t header[18] = { 0 };
+    header[2]          = 2; // uncompressed true colour
+    header[12]         = (uint8_t)(width & 0xff);
+    header[13]         = (uint8_t)(width >> 8);
+    header[14]         = (uint8_t)(height & 0xff);
+    header[15]         = (uint8_t)(height >> 8);
+    header[16]         = 32;
+    header[17]         = 0x28; // 8 alpha bits, top-left origin
+    fwrite(header, 1, sizeof(header), file);
+
+    std::vector<uint8_t> row(width * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* source = rgba + (size_t)y * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            row[x * 4 + 0] = source[x * 4 + 2];
+            row[x * 4 + 1] = source[x * 4 + 1];
+            row[x * 4 + 2] = source[x * 4 + 0];
+            row[x * 4 + 3] = source[x * 4 + 3];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+
+    return fclose(file) == 0;
+}
+
+static void print_stats(const AtlasPackerDesc* desc, const AtlasPackerStats* stats, double ms)
+{
+    printf("%u rects in %u page(s) of %ux%u, %.1f%% efficiency (last page %.1f%%), %.2fms\n", stats->rects,
+        stats->pages, desc->page_width, desc->page_height, stats->efficiency * 100.0f,
+        stats->last_page_efficiency * 100.0f, ms);
+}
+
+// Every rect has its image's size (swapped when rotated), lies inside its page with its padding, and overlaps no other
+// rect on the same page, padding included. Rects are swept left to right per page, so this stays fast for big sets.
+static bool verify_packing(
+    const AtlasPackerDesc* desc, const AtlasSize* sizes, const AtlasRect* rects, uint32_t count, uint32_t pages)
+{
+    uint32_t padding = desc->padding;
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < count; i++) {
+        const AtlasRect* rect = &rects[i];
+        if (!rect->width) { continue; }
+
+        uint32_t width  = rect->rotated ? sizes[i].height : sizes[i].width;
+        uint32_t height = rect->rotated ? sizes[i].width : sizes[i].height;
+        if (rect->width != width || rect->height != height || (rect->rotated && !desc->allow_rotation)) {
+            fprintf(stderr, "rect %u is %ux%u%s for a %ux%u image\n", i, rect->width, rect->height,
+                rect->rotated ? " rotated" : "", sizes[i].width, sizes[i].height);
+            return false;
+        }
+        if (rect->page >= pages || rect->x < padding || rect->y < padding
+            || (uint64_t)rect->x + rect->width + padding > desc->page_width
+            || (uint64_t)rect->y + rect->height + padding > desc->page_height) {
+            fprintf(stderr, "rect %u at %u, %u size %ux%u on page %u is outside its page with padding %u\n", i,
+                rect->x, rect->y, rect->width, rect->height, rect->page, padding);
+            return false;
+        }
+        order.push_back(i);
+    }
+
+    std::sort(order.begin(), order.end(), [rects](uint32_t a, uint32_t b) {
+        return rects[a].page != rects[b].page ? rects[a].page < rects[b].page : rects[a].x < rects[b].x;
+    });
+    for (size_t i = 0; i < order.size(); i++) {
+        const AtlasRect* a = &rects[order[i]];
+        for (size_t j = i + 1; j < order.size(); j++) {
+            const AtlasRect* b = &rects[order[j]];
+            if (b->page != a->page || b->x - padding >= a->x + a->width + padding) { break; }
+            if (b->y - padding < a->y + a->height + padding && a->y - padding < b->y + b->height + padding) {
+                fprintf(stderr, "rects %u and %u overlap on page %u with padding %u\n", order[i], order[j], a->page,
+                    padding);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Blits a 5x3 image as stored and rotated into a small page. Each copy must hold the image's texels where they belong,
+// every padding texel must match the edge texel nearest to it, and nothing beyond the padding may be touched.
+static bool verify_blit(uint32_t padding)
+{
+    const uint32_t page_size = 64, channels = 2, width = 5, height = 3;
+    std::vector<uint8_t> pixels(width * height * channels);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            pixels[(y * width + x) * channels]     = (uint8_t)(1 + x);
+            pixels[(y * width + x) * channels + 1] = (uint8_t)(1 + y);
+        }
+    }
+    std::vector<uint8_t> page(page_size * page_size * channels, 0xEE);
+    AtlasRect rects[2] = { { 0, padding + 1, padding + 1, width, height, false },
+        { 0, 3 * padding + width + 2, padding + 1, height, width, true } };
+    for (const AtlasRect& rect : rects) {
+        atlas_blit(page.data(), page_size, page_size, channels, &rect, padding, pixels.data());
+    }
+
+    auto texel = [&](int64_t x, int64_t y) { return &page[((size_t)y * page_size + x) * channels]; };
+    for (const AtlasRect& rect : rects) {
+        // Rotated clockwise, source texel (x, y) lands in column height - 1 - y of row x.
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                uint32_t page_x = rect.rotated ? rect.x + height - 1 - y : rect.x + x;
+                uint32_t page_y = rect.rotated ? rect.y + x : rect.y + y;
+                if (memcmp(texel(page_x, page_y), &pixels[(y * width + x) * channels], channels) != 0) {
+                    fprintf(stderr, "blit: texel %u, %u of the%s image is not at %u, %u\n", x, y,
+                        rect.rotated ? " rotated" : "", page_x, page_y);
+                    return false;
+                }
+            }
+        }
+        for (int64_t y = (int64_t)rect.y - padding; y < (int64_t)(rect.y + rect.height + padding); y++) {
+            for (int64_t x = (int64_t)rect.x - padding; x < (int64_t)(rect.x + rect.width + padding); x++) {
+                int64_t edge_x = std::min<int64_t>(std::max<int64_t>(x, rect.x), rect.x + rect.width - 1);
+                int64_t edge_y = std::min<int64_t>(std::max<int64_t>(y, rect.y), rect.y + rect.height - 1);
+                if (memcmp(texel(x, y), texel(edge_x, edge_y), channels) != 0) {
+                    fprintf(stderr, "blit: padding texel %lld, %lld of the%s image does not match its edge\n",
+                        (long long)x, (long long)y, rect.rotated ? " rotated" : "");
+                    return false;
+                }
+            }
+        }
+    }
+
+    uint32_t touched = 0;
+    for (uint32_t i = 0; i < page_size * page_size; i++) { touched += page[i * channels] != 0xEE; }
+    if (touched != 2 * (width + 2 * padding) * (height + 2 * padding)) {
+        fprintf(stderr, "blit: wrote %u texels, beyond the images and their padding\n", touched);
+        return false;
+    }
+    return true;
+}
+
+// Sprite-like sizes between 8 and 128 texels, from a fixed seed so runs compare. Also checks both packings are valid,
+// and that blits are, so it returns non-zero if they are not.
+static int benchmark(AtlasPackerDesc desc, uint32_t count)
+{
+    std::vector<AtlasSize> sizes(count);
+    uint32_t state = 12345;
+    for (AtlasSize& size : sizes) {
+        state       = state * 1664525u + 1013904223u;
+        size.width  = 8 + (state >> 8) % 121;
+        state       = state * 1664525u + 1013904223u;
+        size.height = 8 + (state >> 8) % 121;
+    }
+    std::vector<AtlasRect> rects(count);
+
+    // Offline: the whole set at once, sorted.
+    AtlasPacker* packer = atlas_packer_create(&desc);
+    auto start          = std::chrono::steady_clock::now();
+    uint32_t placed        = atlas_packer_pack(packer, sizes.data(), count, rects.data());
+    double ms              = elapsed_ms(start);
+    AtlasPackerStats stats = atlas_packer_stats(packer);
+    printf("batch:  ");
+    print_stats(&desc, &stats, ms);
+    atlas_packer_destroy(packer);
+    bool ok = placed == count && verify_packing(&desc, sizes.data(), rects.data(), count, stats.pages);
+
+    // Runtime: one at a time, in arrival order.
+    packer = atlas_packer_create(&desc);
+    start  = std::chrono::steady_clock::now();
+    placed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        placed += atlas_packer_insert(packer, sizes[i].width, sizes[i].height, &rects[i]);
+    }
+    ms    = elapsed_ms(start);
+    stats = atlas_packer_stats(packer);
+    printf("insert: ");
+    print_stats(&desc, &stats, ms);
+    atlas_packer_destroy(packer);
+    ok = placed == count && verify_packing(&desc, sizes.data(), rects.data(), count, stats.pages) && ok;
+    ok = verify_blit(desc.padding) && ok;
+
+    if (ok) {
+        printf("every rect is inside its page and clear of the others, padding included, and blits extrude their "
+               "edges\n");
+    }
+    return ok ? 0 : 1;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: atlas_pack --output <path> [--root <dir>] [--page-size <n>] [--padding <n>] [--rotate] images...\n"
+        "       atlas_pack --benchmark <count> [--page-size <n>] [--padding <n>] [--rotate]\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string output, root;
+    std::vector<std::string> inputs;
+    uint32_t benchmark_count = 0;
+
+    AtlasPackerDesc desc = { 0 };
+    desc.page_width      = 2048;
+    desc.page_height     = 2048;
+    desc.padding         = 4;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--root" && i + 1 < argc) {
+            root = argv[++i];
+            if (!root.empty() && root.back() != '/' && root.back() != '\\') { root += '/'; }
+        } else if (arg == "--page-size" && i + 1 < argc) {
+            desc.page_width  = (uint32_t)strtoul(argv[++i], NULL, 10);
+            desc.page_height = desc.page_width;
+        } else if (arg == "--padding" && i + 1 < argc) {
+            desc.padding = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--rotate") {
+            desc.allow_rotation = true;
+        } else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmark_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (starts_with(arg, "--")) {
+            usage();
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (!desc.page_width) {
+        usage();
+        return 1;
+    }
+    if (benchmark_count) { return benchmark(desc, benchmark_count); }
+    if (output.empty() || inputs.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<Image> images;
+    std::vector<AtlasSize> sizes;
+    for (const std::string& input : inputs) {
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(input.c_str(), &width, &height, &channels, 4);
+        if (!pixels) {
+            fprintf(stderr, "%s: %s\n", input.c_str(), stbi_failure_reason());
+            return 1;
+        }
+        Image image = { starts_with(input, root.c_str()) ? input.substr(root.size()) : input, (uint32_t)width,
+            (uint32_t)height, pixels };
+        images.push_back(image);
+        sizes.push_back({ image.width, image.height });
+    }
+
+    std::vector<AtlasRect> rects(images.size());
+    AtlasPacker* packer    = atlas_packer_create(&desc);
+    auto start             = std::chrono::steady_clock::now();
+    uint32_t placed        = atlas_packer_pack(packer, sizes.data(), (uint32_t)sizes.size(), rects.data());
+    double pack_ms         = elapsed_ms(start);
+    AtlasPackerStats stats = atlas_packer_stats(packer);
+    atlas_packer_destroy(packer);
+
+    if (!verify_packing(&desc, sizes.data(), rects.data(), (uint32_t)sizes.size(), stats.pages)) { return 1; }
+    if (placed != images.size()) {
+        for (size_t i = 0; i < images.size(); i++) {
+            if (!rects[i].width) { fprintf(stderr, "%s: does not fit in a page\n", images[i].name.c_str()); }
+        }
+        return 1;
+    }
+
+    uint32_t page_width  = desc.page_width;
+    uint32_t page_height = desc.page_height;
+    std::vector<std::vector<uint8_t>> pages(stats.pages, std::vector<uint8_t>((size_t)page_width * page_height * 4, 0));
+    for (size_t i = 0; i < images.size(); i++) {
+        atlas_blit(pages[rects[i].page].data(), page_width, page_height, 4, &rects[i], desc.padding, images[i].pixels);
+        stbi_image_free(images[i].pixels);
+    }
+
+    std::vector<std::string> page_names;
+    for (uint32_t page = 0; page < stats.pages; page++) {
+        std::string path = output + "_" + std::to_string(page) + ".tga";
+        if (!write_tga(path.c_str(), pages[page].data(), page_width, page_height)) {
+            fprintf(stderr, "%s: cannot write file\n", path.c_str());
+            return 1;
+        }
+        page_names.push_back(file_name(path));
+    }
+
+    std::string header = output + ".h";
+    FILE* out          = fopen(header.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "%s: cannot write file\n", header.c_str());
+        return 1;
+    }
+
+    std::string ident  = make_ident(file_name(output));
+    std::string prefix = upper(ident);
+    fprintf(out, "// Generated by atlas_pack. Do not edit.\n\n#pragma once\n\n#include \"atlas_packer.h\"\n\n");
+    fprintf(out, "#define %s_PAGE_WIDTH %u\n#define %s_PAGE_HEIGHT %u\n#define %s_PAGE_COUNT %u\n\n", prefix.c_str(),
+        page_width, prefix.c_str(), page_height, prefix.c_str(), stats.pages);
+
+    fprintf(out, "static const char* const %s_pages[] = {\n", ident.c_str());
+    for (const std::string& name : page_names) {
+        fprintf(out, "    \"%s\",\n", name.c_str());
+    }
+    fprintf(out, "};\n\n");
+
+    for (size_t i = 0; i < images.size(); i++) {
+        fprintf(out, "#define %s_%s %zu\n", prefix.c_str(), upper(make_ident(images[i].name)).c_str(), i);
+    }
+    fprintf(out, "\nstatic const AtlasEntry %s_entries[] = {\n", ident.c_str());
+    for (size_t i = 0; i < images.size(); i++) {
+        float uv[4];
+        atlas_rect_uv(&rects[i], page_width, page_height, uv);
+        fprintf(out, "    { \"%s\", %u, %.8ff, %.8ff, %.8ff, %.8ff, %s },\n", images[i].name.c_str(), rects[i].page,
+            uv[0], uv[1], uv[2], uv[3], rects[i].rotated ? "true" : "false");
+    }
+    fprintf(out, "};\n\n#define %s_ENTRY_COUNT %zu\n", prefix.c_str(), images.size());
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "%s: cannot write file\n", header.c_str());
+        return 1;
+    }
+
+    print_stats(&desc, &stats, pack_ms);
+    return 0;
+}
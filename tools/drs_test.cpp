@@ -0,0 +1,163 @@
+/* Feeds the dynamic resolution controller synthetic GPU frame time traces, from a model where frame time follows the */
+/* pixel count, and checks that the scale converges to the largest step within budget without oscillating. */
+/* Returns non-zero when a check fails. Usage: drs_test [--verbose] */
+
+#include "dynamic_resolution.h"
+#include "tool_common.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#define TARGET_MS 16.6f
+#define FIXED_MS 1.5f // per frame work that does not scale with resolution
+#define FRAMES 1200
+
+static bool verbose = false;
+
+// GPU time for a frame of a scene that takes full_ms at full resolution.
+static float model_ms(float full_ms, float scale) { return FIXED_MS + (full_ms - FIXED_MS) * scale * scale; }
+
+typedef struct Run {
+    uint32_t converged_frame; // last frame the scale changed
+    uint32_t reversals;       // times the scale changed direction
+    uint32_t changes;
+    float min_scale;
+    float max_scale;
+} Run;
+
+// Runs frames [begin, end) of a trace of scene cost at full resolution, with +-noise relative jitter per frame.
+static void run(DynamicResolution* drs, uint32_t begin, uint32_t end, float (*full_ms)(uint32_t), float noise, Run* out)
+{
+    uint32_t state = 0x2545F491u;
+    int last_dir   = 0;
+    *out           = { begin, 0, 0, drs->scale, drs->scale };
+    for (uint32_t frame = begin; frame < end; frame++) {
+        float jitter = 1.0f + noise * ((next_random(&state) % 2001) / 1000.0f - 1.0f);
+        float before = drs->scale;
+        if (!dynamic_resolution_update(drs, model_ms(full_ms(frame), drs->scale) * jitter)) { continue; }
+
+        int dir = drs->scale > before ? 1 : -1;
+        if (last_dir && dir != last_dir) { out->reversals++; }
+        last_dir             = dir;
+        out->converged_frame = frame;
+        out->changes++;
+        out->min_scale = fminf(out->min_scale, drs->scale);
+        out->max_scale = fmaxf(out->max_scale, drs->scale);
+        if (verbose) { printf("  frame %u: %.2f -> %.2f\n", frame, before, drs->scale); }
+    }
+}
+
+// The controller holds still at a scale when the scene fits the budget there and either is not comfortably under it or
+// would not fit one step up.
+static bool is_settled_scale(const DynamicResolution* drs, float full_ms)
+{
+    float ms = model_ms(full_ms, drs->scale);
+    if (ms > TARGET_MS && drs->scale > drs->desc.min_scale + 1e-4f) { return false; }
+    if (drs->scale >= drs->desc.max_scale - 1e-4f) { return true; }
+    return ms >= TARGET_MS * drs->desc.headroom || model_ms(full_ms, drs->scale + drs->desc.scale_step) > TARGET_MS;
+}
+
+static float heavy(uint32_t frame) { return 28.0f; }
+static float light(uint32_t frame) { return 9.0f; }
+static float heavy_then_light(uint32_t frame) { return frame < 300 ? 28.0f : 9.0f; }
+static float spike(uint32_t frame) { return frame == 400 ? 60.0f : 20.0f; }
+static float ramp(uint32_t frame) { return 10.0f + 20.0f * frame / FRAMES; }
+
+static bool check(bool condition, const char* trace, const char* what)
+{
+    if (!condition) { fprintf(stderr, "%s: %s\n", trace, what); }
+    return condition;
+}
+
+static void init(DynamicResolution* drs)
+{
+    DynamicResolutionDesc desc = { 0 };
+    desc.target_frame_ms       = TARGET_MS;
+    dynamic_resolution_init(drs, &desc);
+}
+
+int main(int argc, char** argv)
+{
+    verbose = argc > 1 && strcmp(argv[1], "--verbose") == 0;
+    if (argc > 2 || (argc == 2 && !verbose)) {
+        fprintf(stderr, "usage: drs_test [--verbose]\n");
+        return 1;
+    }
+
+    bool ok = true;
+    DynamicResolution drs;
+    Run result;
+
+    // Over budget: drops at once, in as few changes as the sqrt estimate allows, and never comes back up.
+    init(&drs);
+    run(&drs, 0, FRAMES, heavy, 0.0f, &result);
+    ok = check(result.converged_frame < 60, "over budget", "took too long to converge") && ok;
+    ok = check(result.reversals == 0, "over budget", "oscillated") && ok;
+    ok = check(is_settled_scale(&drs, heavy(0)), "over budget", "settled on the wrong scale") && ok;
+    printf("over budget (%.1fms): %.2f after %u changes by frame %u\n", heavy(0), drs.scale, result.changes,
+        result.converged_frame);
+
+    // Under budget: never leaves full resolution.
+    init(&drs);
+    run(&drs, 0, FRAMES, light, 0.0f, &result);
+    ok = check(result.changes == 0 && drs.scale == drs.desc.max_scale, "under budget", "changed scale") && ok;
+
+    // The scene gets cheaper: climbs back one step at a time, never dropping on the way, and stops at full resolution.
+    init(&drs);
+    run(&drs, 0, 300, heavy_then_light, 0.0f, &result);
+    float low = drs.scale;
+    run(&drs, 300, FRAMES, heavy_then_light, 0.0f, &result);
+    ok = check(result.reversals == 0 && result.min_scale >= low, "recovery", "dropped while climbing back") && ok;
+    ok = check(drs.scale == drs.desc.max_scale, "recovery", "did not get back to full resolution") && ok;
+    printf("recovery: %.2f back to %.2f in %u steps by frame %u\n", low, drs.scale, result.changes,
+        result.converged_frame);
+
+    // Noise of +-10% a frame around a scene that fits at a middle scale: a few corrections at most, not a sawtooth.
+    init(&drs);
+    run(&drs, 0, 120, heavy, 0.1f, &result);
+    run(&drs, 120, FRAMES, heavy, 0.1f, &result);
+    ok = check(result.reversals <= 2 && result.changes <= 4, "noisy", "oscillated") && ok;
+    ok = check(result.max_scale - result.min_scale <= 2 * drs.desc.scale_step + 1e-4f, "noisy", "wandered") && ok;
+    printf("noisy (%.1fms +-10%%): %u changes and %u reversals after settling, %.2f-%.2f\n", heavy(0), result.changes,
+        result.reversals, result.min_scale, result.max_scale);
+
+    // A single slow frame drops the scale, which then climbs back. The first drop can land on a scale just under the
+    // budget that stepping up, which wants headroom, would not reach, so it may come back one step short of it.
+    init(&drs);
+    run(&drs, 0, 400, spike, 0.0f, &result);
+    float before = drs.scale;
+    run(&drs, 400, FRAMES, spike, 0.0f, &result);
+    ok = check(result.min_scale < before, "spike", "ignored a 3x frame") && ok;
+    bool recovered = drs.scale >= before - drs.desc.scale_step - 1e-4f && is_settled_scale(&drs, spike(0));
+    ok             = check(recovered, "spike", "did not recover") && ok;
+    printf("spike: %.2f down to %.2f and back to %.2f by frame %u\n", before, result.min_scale, drs.scale,
+        result.converged_frame);
+
+    // A scene that keeps getting heavier: only ever goes down, and stays within budget once it has adjusted.
+    init(&drs);
+    run(&drs, 0, FRAMES, ramp, 0.0f, &result);
+    ok = check(result.reversals == 0 && drs.scale < drs.desc.max_scale, "ramp", "did not follow the load down") && ok;
+    ok = check(model_ms(ramp(FRAMES - 1), drs.scale) <= TARGET_MS * 1.05f, "ramp", "ended over budget") && ok;
+    printf("ramp to %.1fms: %.2f after %u changes\n", ramp(FRAMES - 1), drs.scale, result.changes);
+
+    // Every scene cost from trivial to four times over budget settles on a scale within budget.
+    for (float full_ms = 4.0f; full_ms <= 66.0f && ok; full_ms += 0.5f) {
+        init(&drs);
+        for (uint32_t frame = 0; frame < FRAMES; frame++) {
+            dynamic_resolution_update(&drs, model_ms(full_ms, drs.scale));
+        }
+        uint32_t changes = drs.changes;
+        for (uint32_t frame = 0; frame < FRAMES; frame++) {
+            dynamic_resolution_update(&drs, model_ms(full_ms, drs.scale));
+        }
+        if (drs.changes != changes || !is_settled_scale(&drs, full_ms)) {
+            fprintf(stderr, "sweep: a %.1fms scene did not settle (scale %.2f)\n", full_ms, drs.scale);
+            ok = false;
+        }
+    }
+
+    if (ok) { printf("dynamic resolution traces passed\n"); }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,333 @@
+/* Analyzes a GL trace recorded with logl --capture, on any platform and without a GPU. */
+/* Usage: gl_trace [--frames] [--dump] trace */
+/* The trace is replayed against the driver with logl --replay trace. */
+
+#include "gl_trace.h"
+#include "hash.h"
+
+#include <GL/glcorearb.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+typedef struct CallStats {
+    uint64_t count;
+    uint64_t redundant;
+    uint64_t uploaded;
+} CallStats;
+
+typedef struct FrameStats {
+    uint64_t calls;
+    uint64_t draws;
+    uint64_t state_changes;
+    uint64_t redundant;
+    uint64_t uploaded;
+} FrameStats;
+
+// The GL state the traced calls set, enough to tell when a call sets something to what it already was. Each piece of
+// state is keyed by what it belongs to and holds a hash of its value.
+typedef struct GlState {
+    std::unordered_map<uint64_t, uint64_t> values;
+    uint32_t array_buffer;
+    uint32_t vertex_array;
+    uint32_t program;
+    uint32_t texture;
+} GlState;
+
+typedef enum StateKind {
+    STATE_BUFFER_BINDING,
+    STATE_ELEMENT_BUFFER, // per vertex array
+    STATE_TEXTURE_BINDING,
+    STATE_FRAMEBUFFER_BINDING,
+    STATE_RENDERBUFFER_BINDING,
+    STATE_VERTEX_ARRAY,
+    STATE_PROGRAM,
+    STATE_CAPABILITY,
+    STATE_BLEND_FUNC,
+    STATE_VIEWPORT,
+    STATE_CLEAR_COLOR,
+    STATE_PIXEL_STORE,
+    STATE_TEX_PARAMETER,  // per texture
+    STATE_UNIFORM,        // per program
+    STATE_ATTRIB_POINTER, // per vertex array
+    STATE_ATTRIB_ENABLED, // per vertex array
+    STATE_ATTRIB_DIVISOR, // per vertex array
+} StateKind;
+
+static uint64_t state_key(StateKind kind, uint64_t a, uint64_t b = 0)
+{
+    uint64_t key[3] = { (uint64_t)kind, a, b };
+    return hash_fnv1a(key, sizeof(key), HASH_FNV1A_SEED);
+}
+
+// Records the new value, returning false if it was already set to it.
+static bool set_state(GlState* state, uint64_t key, const uint64_t* values, uint32_t count)
+{
+    uint64_t value = hash_fnv1a(values, count * sizeof(uint64_t), HASH_FNV1A_SEED);
+    auto found     = state->values.find(key);
+    if (found != state->values.end() && found->second == value) { return false; }
+    state->values[key] = value;
+    return true;
+}
+
+static bool set_binding(GlState* state, uint64_t key, uint64_t name) { return set_state(state, key, &name, 1); }
+
+static void unbind_deleted(GlState* state, StateKind kind, uint64_t target, const GlTraceRecord* record)
+{
+    const uint32_t* names = (const uint32_t*)record->payload;
+    uint64_t key          = state_key(kind, target);
+    for (uint64_t i = 0; i < record->payload_size / sizeof(uint32_t); i++) {
+        auto found = state->values.find(key);
+        if (found == state->values.end()) { continue; }
+        uint64_t name = names[i];
+        if (found->second == hash_fnv1a(&name, sizeof(name), HASH_FNV1A_SEED)) { set_binding(state, key, 0); }
+    }
+}
+
+// Whether the call changed any state; false for calls that only set something to its current value. Calls that are
+// not state setters (draws, clears, uploads, object creation) count as changes.
+static bool apply(GlState* state, const GlTraceRecord* r)
+{
+    const uint64_t* a = r->args;
+    switch (r->call) {
+    case GL_TRACE_BIND_BUFFER:
+        if (a[0] == GL_ELEMENT_ARRAY_BUFFER) {
+            return set_binding(state, state_key(STATE_ELEMENT_BUFFER, state->vertex_array), a[1]);
+        }
+        if (a[0] == GL_ARRAY_BUFFER) { state->array_buffer = (uint32_t)a[1]; }
+        return set_binding(state, state_key(STATE_BUFFER_BINDING, a[0]), a[1]);
+    case GL_TRACE_BIND_TEXTURE:
+        state->texture = (uint32_t)a[1];
+        return set_binding(state, state_key(STATE_TEXTURE_BINDING, a[0]), a[1]);
+    case GL_TRACE_BIND_FRAMEBUFFER:
+        if (a[0] == GL_FRAMEBUFFER) {
+            bool read = set_binding(state, state_key(STATE_FRAMEBUFFER_BINDING, GL_READ_FRAMEBUFFER), a[1]);
+            bool draw = set_binding(state, state_key(STATE_FRAMEBUFFER_BINDING, GL_DRAW_FRAMEBUFFER), a[1]);
+            return read || draw;
+        }
+        return set_binding(state, state_key(STATE_FRAMEBUFFER_BINDING, a[0]), a[1]);
+    case GL_TRACE_BIND_RENDERBUFFER: return set_binding(state, state_key(STATE_RENDERBUFFER_BINDING, a[0]), a[1]);
+    case GL_TRACE_BIND_VERTEX_ARRAY:
+        state->vertex_array = (uint32_t)a[0];
+        return set_binding(state, state_key(STATE_VERTEX_ARRAY, 0), a[0]);
+    case GL_TRACE_USE_PROGRAM:
+        state->program = (uint32_t)a[0];
+        return set_binding(state, state_key(STATE_PROGRAM, 0), a[0]);
+    case GL_TRACE_ENABLE: return set_binding(state, state_key(STATE_CAPABILITY, a[0]), 1);
+    case GL_TRACE_DISABLE: return set_binding(state, state_key(STATE_CAPABILITY, a[0]), 0);
+    case GL_TRACE_BLEND_FUNC: return set_state(state, state_key(STATE_BLEND_FUNC, 0), a, 2);
+    case GL_TRACE_VIEWPORT: return set_state(state, state_key(STATE_VIEWPORT, 0), a, 4);
+    case GL_TRACE_CLEAR_COLOR: return set_state(state, state_key(STATE_CLEAR_COLOR, 0), a, 4);
+    case GL_TRACE_PIXEL_STORE_I: return set_binding(state, state_key(STATE_PIXEL_STORE, a[0]), a[1]);
+    case GL_TRACE_TEX_PARAMETER_I:
+        return set_binding(state, state_key(STATE_TEX_PARAMETER, state->texture, a[1]), a[2]);
+    case GL_TRACE_UNIFORM_1F:
+    case GL_TRACE_UNIFORM_1I:
+    case GL_TRACE_UNIFORM_2F:
+        return set_state(state, state_key(STATE_UNIFORM, state->program, a[0]), a + 1, r->arg_count - 1);
+    case GL_TRACE_VERTEX_ATTRIB_POINTER: {
+        uint64_t pointer[6] = { a[1], a[2], a[3], a[4], a[5], state->array_buffer };
+        return set_state(state, state_key(STATE_ATTRIB_POINTER, state->vertex_array, a[0]), pointer, 6);
+    }
+    case GL_TRACE_ENABLE_VERTEX_ATTRIB_ARRAY:
+        return set_binding(state, state_key(STATE_ATTRIB_ENABLED, state->vertex_array, a[0]), 1);
+    case GL_TRACE_VERTEX_ATTRIB_DIVISOR:
+        return set_binding(state, state_key(STATE_ATTRIB_DIVISOR, state->vertex_array, a[0]), a[1]);
+    case GL_TRACE_DELETE_BUFFERS:
+        unbind_deleted(state, STATE_BUFFER_BINDING, GL_ARRAY_BUFFER, r);
+        return true;
+    case GL_TRACE_DELETE_TEXTURES:
+        unbind_deleted(state, STATE_TEXTURE_BINDING, GL_TEXTURE_2D, r);
+        return true;
+    case GL_TRACE_DELETE_VERTEX_ARRAYS:
+        unbind_deleted(state, STATE_VERTEX_ARRAY, 0, r);
+        return true;
+    default: return true;
+    }
+}
+
+static bool is_state_setter(GlTraceCall call)
+{
+    switch (call) {
+    case GL_TRACE_BIND_BUFFER:
+    case GL_TRACE_BIND_TEXTURE:
+    case GL_TRACE_BIND_FRAMEBUFFER:
+    case GL_TRACE_BIND_RENDERBUFFER:
+    case GL_TRACE_BIND_VERTEX_ARRAY:
+    case GL_TRACE_USE_PROGRAM:
+    case GL_TRACE_ENABLE:
+    case GL_TRACE_DISABLE:
+    case GL_TRACE_BLEND_FUNC:
+    case GL_TRACE_VIEWPORT:
+    case GL_TRACE_CLEAR_COLOR:
+    case GL_TRACE_PIXEL_STORE_I:
+    case GL_TRACE_TEX_PARAMETER_I:
+    case GL_TRACE_UNIFORM_1F:
+    case GL_TRACE_UNIFORM_1I:
+    case GL_TRACE_UNIFORM_2F:
+    case GL_TRACE_VERTEX_ATTRIB_POINTER:
+    case GL_TRACE_VERTEX_ATTRIB_DIVISOR:
+    case GL_TRACE_ENABLE_VERTEX_ATTRIB_ARRAY: return true;
+    default: return false;
+    }
+}
+
+// Bytes the call hands the driver to copy to the GPU.
+static uint64_t uploaded_bytes(const GlTraceRecord* r)
+{
+    switch (r->call) {
+    case GL_TRACE_BUFFER_DATA:
+    case GL_TRACE_BUFFER_SUB_DATA:
+    case GL_TRACE_TEX_IMAGE_2D:
+    case GL_TRACE_TEX_SUB_IMAGE_2D: return r->payload_size;
+    default: return 0;
+    }
+}
+
+static void dump(const GlTraceRecord* r, uint32_t frame)
+{
+    if (r->call == GL_TRACE_FRAME) {
+        printf("---- end of frame %u\n", frame);
+        return;
+    }
+    bool floats = r->call == GL_TRACE_CLEAR_COLOR || r->call == GL_TRACE_UNIFORM_1F || r->call == GL_TRACE_UNIFORM_2F;
+    printf("%s(", gl_trace_call_name(r->call));
+    for (uint32_t i = 0; i < r->arg_count; i++) {
+        const char* separator = i ? ", " : "";
+        if (floats && (r->call == GL_TRACE_CLEAR_COLOR || i > 0)) {
+            printf("%s%g", separator, gl_trace_to_float(r->args[i]));
+        } else if (r->args[i] >= 0x100 && r->args[i] < 0x10000) {
+            printf("%s0x%04llx", separator, (unsigned long long)r->args[i]); // most likely an enum
+        } else {
+            printf("%s%llu", separator, (unsigned long long)r->args[i]);
+        }
+    }
+    if (r->payload) {
+        printf(") + %llu bytes\n", (unsigned long long)r->payload_size);
+    } else {
+        printf(")\n");
+    }
+}
+
+static double mib(uint64_t bytes) { return (double)bytes / (1024.0 * 1024.0); }
+
+static void usage() { fprintf(stderr, "usage: gl_trace [--frames] [--dump] <trace>\n"); }
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    bool per_frame   = false;
+    bool dump_calls  = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0) {
+            per_frame = true;
+        } else if (strcmp(argv[i], "--dump") == 0) {
+            dump_calls = true;
+        } else if (argv[i][0] == '-' || path) {
+            usage();
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        usage();
+        return 1;
+    }
+
+    GlTraceReader* reader = gl_trace_open(path);
+    if (!reader) {
+        fprintf(stderr, "%s: not a GL trace\n", path);
+        return 1;
+    }
+
+    GlState state = {};
+    std::vector<CallStats> calls(GL_TRACE_CALL_COUNT, CallStats {});
+    std::vector<FrameStats> frames(1, FrameStats {});
+    GlTraceRecord record;
+    while (gl_trace_next(reader, &record)) {
+        if (dump_calls) { dump(&record, (uint32_t)frames.size() - 1); }
+        if (record.call == GL_TRACE_FRAME) {
+            frames.push_back(FrameStats {});
+            continue;
+        }
+
+        FrameStats* frame = &frames.back();
+        CallStats* call   = &calls[record.call];
+        bool changed      = apply(&state, &record);
+        uint64_t uploaded = uploaded_bytes(&record);
+        call->count++;
+        call->uploaded += uploaded;
+        frame->calls++;
+        frame->uploaded += uploaded;
+        frame->draws += record.call == GL_TRACE_DRAW_ARRAYS || record.call == GL_TRACE_DRAW_ARRAYS_INSTANCED
+            || record.call == GL_TRACE_DRAW_ELEMENTS;
+        if (is_state_setter(record.call)) {
+            frame->state_changes++;
+            if (!changed) {
+                call->redundant++;
+                frame->redundant++;
+            }
+        }
+    }
+    bool failed = gl_trace_failed(reader);
+    gl_trace_reader_close(reader);
+
+    // Calls after the last present belong to no frame; usually shutdown.
+    FrameStats trailing = frames.back();
+    frames.pop_back();
+
+    if (per_frame) {
+        printf("%8s %8s %8s %10s %10s %12s\n", "frame", "calls", "draws", "state", "redundant", "uploaded");
+        for (size_t i = 0; i < frames.size(); i++) {
+            printf("%8zu %8llu %8llu %10llu %10llu %10.2fKB\n", i, (unsigned long long)frames[i].calls,
+                (unsigned long long)frames[i].draws, (unsigned long long)frames[i].state_changes,
+                (unsigned long long)frames[i].redundant, frames[i].uploaded / 1024.0);
+        }
+        printf("\n");
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < GL_TRACE_CALL_COUNT; i++) {
+        if (calls[i].count) { order.push_back(i); }
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return calls[a].count > calls[b].count; });
+    printf("%-32s %10s %10s %12s\n", "call", "count", "redundant", "uploaded");
+    for (uint32_t i : order) {
+        printf("%-32s %10llu %10llu %10.2fMB\n", gl_trace_call_name((GlTraceCall)i), (unsigned long long)calls[i].count,
+            (unsigned long long)calls[i].redundant, mib(calls[i].uploaded));
+    }
+
+    // Frame 0 includes the loading, so the steady state averages leave it out when there is more than one frame.
+    FrameStats total = {}, worst = {};
+    size_t first     = frames.size() > 1 ? 1 : 0;
+    for (size_t i = first; i < frames.size(); i++) {
+        total.calls += frames[i].calls;
+        total.draws += frames[i].draws;
+        total.state_changes += frames[i].state_changes;
+        total.redundant += frames[i].redundant;
+        total.uploaded += frames[i].uploaded;
+        worst.calls    = std::max(worst.calls, frames[i].calls);
+        worst.uploaded = std::max(worst.uploaded, frames[i].uploaded);
+    }
+    double steady = (double)(frames.size() - first);
+    printf("\n%zu frames", frames.size());
+    if (steady > 0) {
+        printf(", after the first: %.1f calls, %.1f draws, %.1f state changes (%.1f%% redundant), %.2f KB uploaded"
+               " per frame; worst %llu calls, %.2f KB",
+            total.calls / steady, total.draws / steady, total.state_changes / steady,
+            total.state_changes ? 100.0 * total.redundant / total.state_changes : 0.0, total.uploaded / steady / 1024.0,
+            (unsigned long long)worst.calls, worst.uploaded / 1024.0);
+    }
+    printf("\n");
+    if (trailing.calls) { printf("%llu calls after the last frame\n", (unsigned long long)trailing.calls); }
+    if (failed) {
+        fprintf(stderr, "%s: stopped at a malformed record\n", path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+/* Writes a synthetic GL trace and reads it back: every call comes back with its arguments and payload, payloads */
+/* uploaded twice are stored once, frame markers are numbered in order, and a trace cut short anywhere stops the */
+/* reader with gl_trace_failed() rather than handing back a bad record. Returns non-zero when a check fails. */
+/* Usage: gl_trace_test [--keep] */
+
+#include "gl_trace.h"
+#include "tool_common.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef struct ExpectedCall {
+    GlTraceCall call;
+    std::vector<uint64_t> args;
+    std::vector<uint8_t> payload;
+    bool has_payload;
+} ExpectedCall;
+
+static void write_call(GlTraceWriter* writer, std::vector<ExpectedCall>* expected, GlTraceCall call,
+    std::vector<uint64_t> args, const std::vector<uint8_t>* payload = NULL)
+{
+    gl_trace_call(writer, call, args.data(), (uint32_t)args.size(), payload ? payload->data() : NULL,
+        payload ? payload->size() : 0);
+    expected->push_back({ call, args, payload ? *payload : std::vector<uint8_t>(), payload != NULL });
+}
+
+static void write_frame(GlTraceWriter* writer, std::vector<ExpectedCall>* expected)
+{
+    uint64_t frame = 0;
+    for (const ExpectedCall& call : *expected) {
+        frame += call.call == GL_TRACE_FRAME;
+    }
+    gl_trace_frame(writer);
+    expected->push_back({ GL_TRACE_FRAME, { frame }, {}, false });
+}
+
+static bool matches(const GlTraceRecord& record, const ExpectedCall& expected)
+{
+    if (record.call != expected.call || record.arg_count != expected.args.size()) { return false; }
+    if (memcmp(record.args, expected.args.data(), expected.args.size() * sizeof(uint64_t)) != 0) { return false; }
+    if ((record.payload != NULL) != expected.has_payload) { return false; }
+    return !record.payload
+        || (record.payload_size == expected.payload.size()
+            && memcmp(record.payload, expected.payload.data(), expected.payload.size()) == 0);
+}
+
+// Reads a trace back, checking each record against the calls written. A truncated trace may end early, but only
+// after records that match.
+static uint32_t read_back(const fs::path& path, const std::vector<ExpectedCall>& expected, bool* mismatch,
+    bool* failed, std::vector<const void*>* payloads)
+{
+    *mismatch             = false;
+    *failed               = false;
+    GlTraceReader* reader = gl_trace_open(path.string().c_str());
+    if (!reader) {
+        *failed = true;
+        return 0;
+    }
+    uint32_t count = 0;
+    GlTraceRecord record;
+    while (gl_trace_next(reader, &record)) {
+        if (count >= expected.size() || !matches(record, expected[count])) {
+            *mismatch = true;
+            break;
+        }
+        if (payloads) { payloads->push_back(record.payload); }
+        count++;
+    }
+    *failed = gl_trace_failed(reader);
+    gl_trace_reader_close(reader);
+    return count;
+}
+
+static bool write_bytes(const fs::path& path, const std::vector<uint8_t>& bytes, size_t size)
+{
+    FILE* file = fopen(path.string().c_str(), "wb");
+    if (!file) { return false; }
+    bool ok = fwrite(bytes.data(), 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+static bool read_bytes(const fs::path& path, std::vector<uint8_t>* bytes)
+{
+    std::error_code error;
+    uintmax_t size = fs::file_size(path, error);
+    if (error) { return false; }
+    FILE* file = fopen(path.string().c_str(), "rb");
+    if (!file) { return false; }
+    bytes->resize((size_t)size);
+    bool ok = fread(bytes->data(), 1, bytes->size(), file) == bytes->size();
+    fclose(file);
+    return ok;
+}
+
+static bool check_trace(const fs::path& directory)
+{
+    fs::path path         = directory / "synthetic.trace";
+    GlTraceWriter* writer = gl_trace_create(path.string().c_str());
+    if (!writer) { return fail("write: cannot create the trace"); }
+
+    std::vector<uint8_t> vertices(1000), indices(64);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        vertices[i] = (uint8_t)(i * 7 + 3);
+    }
+    for (size_t i = 0; i < indices.size(); i++) {
+        indices[i] = (uint8_t)i;
+    }
+    const char name[] = "u_texture";
+    std::vector<uint8_t> uniform(name, name + sizeof(name));
+
+    // Arguments cover the varint lengths: small enums, 32 bit -1, float bits, offsets and a full 64 bit value.
+    std::vector<ExpectedCall> expected;
+    write_call(writer, &expected, GL_TRACE_BIND_BUFFER, { 0x8892, 7 });
+    write_call(writer, &expected, GL_TRACE_BUFFER_DATA, { 0x8892, vertices.size(), 0x88E8 }, &vertices);
+    write_call(writer, &expected, GL_TRACE_GET_UNIFORM_LOCATION, { 3, 0xFFFFFFFFu }, &uniform);
+    write_call(writer, &expected, GL_TRACE_CLEAR_COLOR,
+        { gl_trace_float(0.1f), gl_trace_float(0.2f), gl_trace_float(0.3f), gl_trace_float(1.0f) });
+    write_call(writer, &expected, GL_TRACE_BLIT_FRAMEBUFFER,
+        { 0, 0, 1920, 1080, 0, 0, 1280, 720, 0x4000, 0x2601 });
+    write_call(writer, &expected, GL_TRACE_VERTEX_ATTRIB_POINTER, { 0, 3, 0x1406, 0, 20, 0xFFFFFFFFFFFFFFFFull });
+    write_frame(writer, &expected);
+
+    // The same vertices again, which must not be stored a second time, and a payload that has not been seen.
+    write_call(writer, &expected, GL_TRACE_BUFFER_SUB_DATA, { 0x8892, 0, vertices.size() }, &vertices);
+    write_call(writer, &expected, GL_TRACE_BUFFER_DATA, { 0x8893, indices.size(), 0x88E4 }, &indices);
+    write_call(writer, &expected, GL_TRACE_DRAW_ELEMENTS, { 4, 64, 0x1401, 0 });
+    write_frame(writer, &expected);
+    write_call(writer, &expected, GL_TRACE_CLEAR, { 0x4000 });
+    write_frame(writer, &expected);
+
+    GlTraceStats stats;
+    if (!gl_trace_close(writer, &stats)) { return fail("write: the trace failed to write"); }
+
+    bool ok = true;
+    if (stats.calls != expected.size() - stats.frames || stats.frames != 3) {
+        ok = fail("stats: wrong call or frame count");
+    }
+    uint64_t payload_bytes = 2 * vertices.size() + indices.size() + uniform.size();
+    if (stats.blobs != 3 || stats.payload_bytes != payload_bytes
+        || stats.blob_bytes != vertices.size() + indices.size() + uniform.size()) {
+        ok = fail("dedup: a payload written twice was stored twice");
+    }
+
+    bool mismatch, failed;
+    std::vector<const void*> payloads;
+    uint32_t count = read_back(path, expected, &mismatch, &failed, &payloads);
+    if (mismatch || failed || count != expected.size()) {
+        ok = fail("read: the calls did not come back as they were written");
+    } else if (payloads[1] != payloads[7]) {
+        ok = fail("dedup: a repeated payload was not read back from the one blob");
+    }
+    printf("%u records, %u frames, %u blobs, %llu bytes\n", count, stats.frames, stats.blobs,
+        (unsigned long long)stats.file_bytes);
+
+    // Cutting the trace anywhere after the header must never produce a wrong record, and a cut inside a record (the
+    // last frame marker, or the vertices blob) must be reported rather than read as the end of the trace.
+    std::vector<uint8_t> bytes;
+    if (!read_bytes(path, &bytes) || bytes.size() != stats.file_bytes) { return fail("read: cannot reread the trace"); }
+    fs::path cut = directory / "truncated.trace";
+    for (size_t size = 8; size < bytes.size() && ok; size++) {
+        if (!write_bytes(cut, bytes, size)) { return fail("truncate: cannot write the truncated trace"); }
+        count = read_back(cut, expected, &mismatch, &failed, NULL);
+        if (mismatch || count == expected.size()) {
+            ok = fail("truncate: a truncated trace read back a wrong or extra record");
+        } else if ((size == bytes.size() - 1 || size == 8 + vertices.size() / 2) && !failed) {
+            ok = fail("truncate: a record cut short was read as the end of the trace");
+        }
+    }
+
+    // Anything that does not start with the header is not a trace.
+    bytes[0] ^= 0xFF;
+    if (!write_bytes(cut, bytes, bytes.size())) { return fail("truncate: cannot write the corrupted trace"); }
+    GlTraceReader* reader = gl_trace_open(cut.string().c_str());
+    if (reader) {
+        gl_trace_reader_close(reader);
+        ok = fail("open: a file with the wrong magic was opened as a trace");
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    bool keep = argc > 1 && strcmp(argv[1], "--keep") == 0;
+    if (argc > 2 || (argc == 2 && !keep)) {
+        fprintf(stderr, "usage: gl_trace_test [--keep]\n");
+        return 1;
+    }
+
+    std::error_code error;
+    auto now           = std::chrono::steady_clock::now().time_since_epoch().count();
+    fs::path directory = fs::temp_directory_path(error) / ("gl_trace_test_" + std::to_string(now));
+    if (error || !fs::create_directories(directory, error)) {
+        fprintf(stderr, "cannot create a temporary directory\n");
+        return 1;
+    }
+
+    bool ok = check_trace(directory);
+    if (keep) {
+        printf("left the test files in %s\n", directory.string().c_str());
+    } else {
+        fs::remove_all(directory, error);
+    }
+    if (ok) { printf("gl trace checks passed\n"); }
+    return ok ? 0 : 1;
+}
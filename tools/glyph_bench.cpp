@@ -0,0 +1,319 @@
+/* Benchmarks the glyph path on the CPU, without GDI or GL, using a synthetic rasterizer that draws anti-aliased */
+/* rings and stems: the distance transform on its own, glyph cache LRU churn through a small atlas, and the text */
+/* renderer's run cache on a UI-like frame. Returns non-zero when a check fails. */
+/* Usage: glyph_bench [--iterations 20] [--frames 600] [--threads 0] */
+
+#include "glyph_cache.h"
+#include "job_pool.h"
+#include "text_renderer.h"
+#include "tool_common.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define SDF_SIZE 32
+#define SUPERSAMPLE 4
+#define SPREAD 4
+#define MISSING_CODEPOINT 0xE000u // a private use codepoint the synthetic font has no glyph for
+
+static void usage() { fprintf(stderr, "usage: glyph_bench [--iterations 20] [--frames 600] [--threads 0]\n"); }
+
+// A stand-in for a font: every codepoint gets a ring of its own proportions with a stem on its right, 4x4
+// supersampled for anti-aliased edges like a real rasterizer's. Stateless, so it is safe on several threads at once.
+static bool synthetic_rasterize(void* user, uint32_t codepoint, uint32_t pixel_size, GlyphBitmap* bitmap)
+{
+    *bitmap = {};
+    if (codepoint == MISSING_CODEPOINT) { return false; }
+    float em        = (float)pixel_size;
+    bitmap->advance = em * (0.45f + (codepoint % 7) * 0.05f);
+    if (codepoint == ' ' || codepoint == '\t') { return true; }
+
+    uint32_t width   = (uint32_t)(bitmap->advance - em * 0.1f);
+    uint32_t height  = (uint32_t)(em * (0.5f + (codepoint % 5) * 0.05f));
+    bitmap->width    = width;
+    bitmap->height   = height;
+    bitmap->left     = em * 0.05f;
+    bitmap->top      = (float)height;
+    bitmap->coverage = (uint8_t*)malloc((size_t)width * height);
+
+    float cx = width * 0.4f, cy = height * 0.5f;
+    float rx = width * 0.4f, ry = height * 0.5f;
+    float thickness = 0.18f + (codepoint % 3) * 0.06f;
+    float stem      = width * 0.82f;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t hits = 0;
+            for (uint32_t sy = 0; sy < 4; sy++) {
+                for (uint32_t sx = 0; sx < 4; sx++) {
+                    float px = x + (sx + 0.5f) * 0.25f, py = y + (sy + 0.5f) * 0.25f;
+                    float d  = sqrtf(((px - cx) / rx) * ((px - cx) / rx) + ((py - cy) / ry) * ((py - cy) / ry));
+                    hits += (d <= 1.0f && d >= 1.0f - thickness) || (px >= stem && px < stem + width * 0.12f);
+                }
+            }
+            bitmap->coverage[(size_t)y * width + x] = (uint8_t)(hits * 255 / 16);
+        }
+    }
+    return true;
+}
+
+// A disc has a known field: full inside past the spread, empty outside past it, and rising steadily in between.
+static bool check_sdf()
+{
+    const uint32_t size = 128, radius = 40;
+    std::vector<uint8_t> coverage(size * size);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            float dx = x + 0.5f - size / 2.0f, dy = y + 0.5f - size / 2.0f;
+            coverage[y * size + x] = dx * dx + dy * dy <= radius * radius ? 255 : 0;
+        }
+    }
+
+    uint32_t max = size / SUPERSAMPLE + 2 * SPREAD, width, height;
+    std::vector<uint8_t> sdf(max * max);
+    glyph_sdf_generate(coverage.data(), size, size, SUPERSAMPLE, SPREAD, max, max, sdf.data(), &width, &height);
+    if (width != max || height != max) { return fail("sdf: wrong field size for a padded bitmap"); }
+
+    uint32_t center = max / 2;
+    const uint8_t* row = &sdf[center * width];
+    if (row[center] != 255 || row[0] != 0 || sdf[0] != 0) { return fail("sdf: a disc's inside or outside is wrong"); }
+    for (uint32_t x = 1; x <= center; x++) {
+        if (row[x] < row[x - 1]) { return fail("sdf: the field falls towards the middle of a disc"); }
+    }
+
+    // The outline sits radius / supersample texels from the middle, past the padding.
+    float edge = SPREAD + (size / 2.0f - radius) / SUPERSAMPLE;
+    uint32_t at = (uint32_t)edge;
+    if (abs((int)row[at] - 128) > 20) {
+        fprintf(stderr, "sdf: %u on the outline of a disc, expected about 128\n", row[at]);
+        return false;
+    }
+    return true;
+}
+
+// Distance fields of the printable ASCII glyphs at the cache's rasterization size.
+static bool benchmark_sdf(uint32_t iterations)
+{
+    std::vector<GlyphBitmap> bitmaps;
+    uint64_t pixels = 0;
+    for (uint32_t codepoint = '!'; codepoint <= '~'; codepoint++) {
+        GlyphBitmap bitmap;
+        synthetic_rasterize(NULL, codepoint, SDF_SIZE * SUPERSAMPLE, &bitmap);
+        pixels += (uint64_t)bitmap.width * bitmap.height;
+        bitmaps.push_back(bitmap);
+    }
+
+    uint32_t max = (uint32_t)ceilf(SDF_SIZE * 1.25f) + 2 * SPREAD, width, height;
+    std::vector<uint8_t> sdf(max * max);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (const GlyphBitmap& bitmap : bitmaps) {
+            glyph_sdf_generate(bitmap.coverage, bitmap.width, bitmap.height, SUPERSAMPLE, SPREAD, max, max, sdf.data(),
+                &width, &height);
+        }
+    }
+    double ms = elapsed_ms(start);
+    printf("sdf: %zu glyphs of %.0f pixels on average, %.1f us per glyph, %.2f ns per coverage pixel\n",
+        bitmaps.size(), (double)pixels / bitmaps.size(), ms * 1e3 / (iterations * bitmaps.size()),
+        ms * 1e6 / ((double)iterations * pixels));
+
+    for (GlyphBitmap& bitmap : bitmaps) { free(bitmap.coverage); }
+    return true;
+}
+
+// Every frame draws a window of 20 glyphs that slides by one every other frame through 200, through an atlas of 25
+// slots, so glyphs are evicted all the time. Glyphs drawn in a frame must still be there the next frame, whatever got
+// evicted.
+static bool benchmark_churn(JobPool* jobs, uint32_t frames)
+{
+    GlyphCacheDesc desc = { 0 };
+    desc.jobs           = jobs;
+    desc.rasterize      = synthetic_rasterize;
+    desc.sdf_size       = SDF_SIZE;
+    desc.supersample    = SUPERSAMPLE;
+    desc.spread         = SPREAD;
+    desc.atlas_width    = 256;
+    desc.atlas_height   = 256;
+    GlyphCache* cache   = glyph_cache_create(&desc);
+
+    GlyphUpload uploads[64];
+    std::unordered_map<uint32_t, uint32_t> drawn, last_drawn; // codepoint -> slot
+    double update_ms = 0.0, worst = 0.0;
+    uint32_t uploaded = 0;
+    bool ok           = true;
+    for (uint32_t frame = 0; frame < frames && ok; frame++) {
+        // The glyphs kept from last frame first, the way a renderer reusing its vertices would touch them.
+        for (const auto& kept : last_drawn) {
+            const Glyph* glyph = glyph_cache_get(cache, kept.first);
+            if (!glyph || glyph->slot != kept.second) {
+                fprintf(stderr, "churn: glyph %u was evicted right after being drawn\n", kept.first);
+                ok = false;
+                break;
+            }
+        }
+
+        drawn.clear();
+        uint32_t base = 'A' + (frame / 2) % 180;
+        for (uint32_t i = 0; i < 20 && ok; i++) {
+            const Glyph* glyph = glyph_cache_get(cache, base + i);
+            if (glyph && glyph->visible) { drawn[base + i] = glyph->slot; }
+        }
+
+        // A frame is long enough for the glyphs asked for in it to be rasterized by the next one.
+        job_pool_wait(jobs);
+        auto start     = std::chrono::steady_clock::now();
+        uint32_t count = glyph_cache_update(cache, uploads, 64);
+        double ms      = elapsed_ms(start);
+        update_ms += ms;
+        worst = ms > worst ? ms : worst;
+        uploaded += count;
+        for (uint32_t i = 0; i < count && ok; i++) {
+            const GlyphUpload& upload = uploads[i];
+            if (upload.x + upload.width > desc.atlas_width || upload.y + upload.height > desc.atlas_height
+                || !upload.pixels) {
+                ok = fail("churn: an upload is outside the atlas");
+            }
+        }
+        last_drawn.swap(drawn);
+    }
+
+    GlyphCacheStats stats = glyph_cache_stats(cache);
+    if (ok && (!stats.evictions || stats.resident > stats.slots)) { ok = fail("churn: the atlas never filled up"); }
+    if (ok) {
+        printf("churn: %u frames through %u slots, update %.3fms (worst %.3fms), %.1f%% hits, %llu rasterized, %llu "
+               "evictions, %u uploads\n",
+            frames, stats.slots, update_ms / frames, worst, 100.0 * stats.hits / (stats.hits + stats.misses),
+            (unsigned long long)stats.rasterized, (unsigned long long)stats.evictions, uploaded);
+    }
+    glyph_cache_destroy(cache);
+    return ok;
+}
+
+// A debug overlay's worth of text: 40 labels that never change, a counter that changes every frame, a timing that
+// cycles through a few values and a string with a glyph missing from the font. Returns the glyphs drawn.
+static uint32_t draw_overlay(TextRenderer* text, const std::vector<std::string>& labels, uint32_t frame)
+{
+    char value[64];
+    for (uint32_t i = 0; i < labels.size(); i++) {
+        text_draw(text, labels[i].c_str(), 10.0f, 10.0f + i * 20.0f, 16.0f, 0xFFFFFFFFu);
+    }
+    snprintf(value, sizeof(value), "frame %u", frame);
+    text_draw(text, value, 600.0f, 10.0f, 16.0f, 0xFF00FFFFu);
+    snprintf(value, sizeof(value), "%.2f ms", 16.0 + (frame % 17) * 0.01);
+    text_draw(text, value, 600.0f, 30.0f, 16.0f, 0xFF00FFFFu);
+    text_draw(text, "tofu \xee\x80\x80 here", 600.0f, 50.0f, 16.0f, 0xFF00FFFFu); // U+E000
+
+    uint32_t vertex_count;
+    text_renderer_vertices(text, &vertex_count);
+    return vertex_count / 6;
+}
+
+// Once every glyph is in the atlas, strings that did not change are drawn from the run cache and only the changing
+// ones are laid out again.
+static bool benchmark_runs(JobPool* jobs, uint32_t frames)
+{
+    GlyphCacheDesc desc = { 0 };
+    desc.jobs           = jobs;
+    desc.rasterize      = synthetic_rasterize;
+    desc.sdf_size       = SDF_SIZE;
+    desc.supersample    = SUPERSAMPLE;
+    desc.spread         = SPREAD;
+    desc.atlas_width    = 1024;
+    desc.atlas_height   = 1024;
+    GlyphCache* cache   = glyph_cache_create(&desc);
+
+    TextRendererDesc text_desc = { 0 };
+    text_desc.glyphs           = cache;
+    TextRenderer* text         = text_renderer_create(&text_desc);
+
+    std::vector<std::string> labels;
+    uint32_t expected = (uint32_t)strlen("frame0") + (uint32_t)strlen("16.00ms") + (uint32_t)strlen("tofuhere");
+    for (uint32_t i = 0; i < 40; i++) {
+        labels.push_back("Label " + std::to_string(i) + ": the quick brown fox");
+        for (char c : labels.back()) { expected += c != ' '; }
+    }
+
+    // Warm up until nothing is left to rasterize, waiting out the pool every frame, and then through one more cycle of
+    // the timing values so none is left in the cache laid out before its glyphs were in.
+    GlyphUpload uploads[256];
+    uint32_t warmup = 0;
+    bool ok         = true;
+    for (uint32_t idle = 0; idle <= 17 && ok; warmup++) {
+        draw_overlay(text, labels, warmup);
+        text_renderer_end_frame(text);
+        job_pool_wait(jobs);
+        glyph_cache_update(cache, uploads, 256);
+        idle = glyph_cache_stats(cache).pending ? 0 : idle + 1;
+        if (warmup > 100) { ok = fail("runs: glyphs never finished rasterizing"); }
+    }
+
+    TextRendererStats warm = text_renderer_stats(text);
+    double draw_ms         = 0.0;
+    for (uint32_t frame = warmup; frame < warmup + frames && ok; frame++) {
+        auto start     = std::chrono::steady_clock::now();
+        uint32_t drawn = draw_overlay(text, labels, frame);
+        draw_ms += elapsed_ms(start);
+        text_renderer_end_frame(text);
+        glyph_cache_update(cache, uploads, 256);
+
+        // "frame N" has one glyph more from frame 10, 100 and so on; at least as many glyphs as in frame 0.
+        if (drawn < expected) {
+            fprintf(stderr, "runs: %u glyphs drawn in frame %u, expected at least %u\n", drawn, frame, expected);
+            ok = false;
+        }
+    }
+
+    TextRendererStats stats = text_renderer_stats(text);
+    uint64_t hits = stats.run_hits - warm.run_hits, misses = stats.run_misses - warm.run_misses;
+    uint64_t rebuilds = stats.run_rebuilds - warm.run_rebuilds;
+    if (ok && (misses > frames + 17 || rebuilds)) { ok = fail("runs: unchanged strings were laid out again"); }
+    if (ok) {
+        printf("runs: %zu strings a frame, draw %.3fms a frame, %.1f%% run cache hits (%llu misses, %llu rebuilds) "
+               "after %u warm-up frames\n",
+            labels.size() + 3, draw_ms / frames, 100.0 * hits / (hits + misses + rebuilds), (unsigned long long)misses,
+            (unsigned long long)rebuilds, warmup);
+    }
+    text_renderer_destroy(text);
+    glyph_cache_destroy(cache);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = 20;
+    uint32_t frames     = 600;
+    uint32_t threads    = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!iterations || !frames) {
+        usage();
+        return 1;
+    }
+
+    JobPool* jobs = job_pool_create(threads);
+    printf("%u worker thread(s)\n", job_pool_thread_count(jobs));
+    bool ok = check_sdf();
+    ok      = benchmark_sdf(iterations) && ok;
+    ok      = benchmark_churn(jobs, frames) && ok;
+    ok      = benchmark_runs(jobs, frames) && ok;
+    job_pool_destroy(jobs);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+/* Drives the file watcher and hot reload against real files in a temporary directory: editor style multi-step */
+/* saves are debounced into one change, reloads land through the job pool, unchanged saves are dropped, and a hot */
+/* swap keeps the old object active until its replacement is ready. Returns non-zero when a check fails. */
+/* Usage: hot_reload_test [--keep] */
+
+#include "file_watcher.h"
+#include "hot_reload.h"
+#include "job_pool.h"
+#include "tool_common.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+
+#define DEBOUNCE_MS 50
+#define TIMEOUT_MS 5000
+
+namespace fs = std::filesystem;
+
+static bool write_file(const fs::path& path, const char* contents, bool append = false)
+{
+    FILE* file = fopen(path.string().c_str(), append ? "ab" : "wb");
+    if (!file) { return false; }
+    bool ok = fwrite(contents, 1, strlen(contents), file) == strlen(contents);
+    return fclose(file) == 0 && ok;
+}
+
+typedef std::map<std::string, uint32_t> ChangeCounts;
+
+static void count_change(const char* path, void* user)
+{
+    (*(ChangeCounts*)user)[fs::path(path).filename().string()]++;
+}
+
+// Time is passed to file_watcher_poll() by hand, so the debounce is checked exactly. inotify queues an event before
+// the write that caused it returns, so the first poll after the writes sees all of them.
+static bool check_watcher(const fs::path& directory)
+{
+    FileWatcher* watcher = file_watcher_create(DEBOUNCE_MS);
+    if (!watcher || !file_watcher_add_directory(watcher, directory.string().c_str())) {
+        file_watcher_destroy(watcher);
+        return fail("watcher: cannot watch the temporary directory");
+    }
+
+    // Saved the way editors do: truncate and write in pieces, and write a temporary that is renamed over the target.
+    ChangeCounts changes;
+    bool ok = write_file(directory / "texture.ppm", "P3\n") && write_file(directory / "texture.ppm", "1 1\n", true)
+        && write_file(directory / "texture.ppm", "255\n0 0 0\n", true) && write_file(directory / "shader.tmp", "x")
+        && (fs::rename(directory / "shader.tmp", directory / "shader.frag"), true);
+    if (!ok) { fail("watcher: cannot write the test files"); }
+
+    uint64_t start = 1000;
+    if (ok
+        && (file_watcher_poll(watcher, start, count_change, &changes)
+            || file_watcher_poll(watcher, start + DEBOUNCE_MS - 1, count_change, &changes))) {
+        ok = fail("watcher: reported a change before it settled");
+    }
+    uint32_t reported = file_watcher_poll(watcher, start + DEBOUNCE_MS, count_change, &changes);
+    // The temporary is reported too; hot reload ignores files nothing is built from.
+    for (const auto& change : changes) {
+        if (ok && change.second != 1) {
+            fprintf(stderr, "watcher: %s reported %u times\n", change.first.c_str(), change.second);
+            ok = false;
+        }
+    }
+    if (ok && (reported != changes.size() || !changes.count("texture.ppm") || !changes.count("shader.frag"))) {
+        ok = fail("watcher: a multi-step save or a rename was not reported");
+    }
+    if (ok && file_watcher_poll(watcher, start + 10 * DEBOUNCE_MS, count_change, &changes)) {
+        ok = fail("watcher: reported the same change twice");
+    }
+
+    // Another write while a change is pending restarts its debounce.
+    changes.clear();
+    start += 20 * DEBOUNCE_MS;
+    ok = ok && write_file(directory / "texture.ppm", "P3\n1 1\n255\n1 1 1\n");
+    file_watcher_poll(watcher, start, count_change, &changes);
+    ok = ok && write_file(directory / "texture.ppm", "P3\n1 1\n255\n2 2 2\n");
+    file_watcher_poll(watcher, start + DEBOUNCE_MS / 2, count_change, &changes);
+    if (ok && file_watcher_poll(watcher, start + DEBOUNCE_MS, count_change, &changes)) {
+        ok = fail("watcher: a file still being written was reported");
+    }
+    if (ok && (file_watcher_poll(watcher, start + DEBOUNCE_MS / 2 + DEBOUNCE_MS, count_change, &changes) != 1
+            || changes["texture.ppm"] != 1)) {
+        ok = fail("watcher: a file written twice was not reported once after the last write");
+    }
+
+    // A watched directory that is deleted is reported as lost, once.
+    fs::path doomed = directory / "doomed";
+    std::error_code error;
+    changes.clear();
+    if (ok && (!fs::create_directory(doomed, error) || !file_watcher_add_directory(watcher, doomed.string().c_str()))) {
+        ok = fail("watcher: cannot watch a second directory");
+    }
+    if (ok) {
+        fs::remove(doomed, error);
+        file_watcher_poll(watcher, start + 100 * DEBOUNCE_MS, count_change, &changes);
+        if (file_watcher_poll_lost(watcher, count_change, &changes) != 1 || changes["doomed"] != 1
+            || file_watcher_poll_lost(watcher, count_change, &changes)) {
+            ok = fail("watcher: a deleted directory was not reported lost once");
+        }
+    }
+
+    file_watcher_destroy(watcher);
+    return ok;
+}
+
+// Polls for real, the way the render loop does, until a reload lands or the timeout passes.
+static bool wait_for_reload(HotReload* reload, HotReloadResult* result, uint32_t timeout_ms = TIMEOUT_MS)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(timeout_ms)) {
+        hot_reload_poll(reload);
+        if (hot_reload_next(reload, result)) { return true; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+static void release(HotReloadResult* result)
+{
+    hot_reload_release(result);
+    *result = {};
+}
+
+// A shader whose include is edited is reloaded and swapped in. The program built from the old source stays active
+// while the new one "compiles", and a replacement that fails to build is thrown away without touching it.
+static bool check_reload(const fs::path& directory, JobPool* jobs)
+{
+    fs::path shader  = directory / "shader.frag";
+    fs::path include = directory / "include" / "color.glsl";
+    fs::create_directories(include.parent_path());
+    bool ok = write_file(include, "vec4 color() { return vec4(1.0); }\n")
+        && write_file(shader, "#include \"include/color.glsl\"\nout vec4 frag;\nvoid main() { frag = color(); }\n")
+        && write_file(directory / "texture.ppm", "P6\n2 1\n255\n\xff\x01\x01\x01\xff\x01");
+    if (!ok) { return fail("reload: cannot write the test files"); }
+
+    HotReloadDesc desc  = { 0 };
+    desc.jobs           = jobs;
+    desc.glsl_version   = "330 core";
+    desc.debounce_ms    = DEBOUNCE_MS;
+    HotReload* reload   = hot_reload_create(&desc);
+    uint32_t shader_id  = hot_reload_watch_shader(reload, shader.string().c_str(), 0, 0);
+    uint32_t texture_id = hot_reload_watch_texture(reload, (directory / "texture.ppm").string().c_str());
+    hot_reload_poll(reload); // starts watching the directories
+
+    HotSwapSlot program    = { 1, 0 };
+    uint32_t next_program  = 2;
+    HotReloadResult result = {};
+
+    ok = write_file(include, "vec4 color() { return vec4(0.5); }\n");
+    if (ok && !wait_for_reload(reload, &result)) { ok = fail("reload: editing an include did not reload the shader"); }
+    if (ok && (result.asset != shader_id || result.kind != HOT_RELOAD_SHADER || !result.ok
+            || !strstr(result.source, "vec4(0.5)") || strncmp(result.source, "#version 330 core", 17))) {
+        fprintf(
+            stderr, "reload: bad shader reload of %s: %s\n", result.path, result.ok ? "wrong source" : result.error);
+        ok = false;
+    }
+    if (ok) {
+        uint32_t superseded = hot_swap_begin(&program, next_program++);
+        if (superseded || program.active != 1 || program.pending != 2) {
+            ok = fail("swap: the old program was not kept while the new one builds");
+        }
+    }
+    release(&result);
+
+    // Saving the same bytes again reloads to the same hash, which is dropped before it reaches the render thread.
+    ok = ok && write_file(include, "vec4 color() { return vec4(0.5); }\n");
+    if (ok && wait_for_reload(reload, &result, 10 * DEBOUNCE_MS)) {
+        ok = fail("reload: an unchanged save was handed back");
+        release(&result);
+    }
+
+    // An edit that lands while the previous build is still pending supersedes it; the old program is still active.
+    ok = ok && write_file(include, "vec4 color() { return vec4(0.25); }\n");
+    if (ok && !wait_for_reload(reload, &result)) { ok = fail("reload: a second edit was not reloaded"); }
+    if (ok) {
+        uint32_t superseded = hot_swap_begin(&program, next_program++);
+        if (superseded != 2 || program.active != 1 || program.pending != 3) {
+            ok = fail("swap: a superseded build was not handed back, or the active program changed");
+        }
+        if (ok && (hot_swap_finish(&program, true) != 1 || program.active != 3 || program.pending)) {
+            ok = fail("swap: a finished build did not replace the active program");
+        }
+    }
+    release(&result);
+
+    // A broken include fails the reload, and the failed build never replaces what is active.
+    ok = ok && write_file(shader, "#include \"include/missing.glsl\"\nvoid main() { }\n");
+    if (ok && (!wait_for_reload(reload, &result) || result.ok || !result.error[0])) {
+        ok = fail("reload: a broken shader was not reported as a failed reload");
+    }
+    release(&result);
+    if (ok) {
+        hot_swap_begin(&program, next_program++);
+        if (hot_swap_finish(&program, false) != 4 || program.active != 3 || program.pending) {
+            ok = fail("swap: a failed build replaced the active program");
+        }
+    }
+
+    // Textures are decoded and mipped on the pool. Binary PPM, so the pixels can be written as a string.
+    ok = ok && write_file(directory / "texture.ppm", "P6\n2 1\n255\n\x01\x01\xff\xff\xff\xff");
+    if (ok && (!wait_for_reload(reload, &result) || result.asset != texture_id || !result.ok)) {
+        fprintf(stderr, "reload: an edited texture was not reloaded: %s\n", result.error);
+        ok = false;
+    }
+    if (ok
+        && (result.mips.level_count != 2 || result.mips.levels[0].width != 2
+            || result.mips.levels[0].pixels[2] != 255)) {
+        ok = fail("reload: the reloaded texture has the wrong pixels");
+    }
+    release(&result);
+
+    hot_reload_destroy(reload);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    bool keep = argc > 1 && strcmp(argv[1], "--keep") == 0;
+    if (argc > 2 || (argc == 2 && !keep)) {
+        fprintf(stderr, "usage: hot_reload_test [--keep]\n");
+        return 1;
+    }
+
+    std::error_code error;
+    fs::path directory = fs::temp_directory_path(error) / ("hot_reload_test_" + std::to_string(file_watcher_now_ms()));
+    if (error || !fs::create_directories(directory, error)) { return fail("cannot create a temporary directory"); }
+
+    JobPool* jobs = job_pool_create(2);
+    bool ok       = check_watcher(directory);
+    ok            = check_reload(directory, jobs) && ok;
+    job_pool_destroy(jobs);
+
+    if (ok) { printf("file watcher debounce, shader and texture reloads and hot swaps checked\n"); }
+    if (keep) {
+        printf("test files left in %s\n", directory.string().c_str());
+    } else {
+        fs::remove_all(directory, error);
+    }
+    return ok ? 0 : 1;
+}
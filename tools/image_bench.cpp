@@ -0,0 +1,680 @@
+/* Checks the fast JPEG and PNG decoders against stb_image and compares their throughput. */
+/* Usage: image_bench [--iterations 10] [--threads 0] [--synthetic 4096]... [images...] */
+/* Synthetic images are encoded here: JPEGs 4:4:4 and 4:2:0, with and without restart markers, and PNGs with 1-4 */
+/* channels. */
+
+#include "image_decode.h"
+#include "job_pool.h"
+#include "tool_common.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Largest difference from stb_image allowed in any channel, and on average, for JPEGs. The two use different IDCTs and
+// color conversion arithmetic, so they round differently. PNGs have to match exactly.
+#define MAX_DIFFERENCE 4
+#define MAX_MEAN_DIFFERENCE 0.1
+
+typedef struct TestImage {
+    std::string name;
+    std::vector<uint8_t> data;
+    bool png;
+} TestImage;
+
+static bool starts_with(const std::string& s, const char* prefix) { return s.compare(0, strlen(prefix), prefix) == 0; }
+
+static bool read_file(const char* path, std::vector<uint8_t>* contents)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) { return false; }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents->resize(size > 0 ? (size_t)size : 0);
+    bool ok = !contents->empty() && fread(contents->data(), 1, contents->size(), file) == contents->size();
+    fclose(file);
+    return ok;
+}
+
+// A minimal baseline JPEG encoder with the example tables from Annex K of the spec.
+
+static const uint8_t zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6, 7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22,
+    15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+static const uint8_t luma_quant[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51,
+    87, 80, 62, 18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+static const uint8_t chroma_quant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99,
+};
+
+static const uint8_t dc_luma_bits[16]   = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dc_values[12]      = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t ac_luma_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14,
+    0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09,
+    0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a,
+    0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65,
+    0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+    0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9,
+    0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca,
+    0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+    0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+static const uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t ac_chroma_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32,
+    0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16,
+    0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64,
+    0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86,
+    0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8,
+    0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+    0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+typedef struct HuffmanCode {
+    uint16_t code;
+    uint8_t length;
+} HuffmanCode;
+
+typedef struct BitWriter {
+    std::vector<uint8_t>* out;
+    uint32_t buffer;
+    uint32_t count;
+} BitWriter;
+
+static void build_codes(const uint8_t* bits, const uint8_t* values, HuffmanCode* codes)
+{
+    uint32_t code = 0, k = 0;
+    for (uint32_t length = 1; length <= 16; length++, code <<= 1) {
+        for (uint32_t i = 0; i < bits[length - 1]; i++, k++, code++) {
+            codes[values[k]] = { (uint16_t)code, (uint8_t)length };
+        }
+    }
+}
+
+static void put_bits(BitWriter* writer, uint32_t value, uint32_t length)
+{
+    writer->buffer = (writer->buffer << length) | (value & ((1u << length) - 1));
+    writer->count += length;
+    while (writer->count >= 8) {
+        uint8_t byte = (uint8_t)(writer->buffer >> (writer->count - 8));
+        writer->out->push_back(byte);
+        if (byte == 0xFF) { writer->out->push_back(0x00); }
+        writer->count -= 8;
+    }
+}
+
+// Pads the last byte with ones, as the spec asks before a marker.
+static void flush_bits(BitWriter* writer)
+{
+    if (writer->count) { put_bits(writer, 0x7F, 8 - writer->count); }
+    writer->buffer = 0;
+}
+
+static void put_marker(std::vector<uint8_t>* out, uint8_t marker, const std::vector<uint8_t>& body)
+{
+    out->push_back(0xFF);
+    out->push_back(marker);
+    if (marker == 0xD8 || marker == 0xD9) { return; }
+    out->push_back((uint8_t)((body.size() + 2) >> 8));
+    out->push_back((uint8_t)(body.size() + 2));
+    out->insert(out->end(), body.begin(), body.end());
+}
+
+static void put_value(BitWriter* writer, const HuffmanCode* codes, uint32_t run, int32_t value)
+{
+    uint32_t magnitude = (uint32_t)(value < 0 ? -value : value);
+    uint32_t size      = 0;
+    while (magnitude >> size) {
+        size++;
+    }
+    put_bits(writer, codes[(run << 4) | size].code, codes[(run << 4) | size].length);
+    if (size) { put_bits(writer, (uint32_t)(value < 0 ? value - 1 : value), size); }
+}
+
+static void encode_block(BitWriter* writer, const float* samples, const uint8_t* quant, const HuffmanCode* dc,
+    const HuffmanCode* ac, int32_t* dc_pred)
+{
+    // Straightforward separable forward DCT; encoding speed does not matter here.
+    static float basis[8][8];
+    if (basis[0][0] == 0.0f) {
+        for (int u = 0; u < 8; u++) {
+            for (int x = 0; x < 8; x++) {
+                basis[u][x] = (u ? 0.5f : 0.353553391f) * cosf((2 * x + 1) * u * 3.14159265f / 16.0f);
+            }
+        }
+    }
+    float rows[64], coefficients[64];
+    for (int y = 0; y < 8; y++) {
+        for (int u = 0; u < 8; u++) {
+            float sum = 0.0f;
+            for (int x = 0; x < 8; x++) {
+                sum += (samples[y * 8 + x] - 128.0f) * basis[u][x];
+            }
+            rows[y * 8 + u] = sum;
+        }
+    }
+    for (int u = 0; u < 8; u++) {
+        for (int v = 0; v < 8; v++) {
+            float sum = 0.0f;
+            for (int y = 0; y < 8; y++) {
+                sum += rows[y * 8 + u] * basis[v][y];
+            }
+            coefficients[v * 8 + u] = sum;
+        }
+    }
+
+    int32_t quantized[64];
+    for (int k = 0; k < 64; k++) {
+        quantized[k] = (int32_t)lroundf(coefficients[zigzag[k]] / quant[k]);
+    }
+
+    put_value(writer, dc, 0, quantized[0] - *dc_pred);
+    *dc_pred = quantized[0];
+    uint32_t run = 0;
+    for (int k = 1; k < 64; k++) {
+        if (!quantized[k]) {
+            run++;
+            continue;
+        }
+        for (; run >= 16; run -= 16) {
+            put_bits(writer, ac[0xF0].code, ac[0xF0].length);
+        }
+        put_value(writer, ac, run, quantized[k]);
+        run = 0;
+    }
+    if (run) { put_bits(writer, ac[0x00].code, ac[0x00].length); }
+}
+
+// Quantization tables are the spec's examples, in zigzag order as they are stored.
+static std::vector<uint8_t> encode_jpeg(
+    const uint8_t* rgb, uint32_t width, uint32_t height, bool subsample, uint32_t restart_interval)
+{
+    uint8_t quant[2][64];
+    for (int k = 0; k < 64; k++) {
+        quant[0][k] = luma_quant[zigzag[k]];
+        quant[1][k] = chroma_quant[zigzag[k]];
+    }
+    HuffmanCode dc_codes[2][256], ac_codes[2][256];
+    build_codes(dc_luma_bits, dc_values, dc_codes[0]);
+    build_codes(dc_chroma_bits, dc_values, dc_codes[1]);
+    build_codes(ac_luma_bits, ac_luma_values, ac_codes[0]);
+    build_codes(ac_chroma_bits, ac_chroma_values, ac_codes[1]);
+
+    std::vector<uint8_t> out;
+    put_marker(&out, 0xD8, {});
+    for (uint8_t table = 0; table < 2; table++) {
+        std::vector<uint8_t> body = { table };
+        body.insert(body.end(), quant[table], quant[table] + 64);
+        put_marker(&out, 0xDB, body);
+    }
+    uint8_t luma_sampling = subsample ? 0x22 : 0x11;
+    put_marker(&out, 0xC0,
+        { 8, (uint8_t)(height >> 8), (uint8_t)height, (uint8_t)(width >> 8), (uint8_t)width, 3, 1, luma_sampling, 0, 2,
+            0x11, 1, 3, 0x11, 1 });
+    const uint8_t* bits[4]   = { dc_luma_bits, ac_luma_bits, dc_chroma_bits, ac_chroma_bits };
+    const uint8_t* values[4] = { dc_values, ac_luma_values, dc_values, ac_chroma_values };
+    const uint8_t ids[4]     = { 0x00, 0x10, 0x01, 0x11 };
+    for (int i = 0; i < 4; i++) {
+        std::vector<uint8_t> body = { ids[i] };
+        body.insert(body.end(), bits[i], bits[i] + 16);
+        uint32_t count = 0;
+        for (int j = 0; j < 16; j++) {
+            count += bits[i][j];
+        }
+        body.insert(body.end(), values[i], values[i] + count);
+        put_marker(&out, 0xC4, body);
+    }
+    if (restart_interval) { put_marker(&out, 0xDD, { (uint8_t)(restart_interval >> 8), (uint8_t)restart_interval }); }
+    put_marker(&out, 0xDA, { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 });
+
+    uint32_t mcu_size = subsample ? 16 : 8;
+    uint32_t mcus_x   = (width + mcu_size - 1) / mcu_size;
+    uint32_t mcus_y   = (height + mcu_size - 1) / mcu_size;
+    BitWriter writer  = { &out, 0, 0 };
+    int32_t dc_pred[3] = { 0, 0, 0 };
+    for (uint32_t mcu = 0; mcu < mcus_x * mcus_y; mcu++) {
+        if (restart_interval && mcu && mcu % restart_interval == 0) {
+            flush_bits(&writer);
+            out.push_back(0xFF);
+            out.push_back((uint8_t)(0xD0 + (mcu / restart_interval - 1) % 8));
+            dc_pred[0] = dc_pred[1] = dc_pred[2] = 0;
+        }
+
+        // Y, Cb and Cr for the MCU, edge pixels repeated past the right and bottom of the image.
+        float planes[3][16 * 16];
+        for (uint32_t y = 0; y < mcu_size; y++) {
+            for (uint32_t x = 0; x < mcu_size; x++) {
+                uint32_t px      = std::min((mcu % mcus_x) * mcu_size + x, width - 1);
+                uint32_t py      = std::min((mcu / mcus_x) * mcu_size + y, height - 1);
+                const uint8_t* p = rgb + ((size_t)py * width + px) * 3;
+                uint32_t i       = y * mcu_size + x;
+                planes[0][i]     = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+                planes[1][i]     = 128.0f - 0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2];
+                planes[2][i]     = 128.0f + 0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2];
+            }
+        }
+
+        float block[64];
+        for (uint32_t by = 0; by < mcu_size / 8; by++) {
+            for (uint32_t bx = 0; bx < mcu_size / 8; bx++) {
+                for (uint32_t i = 0; i < 64; i++) {
+                    block[i] = planes[0][(by * 8 + i / 8) * mcu_size + bx * 8 + i % 8];
+                }
+                encode_block(&writer, block, quant[0], dc_codes[0], ac_codes[0], &dc_pred[0]);
+            }
+        }
+        for (uint32_t c = 1; c < 3; c++) {
+            for (uint32_t i = 0; i < 64; i++) {
+                if (!subsample) {
+                    block[i] = planes[c][i];
+                    continue;
+                }
+                const float* quad = &planes[c][(i / 8) * 2 * 16 + (i % 8) * 2];
+                block[i]          = (quad[0] + quad[1] + quad[16] + quad[17]) * 0.25f;
+            }
+            encode_block(&writer, block, quant[1], dc_codes[1], ac_codes[1], &dc_pred[c]);
+        }
+    }
+    flush_bits(&writer);
+    put_marker(&out, 0xD9, {});
+    return out;
+}
+
+// A minimal PNG encoder. Rows take each filter type in turn, so all five get checked, and are deflated with the fixed
+// Huffman codes and a greedy matcher, so inflating them is about as much work as for a real PNG.
+
+typedef struct DeflateWriter {
+    std::vector<uint8_t>* out;
+    uint32_t buffer; // LSB first
+    uint32_t count;
+} DeflateWriter;
+
+static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5,
+    5, 5, 0 };
+static const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+    769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+    11, 11, 12, 12, 13, 13 };
+
+static void put_deflate_bits(DeflateWriter* writer, uint32_t value, uint32_t length)
+{
+    writer->buffer |= value << writer->count;
+    writer->count += length;
+    while (writer->count >= 8) {
+        writer->out->push_back((uint8_t)writer->buffer);
+        writer->buffer >>= 8;
+        writer->count -= 8;
+    }
+}
+
+// Huffman codes go in most significant bit first, unlike everything else in deflate.
+static void put_code(DeflateWriter* writer, uint32_t code, uint32_t length)
+{
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    }
+    put_deflate_bits(writer, reversed, length);
+}
+
+static void put_literal(DeflateWriter* writer, uint32_t symbol)
+{
+    if (symbol < 144) {
+        put_code(writer, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        put_code(writer, 0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        put_code(writer, symbol - 256, 7);
+    } else {
+        put_code(writer, 0xC0 + symbol - 280, 8);
+    }
+}
+
+static void put_match(DeflateWriter* writer, uint32_t length, uint32_t distance)
+{
+    uint32_t l = 28;
+    while (length_base[l] > length) {
+        l--;
+    }
+    put_literal(writer, 257 + l);
+    put_deflate_bits(writer, length - length_base[l], length_extra[l]);
+    uint32_t d = 29;
+    while (distance_base[d] > distance) {
+        d--;
+    }
+    put_code(writer, d, 5);
+    put_deflate_bits(writer, distance - distance_base[d], distance_extra[d]);
+}
+
+static std::vector<uint8_t> zlib_compress(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> out = { 0x78, 0x01 };
+    DeflateWriter writer     = { &out, 0, 0 };
+    put_deflate_bits(&writer, 1, 1); // the final block
+    put_deflate_bits(&writer, 1, 2); // fixed codes
+
+    std::vector<int64_t> last(1 << 15, -1); // most recent position of each hashed 3 byte prefix
+    size_t size = data.size();
+    for (size_t i = 0; i < size;) {
+        uint32_t length = 0;
+        size_t distance = 0;
+        if (i + 3 <= size) {
+            uint32_t hash = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & 0x7FFF;
+            int64_t match = last[hash];
+            last[hash]    = (int64_t)i;
+            if (match >= 0 && i - (size_t)match <= 32768) {
+                while (length < 258 && i + length < size && data[(size_t)match + length] == data[i + length]) {
+                    length++;
+                }
+                distance = i - (size_t)match;
+            }
+        }
+        if (length >= 3) {
+            put_match(&writer, length, (uint32_t)distance);
+            i += length;
+        } else {
+            put_literal(&writer, data[i++]);
+        }
+    }
+    put_literal(&writer, 256);
+    if (writer.count) { put_deflate_bits(&writer, 0, 8 - writer.count); }
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(adler >> shift));
+    }
+    return out;
+}
+
+static void put_chunk(std::vector<uint8_t>* out, const char* type, const std::vector<uint8_t>& body)
+{
+    size_t start = out->size();
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out->push_back((uint8_t)(body.size() >> shift));
+    }
+    out->insert(out->end(), type, type + 4);
+    out->insert(out->end(), body.begin(), body.end());
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = start + 4; i < out->size(); i++) {
+        crc ^= (*out)[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    crc ^= 0xFFFFFFFFu;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out->push_back((uint8_t)(crc >> shift));
+    }
+}
+
+static uint8_t paeth_predictor(int a, int b, int c)
+{
+    int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+    return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+static std::vector<uint8_t> encode_png(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels)
+{
+    size_t row_size = (size_t)width * channels;
+    std::vector<uint8_t> filtered;
+    filtered.reserve((row_size + 1) * height);
+    std::vector<uint8_t> zeros(row_size, 0);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row   = pixels + y * row_size;
+        const uint8_t* prior = y ? row - row_size : zeros.data();
+        uint8_t filter       = (uint8_t)(y % 5);
+        filtered.push_back(filter);
+        for (size_t i = 0; i < row_size; i++) {
+            int a = i >= channels ? row[i - channels] : 0;
+            int b = prior[i];
+            int c = i >= channels ? prior[i - channels] : 0;
+            int predicted = 0;
+            if (filter == 1) { predicted = a; }
+            if (filter == 2) { predicted = b; }
+            if (filter == 3) { predicted = (a + b) / 2; }
+            if (filter == 4) { predicted = paeth_predictor(a, b, c); }
+            filtered.push_back((uint8_t)(row[i] - predicted));
+        }
+    }
+
+    static const uint8_t color_type[5] = { 0, 0, 4, 2, 6 };
+    std::vector<uint8_t> header = { (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8),
+        (uint8_t)width, (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height, 8,
+        color_type[channels], 0, 0, 0 };
+    std::vector<uint8_t> out = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    put_chunk(&out, "IHDR", header);
+    put_chunk(&out, "IDAT", zlib_compress(filtered));
+    put_chunk(&out, "IEND", {});
+    return out;
+}
+
+// Gradients, rings and noise: enough detail that the entropy decoder does real work.
+static std::vector<uint8_t> synthetic_rgb(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    uint32_t state = 12345;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            state      = state * 1664525u + 1013904223u;
+            float dx   = (float)x - width * 0.5f;
+            float dy   = (float)y - height * 0.5f;
+            float ring = 0.5f + 0.5f * sinf(sqrtf(dx * dx + dy * dy) * 0.05f);
+            uint8_t* p = &rgb[((size_t)y * width + x) * 3];
+            int noise  = (int)(state >> 28) - 8;
+            p[0]       = (uint8_t)std::clamp((int)(255.0f * x / width) + noise, 0, 255);
+            p[1]       = (uint8_t)std::clamp((int)(255.0f * ring) + noise, 0, 255);
+            p[2]       = (uint8_t)std::clamp((int)(255.0f * y / height) + noise, 0, 255);
+        }
+    }
+    return rgb;
+}
+
+template <typename Decode> static double best_ms(uint32_t iterations, Decode decode)
+{
+    double best = 1e30;
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        decode();
+        best = std::min(best, elapsed_ms(start));
+    }
+    return best;
+}
+
+static void print_time(const char* label, double ms, uint32_t width, uint32_t height, double baseline_ms)
+{
+    printf("  %-24s %8.2fms %7.1f MPix/s %5.2fx\n", label, ms, (double)width * height / (ms * 1000.0),
+        baseline_ms / ms);
+}
+
+static bool check(const TestImage* image, JobPool* jobs, uint32_t iterations)
+{
+    const uint8_t* data = image->data.data();
+    int size            = (int)image->data.size();
+    auto decode         = image->png ? image_decode_png : image_decode_jpeg;
+    uint32_t max_worst  = image->png ? 0 : MAX_DIFFERENCE;
+    double max_mean     = image->png ? 0.0 : MAX_MEAN_DIFFERENCE;
+
+    bool ok = true;
+    ImageDecodeResult result;
+    for (uint32_t channels = 1; channels <= 4; channels++) {
+        int width, height, image_channels;
+        stbi_uc* expected = stbi_load_from_memory(data, size, &width, &height, &image_channels, (int)channels);
+        ImageDecodeDesc desc = { 0 };
+        desc.jobs            = jobs;
+        desc.channels        = channels;
+        if (!expected || !decode(data, (size_t)size, &desc, &result)) {
+            printf("%s: %s\n", image->name.c_str(), expected ? image_failure_reason() : stbi_failure_reason());
+            stbi_image_free(expected);
+            return false;
+        }
+
+        size_t count        = (size_t)width * height * channels;
+        uint32_t worst      = 0;
+        uint64_t difference = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t d = (uint32_t)abs(expected[i] - result.pixels[i]);
+            worst      = std::max(worst, d);
+            difference += d;
+        }
+        double mean = (double)difference / count;
+        bool match  = worst <= max_worst && mean <= max_mean;
+        if (channels == 1 && image->png) {
+            printf("%s: %ux%u, %u channel(s)\n", image->name.c_str(), result.width, result.height,
+                result.image_channels);
+        } else if (channels == 1) {
+            printf("%s: %ux%u, %u channel(s), %u restart segment(s)\n", image->name.c_str(), result.width,
+                result.height, result.image_channels, result.segments);
+        }
+        printf("  %u channel output vs stb_image: max difference %u, mean %.3f%s\n", channels, worst, mean,
+            match ? "" : "  MISMATCH");
+        ok = ok && match;
+        stbi_image_free(expected);
+        image_free(result.pixels);
+    }
+
+    int width, height, image_channels;
+    double stb_ms = best_ms(iterations, [&] {
+        stbi_image_free(stbi_load_from_memory(data, size, &width, &height, &image_channels, 4));
+    });
+    print_time("stb_image RGBA", stb_ms, width, height, stb_ms);
+
+    ImageDecodeDesc desc = { 0 };
+    desc.channels        = 4;
+    double ms = best_ms(iterations, [&] {
+        decode(data, (size_t)size, &desc, &result);
+        image_free(result.pixels);
+    });
+    print_time("fast RGBA", ms, width, height, stb_ms);
+
+    desc.jobs = jobs;
+    ms        = best_ms(iterations, [&] {
+        decode(data, (size_t)size, &desc, &result);
+        image_free(result.pixels);
+    });
+    print_time("fast RGBA, jobs", ms, width, height, stb_ms);
+
+    // Into a buffer that already exists, as when decoding into a mapped upload buffer.
+    std::vector<uint8_t> buffer((size_t)width * height * 4);
+    desc.output = buffer.data();
+    ms          = best_ms(iterations, [&] { decode(data, (size_t)size, &desc, &result); });
+    print_time("fast RGBA, jobs, buffer", ms, width, height, stb_ms);
+    return ok;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: image_bench [--iterations <n>] [--threads <n>] [--synthetic <size>]... [images...]\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = 10;
+    uint32_t threads    = 0;
+    std::vector<uint32_t> synthetic_sizes;
+    std::vector<TestImage> images;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--synthetic" && i + 1 < argc) {
+            synthetic_sizes.push_back((uint32_t)strtoul(argv[++i], NULL, 10));
+        } else if (starts_with(arg, "--")) {
+            usage();
+            return 1;
+        } else {
+            TestImage image = { arg, {}, false };
+            if (!read_file(arg.c_str(), &image.data)) {
+                fprintf(stderr, "%s: cannot read file\n", arg.c_str());
+                return 1;
+            }
+            image.png = image.data.size() >= 4 && !memcmp(image.data.data(), "\x89PNG", 4);
+            images.push_back(std::move(image));
+        }
+    }
+    if (images.empty() && synthetic_sizes.empty()) {
+        usage();
+        return 1;
+    }
+
+    for (uint32_t size : synthetic_sizes) {
+        if (!size || size > 65535) {
+            usage();
+            return 1;
+        }
+        // Odd sizes so partial MCUs at the edges get exercised.
+        uint32_t width         = size - 3;
+        uint32_t height        = size * 3 / 4 + 5;
+        std::vector<uint8_t> rgb = synthetic_rgb(width, height);
+        for (int subsample = 0; subsample < 2; subsample++) {
+            for (int restart = 0; restart < 2; restart++) {
+                uint32_t mcu_row = (width + (subsample ? 15 : 7)) / (subsample ? 16 : 8);
+                TestImage image  = { "synthetic " + std::to_string(width) + "x" + std::to_string(height)
+                        + (subsample ? " 4:2:0" : " 4:4:4") + (restart ? " restart" : ""),
+                    encode_jpeg(rgb.data(), width, height, subsample, restart ? mcu_row : 0), false };
+                images.push_back(std::move(image));
+            }
+        }
+
+        // Alpha and grey made up from the RGB.
+        static const char* const png_kinds[5] = { "", "grey", "grey alpha", "RGB", "RGBA" };
+        std::vector<uint8_t> pixels((size_t)width * height * 4);
+        for (uint32_t channels = 1; channels <= 4; channels++) {
+            for (size_t i = 0; i < (size_t)width * height; i++) {
+                const uint8_t* p = &rgb[i * 3];
+                uint8_t* out     = &pixels[i * channels];
+                if (channels <= 2) { out[0] = (uint8_t)((p[0] + p[1] * 2 + p[2]) / 4); }
+                if (channels >= 3) { memcpy(out, p, 3); }
+                if (channels % 2 == 0) { out[channels - 1] = (uint8_t)(p[0] ^ p[2]); }
+            }
+            TestImage image = { "synthetic " + std::to_string(width) + "x" + std::to_string(height) + " PNG "
+                    + png_kinds[channels],
+                encode_png(pixels.data(), width, height, channels), true };
+            images.push_back(std::move(image));
+        }
+    }
+
+    JobPool* jobs = job_pool_create(threads);
+    printf("%u worker thread(s), best of %u\n", job_pool_thread_count(jobs), iterations);
+    bool ok = true;
+    for (const TestImage& image : images) {
+        ok = check(&image, jobs, iterations) && ok;
+    }
+    job_pool_destroy(jobs);
+    return ok ? 0 : 1;
+}
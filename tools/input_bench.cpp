@@ -0,0 +1,252 @@
+/* Checks the input queue and latency tracker, then benchmarks the queue with a producer and a consumer thread. */
+/* Covers coalescing of moves, raw motion and wheel, ordering against keys, overflow accounting, SPSC ordering across */
+/* threads and the latency stats. Returns non-zero when a check fails. Usage: input_bench [--events 4000000] */
+
+#include "input_queue.h"
+#include "tool_common.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+static void usage() { fprintf(stderr, "usage: input_bench [--events 4000000]\n"); }
+
+static void push(InputQueue* queue, InputEventType type, uint32_t code, float x, float y, uint64_t timestamp_ns)
+{
+    InputEvent event   = {};
+    event.timestamp_ns = timestamp_ns;
+    event.type         = type;
+    event.code         = code;
+    event.x            = x;
+    event.y            = y;
+    input_queue_push(queue, &event);
+}
+
+static bool pop_expect(InputQueue* queue, InputEventType type, float x, float y, uint32_t count, uint64_t timestamp_ns)
+{
+    InputEvent event;
+    if (!input_queue_pop(queue, &event)) { return fail("coalescing: an event is missing"); }
+    if (event.type != type || event.x != x || event.y != y || event.count != count
+        || event.timestamp_ns != timestamp_ns) {
+        fprintf(stderr, "coalescing: got type %d at %g, %g x%u from %llu, expected type %d at %g, %g x%u from %llu\n",
+            event.type, event.x, event.y, event.count, (unsigned long long)event.timestamp_ns, type, x, y, count,
+            (unsigned long long)timestamp_ns);
+        return false;
+    }
+    return true;
+}
+
+static bool check_stats(InputQueue* queue, uint64_t pushed, uint64_t published, uint64_t coalesced, uint64_t dropped)
+{
+    InputQueueStats stats = input_queue_stats(queue);
+    if (stats.pushed != pushed || stats.published != published || stats.coalesced != coalesced
+        || stats.dropped != dropped) {
+        fprintf(stderr, "stats: %llu pushed, %llu published, %llu coalesced, %llu dropped; expected %llu, %llu, %llu, "
+                        "%llu\n",
+            (unsigned long long)stats.pushed, (unsigned long long)stats.published, (unsigned long long)stats.coalesced,
+            (unsigned long long)stats.dropped, (unsigned long long)pushed, (unsigned long long)published,
+            (unsigned long long)coalesced, (unsigned long long)dropped);
+        return false;
+    }
+    return true;
+}
+
+// Moves keep the latest position, raw motion and wheel are summed, all three keep their earliest timestamp and are
+// held back until a key or button or a flush, and come out oldest first.
+static bool check_coalescing()
+{
+    InputQueue* queue = input_queue_create(64);
+    InputEvent event;
+
+    push(queue, INPUT_MOUSE_MOVE, 0, 10.0f, 20.0f, 100);
+    push(queue, INPUT_MOUSE_RAW, 0, 1.0f, -1.0f, 110);
+    push(queue, INPUT_MOUSE_MOVE, 0, 11.0f, 21.0f, 120);
+    push(queue, INPUT_MOUSE_WHEEL, 0, 0.0f, 1.0f, 130);
+    push(queue, INPUT_MOUSE_RAW, 0, 2.0f, -3.0f, 140);
+    push(queue, INPUT_MOUSE_MOVE, 0, 12.0f, 22.0f, 150);
+    push(queue, INPUT_MOUSE_WHEEL, 0, 0.0f, 2.0f, 160);
+    bool ok = !input_queue_pop(queue, &event) || fail("coalescing: motion was published before a flush");
+
+    // A key flushes the motion before it, and motion after it starts a new event.
+    push(queue, INPUT_KEY_DOWN, 'W', 0.0f, 0.0f, 170);
+    push(queue, INPUT_MOUSE_MOVE, 0, 13.0f, 23.0f, 180);
+    push(queue, INPUT_MOUSE_DOWN, INPUT_MOUSE_LEFT, 13.0f, 23.0f, 190);
+    push(queue, INPUT_MOUSE_MOVE, 0, 14.0f, 24.0f, 200);
+    input_queue_flush(queue);
+
+    ok = ok && pop_expect(queue, INPUT_MOUSE_MOVE, 12.0f, 22.0f, 3, 100);
+    ok = ok && pop_expect(queue, INPUT_MOUSE_RAW, 3.0f, -4.0f, 2, 110);
+    ok = ok && pop_expect(queue, INPUT_MOUSE_WHEEL, 0.0f, 3.0f, 2, 130);
+    ok = ok && pop_expect(queue, INPUT_KEY_DOWN, 0.0f, 0.0f, 1, 170);
+    ok = ok && pop_expect(queue, INPUT_MOUSE_MOVE, 13.0f, 23.0f, 1, 180);
+    ok = ok && pop_expect(queue, INPUT_MOUSE_DOWN, 13.0f, 23.0f, 1, 190);
+    ok = ok && pop_expect(queue, INPUT_MOUSE_MOVE, 14.0f, 24.0f, 1, 200);
+    ok = ok && (!input_queue_pop(queue, &event) || fail("coalescing: more events than were published"));
+    ok = ok && check_stats(queue, 11, 7, 4, 0);
+
+    input_queue_destroy(queue);
+    return ok;
+}
+
+// A full ring drops new events and counts them, and keeps the ones the consumer has not seen yet.
+static bool check_overflow()
+{
+    InputQueue* queue = input_queue_create(6); // rounded up to 8
+    for (uint32_t i = 0; i < 20; i++) { push(queue, INPUT_KEY_DOWN, i, 0.0f, 0.0f, i + 1); }
+    bool ok = check_stats(queue, 20, 8, 0, 12);
+
+    InputEvent event;
+    for (uint32_t i = 0; i < 8 && ok; i++) {
+        if (!input_queue_pop(queue, &event) || event.code != i) { ok = fail("overflow: lost an event already queued"); }
+    }
+    ok = ok && (!input_queue_pop(queue, &event) || fail("overflow: a dropped event was queued"));
+
+    // Room again once the consumer has caught up.
+    push(queue, INPUT_KEY_UP, 99, 0.0f, 0.0f, 100);
+    ok = ok && input_queue_pop(queue, &event) && event.code == 99;
+    ok = ok && check_stats(queue, 21, 9, 0, 12);
+    input_queue_destroy(queue);
+    return ok;
+}
+
+// Latency is measured per frame from the oldest input consumed to the present; frames without input are not samples.
+static bool check_latency()
+{
+    InputLatency latency;
+    input_latency_reset(&latency);
+    InputEvent event = {};
+
+    bool ok = !input_latency_present(&latency, 1000000) || fail("latency: a frame without input was counted");
+
+    // 300 frames of 1-300ms, the oldest of three events per frame; only the last 256 are kept.
+    for (uint32_t frame = 1; frame <= 300; frame++) {
+        uint64_t present = frame * 1000000000ull;
+        for (uint32_t i = 0; i < 3; i++) {
+            event.timestamp_ns = present - (frame - i * (frame / 3)) * 1000000ull;
+            input_latency_consume(&latency, &event);
+        }
+        ok = ok && (input_latency_present(&latency, present) || fail("latency: a frame with input was not counted"));
+    }
+
+    InputLatencyStats stats = input_latency_stats(&latency);
+    float mean              = (45.0f + 300.0f) / 2.0f;
+    if (ok && (stats.frames != 300 || stats.last_ms != 300.0f || fabsf(stats.mean_ms - mean) > 0.01f
+            || stats.max_ms != 300.0f || stats.p95_ms != 45.0f + 243.0f)) {
+        fprintf(stderr, "latency: %llu frames, last %g, mean %g, p95 %g, max %g\n", (unsigned long long)stats.frames,
+            stats.last_ms, stats.mean_ms, stats.p95_ms, stats.max_ms);
+        ok = false;
+    }
+    return ok;
+}
+
+typedef struct Threaded {
+    InputQueue* queue;
+    uint32_t events;
+    std::atomic<bool> done;
+    uint64_t popped;
+    uint64_t keys;
+    bool in_order;
+} Threaded;
+
+// Every fourth event is a key carrying its sequence number, the rest are mouse moves carrying theirs, so the consumer
+// can check that keys arrive in order and no move is reordered around a key.
+static void produce(Threaded* threaded)
+{
+    for (uint32_t i = 0; i < threaded->events; i++) {
+        InputEvent event   = {};
+        event.timestamp_ns = i + 1;
+        event.type         = i % 4 == 3 ? INPUT_KEY_DOWN : INPUT_MOUSE_MOVE;
+        event.code         = i;
+        event.x            = (float)i;
+        input_queue_push(threaded->queue, &event);
+    }
+    input_queue_flush(threaded->queue);
+    threaded->done.store(true, std::memory_order_release);
+}
+
+static void consume(Threaded* threaded)
+{
+    uint64_t last_timestamp = 0;
+    int64_t last_key        = -1;
+    InputEvent event;
+    for (;;) {
+        bool done = threaded->done.load(std::memory_order_acquire);
+        while (input_queue_pop(threaded->queue, &event)) {
+            threaded->popped++;
+            if (event.timestamp_ns <= last_timestamp) { threaded->in_order = false; }
+            last_timestamp = event.timestamp_ns;
+            if (event.type == INPUT_KEY_DOWN) {
+                if ((int64_t)event.code <= last_key) { threaded->in_order = false; }
+                last_key = event.code;
+                threaded->keys++;
+            } else if (event.x < (float)last_key || (uint32_t)event.x % 4 == 3) {
+                threaded->in_order = false;
+            }
+        }
+        if (done) { return; }
+    }
+}
+
+// The producer pushes as fast as it can while the consumer drains as fast as it can. With a ring large enough to
+// absorb scheduling hiccups nothing is dropped; either way everything published is popped once and in order.
+static bool benchmark(uint32_t events)
+{
+    Threaded threaded = {};
+    threaded.queue    = input_queue_create(1u << 16);
+    threaded.events   = events;
+    threaded.in_order = true;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer(consume, &threaded);
+    std::thread producer(produce, &threaded);
+    producer.join();
+    consumer.join();
+    double ms = elapsed_ms(start);
+
+    InputQueueStats stats = input_queue_stats(threaded.queue);
+    bool ok               = true;
+    if (!threaded.in_order) { ok = fail("threads: events were popped out of order"); }
+    if (stats.pushed != events || stats.pushed != stats.published + stats.coalesced + stats.dropped) {
+        ok = fail("threads: pushed events do not add up to published, coalesced and dropped ones");
+    }
+    if (threaded.popped != stats.published) { ok = fail("threads: popped a different number of events"); }
+    if (!stats.dropped && threaded.keys != events / 4) { ok = fail("threads: lost keys without counting drops"); }
+    if (ok) {
+        printf("%u events across two threads in %.1fms, %.1f ns per event: %llu published, %llu coalesced, %llu "
+               "dropped\n",
+            events, ms, ms * 1e6 / events, (unsigned long long)stats.published, (unsigned long long)stats.coalesced,
+            (unsigned long long)stats.dropped);
+    }
+    input_queue_destroy(threaded.queue);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t events = 4000000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--events" && i + 1 < argc) {
+            events = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!events) {
+        usage();
+        return 1;
+    }
+
+    bool ok = check_coalescing();
+    ok      = check_overflow() && ok;
+    ok      = check_latency() && ok;
+    if (ok) { printf("coalescing, overflow and latency checks passed\n"); }
+    ok = benchmark(events) && ok;
+    return ok ? 0 : 1;
+}
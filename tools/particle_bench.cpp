@@ -0,0 +1,183 @@
+/* Benchmarks the particle simulation on its own, without any GL: update and write to memory, at steady state. */
+/* Usage: particle_bench [--particles 1000000] [--emitters 4] [--frames 300] [--threads 0] [--no-instances] */
+
+#include "job_pool.h"
+#include "particle_system.h"
+#include "tool_common.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define FRAME_DT (1.0f / 60.0f)
+#define LIFE_MIN 1.5f
+#define LIFE_MAX 2.5f
+
+// Longer than any particle lives, so the emitters have settled into replacing what expires.
+#define WARMUP_FRAMES 240
+
+static void usage()
+{
+    fprintf(stderr, "usage: particle_bench [--particles 1000000] [--emitters 4] [--frames 300] [--threads 0] "
+                    "[--no-instances]\n");
+}
+
+// Emitters spread over a 1920x1080 screen, with every force turned on, emitting at the rate that keeps them full.
+static void create_emitters(ParticleSystem* system, uint32_t particles, uint32_t emitters)
+{
+    for (uint32_t i = 0; i < emitters; i++) {
+        ParticleEmitterDesc desc = { 0 };
+        desc.max_particles       = particles / emitters + (i < particles % emitters ? 1 : 0);
+        desc.rate                = desc.max_particles / ((LIFE_MIN + LIFE_MAX) * 0.5f);
+        desc.x                   = 1920.0f * (i + 0.5f) / emitters;
+        desc.y                   = 900.0f;
+        desc.radius              = 20.0f;
+        desc.direction           = -1.5708f;
+        desc.spread              = 0.6f;
+        desc.speed_min           = 200.0f;
+        desc.speed_max           = 500.0f;
+        desc.life_min            = LIFE_MIN;
+        desc.life_max            = LIFE_MAX;
+        desc.gravity_y           = 300.0f;
+        desc.drag                = 0.2f;
+        desc.attractor_x         = 960.0f;
+        desc.attractor_y         = 300.0f;
+        desc.attractor_strength  = 50.0f;
+        desc.colors[0]           = { 0.0f, 0xFF40C0FFu };
+        desc.colors[1]           = { 0.5f, 0xC02060FFu };
+        desc.colors[2]           = { 1.0f, 0x00100020u };
+        desc.color_count         = 3;
+        desc.sizes[0]            = { 0.0f, 2.0f };
+        desc.sizes[1]            = { 1.0f, 8.0f };
+        desc.size_count          = 2;
+        desc.seed                = i + 1;
+        particle_emitter_create(system, &desc);
+    }
+}
+
+// Everything written is something a vertex shader can use.
+static bool check_instances(const ParticleInstance* instances, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const ParticleInstance* p = &instances[i];
+        if (!std::isfinite(p->x) || !std::isfinite(p->y) || !(p->size >= 2.0f && p->size <= 8.0f)) {
+            fprintf(stderr, "instance %u is broken: %g, %g, size %g\n", i, p->x, p->y, p->size);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Batches are seeded independently of the threads that run them, so the instances should be the same bytes whatever
+// the thread count.
+static bool check_deterministic(JobPool* jobs)
+{
+    std::vector<ParticleInstance> instances[2];
+    uint32_t counts[2] = { 0, 0 };
+    for (int run = 0; run < 2; run++) {
+        ParticleSystemDesc desc = { 0 };
+        desc.jobs               = run ? jobs : NULL;
+        desc.batch_size         = 1000;
+        ParticleSystem* system  = particle_system_create(&desc);
+        create_emitters(system, 50000, 3);
+        instances[run].resize(50000);
+        ParticleDraw draws[3];
+        for (uint32_t frame = 0; frame < 150; frame++) {
+            counts[run] = particle_system_update(system, FRAME_DT);
+            particle_system_write(system, instances[run].data(), draws, 3);
+        }
+        particle_system_destroy(system);
+    }
+    bool same = counts[0] == counts[1]
+        && memcmp(instances[0].data(), instances[1].data(), counts[0] * sizeof(ParticleInstance)) == 0;
+    if (!same) { fprintf(stderr, "instances differ between one thread and the pool\n"); }
+    return same;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t particles = 1000000;
+    uint32_t emitters  = 4;
+    uint32_t frames    = 300;
+    uint32_t threads   = 0;
+    bool write         = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--particles" && i + 1 < argc) {
+            particles = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--emitters" && i + 1 < argc) {
+            emitters = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--no-instances") {
+            write = false;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!emitters || particles < emitters || !frames) {
+        usage();
+        return 1;
+    }
+
+    JobPool* jobs = job_pool_create(threads);
+    printf("%u worker thread(s) and the caller, %u particles in %u emitters\n", job_pool_thread_count(jobs), particles,
+        emitters);
+    bool ok = check_deterministic(jobs);
+
+    ParticleSystemDesc desc = { 0 };
+    desc.jobs               = jobs;
+    ParticleSystem* system  = particle_system_create(&desc);
+    create_emitters(system, particles, emitters);
+    std::vector<ParticleInstance> instances(particles);
+    std::vector<ParticleDraw> draws(emitters);
+
+    double update_total = 0.0, write_total = 0.0, best = 1e9, worst = 0.0;
+    uint64_t live_total = 0;
+    for (uint32_t frame = 0; frame < WARMUP_FRAMES + frames && ok; frame++) {
+        auto start     = std::chrono::steady_clock::now();
+        uint32_t count = particle_system_update(system, FRAME_DT);
+        double update  = elapsed_ms(start);
+        start          = std::chrono::steady_clock::now();
+        particle_system_write(system, write ? instances.data() : NULL, draws.data(), emitters);
+        double written = elapsed_ms(start);
+
+        if (count != particle_system_stats(system).live) {
+            fprintf(stderr, "frame %u: update promised %u instances, %u are live\n", frame, count,
+                particle_system_stats(system).live);
+            ok = false;
+        }
+        if (frame < WARMUP_FRAMES) { continue; }
+        update_total += update;
+        write_total += written;
+        best  = update + written < best ? update + written : best;
+        worst = update + written > worst ? update + written : worst;
+        live_total += count;
+        if (frame + 1 == WARMUP_FRAMES + frames && write) { ok = check_instances(instances.data(), count) && ok; }
+    }
+
+    if (ok) {
+        ParticleSystemStats stats = particle_system_stats(system);
+        double live               = (double)live_total / frames;
+        double frame_ms           = (update_total + write_total) / frames;
+        printf("%.0f live on average, %llu emitted, %llu expired, %llu dropped\n", live,
+            (unsigned long long)stats.emitted, (unsigned long long)stats.expired, (unsigned long long)stats.dropped);
+        printf("update %.3fms + write %.3fms = %.3fms per frame (best %.3fms, worst %.3fms)\n", update_total / frames,
+            write_total / frames, frame_ms, best, worst);
+        printf("%.2f ns per particle, %.1f M particles/s%s\n", frame_ms * 1e6 / live, live / frame_ms / 1000.0,
+            write ? "" : ", instances not written");
+    }
+
+    particle_system_destroy(system);
+    job_pool_destroy(jobs);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+/* Checks the texture residency policy without any GL, by replaying draw requests against a budget and applying the */
+/* ops it plans, then times planning frames for thousands of textures. Returns non-zero when a check fails. */
+/* Usage: residency_bench [--textures 4096] [--frames 300] */
+
+#include "mip_chain.h"
+#include "texture_residency.h"
+#include "tool_common.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define MIB (1024ull * 1024)
+#define TAIL_DIMENSION 64
+#define MAX_OPS 65536
+
+static void usage() { fprintf(stderr, "usage: residency_bench [--textures 4096] [--frames 300]\n"); }
+
+// A residency manager and the square RGBA textures registered with it, with the mips the applied ops left resident.
+typedef struct Scene {
+    ResidencyDesc desc;
+    TextureResidency* residency;
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> tops;
+    ResidencyMetrics metrics;
+    double update_ms;
+} Scene;
+
+static void scene_init(Scene* scene, uint64_t budget_bytes, uint64_t max_upload_bytes)
+{
+    scene->desc                            = {};
+    scene->desc.budget_bytes               = budget_bytes;
+    scene->desc.max_upload_bytes_per_frame = max_upload_bytes;
+    scene->desc.tail_dimension             = TAIL_DIMENSION;
+    scene->residency                       = residency_create(&scene->desc);
+    scene->metrics                         = {};
+    scene->update_ms                       = 0.0;
+}
+
+static uint32_t scene_add(Scene* scene, uint32_t size)
+{
+    uint32_t id = residency_register_texture(scene->residency, size, size, 4, 0);
+    if (id >= scene->sizes.size()) {
+        scene->sizes.resize(id + 1);
+        scene->tops.resize(id + 1);
+    }
+    scene->sizes[id] = size;
+    scene->tops[id]  = mip_count_for_size(size, size);
+    return id;
+}
+
+static uint32_t tail_mip(uint32_t size)
+{
+    uint32_t mip = 0;
+    while ((size >> mip) > TAIL_DIMENSION) { mip++; }
+    return mip;
+}
+
+static void request(Scene* scene, uint32_t texture, uint32_t screen_size)
+{
+    residency_request_texture(scene->residency, texture, screen_size, screen_size);
+}
+
+// Plans a frame, applies its ops and checks what the policy guarantees every frame: mips are loaded coarse to fine and
+// evicted fine to coarse one at a time, tails are never evicted, the budget is never exceeded, and only the first mip
+// streamed in a frame may take it over the upload limit.
+static bool scene_update(Scene* scene)
+{
+    static ResidencyOp ops[MAX_OPS];
+    auto start     = std::chrono::steady_clock::now();
+    uint32_t count = residency_update(scene->residency, ops, MAX_OPS);
+    scene->update_ms += elapsed_ms(start);
+
+    uint64_t streamed_bytes = 0;
+    uint32_t streamed       = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const ResidencyOp* op = &ops[i];
+        if (op->texture >= scene->sizes.size()) {
+            fprintf(stderr, "op for unknown texture %u\n", op->texture);
+            return false;
+        }
+        uint32_t size = scene->sizes[op->texture];
+        uint32_t* top = &scene->tops[op->texture];
+        if (op->type == RESIDENCY_OP_LOAD_MIP) {
+            if (op->mip + 1 != *top) {
+                fprintf(stderr, "texture %u loaded mip %u on top of mip %u\n", op->texture, op->mip, *top);
+                return false;
+            }
+            *top = op->mip;
+            if (op->mip < tail_mip(size)) {
+                streamed_bytes += mip_level_size(size, size, 4, op->mip);
+                streamed++;
+            }
+        } else {
+            if (op->mip != *top || op->mip >= tail_mip(size)) {
+                fprintf(stderr, "texture %u evicted mip %u with mip %u on top\n", op->texture, op->mip, *top);
+                return false;
+            }
+            *top = op->mip + 1;
+        }
+    }
+    if (streamed > 1 && streamed_bytes > scene->desc.max_upload_bytes_per_frame) {
+        fprintf(stderr, "streamed %u mips, %llu bytes, over the upload limit\n", streamed,
+            (unsigned long long)streamed_bytes);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < scene->sizes.size(); i++) {
+        if (residency_texture_top_mip(scene->residency, i) != scene->tops[i]) {
+            fprintf(stderr, "texture %u reports mip %u on top, the ops left mip %u\n", i,
+                residency_texture_top_mip(scene->residency, i), scene->tops[i]);
+            return false;
+        }
+    }
+    residency_get_metrics(scene->residency, &scene->metrics);
+    if (scene->metrics.used_bytes > scene->desc.budget_bytes) {
+        fprintf(stderr, "%llu bytes resident over a budget of %llu\n", (unsigned long long)scene->metrics.used_bytes,
+            (unsigned long long)scene->desc.budget_bytes);
+        return false;
+    }
+    return true;
+}
+
+// More textures on screen than fit: they all sharpen until the budget is full and then hold still, with the buffers
+// counted against the budget too.
+static bool check_budget()
+{
+    Scene scene;
+    scene_init(&scene, 24 * MIB, 4 * MIB);
+    residency_register_buffer(scene.residency, 2 * MIB);
+    for (uint32_t i = 0; i < 8; i++) { scene_add(&scene, 1024); }
+
+    bool ok = true;
+    for (uint32_t frame = 0; frame < 60 && ok; frame++) {
+        for (uint32_t i = 0; i < 8; i++) { request(&scene, i, 1024); }
+        ok = scene_update(&scene);
+        if (ok && frame >= 50 && (scene.metrics.loads_last_frame || scene.metrics.evictions_last_frame)) {
+            ok = fail("budget: visible textures are still loading or evicting after settling");
+        }
+    }
+    for (uint32_t i = 0; i < 8 && ok; i++) {
+        if (scene.tops[i] && scene.metrics.used_bytes + mip_level_size(1024, 1024, 4, scene.tops[i] - 1)
+                <= scene.desc.budget_bytes) {
+            ok = fail("budget: settled with room for another mip");
+        }
+    }
+    if (ok && !scene.metrics.textures_waiting) { ok = fail("budget: every texture got everything it asked for"); }
+    residency_destroy(scene.residency);
+    return ok;
+}
+
+// When a new texture comes on screen, the room comes from the texture that has been off screen the longest, not from
+// the ones still drawn.
+static bool check_lru()
+{
+    Scene scene;
+    uint64_t full = 0;
+    for (uint32_t mip = 0; mip < mip_count_for_size(1024, 1024); mip++) { full += mip_level_size(1024, 1024, 4, mip); }
+    // Room for three textures and the tail of a fourth.
+    scene_init(&scene, 3 * full + 64 * 1024, 64 * MIB);
+    uint32_t old_a = scene_add(&scene, 1024);
+    uint32_t old_b = scene_add(&scene, 1024);
+    uint32_t kept  = scene_add(&scene, 1024);
+    uint32_t fresh = scene_add(&scene, 1024);
+
+    bool ok = true;
+    for (uint32_t frame = 0; frame < 10 && ok; frame++) {
+        if (frame < 5) { request(&scene, old_a, 1024); }
+        request(&scene, old_b, 1024);
+        request(&scene, kept, 1024);
+        ok = scene_update(&scene);
+    }
+    if (ok && (scene.tops[old_a] || scene.tops[old_b] || scene.tops[kept])) { ok = fail("lru: did not stream in"); }
+
+    for (uint32_t frame = 0; frame < 10 && ok; frame++) {
+        request(&scene, kept, 1024);
+        request(&scene, fresh, 1024);
+        ok = scene_update(&scene);
+    }
+    if (ok && (scene.tops[kept] || scene.tops[fresh])) { ok = fail("lru: visible textures did not keep mip 0"); }
+    if (ok && scene.tops[old_a] == 0) { ok = fail("lru: the least recently used texture kept its top mip"); }
+    if (ok && scene.tops[old_b] != 0) { ok = fail("lru: evicted from a more recently used texture first"); }
+    residency_destroy(scene.residency);
+    return ok;
+}
+
+// Textures that go off screen stop streaming, so two of them that do not both fit do not evict each other's top mips
+// every frame. Coming back on screen picks up where they left off.
+static bool check_off_screen()
+{
+    Scene scene;
+    scene_init(&scene, 8 * MIB, 64 * MIB);
+    uint32_t a = scene_add(&scene, 1024);
+    uint32_t b = scene_add(&scene, 1024);
+
+    bool ok = true;
+    for (uint32_t frame = 0; frame < 10 && ok; frame++) {
+        request(&scene, a, 1024);
+        request(&scene, b, 1024);
+        ok = scene_update(&scene);
+    }
+    uint64_t loads = scene.metrics.total_loads, evictions = scene.metrics.total_evictions;
+    for (uint32_t frame = 0; frame < 30 && ok; frame++) { ok = scene_update(&scene); }
+    if (ok && (scene.metrics.total_loads != loads || scene.metrics.total_evictions != evictions)) {
+        fprintf(stderr, "off screen: %llu loads and %llu evictions with nothing drawn\n",
+            (unsigned long long)(scene.metrics.total_loads - loads),
+            (unsigned long long)(scene.metrics.total_evictions - evictions));
+        ok = false;
+    }
+    if (ok && scene.metrics.textures_waiting) { ok = fail("off screen: textures still waiting for mips"); }
+
+    for (uint32_t frame = 0; frame < 10 && ok; frame++) {
+        request(&scene, a, 1024);
+        ok = scene_update(&scene);
+    }
+    if (ok && scene.tops[a] != 0) { ok = fail("off screen: did not stream back in"); }
+    residency_destroy(scene.residency);
+    return ok;
+}
+
+// A budget too small for every tail loads as many as fit, most recently used first, counts the frames as over
+// budget, and loads the rest once the budget grows.
+static bool check_tails()
+{
+    Scene scene;
+    scene_init(&scene, 1 * MIB, 64 * MIB);
+    for (uint32_t i = 0; i < 100; i++) { scene_add(&scene, 256); }
+    uint64_t tail = 0;
+    for (uint32_t mip = tail_mip(256); mip < mip_count_for_size(256, 256); mip++) {
+        tail += mip_level_size(256, 256, 4, mip);
+    }
+
+    bool ok = scene_update(&scene) && scene_update(&scene);
+    uint32_t loaded = 0;
+    for (uint32_t i = 0; i < 100 && ok; i++) { loaded += scene.tops[i] <= tail_mip(256); }
+    if (ok && loaded != scene.desc.budget_bytes / tail) {
+        fprintf(stderr, "tails: %u of 100 tails loaded where %llu fit\n", loaded,
+            (unsigned long long)(scene.desc.budget_bytes / tail));
+        ok = false;
+    }
+    if (ok && scene.metrics.over_budget_frames != 2) { ok = fail("tails: frames short of tails were not counted"); }
+    if (ok && scene.tops[99] > tail_mip(256)) { ok = fail("tails: the most recently registered texture waited"); }
+
+    residency_set_budget(scene.residency, 4 * MIB);
+    scene.desc.budget_bytes = 4 * MIB;
+    ok = ok && scene_update(&scene);
+    for (uint32_t i = 0; i < 100 && ok; i++) {
+        if (scene.tops[i] != tail_mip(256)) { ok = fail("tails: did not load once the budget grew"); }
+    }
+
+    // Nothing is resident for a texture that is gone or was never registered, so it must not report mip 0.
+    residency_unregister_texture(scene.residency, 0);
+    if (ok && residency_texture_top_mip(scene.residency, 0) != RESIDENCY_NO_MIP) {
+        ok = fail("tails: an unregistered texture reports a resident mip");
+    }
+    if (ok && residency_texture_top_mip(scene.residency, 100) != RESIDENCY_NO_MIP) {
+        ok = fail("tails: an id that was never registered reports a resident mip");
+    }
+    residency_destroy(scene.residency);
+    return ok;
+}
+
+// Thousands of textures from 64 to 2048 texels, a random quarter of them drawn each frame at random sizes, against the
+// default budget.
+static bool benchmark(uint32_t texture_count, uint32_t frames)
+{
+    Scene scene;
+    scene_init(&scene, 256 * MIB, 16 * MIB);
+    uint32_t state = 0x9E3779B9u;
+    for (uint32_t i = 0; i < texture_count; i++) { scene_add(&scene, 64u << next_random(&state) % 6); }
+
+    bool ok          = scene_update(&scene);
+    scene.update_ms  = 0.0;
+    uint64_t loads   = scene.metrics.total_loads;
+    uint64_t evicted = scene.metrics.total_evictions;
+    double worst     = 0.0;
+    for (uint32_t frame = 0; frame < frames && ok; frame++) {
+        for (uint32_t i = 0; i < texture_count / 4; i++) {
+            request(&scene, next_random(&state) % texture_count, 16u << next_random(&state) % 8);
+        }
+        double before = scene.update_ms;
+        ok            = scene_update(&scene);
+        worst         = scene.update_ms - before > worst ? scene.update_ms - before : worst;
+    }
+    if (ok) {
+        printf("%u textures, %u drawn per frame: update %.3fms (worst %.3fms), %.1f loads and %.1f evictions per "
+               "frame, %.1f of %.1f MiB used\n",
+            texture_count, texture_count / 4, scene.update_ms / frames, worst,
+            (double)(scene.metrics.total_loads - loads) / frames,
+            (double)(scene.metrics.total_evictions - evicted) / frames, scene.metrics.used_bytes / (double)MIB,
+            scene.desc.budget_bytes / (double)MIB);
+    }
+    residency_destroy(scene.residency);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t textures = 4096;
+    uint32_t frames   = 300;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--textures" && i + 1 < argc) {
+            textures = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!textures || !frames) {
+        usage();
+        return 1;
+    }
+
+    bool ok = check_budget();
+    ok      = check_lru() && ok;
+    ok      = check_off_screen() && ok;
+    ok      = check_tails() && ok;
+    if (ok) { printf("budget, LRU, off screen and tail checks passed\n"); }
+    ok = benchmark(textures, frames) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/* Build step that turns the GLSL files under shaders/ into a header of ready-to-compile variants. */
+/* Usage: shader_embed --glsl-version "330 core" --root shaders --output shaders.h [--used usage.txt] files... */
+
+#include "shader_preprocess.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+typedef struct ShaderFile {
+    std::string name;
+    std::string ident;
+    ShaderPreprocessed preprocessed;
+} ShaderFile;
+
+static bool starts_with(const std::string& s, const char* prefix) { return s.compare(0, strlen(prefix), prefix) == 0; }
+
+static std::string make_ident(const std::string& name)
+{
+    std::string ident = name;
+    for (char& c : ident) {
+        if (!isalnum((unsigned char)c)) { c = '_'; }
+    }
+    if (!ident.empty() && isdigit((unsigned char)ident[0])) { ident = "_" + ident; }
+    return ident;
+}
+
+static std::string upper(std::string s)
+{
+    for (char& c : s) {
+        c = (char)toupper((unsigned char)c);
+    }
+    return s;
+}
+
+static void write_string_literal(FILE* out, const std::string& s)
+{
+    fprintf(out, "    \"");
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        switch (c) {
+        case '\n':
+            fprintf(out, i + 1 < s.size() ? "\\n\"\n    \"" : "\\n");
+            break;
+        case '\t':
+            fprintf(out, "\\t");
+            break;
+        case '"':
+            fprintf(out, "\\\"");
+            break;
+        case '\\':
+            fprintf(out, "\\\\");
+            break;
+        case '\r':
+            break;
+        default:
+            fputc(c, out);
+            break;
+        }
+    }
+    fprintf(out, "\"");
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: shader_embed --glsl-version <version> --output <header> [--root <dir>] [--used <file>] shaders...\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string glsl_version, output, root, used_path;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--glsl-version" && i + 1 < argc) {
+            glsl_version = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--root" && i + 1 < argc) {
+            root = argv[++i];
+            if (!root.empty() && root.back() != '/' && root.back() != '\\') { root += '/'; }
+        } else if (arg == "--used" && i + 1 < argc) {
+            used_path = argv[++i];
+        } else if (starts_with(arg, "--")) {
+            usage();
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (glsl_version.empty() || output.empty() || inputs.empty()) {
+        usage();
+        return 1;
+    }
+
+    // Without a usage file every variant is kept. With one, only the variants listed in it are embedded.
+    bool prune = false;
+    std::set<std::pair<std::string, uint32_t>> used;
+    if (!used_path.empty()) {
+        std::ifstream file(used_path);
+        if (file) {
+            prune = true;
+            std::string name;
+            uint32_t mask;
+            while (file >> name >> mask) {
+                used.insert({ name, mask });
+            }
+        }
+    }
+
+    std::vector<ShaderFile> shaders;
+    uint32_t total_variants = 0;
+    for (const std::string& input : inputs) {
+        ShaderFile shader;
+        shader.name  = starts_with(input, root.c_str()) ? input.substr(root.size()) : input;
+        shader.ident = make_ident(shader.name);
+
+        if (!shader_preprocess(input.c_str(), &shader.preprocessed)) {
+            fprintf(stderr, "%s\n", shader.preprocessed.error);
+            return 1;
+        }
+        total_variants += 1u << shader.preprocessed.define_count;
+        shaders.push_back(shader);
+    }
+
+    if (total_variants > SHADER_USAGE_MAX) {
+        fprintf(stderr, "%u variants, more than the %d the usage table can track\n", total_variants, SHADER_USAGE_MAX);
+        return 1;
+    }
+
+    FILE* out = fopen(output.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "%s: cannot write file\n", output.c_str());
+        return 1;
+    }
+
+    fprintf(out, "// Generated by shader_embed for GLSL %s. Do not edit.\n\n", glsl_version.c_str());
+    fprintf(out, "#pragma once\n\n#include \"shader_variants.h\"\n");
+
+    uint32_t usage_index = 0;
+    for (ShaderFile& shader : shaders) {
+        const ShaderPreprocessed* preprocessed = &shader.preprocessed;
+        uint32_t variant_count                 = 1u << preprocessed->define_count;
+        std::string prefix                     = upper(shader.ident);
+
+        fprintf(out, "\n// %s\n\n", shader.name.c_str());
+        for (uint32_t i = 0; i < preprocessed->define_count; i++) {
+            fprintf(out, "#define %s_%s (1u << %u)\n", prefix.c_str(), preprocessed->defines[i], i);
+        }
+        if (preprocessed->define_count) { fprintf(out, "\n"); }
+
+        std::vector<std::pair<bool, std::string>> variants;
+        for (uint32_t mask = 0; mask < variant_count; mask++) {
+            bool keep = !prune || used.count({ shader.name, mask }) != 0;
+            if (!keep) {
+                variants.push_back({ false, std::string() });
+                continue;
+            }
+
+            char* variant = shader_preprocess_variant(preprocessed, glsl_version.c_str(), mask, NULL);
+            std::string source(variant);
+            free(variant);
+            variants.push_back({ true, source });
+
+            fprintf(out, "SHADER_DATA char %s_%u[] =\n", shader.ident.c_str(), mask);
+            write_string_literal(out, source);
+            fprintf(out, ";\n\n");
+        }
+
+        fprintf(out, "static const char* const %s_defines[] = {", shader.ident.c_str());
+        if (!preprocessed->define_count) { fprintf(out, " NULL"); }
+        for (uint32_t i = 0; i < preprocessed->define_count; i++) {
+            fprintf(out, "%s \"%s\"", i ? "," : "", preprocessed->defines[i]);
+        }
+        fprintf(out, " };\n\n");
+
+        fprintf(out, "SHADER_DATA ShaderVariant %s_variants[] = {\n", shader.ident.c_str());
+        for (uint32_t mask = 0; mask < variant_count; mask++) {
+            if (variants[mask].first) {
+                fprintf(out, "    { %s_%u, %zu, 0x%016llxull },\n", shader.ident.c_str(), mask,
+                    variants[mask].second.size(),
+                    (unsigned long long)shader_source_hash(variants[mask].second.c_str(), variants[mask].second.size()));
+            } else {
+                fprintf(out, "    { NULL, 0, 0 },\n");
+            }
+        }
+        fprintf(out, "};\n\n");
+
+        fprintf(out, "SHADER_DATA ShaderSource %s = { \"%s\", %s_defines, %u, %u, %s_variants };\n",
+            shader.ident.c_str(), shader.name.c_str(), shader.ident.c_str(), preprocessed->define_count, usage_index,
+            shader.ident.c_str());
+        usage_index += variant_count;
+        shader_preprocess_free(&shader.preprocessed);
+    }
+
+    fprintf(out, "\nstatic const ShaderSource* const shader_sources[] = {\n");
+    for (const ShaderFile& shader : shaders) {
+        fprintf(out, "    &%s,\n", shader.ident.c_str());
+    }
+    fprintf(out, "};\n\n#define SHADER_SOURCE_COUNT %zu\n", shaders.size());
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "%s: cannot write file\n", output.c_str());
+        return 1;
+    }
+
+    return 0;
+}
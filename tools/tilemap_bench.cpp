@@ -0,0 +1,196 @@
+/* Benchmarks tilemap chunk rebuilds on their own, without any GL: baking a whole map, then a camera panning over it */
+/* while tiles change. Usage: tilemap_bench [--size 4096] [--chunk 32] [--edits 64] [--frames 600] [--threads 0] */
+
+#include "job_pool.h"
+#include "tilemap.h"
+#include "tool_common.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define TILE_PIXELS 16.0f
+#define ATLAS_COLUMNS 8
+#define ATLAS_ROWS 8
+#define SCREEN_WIDTH 1920.0f
+#define SCREEN_HEIGHT 1080.0f
+#define SCREEN_TILES_X 120
+#define SCREEN_TILES_Y 67
+#define PAN_PIXELS 6.0f
+
+static void usage()
+{
+    fprintf(stderr, "usage: tilemap_bench [--size 4096] [--chunk 32] [--edits 64] [--frames 600] [--threads 0]\n");
+}
+
+// Mostly filled, with some empty stretches and some tiles past the end of the tileset, which are drawn as nothing.
+static uint64_t fill_map(Tilemap* map, uint32_t size)
+{
+    uint32_t state = 0x9E3779B9u;
+    uint64_t drawn = 0;
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint32_t r = next_random(&state) % 100;
+            Tile tile  = r < 10 ? TILE_EMPTY : r < 12 ? (Tile)1000 : (Tile)(1 + r % (ATLAS_COLUMNS * ATLAS_ROWS));
+            tilemap_set(map, x, y, tile);
+            drawn += tile != TILE_EMPTY && tile <= ATLAS_COLUMNS * ATLAS_ROWS;
+        }
+    }
+    return drawn;
+}
+
+// Rebuilt quads should be exactly the chunk's tiles.
+static bool check_draw(const Tilemap* map, const TilemapDraw* draw)
+{
+    for (uint32_t i = 0; i < draw->quad_count; i++) {
+        const TileVertex* quad = &draw->vertices[i * 4];
+        Tile tile              = tilemap_get(map, quad[0].x, quad[0].y);
+        bool square = quad[2].x == quad[0].x + 1 && quad[2].y == quad[0].y + 1 && quad[1].y == quad[0].y
+            && quad[3].x == quad[0].x;
+        if (tile == TILE_EMPTY || tile > ATLAS_COLUMNS * ATLAS_ROWS || !square || quad[0].u >= quad[2].u) {
+            fprintf(stderr, "quad %u at %u, %u does not match tile %u\n", i, quad[0].x, quad[0].y, tile);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t size       = 4096;
+    uint32_t chunk_size = 32;
+    uint32_t edits      = 64;
+    uint32_t frames     = 600;
+    uint32_t threads    = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            size = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            chunk_size = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--edits" && i + 1 < argc) {
+            edits = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (size < 128 || size > 65535 || !chunk_size || chunk_size > 64 || !frames) {
+        usage();
+        return 1;
+    }
+
+    // The bake steps a camera of 8 x 8 chunks across the map, so it has to fit them all.
+    JobPool* jobs      = job_pool_create(threads);
+    TilemapDesc desc   = { 0 };
+    desc.jobs          = jobs;
+    desc.width         = size;
+    desc.height        = size;
+    desc.tile_size     = TILE_PIXELS;
+    desc.chunk_size    = chunk_size;
+    desc.max_resident  = 256;
+    desc.atlas_columns = ATLAS_COLUMNS;
+    desc.atlas_rows    = ATLAS_ROWS;
+    Tilemap* map       = tilemap_create(&desc);
+    TilemapStats info  = tilemap_stats(map);
+    std::vector<TilemapDraw> draws(info.chunks);
+    printf("%u worker thread(s) and the caller, %ux%u tiles (%.1f M) in %u chunks of %u tiles\n",
+        job_pool_thread_count(jobs), size, size, size * (double)size / 1e6, info.chunks, chunk_size * chunk_size);
+
+    auto start        = std::chrono::steady_clock::now();
+    uint64_t drawable = fill_map(map, size);
+    printf("filled in %.1fms\n", elapsed_ms(start));
+
+    // Every chunk is built exactly once, 64 at a time.
+    float step       = TILE_PIXELS * chunk_size * 8;
+    double bake_ms   = 0.0;
+    uint64_t quads   = 0;
+    uint32_t batches = 0;
+    bool ok          = true;
+    for (float y = 0.0f; y < size * TILE_PIXELS && ok; y += step) {
+        for (float x = 0.0f; x < size * TILE_PIXELS && ok; x += step) {
+            start          = std::chrono::steady_clock::now();
+            uint32_t count = tilemap_update(map, x, y, step, step, draws.data(), (uint32_t)draws.size());
+            bake_ms += elapsed_ms(start);
+            batches++;
+            for (uint32_t i = 0; i < count && ok; i++) {
+                ok = draws[i].vertices && check_draw(map, &draws[i]);
+                quads += draws[i].quad_count;
+            }
+        }
+    }
+    if (ok && quads != drawable) {
+        fprintf(stderr, "baked %llu quads for %llu drawable tiles\n", (unsigned long long)quads,
+            (unsigned long long)drawable);
+        ok = false;
+    }
+    if (ok) {
+        printf("baked every chunk in %.1fms over %u updates, %.2f ns per tile, %.1f us per chunk\n", bake_ms, batches,
+            bake_ms * 1e6 / ((double)size * size), bake_ms * 1e3 / info.chunks);
+    }
+
+    // A screen sized camera on the same spot twice: nothing changed, so nothing is rebuilt.
+    tilemap_update(map, 100.0f, 100.0f, SCREEN_WIDTH, SCREEN_HEIGHT, draws.data(), (uint32_t)draws.size());
+    tilemap_update(map, 100.0f, 100.0f, SCREEN_WIDTH, SCREEN_HEIGHT, draws.data(), (uint32_t)draws.size());
+    if (ok && tilemap_stats(map).rebuilt) {
+        fprintf(stderr, "a still camera over an unchanged map rebuilt %u chunks\n", tilemap_stats(map).rebuilt);
+        ok = false;
+    }
+
+    // Panning diagonally and bouncing off the edges, changing random tiles on screen every frame.
+    float camera_x = 0.0f, camera_y = 0.0f, dx = PAN_PIXELS, dy = PAN_PIXELS * 0.5f;
+    float max_x = size * TILE_PIXELS - SCREEN_WIDTH, max_y = size * TILE_PIXELS - SCREEN_HEIGHT;
+    uint32_t state  = 12345;
+    double total_ms = 0.0, worst = 0.0;
+    uint64_t rebuilt = 0, drawn = 0;
+    for (uint32_t frame = 0; frame < frames && ok; frame++) {
+        for (uint32_t i = 0; i < edits; i++) {
+            uint32_t x = (uint32_t)(camera_x / TILE_PIXELS) + next_random(&state) % SCREEN_TILES_X;
+            uint32_t y = (uint32_t)(camera_y / TILE_PIXELS) + next_random(&state) % SCREEN_TILES_Y;
+            tilemap_set(map, x, y, (Tile)(1 + next_random(&state) % (ATLAS_COLUMNS * ATLAS_ROWS)));
+        }
+
+        start          = std::chrono::steady_clock::now();
+        uint32_t count = tilemap_update(
+            map, camera_x, camera_y, SCREEN_WIDTH, SCREEN_HEIGHT, draws.data(), (uint32_t)draws.size());
+        double ms = elapsed_ms(start);
+        total_ms += ms;
+        worst = ms > worst ? ms : worst;
+
+        TilemapStats stats = tilemap_stats(map);
+        rebuilt += stats.rebuilt;
+        drawn += count;
+        for (uint32_t i = 0; i < count && ok; i++) {
+            if (draws[i].vertices) { ok = check_draw(map, &draws[i]); }
+        }
+        if (stats.skipped) {
+            fprintf(stderr, "frame %u skipped %u visible chunks\n", frame, stats.skipped);
+            ok = false;
+        }
+
+        camera_x += dx;
+        camera_y += dy;
+        if (camera_x < 0.0f || camera_x > max_x) { dx = -dx, camera_x += 2 * dx; }
+        if (camera_y < 0.0f || camera_y > max_y) { dy = -dy, camera_y += 2 * dy; }
+    }
+
+    if (ok) {
+        TilemapStats stats = tilemap_stats(map);
+        printf("panning with %u edits per frame: %.3fms per frame (worst %.3fms), %.1f chunks rebuilt and %.1f drawn "
+               "per frame, %llu evictions\n",
+            edits, total_ms / frames, worst, (double)rebuilt / frames, (double)drawn / frames,
+            (unsigned long long)stats.evictions);
+    }
+
+    tilemap_destroy(map);
+    job_pool_destroy(jobs);
+    return ok ? 0 : 1;
+}
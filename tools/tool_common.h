@@ -0,0 +1,28 @@
+#pragma once
+
+// Helpers shared by the benchmarks and test drivers in tools/.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+inline double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reports a failed check, for `ok = fail("what went wrong")`.
+inline bool fail(const char* check)
+{
+    fprintf(stderr, "%s\n", check);
+    return false;
+}
+
+// xorshift32, so test data is the same on every run and platform. The state must not start at zero.
+inline uint32_t next_random(uint32_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
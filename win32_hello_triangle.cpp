@@ -80,6 +80,7 @@ int WINAPI WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmd_line, int cmd_show)
     state.height       = 576;
 
     state.window = create_window(inst, state.width, state.height, "Hello Triangle");
+    SetWindowLongPtr(state.window, GWLP_USERDATA, (LONG_PTR)&state);
     state.dc     = GetDC(state.window);
     state.rc     = init_opengl(state.dc);
     if (!init(&state)) { fatal_error("Failed to initialise user data."); }
@@ -263,6 +264,15 @@ static LRESULT CALLBACK window_callback(HWND window, UINT msg, WPARAM wparam, LP
     LRESULT result = 0;
 
     switch (msg) {
+    case WM_SIZE: {
+        // draw() sets the viewport from these every frame, so there is nothing else to resize.
+        TargetState* state = (TargetState*)GetWindowLongPtr(window, GWLP_USERDATA);
+        if (state) {
+            state->width  = LOWORD(lparam);
+            state->height = HIWORD(lparam);
+        }
+        break;
+    }
     case WM_CLOSE:
         DestroyWindow(window);
         break;